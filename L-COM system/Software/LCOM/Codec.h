@@ -0,0 +1,222 @@
+#ifndef INC_CODEC_H_
+#define INC_CODEC_H_
+
+#include <Arduino.h>
+#include <string.h>
+
+
+/*-------------------------------------------------------------------------*\
+|								  Definitions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*
+     * Set to 1 for hosts that predate fixed point, every FIX field then goes on the wire as an IEEE float
+     * in its display unit (e.g. MHz for a kHz field) and soft-float is linked back in to convert it.
+     * Generate_schemas.py takes --float-payloads to match.
+     */
+    #ifndef FLOAT_PAYLOADS
+    #define FLOAT_PAYLOADS                  0
+    #endif
+
+    /*
+     * A payload is described once, as a schema, an X-macro listing its fields in wire order as X(type, name).
+     * The macros below expand a schema into its struct, its length, and an encoder and decoder that are
+     * straight-line big-endian stores and loads at constant offsets. Python GUI/Generate_schemas.py reads
+     * the same schemas (Schemas.h) to write the GUI's field lists, so add new types in both places.
+     */
+
+    /* Field types, as their size on the wire */
+    #define CODEC_SIZE_U8                   1
+    #define CODEC_SIZE_I8                   1
+    #define CODEC_SIZE_U16                  2
+    #define CODEC_SIZE_I16                  2
+    #define CODEC_SIZE_U32                  4
+    #define CODEC_SIZE_I32                  4
+    #define CODEC_SIZE_F32                  4                       // IEEE 754 single
+
+    /* Fixed point, FIX<n> is an integer in units of 10^-n of the value shown to the user */
+    #if FLOAT_PAYLOADS
+    #define CODEC_SIZE_FIX0_U32             4
+    #define CODEC_SIZE_FIX1_U16             4
+    #define CODEC_SIZE_FIX2_I16             4
+    #define CODEC_SIZE_FIX3_U32             4
+    #else
+    #define CODEC_SIZE_FIX0_U32             4
+    #define CODEC_SIZE_FIX1_U16             2
+    #define CODEC_SIZE_FIX2_I16             2
+    #define CODEC_SIZE_FIX3_U32             4
+    #endif
+
+    /* Schema expansions */
+    #define CODEC_MEMBER(type, name)        codec_##type name;
+    #define CODEC_FIELD_SIZE(type, name)    + CODEC_SIZE_##type
+    #define CODEC_PUT(type, name)           p = codecPut_##type(p, s.name);
+    #define CODEC_GET(type, name)           p = codecGet_##type(p, &s->name);
+
+    /* Bytes on the wire for a schema */
+    #define CODEC_LEN(SCHEMA)               (0 SCHEMA(CODEC_FIELD_SIZE))
+
+    /* Declares the struct for a schema, members in wire order */
+    #define CODEC_STRUCT(Name, SCHEMA)      struct Name{ SCHEMA(CODEC_MEMBER) };
+
+    /*
+     * Defines encode<Name> and decode<Name>. Each takes a pointer to the first byte of the payload and
+     * returns a pointer to the byte after it, so payloads can follow one another.
+     */
+    #define CODEC_FUNCTIONS(Name, SCHEMA)                                                           \
+        inline uint8_t* encode##Name(uint8_t* p, const Name& s){ SCHEMA(CODEC_PUT) return p; }      \
+        inline const uint8_t* decode##Name(const uint8_t* p, Name* s){ SCHEMA(CODEC_GET) return p; }
+
+
+/*-------------------------------------------------------------------------*\
+|								     Types					   			    |
+\*-------------------------------------------------------------------------*/
+
+
+    typedef uint8_t     codec_U8;
+    typedef int8_t      codec_I8;
+    typedef uint16_t    codec_U16;
+    typedef int16_t     codec_I16;
+    typedef uint32_t    codec_U32;
+    typedef int32_t     codec_I32;
+    typedef float       codec_F32;
+    typedef uint32_t    codec_FIX0_U32;
+    typedef uint16_t    codec_FIX1_U16;
+    typedef int16_t     codec_FIX2_I16;
+    typedef uint32_t    codec_FIX3_U32;
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       codecPut_<type>                                                         |
+    |   Purpose:    Writes a field big-endian. Floats are copied bitwise with memcpy,       |
+    |               never punned through a pointer cast.                                    |
+    |   Arguments:  uint8_t*, <C type>                                                      |
+    |   Returns:    uint8_t* (the byte after the field)                                     |
+    \*-------------------------------------------------------------------------------------*/
+    inline uint8_t* codecPut_U8(uint8_t* p, uint8_t v){
+        p[0] = v;
+        return p + 1;
+    }
+    inline uint8_t* codecPut_I8(uint8_t* p, int8_t v){
+        return codecPut_U8(p, (uint8_t)v);
+    }
+    inline uint8_t* codecPut_U16(uint8_t* p, uint16_t v){
+        p[0] = v >> 8;
+        p[1] = v;
+        return p + 2;
+    }
+    inline uint8_t* codecPut_I16(uint8_t* p, int16_t v){
+        return codecPut_U16(p, (uint16_t)v);
+    }
+    inline uint8_t* codecPut_U32(uint8_t* p, uint32_t v){
+        p[0] = v >> 24;
+        p[1] = v >> 16;
+        p[2] = v >> 8;
+        p[3] = v;
+        return p + 4;
+    }
+    inline uint8_t* codecPut_I32(uint8_t* p, int32_t v){
+        return codecPut_U32(p, (uint32_t)v);
+    }
+    inline uint8_t* codecPut_F32(uint8_t* p, float v){
+        static_assert(sizeof(float) == sizeof(uint32_t), "F32 fields need a 32-bit float");
+        uint32_t bits;
+        memcpy(&bits, &v, sizeof(bits));
+        return codecPut_U32(p, bits);
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       codecGet_<type>                                                         |
+    |   Purpose:    Reads a big-endian field.                                               |
+    |   Arguments:  const uint8_t*, <C type>*                                               |
+    |   Returns:    const uint8_t* (the byte after the field)                               |
+    \*-------------------------------------------------------------------------------------*/
+    inline const uint8_t* codecGet_U8(const uint8_t* p, uint8_t* v){
+        *v = p[0];
+        return p + 1;
+    }
+    inline const uint8_t* codecGet_I8(const uint8_t* p, int8_t* v){
+        *v = (int8_t)p[0];
+        return p + 1;
+    }
+    inline const uint8_t* codecGet_U16(const uint8_t* p, uint16_t* v){
+        *v = ((uint16_t)p[0] << 8) | p[1];
+        return p + 2;
+    }
+    inline const uint8_t* codecGet_I16(const uint8_t* p, int16_t* v){
+        *v = (int16_t)(((uint16_t)p[0] << 8) | p[1]);
+        return p + 2;
+    }
+    inline const uint8_t* codecGet_U32(const uint8_t* p, uint32_t* v){
+        *v = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+        return p + 4;
+    }
+    inline const uint8_t* codecGet_I32(const uint8_t* p, int32_t* v){
+        uint32_t bits;
+        p = codecGet_U32(p, &bits);
+        *v = (int32_t)bits;
+        return p;
+    }
+    inline const uint8_t* codecGet_F32(const uint8_t* p, float* v){
+        uint32_t bits;
+        p = codecGet_U32(p, &bits);
+        memcpy(v, &bits, sizeof(bits));
+        return p;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       codecPut_FIX<n>_<type>, codecGet_FIX<n>_<type>                          |
+    |   Purpose:    Fixed-point fields, sent as the integer itself, or with FLOAT_PAYLOADS  |
+    |               as a float scaled down by 10^n and rounded back on the way in.          |
+    |   Arguments:  As codecPut_<type>, codecGet_<type>                                     |
+    |   Returns:    As codecPut_<type>, codecGet_<type>                                     |
+    \*-------------------------------------------------------------------------------------*/
+    #if FLOAT_PAYLOADS
+    inline uint8_t* codecPut_FIX0_U32(uint8_t* p, uint32_t v){ return codecPut_F32(p, (float)v); }
+    inline uint8_t* codecPut_FIX1_U16(uint8_t* p, uint16_t v){ return codecPut_F32(p, v / 10.0f); }
+    inline uint8_t* codecPut_FIX2_I16(uint8_t* p, int16_t v){ return codecPut_F32(p, v / 100.0f); }
+    inline uint8_t* codecPut_FIX3_U32(uint8_t* p, uint32_t v){ return codecPut_F32(p, v / 1000.0f); }
+
+    inline const uint8_t* codecGet_FIX0_U32(const uint8_t* p, uint32_t* v){
+        float f;
+        p = codecGet_F32(p, &f);
+        *v = (f > 0) ? (uint32_t)(f + 0.5f) : 0;
+        return p;
+    }
+    inline const uint8_t* codecGet_FIX1_U16(const uint8_t* p, uint16_t* v){
+        float f;
+        p = codecGet_F32(p, &f);
+        *v = (f > 0) ? (uint16_t)(f*10.0f + 0.5f) : 0;
+        return p;
+    }
+    inline const uint8_t* codecGet_FIX2_I16(const uint8_t* p, int16_t* v){
+        float f;
+        p = codecGet_F32(p, &f);
+        *v = (int16_t)(f*100.0f + ((f < 0) ? -0.5f : 0.5f));
+        return p;
+    }
+    inline const uint8_t* codecGet_FIX3_U32(const uint8_t* p, uint32_t* v){
+        float f;
+        p = codecGet_F32(p, &f);
+        *v = (f > 0) ? (uint32_t)(f*1000.0f + 0.5f) : 0;
+        return p;
+    }
+    #else
+    inline uint8_t* codecPut_FIX0_U32(uint8_t* p, uint32_t v){ return codecPut_U32(p, v); }
+    inline uint8_t* codecPut_FIX1_U16(uint8_t* p, uint16_t v){ return codecPut_U16(p, v); }
+    inline uint8_t* codecPut_FIX2_I16(uint8_t* p, int16_t v){ return codecPut_I16(p, v); }
+    inline uint8_t* codecPut_FIX3_U32(uint8_t* p, uint32_t v){ return codecPut_U32(p, v); }
+
+    inline const uint8_t* codecGet_FIX0_U32(const uint8_t* p, uint32_t* v){ return codecGet_U32(p, v); }
+    inline const uint8_t* codecGet_FIX1_U16(const uint8_t* p, uint16_t* v){ return codecGet_U16(p, v); }
+    inline const uint8_t* codecGet_FIX2_I16(const uint8_t* p, int16_t* v){ return codecGet_I16(p, v); }
+    inline const uint8_t* codecGet_FIX3_U32(const uint8_t* p, uint32_t* v){ return codecGet_U32(p, v); }
+    #endif
+
+#endif /* INC_CODEC_H_ */
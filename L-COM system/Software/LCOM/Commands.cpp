@@ -4,7 +4,82 @@
 */
 
 
+#include <avr/pgmspace.h>
 #include "Commands.h"
+#include "SerialInterface.h"
+
+
+/*-------------------------------------------------------------------------*\
+|								 Command table				   			    |
+\*-------------------------------------------------------------------------*/
+
+
+    /* Unused opcodes, so every entry sits at the index of its own opcode */
+    #define NO_COMMAND(op)                  { op, NULL, 0, 0, 0 }
+
+    /*
+     * One entry per opcode, in opcode order. The dispatcher checks the payload length against the bounds
+     * and presets the return length before calling the handler, so a handler only has to check what depends
+     * on its content, and only has to set the return length when it returns less than the most.
+     */
+    constexpr CommandEntry commandTable[] PROGMEM = {
+        /*  Opcode                      Handler                 Min payload length                  Max payload length                                              Return length */
+        {   SET_LORA_PARAMETERS,        setLoRaParameters,      SET_LORA_PARAMETERS_PAYLOAD_LEN,    SET_LORA_PARAMETERS_PAYLOAD_LEN,                                0 },
+        {   SET_UNIX,                   setUnix,                SET_UNIX_PAYLOAD_LEN,               SET_UNIX_MS_PAYLOAD_LEN,                                        0 },
+        {   SET_MODE_MESSAGE,           setModeMessage,         SET_MODE_MESSAGE_PAYLOAD_LEN,       SET_MODE_MESSAGE_PAYLOAD_LEN,                                   0 },
+        {   SET_LISTEN_BEFORE_TALK,     setListenBeforeTalk,    SET_LISTEN_BEFORE_TALK_PAYLOAD_LEN, SET_LISTEN_BEFORE_TALK_PAYLOAD_LEN,                             0 },
+        {   SET_HOPPING_PARAMETERS,     setHoppingParameters,   SET_HOPPING_PARAMETERS_PAYLOAD_LEN, SET_HOPPING_PARAMETERS_PAYLOAD_LEN + 4*HOP_MAX_CHANNELS,        0 },
+        {   DEFINE_RADIO_PROFILE,       defineRadioProfile,     DEFINE_RADIO_PROFILE_PAYLOAD_LEN,   DEFINE_RADIO_PROFILE_PAYLOAD_LEN,                               0 },
+        {   ACTIVATE_RADIO_PROFILE,     activateRadioProfile,   ACTIVATE_RADIO_PROFILE_PAYLOAD_LEN, ACTIVATE_RADIO_PROFILE_PAYLOAD_LEN,                             0 },
+        {   SET_BOOT_PROFILE,           setBootProfile,         SET_BOOT_PROFILE_PAYLOAD_LEN,       SET_BOOT_PROFILE_PAYLOAD_LEN,                                   0 },
+        {   SET_HEADER_EXTENSION,       setHeaderExtension,     SET_HEADER_EXTENSION_PAYLOAD_LEN,   SET_HEADER_EXTENSION_PAYLOAD_LEN,                               0 },
+        {   SET_TIME_SYNC,              setTimeSync,            SET_TIME_SYNC_PAYLOAD_LEN,          SET_TIME_SYNC_PAYLOAD_LEN,                                      0 },
+        {   SET_TRACE,                  setTrace,               SET_TRACE_PAYLOAD_LEN,              SET_TRACE_PAYLOAD_LEN,                                          0 },
+        {   SET_TELEMETRY,              setTelemetry,           SET_TELEMETRY_PAYLOAD_LEN,          SET_TELEMETRY_PAYLOAD_LEN,                                      0 },
+        {   SET_IMU,                    setImu,                 SET_IMU_PAYLOAD_LEN,                SET_IMU_PAYLOAD_LEN,                                            0 },
+        {   SET_IMU_SUMMARY,            setImuSummary,          SET_IMU_SUMMARY_PAYLOAD_LEN,        SET_IMU_SUMMARY_PAYLOAD_LEN,                                    0 },
+        {   SET_STORE_FORWARD,          setStoreForward,        SET_STORE_FORWARD_PAYLOAD_LEN,      SET_STORE_FORWARD_PAYLOAD_LEN,                                  0 },
+        NO_COMMAND(0x0F),
+        {   GET_LORA_PARAMETERS,        getLoRaParameters,      GET_LORA_PARAMETERS_PAYLOAD_LEN,    GET_LORA_PARAMETERS_PAYLOAD_LEN,                                GET_LORA_PARAMETERS_RETURN_LEN },
+        {   GET_UNIX,                   getUnix,                GET_UNIX_PAYLOAD_LEN,               GET_UNIX_PAYLOAD_LEN,                                           GET_UNIX_RETURN_LEN },
+        {   GET_MODE_MESSAGE,           getModeMessage,         GET_MODE_MESSAGE_PAYLOAD_LEN,       GET_MODE_MESSAGE_PAYLOAD_LEN,                                   GET_MODE_MESSAGE_RETURN_LEN },
+        {   GET_MODULE_STATUS,          getModuleStatus,        GET_MODULE_STATUS_PAYLOAD_LEN,      GET_MODULE_STATUS_PAYLOAD_LEN,                                  GET_MODULE_STATUS_RETURN_LEN },
+        {   GET_CHANNEL_STATS,          getChannelStats,        GET_CHANNEL_STATS_PAYLOAD_LEN,      GET_CHANNEL_STATS_PAYLOAD_LEN,                                  GET_CHANNEL_STATS_RETURN_LEN },
+        {   GET_HOPPING_STATS,          getHoppingStats,        GET_HOPPING_STATS_PAYLOAD_LEN,      GET_HOPPING_STATS_PAYLOAD_LEN,                                  GET_HOPPING_STATS_RETURN_LEN },
+        {   GET_RADIO_PROFILES,         getRadioProfiles,       GET_RADIO_PROFILES_PAYLOAD_LEN,     GET_RADIO_PROFILES_PAYLOAD_LEN,                                 GET_RADIO_PROFILES_RETURN_LEN },
+        {   GET_TIME_SYNC_STATUS,       getTimeSyncStatusCmd,   GET_TIME_SYNC_STATUS_PAYLOAD_LEN,   GET_TIME_SYNC_STATUS_PAYLOAD_LEN,                               GET_TIME_SYNC_STATUS_RETURN_LEN },
+        {   GET_TASK_STATS,             getTaskStatsCmd,        GET_TASK_STATS_PAYLOAD_LEN,         GET_TASK_STATS_RESET_PAYLOAD_LEN,                               GET_TASK_STATS_RETURN_LEN },
+        {   GET_PERF_STATS,             getPerfStatsCmd,        GET_PERF_STATS_PAYLOAD_LEN,         GET_PERF_STATS_RESET_PAYLOAD_LEN,                               GET_PERF_STATS_RETURN_LEN },
+        {   GET_COMMAND_STATS,          getCommandStats,        GET_COMMAND_STATS_PAYLOAD_LEN,      GET_COMMAND_STATS_RESET_PAYLOAD_LEN,                            GET_COMMAND_STATS_RETURN_LEN },
+        {   GET_ENERGY_STATUS,          getEnergyStatusCmd,     GET_ENERGY_STATUS_PAYLOAD_LEN,      GET_ENERGY_STATUS_PAYLOAD_LEN,                                  GET_ENERGY_STATUS_RETURN_LEN },
+        {   GET_STORE_FORWARD_STATUS,   getStoreForwardStatusCmd, GET_STORE_FORWARD_STATUS_PAYLOAD_LEN, GET_STORE_FORWARD_STATUS_PAYLOAD_LEN,                     GET_STORE_FORWARD_STATUS_RETURN_LEN },
+        NO_COMMAND(0x1D), NO_COMMAND(0x1E), NO_COMMAND(0x1F),
+        {   RADIO_RESET,                radioReset,             RADIO_RESET_PAYLOAD_LEN,            RADIO_RESET_PAYLOAD_LEN,                                        0 },
+        {   SYSTEM_RESET,               systemReset,            SYSTEM_RESET_PAYLOAD_LEN,           SYSTEM_RESET_PAYLOAD_LEN,                                       0 },
+    };
+    #define COMMAND_TABLE_LEN               (sizeof(commandTable)/sizeof(CommandEntry))
+
+    /* Largest return data an Ack can carry, built over the command in its arena block */
+    #define CMD_MAX_RETURN_LEN              (ARENA_BLOCK_SIZE - ARENA_SERIAL_RX_OFFSET - PKT_HEADROOM - ACK_RESULT_LEN - PKT_TRAILER_LEN)
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       commandTableValid                                                       |
+    |   Purpose:    Compile-time check of the table from entry i on.                        |
+    |   Arguments:  uint8_t                                                                 |
+    |   Returns:    bool                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    constexpr bool commandTableValid(uint8_t i){
+        return i == COMMAND_TABLE_LEN ||
+               (commandTable[i].opcode == i &&
+                (commandTable[i].handler == NULL ||
+                 (commandTable[i].minLen >= 1 && commandTable[i].minLen <= commandTable[i].maxLen &&
+                  commandTable[i].maxLen <= PKT_MAX_LEN - PKT_HEADER_TRAILER_LEN &&
+                  commandTable[i].returnLen <= CMD_MAX_RETURN_LEN)) &&
+                commandTableValid(i + 1));
+    }
+
+    static_assert(commandTableValid(0), "Command table out of opcode order, or a length out of bounds");
+    static_assert(COMMAND_TABLE_LEN == COMMAND_COUNT, "Command table must end at the last opcode");
 
 
 /*-------------------------------------------------------------------------*\
@@ -14,6 +89,9 @@
 
     //uint8_t retBuffer[MAX_COMMAND_LEN];
     uint16_t retBufferLen;
+    #if PERF_ENABLED
+    CommandStats commandStats[COMMAND_TABLE_LEN];                           // Only with the perf probes, GET_COMMAND_STATS reports none without
+    #endif
 
 
 /*-------------------------------------------------------------------------*\
@@ -48,54 +126,72 @@
     |   Returns:    int16_t                                                                 |
     \*-------------------------------------------------------------------------------------*/
     int16_t executeCommand(const uint8_t* buf, uint16_t len, uint8_t* retBuf){ // This whole function may go better in the LCOM file
+
+        /* Reset the return data length */
+        retBufferLen = 0;
+        if(len == 0) return CMD_MALFORMED_PAYLOAD;
         
         // Print command data
-        Serial.printf(F("Received command: %02X\r\n"), buf[CMD_INDEX]);
+        uint8_t opcode = buf[CMD_INDEX];
+        Serial.printf(F("Received command: %02X\r\n"), opcode);
+
+        /* Look the command up, straight from flash by its opcode */
+        CommandEntry entry;
+        if(opcode < COMMAND_TABLE_LEN) memcpy_P(&entry, &commandTable[opcode], sizeof(CommandEntry));
+        if(opcode >= COMMAND_TABLE_LEN || entry.handler == NULL){
+            Serial.println(F("Unknown command."));
+            return CMD_UNKNOWN_COMMAND;
+        }
 
-        /* Clear the return buffer */
-        //for(uint16_t i = 0; i != sizeof(retBuffer); i++) retBuf[i] = 0;
+        /* Check the payload length */
+        if(len < entry.minLen || len > entry.maxLen) return CMD_MALFORMED_PAYLOAD;
 
-        /* Reset the return data length */
-        retBufferLen = 0;
+        /* Execute the associated command, timing it */
+        uint16_t retLen = entry.returnLen;
+        #if PERF_ENABLED
+        uint32_t start = micros();
+        #endif
+        int16_t res = entry.handler(buf, len, retBuf, &retLen);
 
-        /* Execute the associated command */
-        int16_t res = CMD_OK;
-        switch(buf[CMD_INDEX]){
-            case SET_LORA_PARAMETERS:
-                res = setLoRaParameters(buf, len);
-                break;
-            case SET_UNIX:
-                res = setUnix(buf, len);
-                break;
-            case SET_MODE_MESSAGE:
-                res = setModeMessage(buf, len);
-                break;
-            case GET_LORA_PARAMETERS:
-                res = getLoRaParameters(buf, len, retBuf);
-                break;
-            case GET_UNIX:
-                res = getUnix(buf, len, retBuf);
-                break;
-            case GET_MODE_MESSAGE:
-                res = getModeMessage(buf, len, retBuf);
-                break;
-            case GET_MODULE_STATUS:
-                res = getModuleStatus(buf, len, retBuf);
-                break;
-            case RADIO_RESET:
-                res = radioReset(len);
-                break;
-            case SYSTEM_RESET:
-                res = systemReset(len);
-                break;
-            default:
-                res = CMD_UNKNOWN_COMMAND;
-                Serial.println(F("Unknown command."));
-        }
+        /* Statistics, both saturate rather than wrap */
+        #if PERF_ENABLED
+        uint32_t elapsed = micros() - start;
+        CommandStats& stats = commandStats[opcode];
+        if(stats.count != 0xFFFF) stats.count++;
+        if(elapsed > stats.worstMicros) stats.worstMicros = (elapsed > 0xFFFF) ? 0xFFFF : elapsed;
+        #endif
+
+        /* Only a successful command returns data */
+        if(res == CMD_OK) retBufferLen = retLen;
 
         return res;
     }
 
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       validateLoRaParameters                                                  |
+    |   Purpose:    Checks a full set of LoRa parameters against what the SX1262 accepts.   |
+    |   Arguments:  const RadioParameters&                                                  |
+    |   Returns:    int16_t (error code)                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t validateLoRaParameters(const RadioParameters& params){
+        /* The SX1262 only supports these bandwidths (Hz), RadioLib rejects anything else */
+        static const uint32_t validBandwidths[] PROGMEM = {7800, 10400, 15600, 20800, 31250, 41700, 62500, 125000, 250000, 500000};
+        bool bandwidthValid = false;
+        for(uint8_t i = 0; i != sizeof(validBandwidths)/sizeof(validBandwidths[0]); i++){
+            if(params.bandwidth == pgm_read_dword(&validBandwidths[i])) bandwidthValid = true;
+        }
+
+        if(params.frequency < 150000 || params.frequency > 960000)          return CMD_INVALID_FREQUENCY;
+        if(!bandwidthValid)                                                 return CMD_INVALID_BANDWIDTH;
+        if(params.spreadingFactor < 5 || params.spreadingFactor > 12)       return CMD_INVALID_SPREADING_FACTOR;
+        if(params.codingRate < 5 || params.codingRate > 8)                  return CMD_INVALID_CODING_RATE;
+        if(params.syncWord == 0x34)                                         return CMD_INVALID_SYNC_WORD;
+        if(params.power < -17 || params.power > 22)                         return CMD_INVALID_POWER;
+        if(params.preambleLength < 6)                                       return CMD_INVALID_PREAMBLE_LENGTH;     // || preambleLength > 65535 (limited by data type)
+        if(params.currentLimit > 1400)                                      return CMD_INVALID_CURRENT_LIMIT;
+        return CMD_OK;
+    }
+
     /* ---------------------------- Setters ---------------------------- */
 
     /*-------------------------------------------------------------------------------------*\
@@ -105,53 +201,30 @@
     |               Bytes               Field                                               |
     |               -------------------------------------------                             |
     |               0                   Command                                             |
-    |               1-4                 Frequency                                           |
-    |               5-8                 Bandwidth                                           |
+    |               1-4                 Frequency (kHz)                                     |
+    |               5-8                 Bandwidth (Hz)                                      |
     |               9                   Spreading factor                                    |
     |               10                  Coding rate                                         |
     |               11                  Sync word                                           |
     |               12                  Power                                               |
     |               13-14               Preamble length                                     |
-    |               15-18               Current limit                                       |
+    |               15-16               Current limit (0.1 mA)                              |
+    |               (LORA_PARAMETERS_SCHEMA, FLOAT_PAYLOADS sends the old floats)           |
     |                                                                                       |
     |   Returns:    int16_t (error code)                                                    |
     \*-------------------------------------------------------------------------------------*/
-    int16_t setLoRaParameters(const uint8_t* buf, uint16_t len){
-        
-        /* Check to make sure the payload is of the correct size */
-        if(len != SET_LORA_PARAMETERS_PAYLOAD_LEN) return CMD_MALFORMED_PAYLOAD;
+    int16_t setLoRaParameters(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen){
 
-        /* Parameters */            
-        int8_t power;
-        uint8_t spreadingFactor, codingRate, syncWord;
-        uint16_t preambleLength;
-        float frequency, bandwidth, currentLimit;
-        
         /* Get the values from byte string */
-        frequency       = extract_float(buf, 1);
-        bandwidth       = extract_float(buf, 5);
-        spreadingFactor = extract_uint8_t(buf, 9);
-        codingRate      = extract_uint8_t(buf, 10);
-        syncWord        = extract_uint8_t(buf, 11);
-        power           = (int8_t)extract_uint8_t(buf, 12);
-        preambleLength  = extract_uint16_t(buf, 13);
-        currentLimit    = extract_float(buf, 15);
+        RadioParameters params;
+        decodeRadioParameters(buf+1, &params);
         
-        /* Validation checks on the parameters */
-        if(frequency < 150.0 || frequency > 960.0)          return CMD_INVALID_FREQUENCY;
-        if(bandwidth < 0.0 || bandwidth > 510.0)            return CMD_INVALID_BANDWIDTH;
-        if(spreadingFactor < 5 || spreadingFactor > 12)     return CMD_INVALID_SPREADING_FACTOR;
-        if(codingRate < 5 || codingRate > 8)                return CMD_INVALID_CODING_RATE;
-        if(syncWord == 0x34)                                return CMD_INVALID_SYNC_WORD;
-        if(power < -17 || power > 22)                       return CMD_INVALID_POWER;
-        if(preambleLength < 6)                              return CMD_INVALID_PREAMBLE_LENGTH;     // || preambleLength > 65535 (limited by data type)
-        if(currentLimit < 0 || currentLimit > 140)          return CMD_INVALID_CURRENT_LIMIT;
-
-        /* Set the radio parameters */
-        int16_t res = setRadioParameters(frequency, bandwidth, spreadingFactor, codingRate, syncWord, power, preambleLength, currentLimit);
-
-        /* Set the return buffer length */
-        retBufferLen = 0;
+        /* Validate the whole set before anything touches the radio */
+        int16_t res = validateLoRaParameters(params);
+        if(res != CMD_OK) return res;
+
+        /* Set the radio parameters, only the changed ones are written and a failure rolls back */
+        res = setRadioParameters(params);
 
         /* Return the result */
         return res;
@@ -159,19 +232,21 @@
 
     /*-------------------------------------------------------------------------------------*\
     |   Name:       setUNIX                                                                 |
-    |   Purpose:    Set the UNIX timestamp.                                                 |
+    |   Purpose:    Set the UNIX timestamp. With the optional milliseconds, successive      |
+    |               updates are also used to estimate and correct crystal drift.            |
     |   Arguments:  Via buf, uint16_t                                                       |
     |               Bytes               Field                                               |
     |               -------------------------------------------                             |
     |               0                   Command                                             |
     |               1-4                 Timestamp                                           |
+    |               5-6                 Milliseconds (optional)                             |
     |                                                                                       |
     |   Returns:    int16_t (error code)                                                    |
     \*-------------------------------------------------------------------------------------*/
-    int16_t setUnix(const uint8_t* buf, uint16_t len){
+    int16_t setUnix(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen){
 
-        /* Check to make sure the payload is of the correct size */
-        if(len != SET_UNIX_PAYLOAD_LEN) return CMD_MALFORMED_PAYLOAD;
+        /* The table only bounds the length, the milliseconds are all or nothing */
+        if(len != SET_UNIX_PAYLOAD_LEN && len != SET_UNIX_MS_PAYLOAD_LEN) return CMD_MALFORMED_PAYLOAD;
 
         /* Parameters */            
         uint32_t timestamp;
@@ -179,8 +254,15 @@
         /* Get the values from byte string */           
         timestamp = extract_uint32_t(buf, 1);
 
-        /* Set the return buffer length */
-        retBufferLen = 0;
+        /* Set the clock, only millisecond updates are precise enough to estimate drift from */
+        if(len == SET_UNIX_MS_PAYLOAD_LEN){
+            uint16_t milliseconds = extract_uint16_t(buf, 5);
+            if(milliseconds > 999) return CMD_MALFORMED_PAYLOAD;
+            syncUnixTime(timestamp, milliseconds);
+        }
+        else{
+            setUnixTime(timestamp);
+        }
 
         /* Return successful */
         return CMD_OK;
@@ -198,10 +280,7 @@
     |                                                                                       |
     |   Returns:    int16_t (error code)                                                    |
     \*-------------------------------------------------------------------------------------*/
-    int16_t setModeMessage(const uint8_t* buf, uint16_t len){
-
-        /* Check to make sure the payload is of the correct size */
-        if(len != SET_MODE_MESSAGE_PAYLOAD_LEN) return CMD_MALFORMED_PAYLOAD;
+    int16_t setModeMessage(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen){
 
         /* Parameters */            
         uint8_t mode;
@@ -210,14 +289,306 @@
         /* Get the values from byte string */           
         mode = extract_uint8_t(buf, 1);
         //memcpy(message...);
+        (void)mode;                                                 // Not stored yet
 
-        /* Set the return buffer length */
-        retBufferLen = 0;
+        /* Return successful */
+        return CMD_OK;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       setListenBeforeTalk                                                     |
+    |   Purpose:    Enable or disable channel activity detection before each transmission. |
+    |   Arguments:  Via buf, uint16_t                                                       |
+    |               Bytes               Field                                               |
+    |               -------------------------------------------                             |
+    |               0                   Command                                             |
+    |               1                   Enable (0 or 1)                                     |
+    |                                                                                       |
+    |   Returns:    int16_t (error code)                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t setListenBeforeTalk(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen){
+
+        /* Get the values from byte string */
+        uint8_t enable = extract_uint8_t(buf, 1);
+        if(enable > 1) return CMD_MALFORMED_PAYLOAD;
+
+        /* Apply it */
+        setLBTEnabled(enable);
 
         /* Return successful */
         return CMD_OK;
     }
 
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       setHoppingParameters                                                    |
+    |   Purpose:    Enable or disable frequency hopping and load the seed and channel table.|
+    |   Arguments:  Via buf, uint16_t                                                       |
+    |               Bytes               Field                                               |
+    |               -------------------------------------------                             |
+    |               0                   Command                                             |
+    |               1                   Enable (0 or 1)                                     |
+    |               2-3                 Seed                                                |
+    |               4                   Channel count (N, 0 keeps the current table)        |
+    |               5-(4+4N)            Channel frequencies (kHz, 902-928 MHz)              |
+    |                                                                                       |
+    |   Returns:    int16_t (error code)                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t setHoppingParameters(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen){
+
+        /* Parameters */
+        uint8_t enable  = extract_uint8_t(buf, 1);
+        uint16_t seed   = extract_uint16_t(buf, 2);
+        uint8_t count   = extract_uint8_t(buf, 4);
+        uint32_t channels[HOP_MAX_CHANNELS];
+
+        /* Validation checks on the parameters */
+        if(enable > 1) return CMD_MALFORMED_PAYLOAD;
+        if(count > HOP_MAX_CHANNELS) return CMD_INVALID_CHANNEL_PLAN;
+        if(len != SET_HOPPING_PARAMETERS_PAYLOAD_LEN + CODEC_SIZE_FIX3_U32*(uint16_t)count) return CMD_MALFORMED_PAYLOAD;
+        const uint8_t* channel = buf + SET_HOPPING_PARAMETERS_PAYLOAD_LEN;
+        for(uint8_t i = 0; i != count; i++){
+            channel = codecGet_FIX3_U32(channel, &channels[i]);
+            if(channels[i] < 902000 || channels[i] > 928000) return CMD_INVALID_CHANNEL_PLAN;
+        }
+
+        /* Apply them */
+        int16_t res = configureHopping(enable, seed, channels, count);
+
+        /* Return the result */
+        return res;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       defineRadioProfile                                                      |
+    |   Purpose:    Store a named set of LoRa parameters in an EEPROM profile slot.         |
+    |   Arguments:  Via buf, uint16_t                                                       |
+    |               Bytes               Field                                               |
+    |               -------------------------------------------                             |
+    |               0                   Command                                             |
+    |               1                   Profile index                                       |
+    |               2-9                 Name (zero padded)                                  |
+    |               10-25               LoRa parameters (as SET_LORA_PARAMETERS 1-16)       |
+    |                                                                                       |
+    |   Returns:    int16_t (error code)                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t defineRadioProfile(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen){
+
+        /* Get the values from byte string */
+        uint8_t idx = extract_uint8_t(buf, 1);
+        RadioParameters params;
+        decodeRadioParameters(buf+2+PROFILE_NAME_LEN, &params);
+
+        /* Only store sets the radio would accept */
+        int16_t res = validateLoRaParameters(params);
+        if(res != CMD_OK) return res;
+
+        /* Store it */
+        res = defineRadioProfile(idx, (const char*)buf+2, params);
+
+        /* Return the result */
+        return res;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       activateRadioProfile                                                    |
+    |   Purpose:    Apply a stored profile to the radio.                                    |
+    |   Arguments:  Via buf, uint16_t                                                       |
+    |               Bytes               Field                                               |
+    |               -------------------------------------------                             |
+    |               0                   Command                                             |
+    |               1                   Profile index                                       |
+    |                                                                                       |
+    |   Returns:    int16_t (error code)                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t activateRadioProfile(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen){
+
+        /* Load the profile */
+        RadioParameters params;
+        int16_t res = loadRadioProfile(extract_uint8_t(buf, 1), NULL, &params);
+        if(res != ERR_NONE) return res;
+
+        /* Apply it, only the fields that differ from the current set are written */
+        res = setRadioParameters(params);
+
+        /* Return the result */
+        return res;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       setBootProfile                                                          |
+    |   Purpose:    Select the profile the radio comes up on after a reset.                 |
+    |   Arguments:  Via buf, uint16_t                                                       |
+    |               Bytes               Field                                               |
+    |               -------------------------------------------                             |
+    |               0                   Command                                             |
+    |               1                   Profile index (0xFF for the defaults)               |
+    |                                                                                       |
+    |   Returns:    int16_t (error code)                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t setBootProfile(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen){
+
+        /* Store the selector */
+        int16_t res = setBootProfile(extract_uint8_t(buf, 1));
+
+        /* Return the result */
+        return res;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       setHeaderExtension                                                      |
+    |   Purpose:    Enable or disable the millisecond field in outgoing packet headers.     |
+    |   Arguments:  Via buf, uint16_t                                                       |
+    |               Bytes               Field                                               |
+    |               -------------------------------------------                             |
+    |               0                   Command                                             |
+    |               1                   Enable (0 or 1)                                     |
+    |                                                                                       |
+    |   Returns:    int16_t (error code)                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t setHeaderExtension(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen){
+
+        /* Get the values from byte string */
+        uint8_t enable = extract_uint8_t(buf, 1);
+        if(enable > 1) return CMD_MALFORMED_PAYLOAD;
+
+        /* Apply it, the Ack for this command already uses the new header */
+        setHeaderExtension(enable);
+
+        /* Return successful */
+        return CMD_OK;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       setTimeSync                                                             |
+    |   Purpose:    Set the over-the-air time sync role and beacon period.                  |
+    |   Arguments:  Via buf, uint16_t                                                       |
+    |               Bytes               Field                                               |
+    |               -------------------------------------------                             |
+    |               0                   Command                                             |
+    |               1                   Mode (0 off, 1 master, 2 slave)                     |
+    |               2-3                 Beacon period (s)                                   |
+    |                                                                                       |
+    |   Returns:    int16_t (error code)                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t setTimeSync(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen){
+
+        /* Apply it */
+        int16_t res = configureTimeSync(extract_uint8_t(buf, 1), extract_uint16_t(buf, 2));
+
+        /* Return the result */
+        return res;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       setTrace                                                                |
+    |   Purpose:    Enable or disable latency tracing of outgoing messages. The receiving   |
+    |               module follows each traced message with a trace packet.                 |
+    |   Arguments:  Via buf, uint16_t                                                       |
+    |               Bytes               Field                                               |
+    |               -------------------------------------------                             |
+    |               0                   Command                                             |
+    |               1                   Enable (0 or 1)                                     |
+    |                                                                                       |
+    |   Returns:    int16_t (error code)                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t setTrace(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen){
+
+        /* Get the values from byte string */
+        uint8_t enable = extract_uint8_t(buf, 1);
+        if(enable > 1) return CMD_MALFORMED_PAYLOAD;
+
+        /* Apply it */
+        setTraceEnabled(enable);
+
+        /* Return successful */
+        return CMD_OK;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       setTelemetry                                                            |
+    |   Purpose:    Set where the module's own telemetry records (IMU, etc.) are sent.      |
+    |   Arguments:  Via buf, uint16_t                                                       |
+    |               Bytes               Field                                               |
+    |               -------------------------------------------                             |
+    |               0                   Command                                             |
+    |               1                   Destination (0 off, 1 UART, 2 radio)                |
+    |                                                                                       |
+    |   Returns:    int16_t (error code)                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t setTelemetry(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen){
+
+        /* Apply it */
+        int16_t res = setTelemetryDestination(extract_uint8_t(buf, 1));
+
+        /* Return the result */
+        return res;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       setImu                                                                  |
+    |   Purpose:    Start or stop IMU sampling, batched into telemetry records.             |
+    |   Arguments:  Via buf, uint16_t                                                       |
+    |               Bytes               Field                                               |
+    |               -------------------------------------------                             |
+    |               0                   Command                                             |
+    |               1-2                 Sample rate (Hz, 0 stops, must divide 1000)         |
+    |               3                   Samples per record (0-8, 0 for summaries only)      |
+    |                                                                                       |
+    |   Returns:    int16_t (error code)                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t setImu(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen){
+
+        /* Apply it */
+        int16_t res = configureImu(extract_uint16_t(buf, 1), extract_uint8_t(buf, 3));
+
+        /* Return the result */
+        return res;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       setImuSummary                                                           |
+    |   Purpose:    Set the window and fields of the IMU summary telemetry records.         |
+    |   Arguments:  Via buf, uint16_t                                                       |
+    |               Bytes               Field                                               |
+    |               -------------------------------------------                             |
+    |               0                   Command                                             |
+    |               1-2                 Window (ms, 100-60000)                              |
+    |               3                   Fields (IMU_SUMMARY_* bits, 0 off)                  |
+    |                                                                                       |
+    |   Returns:    int16_t (error code)                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t setImuSummary(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen){
+
+        /* Apply it */
+        int16_t res = configureImuSummary(extract_uint16_t(buf, 1), extract_uint8_t(buf, 3));
+
+        /* Return the result */
+        return res;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       setStoreForward                                                         |
+    |   Purpose:    Set whether radio telemetry is stored while the link is down, and how   |
+    |               long without a frame counts as down.                                    |
+    |   Arguments:  Via buf, uint16_t                                                       |
+    |               Bytes               Field                                               |
+    |               -------------------------------------------                             |
+    |               0                   Command                                             |
+    |               1                   Enable (0 transmits everything)                     |
+    |               2-3                 Link timeout (s, 1-65535 while enabled)             |
+    |               4-5                 Store interval (s per record of a type)             |
+    |                                                                                       |
+    |   Returns:    int16_t (error code)                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t setStoreForward(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen){
+
+        /* Apply it */
+        int16_t res = configureStoreForward(extract_uint8_t(buf, 1) != 0, extract_uint16_t(buf, 2), extract_uint16_t(buf, 4));
+
+        /* Return the result */
+        return res;
+    }
+
     /* ---------------------------- Getters ---------------------------- */
 
     /*-------------------------------------------------------------------------------------*\
@@ -230,63 +601,21 @@
     |                                                                                       |
     |   Returns:    int16_t (error code)                                                    |
     \*-------------------------------------------------------------------------------------*/
-    int16_t getLoRaParameters(const uint8_t* buf, uint16_t len, uint8_t* retBuf){
-
-        /* Check to make sure the payload is of the correct size */
-        if(len != GET_LORA_PARAMETERS_PAYLOAD_LEN) return CMD_MALFORMED_PAYLOAD;
-        
-        /* Buffer for the float->uint32_t bytes conversion */
-        uint32_t fBytes;
-     
-        /* Parameters */           
-        float frequency         = getFrequency();
-        float bandwidth         = getBandwidth();
-        uint8_t spreadingFactor = getSpreadingFactor();
-        uint8_t codingRate      = getCodingRate();
-        uint8_t syncWord        = getSyncWord();
-        int8_t power            = getPower();
-        uint16_t preambleLength = getPreambleLength();
-        float currentLimit      = getCurrentLim();
-
-        /* Frequency */
-        fBytes = *((uint32_t *) &frequency);
-        retBuf[0] = (fBytes & 0xFF000000) >> 24;
-        retBuf[1] = (fBytes & 0x00FF0000) >> 16;
-        retBuf[2] = (fBytes & 0x0000FF00) >> 8;
-        retBuf[3] = (fBytes & 0x000000FF);
-
-        /* Bandwidth */
-        fBytes = *((uint32_t *) &bandwidth);
-        retBuf[4] = (fBytes & 0xFF000000) >> 24;
-        retBuf[5] = (fBytes & 0x00FF0000) >> 16;
-        retBuf[6] = (fBytes & 0x0000FF00) >> 8;
-        retBuf[7] = (fBytes & 0x000000FF);
-
-        /* Spreading factor */
-        retBuf[8] = spreadingFactor;
-
-        /* Coding rate */
-        retBuf[9] = codingRate;
-
-        /* Sync word   */         
-        retBuf[10] = syncWord;
+    int16_t getLoRaParameters(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen){
         
-        /* Power */
-        retBuf[11] = power;
-        
-        /* Preamble length */
-        retBuf[12] = (preambleLength & 0xFF00) >> 8;
-        retBuf[13] = (preambleLength & 0x00FF);
-
-        /* Current limit */
-        fBytes = *((uint32_t *) &currentLimit);
-        retBuf[14] = (fBytes & 0xFF000000) >> 24;
-        retBuf[15] = (fBytes & 0x00FF0000) >> 16;
-        retBuf[16] = (fBytes & 0x0000FF00) >> 8;
-        retBuf[17] = (fBytes & 0x000000FF);
-
-        /* Set the return buffer length */
-        retBufferLen = GET_LORA_PARAMETERS_RETURN_LEN;
+        /* Parameters */
+        RadioParameters params;
+        params.frequency        = getFrequency();
+        params.bandwidth        = getBandwidth();
+        params.spreadingFactor  = getSpreadingFactor();
+        params.codingRate       = getCodingRate();
+        params.syncWord         = getSyncWord();
+        params.power            = getPower();
+        params.preambleLength   = getPreambleLength();
+        params.currentLimit     = getCurrentLim();
+
+        /* Laid out by LORA_PARAMETERS_SCHEMA */
+        encodeRadioParameters(retBuf, params);
 
         /* Return successful */
         return CMD_OK;
@@ -294,31 +623,25 @@
 
     /*-------------------------------------------------------------------------------------*\
     |   Name:       getUnix                                                                 |
-    |   Purpose:    Returns the current UNIX timestamp.                                     |
+    |   Purpose:    Returns the current UNIX timestamp and clock drift correction.          |
     |   Arguments:  Via buf, uint16_t, buf                                                  |
     |               Bytes               Field                                               |
     |               -------------------------------------------                             |
-    |               0-254               Return data                                         |
+    |               0-3                 Timestamp                                           |
+    |               4-5                 Milliseconds                                        |
+    |               6-7                 Drift correction (ppm, signed)                      |
     |                                                                                       |
     |   Returns:    int16_t (error code)                                                    |
     \*-------------------------------------------------------------------------------------*/
-    int16_t getUnix(const uint8_t* buf, uint16_t len, uint8_t* retBuf){
-
-        /* Check to make sure the payload is of the correct size */
-        if(len != GET_UNIX_PAYLOAD_LEN) return CMD_MALFORMED_PAYLOAD;
+    int16_t getUnix(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen){
      
-        /* Parameters */           
-        uint32_t timestamp = getUnixTime();
-        //Serial.printf(F("TS: %u\r\n"),timestamp);
+        /* Parameters */
+        UnixTime unixTime;
+        getUnixTimeMs(&unixTime.timestamp, &unixTime.milliseconds);
+        unixTime.drift = getClockDrift();
 
-        /* UNIX */
-        retBuf[0] = (timestamp & 0xFF00) >> 24;
-        retBuf[1] = (timestamp & 0xFF00) >> 16;
-        retBuf[2] = (timestamp & 0xFF00) >> 8;
-        retBuf[3] = (timestamp & 0x00FF);
-
-        /* Set the return buffer length */
-        retBufferLen = GET_UNIX_RETURN_LEN;
+        /* Laid out by UNIX_TIME_SCHEMA */
+        encodeUnixTime(retBuf, unixTime);
 
         /* Return successful */
         return CMD_OK;
@@ -330,14 +653,12 @@
     |   Arguments:  Via buf, uint16_t, buf                                                  |
     |               Bytes               Field                                               |
     |               -------------------------------------------                             |
-    |               0-254               Return data                                         |
+    |               0                   Mode                                                |
+    |               1-255               Repeater message                                    |
     |                                                                                       |
     |   Returns:    int16_t (error code)                                                    |
     \*-------------------------------------------------------------------------------------*/
-    int16_t getModeMessage(const uint8_t* buf, uint16_t len, uint8_t* retBuf){
-     
-        /* Check to make sure the payload is of the correct size */
-        if(len != GET_MODE_MESSAGE_PAYLOAD_LEN) return CMD_MALFORMED_PAYLOAD;
+    int16_t getModeMessage(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen){
      
         /* Parameters */           
         uint8_t mode = getMode();
@@ -346,11 +667,10 @@
         /* Mode */
         retBuf[0] = mode;
 
-        /* Repeater message */
-        memcpy(retBuf, messageBuf, SET_MODE_MESSAGE_PAYLOAD_LEN-2);
-
-        /* Set the return buffer length */
-        retBufferLen = GET_MODE_MESSAGE_RETURN_LEN;
+        /* Repeater message, after the mode, only what's kept and zeros after it */
+        static_assert(REPEATER_MESSAGE_BUFFER_LEN <= MAX_REPEATER_MESSAGE_SIZE, "REPEATER_MESSAGE_BUFFER_LEN is larger than MAX_REPEATER_MESSAGE_SIZE");
+        memcpy(retBuf+1, messageBuf, REPEATER_MESSAGE_BUFFER_LEN);
+        memset(retBuf+1+REPEATER_MESSAGE_BUFFER_LEN, 0, MAX_REPEATER_MESSAGE_SIZE-REPEATER_MESSAGE_BUFFER_LEN);
 
         /* Return successful */
         return CMD_OK;
@@ -362,65 +682,339 @@
     |   Arguments:  Via buf, uint16_t, buf                                                  |
     |               Bytes               Field                                               |
     |               -------------------------------------------                             |
-    |               0-254               Return data                                         |
+    |               0                   LoRa set                                            |
+    |               1                   UNIX set                                            |
+    |               2-5                 Uptime (ms)                                         |
+    |               6-7                 Temperature (0.01 degrees C)                        |
+    |               8-11                Time on air of the last frame sent (us)             |
+    |               12-15               Data rate (bps)                                     |
+    |               16                  Reset cause (MCUSR flags)                           |
+    |               17-18               Reset count since power-on                          |
+    |               19-20               Free RAM now                                        |
+    |               21-22               Stack headroom (lowest free RAM since boot)         |
+    |               23-24               Static RAM (.data, .bss, .noinit)                   |
+    |               25-26               Battery voltage (mV)                                |
+    |               27-28               Battery current (mA drawn)                          |
+    |               29-30               Battery temperature (0.01 degrees C)                |
+    |               31                  Power flags (0x80 set if the above are current)     |
+    |               32                  Power policy level (0 normal, 1 low, 2 critical)    |
+    |               (MODULE_STATUS_SCHEMA, FLOAT_PAYLOADS sends the old floats)             |
     |                                                                                       |
     |   Returns:    int16_t (error code)                                                    |
     \*-------------------------------------------------------------------------------------*/
-    int16_t getModuleStatus(const uint8_t* buf, uint16_t len, uint8_t* retBuf){
-
-        /* Check to make sure the payload is of the correct size */
-        if(len != GET_MODULE_STATUS_PAYLOAD_LEN) return CMD_MALFORMED_PAYLOAD;
+    int16_t getModuleStatus(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen){
         
-        /* Buffer for the float->uint32_t bytes conversion */
-        uint32_t fBytes;
-        
-        /* Parameters */           
-        bool LoRaSet        = getLoRaSet();
-        bool UnixSet        = getUnixSet();
-        uint32_t uptime     = millis();
-        float temperature   = getModuleTemperature();
-        uint32_t timeOnAir  = getTOA();
-        float dataRate      = getLoRaDataRate();
-
-        /* LoRa */
-        retBuf[0] = (uint8_t)LoRaSet;
-
-        /* UNIX */
-        retBuf[1] = (uint8_t)UnixSet;
-
-        /* Uptime */
-        retBuf[2] = (uptime & 0xFF00) >> 24;
-        retBuf[3] = (uptime & 0xFF00) >> 16;
-        retBuf[4] = (uptime & 0xFF00) >> 8;
-        retBuf[5] = (uptime & 0x00FF);
-
-        /* Temperature */
-        fBytes = *((uint32_t *) &temperature);
-        retBuf[6] = (fBytes & 0xFF000000) >> 24;
-        retBuf[7] = (fBytes & 0x00FF0000) >> 16;
-        retBuf[8] = (fBytes & 0x0000FF00) >> 8;
-        retBuf[9] = (fBytes & 0x000000FF);
-
-        /* Time on air */
-        retBuf[10] = (timeOnAir & 0xFF00) >> 24;
-        retBuf[11] = (timeOnAir & 0xFF00) >> 16;
-        retBuf[12] = (timeOnAir & 0xFF00) >> 8;
-        retBuf[13] = (timeOnAir & 0x00FF);
-        
-        /* Data rate */
-        fBytes = *((uint32_t *) &dataRate);
-        retBuf[14] = (fBytes & 0xFF000000) >> 24;
-        retBuf[15] = (fBytes & 0x00FF0000) >> 16;
-        retBuf[16] = (fBytes & 0x0000FF00) >> 8;
-        retBuf[17] = (fBytes & 0x000000FF);
-
-        /* Set the return buffer length */
-        retBufferLen = GET_MODULE_STATUS_RETURN_LEN;
+        /* Parameters */
+        ModuleStatus status;
+        status.loraSet          = (uint8_t)getLoRaSet();
+        status.unixSet          = (uint8_t)getUnixSet();
+        status.uptime           = millis();
+        status.temperature      = getModuleTemperature();
+        status.timeOnAir        = getTOA();
+        status.dataRate         = getLoRaDataRate();
+        status.resetCause       = getResetCause();
+        status.resetCount       = getResetCount();
+        status.freeRam          = getFreeRam();
+        status.stackHeadroom    = getStackHeadroom();
+        status.staticRam        = getStaticRam();
+
+        /* Cached from the power board, never waits on the bus */
+        PowerStatus power = getPowerStatus();
+        status.batteryVoltage       = power.batteryVoltage;
+        status.batteryCurrent       = power.batteryCurrent;
+        status.batteryTemperature   = power.batteryTemperature;
+        status.powerFlags           = power.powerFlags;
+        status.powerLevel           = getPowerLevel();
+
+        /* Laid out by MODULE_STATUS_SCHEMA */
+        encodeModuleStatus(retBuf, status);
         
         /* Return successful */
         return CMD_OK;        
     }
 
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getChannelStats                                                         |
+    |   Purpose:    Returns the listen-before-talk state and counters.                      |
+    |   Arguments:  Via buf, uint16_t, buf                                                  |
+    |               Bytes               Field                                               |
+    |               -------------------------------------------                             |
+    |               0                   LBT enabled                                         |
+    |               1-4                 Busy-channel deferrals                              |
+    |               5-8                 Collisions avoided                                  |
+    |               9-12                Transmissions abandoned                             |
+    |                                                                                       |
+    |   Returns:    int16_t (error code)                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t getChannelStats(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen){
+
+        /* Parameters */
+        bool LBTEnabled     = getLBTEnabled();
+        uint32_t deferrals  = getBusyDeferrals();
+        uint32_t avoided    = getCollisionsAvoided();
+        uint32_t abandoned  = getTransmissionsAbandoned();
+
+        /* LBT enabled */
+        retBuf[0] = (uint8_t)LBTEnabled;
+
+        /* Busy-channel deferrals */
+        retBuf[1] = (deferrals & 0xFF000000) >> 24;
+        retBuf[2] = (deferrals & 0x00FF0000) >> 16;
+        retBuf[3] = (deferrals & 0x0000FF00) >> 8;
+        retBuf[4] = (deferrals & 0x000000FF);
+
+        /* Collisions avoided */
+        retBuf[5] = (avoided & 0xFF000000) >> 24;
+        retBuf[6] = (avoided & 0x00FF0000) >> 16;
+        retBuf[7] = (avoided & 0x0000FF00) >> 8;
+        retBuf[8] = (avoided & 0x000000FF);
+
+        /* Transmissions abandoned */
+        retBuf[9]  = (abandoned & 0xFF000000) >> 24;
+        retBuf[10] = (abandoned & 0x00FF0000) >> 16;
+        retBuf[11] = (abandoned & 0x0000FF00) >> 8;
+        retBuf[12] = (abandoned & 0x000000FF);
+
+        /* Return successful */
+        return CMD_OK;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getHoppingStats                                                         |
+    |   Purpose:    Returns the hopping state and per-channel error statistics.             |
+    |   Arguments:  Via buf, uint16_t, buf                                                  |
+    |               Bytes               Field                                               |
+    |               -------------------------------------------                             |
+    |               0-254               Return data (see getHopStats)                       |
+    |                                                                                       |
+    |   Returns:    int16_t (error code)                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t getHoppingStats(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen){
+
+        /* Set the return buffer length, the record grows with the channel table */
+        *retLen = getHopStats(retBuf);
+
+        /* Return successful */
+        return CMD_OK;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getTimeSyncStatusCmd                                                    |
+    |   Purpose:    Returns the time sync state, offset, and accuracy.                      |
+    |   Arguments:  Via buf, uint16_t, buf                                                  |
+    |               Bytes               Field                                               |
+    |               -------------------------------------------                             |
+    |               0                   Mode                                                |
+    |               1                   Synchronized                                        |
+    |               2-3                 Beacon period (s)                                   |
+    |               4-5                 Beacons sent                                        |
+    |               6-7                 Beacons received                                    |
+    |               8-11                Last offset (ms, signed, remote - local)            |
+    |               12-13               Mean absolute offset (ms)                           |
+    |               14-15               Drift correction (ppm, signed)                      |
+    |               16-19               Time since last beacon (ms, 0xFFFFFFFF if none)     |
+    |               (TIME_SYNC_STATUS_SCHEMA)                                               |
+    |                                                                                       |
+    |   Returns:    int16_t (error code)                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t getTimeSyncStatusCmd(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen){
+
+        /* Laid out by TIME_SYNC_STATUS_SCHEMA */
+        encodeTimeSyncStatus(retBuf, getTimeSyncStatus());
+
+        /* Return successful */
+        return CMD_OK;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getTaskStatsCmd                                                         |
+    |   Purpose:    Returns the scheduler's per-task statistics, optionally clearing them.  |
+    |   Arguments:  Via buf, uint16_t, buf                                                  |
+    |               Bytes               Field                                               |
+    |               -------------------------------------------                             |
+    |               0                   Command                                             |
+    |               1                   Reset after reading (0/1, optional, 0 if absent)    |
+    |                                                                                       |
+    |   Returns:    int16_t (error code)                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t getTaskStatsCmd(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen){
+
+        /* The return data overwrites the payload, so read the flag first */
+        bool reset = (len == GET_TASK_STATS_RESET_PAYLOAD_LEN) && buf[1];
+
+        /* Set the return buffer length, the record grows with the task table */
+        *retLen = getTaskStats(retBuf);
+
+        /* Start a fresh measurement window if asked */
+        if(reset) resetTaskStats();
+
+        /* Return successful */
+        return CMD_OK;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getPerfStatsCmd                                                         |
+    |   Purpose:    Returns the performance counters and timers, or clears them.            |
+    |   Arguments:  Via buf, uint16_t, buf                                                  |
+    |               Bytes               Field                                               |
+    |               -------------------------------------------                             |
+    |               0                   Command                                             |
+    |               1                   Subcommand (PERF_STATS_READ/RESET, optional, read)  |
+    |                                                                                       |
+    |   Returns:    int16_t (error code)                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t getPerfStatsCmd(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen){
+
+        /* A bare command reads */
+        uint8_t subcommand = (len == GET_PERF_STATS_RESET_PAYLOAD_LEN) ? buf[1] : PERF_STATS_READ;
+
+        switch(subcommand){
+            case PERF_STATS_READ:
+                *retLen = getPerfStats(retBuf);
+                break;
+            case PERF_STATS_RESET:
+                resetPerfStats();
+                *retLen = 0;
+                break;
+            default:
+                return CMD_MALFORMED_PAYLOAD;
+        }
+
+        /* Return successful */
+        return CMD_OK;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getCommandStats                                                         |
+    |   Purpose:    Returns how often each command has run and its longest execution time,  |
+    |               optionally clearing them. A build without the perf probes reports none. |
+    |   Arguments:  Via buf, uint16_t, buf                                                  |
+    |               Bytes               Field                                               |
+    |               -------------------------------------------                             |
+    |               0                   Command                                             |
+    |               1                   Reset after reading (0/1, optional, 0 if absent)    |
+    |                                                                                       |
+    |   Returns:    int16_t (error code)                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t getCommandStats(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen){
+
+        /* The return data overwrites the payload, so read the flag first */
+        bool reset = (len == GET_COMMAND_STATS_RESET_PAYLOAD_LEN) && buf[1];
+
+        /* Only commands that have run */
+        uint16_t idx = 1;
+        retBuf[0] = 0;
+        #if PERF_ENABLED
+        for(uint8_t i = 0; i != COMMAND_TABLE_LEN; i++){
+            if(commandStats[i].count == 0) continue;
+            retBuf[idx++] = i;
+            retBuf[idx++] = (commandStats[i].count & 0xFF00) >> 8;
+            retBuf[idx++] = (commandStats[i].count & 0x00FF);
+            retBuf[idx++] = (commandStats[i].worstMicros & 0xFF00) >> 8;
+            retBuf[idx++] = (commandStats[i].worstMicros & 0x00FF);
+            retBuf[0]++;
+        }
+
+        /* Start a fresh measurement window if asked */
+        if(reset) memset(commandStats, 0, sizeof(commandStats));
+        #else
+        (void)reset;
+        #endif
+        *retLen = idx;
+
+        /* Return successful */
+        return CMD_OK;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getEnergyStatusCmd                                                      |
+    |   Purpose:    Returns the time spent in each radio and MCU state since boot, and the  |
+    |               charge it cost at the ENERGY_* currents.                                |
+    |   Arguments:  Via buf, uint16_t, buf                                                  |
+    |               Bytes               Field                                               |
+    |               -------------------------------------------                             |
+    |               0-3                 Uptime (ms)                                         |
+    |               4-7                 Transmitting, time on air (ms)                      |
+    |               8-11                Listening (ms)                                      |
+    |               12-15               Radio standby (ms)                                  |
+    |               16-19               MCU active (ms)                                     |
+    |               20-23               MCU idle (ms)                                       |
+    |               24-43               Charge in each of those states, same order (uAh)    |
+    |               44-47               Total charge (uAh)                                  |
+    |               (ENERGY_STATUS_SCHEMA, FLOAT_PAYLOADS sends the charges in mAh)         |
+    |                                                                                       |
+    |   Returns:    int16_t (error code)                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t getEnergyStatusCmd(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen){
+
+        /* Laid out by ENERGY_STATUS_SCHEMA */
+        encodeEnergyStatus(retBuf, getEnergyStatus());
+
+        /* Return successful */
+        return CMD_OK;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getStoreForwardStatusCmd                                                |
+    |   Purpose:    Returns the store-and-forward settings, link state, ring occupancy, and |
+    |               counts since boot.                                                      |
+    |   Arguments:  Via buf, uint16_t, buf                                                  |
+    |               Bytes               Field                                               |
+    |               -------------------------------------------                             |
+    |               0                   Enabled                                             |
+    |               1                   Link up                                             |
+    |               2-3                 Link timeout (s)                                    |
+    |               4-5                 Store interval (s)                                  |
+    |               6-9                 Since a frame was heard (ms, 0xFFFFFFFF never)      |
+    |               10                  Slots in the ring                                   |
+    |               11                  Slots pending                                       |
+    |               12-13               Next sequence                                       |
+    |               14-15               Records stored                                      |
+    |               16-17               Records forwarded                                   |
+    |               18-19               Overwritten while pending                           |
+    |               20-21               Dropped, too long for a slot                        |
+    |               (STORE_FORWARD_STATUS_SCHEMA)                                           |
+    |                                                                                       |
+    |   Returns:    int16_t (error code)                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t getStoreForwardStatusCmd(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen){
+
+        /* Laid out by STORE_FORWARD_STATUS_SCHEMA */
+        encodeStoreForwardStatus(retBuf, getStoreForwardStatus());
+
+        /* Return successful */
+        return CMD_OK;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getRadioProfiles                                                        |
+    |   Purpose:    Returns the boot selector and the name of each stored profile.          |
+    |   Arguments:  Via buf, uint16_t, buf                                                  |
+    |               Bytes               Field                                               |
+    |               -------------------------------------------                             |
+    |               0                   Boot profile index (0xFF for the defaults)          |
+    |               1-72                Per slot: valid (1), name (8)                       |
+    |                                                                                       |
+    |   Returns:    int16_t (error code)                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t getRadioProfiles(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen){
+
+        /* Boot profile */
+        retBuf[0] = getBootProfile();
+
+        /* Profile slots, empty ones report a zeroed name */
+        uint16_t idx = 1;
+        for(uint8_t i = 0; i != MAX_RADIO_PROFILES; i++){
+            bool valid = (loadRadioProfile(i, (char*)retBuf+idx+1, NULL) == ERR_NONE);
+            retBuf[idx] = (uint8_t)valid;
+            if(!valid) memset(retBuf+idx+1, 0, PROFILE_NAME_LEN);
+            idx += 1 + PROFILE_NAME_LEN;
+        }
+
+        /* Return successful */
+        return CMD_OK;
+    }
+
     /* ------------------------- Miscellaneous ------------------------- */
 
     /*-------------------------------------------------------------------------------------*\
@@ -433,16 +1027,10 @@
     |                                                                                       |
     |   Returns:    int16_t (error code)                                                    |
     \*-------------------------------------------------------------------------------------*/
-    int16_t radioReset(uint16_t len){
-        
-        /* Check to make sure the payload is of the correct size */
-        if(len != RADIO_RESET_PAYLOAD_LEN) return CMD_MALFORMED_PAYLOAD;
+    int16_t radioReset(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen){
 
         /* Attempt to reset the radio */
         int16_t res = resetRadio();
-
-        /* Set the return buffer length */
-        retBufferLen = 0;
         
         /* Return successful */
         return res;
@@ -458,16 +1046,10 @@
     |                                                                                       |
     |   Returns:    int16_t (error code)                                                    |
     \*-------------------------------------------------------------------------------------*/
-    int16_t systemReset(uint16_t len){
-        
-        /* Check to make sure the payload is of the correct size */
-        if(len != SYSTEM_RESET_PAYLOAD_LEN) return CMD_MALFORMED_PAYLOAD;
+    int16_t systemReset(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen){
  
         /* Delay 10 seconds, watchdog will kick in at 4 seconds */
         delay(10000);
-
-        /* Set the return buffer length */
-        retBufferLen = 0;
        
         /* If we get a result back then that's probably not good */
         return CMD_OK;
@@ -7,8 +7,23 @@
 #define INC_COMMANDS_H_
 
 #include <Arduino.h>
+#include "Energy.h"
+#include "Imu.h"
+#include "ImuSummary.h"
+#include "Memory.h"
+#include "Perf.h"
+#include "PowerBoard.h"
 #include "RadioController.h"
+#include "RadioProfiles.h"
+#include "Scheduler.h"
+#include "Schemas.h"
+#include "StoreForward.h"
+#include "Telemetry.h"
+#include "Thermistor.h"
+#include "TimeSync.h"
+#include "Trace.h"
 #include "Utility.h"
+#include "WarmRestart.h"
 
 
 /*-------------------------------------------------------------------------*\
@@ -23,30 +38,93 @@
     #define SET_LORA_PARAMETERS                 0x00
     #define SET_UNIX                            0x01
     #define SET_MODE_MESSAGE                    0x02
+    #define SET_LISTEN_BEFORE_TALK              0x03
+    #define SET_HOPPING_PARAMETERS              0x04
+    #define DEFINE_RADIO_PROFILE                0x05
+    #define ACTIVATE_RADIO_PROFILE              0x06
+    #define SET_BOOT_PROFILE                    0x07
+    #define SET_HEADER_EXTENSION                0x08
+    #define SET_TIME_SYNC                       0x09
+    #define SET_TRACE                           0x0A
+    #define SET_TELEMETRY                       0x0B
+    #define SET_IMU                             0x0C
+    #define SET_IMU_SUMMARY                     0x0D
+    #define SET_STORE_FORWARD                   0x0E
     #define GET_LORA_PARAMETERS                 0x10
     #define GET_UNIX                            0x11
     #define GET_MODE_MESSAGE                    0x12
     #define GET_MODULE_STATUS                   0x13
+    #define GET_CHANNEL_STATS                   0x14
+    #define GET_HOPPING_STATS                   0x15
+    #define GET_RADIO_PROFILES                  0x16
+    #define GET_TIME_SYNC_STATUS                0x17
+    #define GET_TASK_STATS                      0x18
+    #define GET_PERF_STATS                      0x19
+    #define GET_COMMAND_STATS                   0x1A
+    #define GET_ENERGY_STATUS                   0x1B
+    #define GET_STORE_FORWARD_STATUS            0x1C
     #define RADIO_RESET                         0x20
     #define SYSTEM_RESET                        0x21
     //#define NEGOTIATE_LORA_PARAMETERS           0X22
 
     /* Payload lengths (command and parameters) */
-    #define SET_LORA_PARAMETERS_PAYLOAD_LEN     (19)
+    #define SET_LORA_PARAMETERS_PAYLOAD_LEN     (1 + LORA_PARAMETERS_LEN)
     #define SET_UNIX_PAYLOAD_LEN                (5)
+    #define SET_UNIX_MS_PAYLOAD_LEN             (7)                 // With milliseconds, used for drift estimation
     #define SET_MODE_MESSAGE_PAYLOAD_LEN        (257)
+    #define SET_LISTEN_BEFORE_TALK_PAYLOAD_LEN  (2)
+    #define SET_HOPPING_PARAMETERS_PAYLOAD_LEN  (5)                 // Plus 4 bytes per channel
+    #define DEFINE_RADIO_PROFILE_PAYLOAD_LEN    (2 + PROFILE_NAME_LEN + LORA_PARAMETERS_LEN)
+    #define ACTIVATE_RADIO_PROFILE_PAYLOAD_LEN  (2)
+    #define SET_BOOT_PROFILE_PAYLOAD_LEN        (2)
+    #define SET_HEADER_EXTENSION_PAYLOAD_LEN    (2)
+    #define SET_TIME_SYNC_PAYLOAD_LEN           (4)
+    #define SET_TRACE_PAYLOAD_LEN               (2)
+    #define SET_TELEMETRY_PAYLOAD_LEN           (2)
+    #define SET_IMU_PAYLOAD_LEN                 (4)
+    #define SET_IMU_SUMMARY_PAYLOAD_LEN         (4)
+    #define SET_STORE_FORWARD_PAYLOAD_LEN       (6)
     #define GET_LORA_PARAMETERS_PAYLOAD_LEN     (1)
     #define GET_UNIX_PAYLOAD_LEN                (1)
     #define GET_MODE_MESSAGE_PAYLOAD_LEN        (1)
     #define GET_MODULE_STATUS_PAYLOAD_LEN       (1)
+    #define GET_CHANNEL_STATS_PAYLOAD_LEN       (1)
+    #define GET_HOPPING_STATS_PAYLOAD_LEN       (1)
+    #define GET_RADIO_PROFILES_PAYLOAD_LEN      (1)
+    #define GET_TIME_SYNC_STATUS_PAYLOAD_LEN    (1)
+    #define GET_TASK_STATS_PAYLOAD_LEN          (1)
+    #define GET_TASK_STATS_RESET_PAYLOAD_LEN    (2)                 // With the reset flag
+    #define GET_PERF_STATS_PAYLOAD_LEN          (1)
+    #define GET_PERF_STATS_RESET_PAYLOAD_LEN    (2)                 // With the subcommand
+    #define GET_COMMAND_STATS_PAYLOAD_LEN       (1)
+    #define GET_COMMAND_STATS_RESET_PAYLOAD_LEN (2)                 // With the reset flag
+    #define GET_ENERGY_STATUS_PAYLOAD_LEN       (1)
+    #define GET_STORE_FORWARD_STATUS_PAYLOAD_LEN (1)
     #define RADIO_RESET_PAYLOAD_LEN             (1)
     #define SYSTEM_RESET_PAYLOAD_LEN            (1)
 
     /* Data return lengths */
-    #define GET_LORA_PARAMETERS_RETURN_LEN      (18)
-    #define GET_UNIX_RETURN_LEN                 (4)
+    #define GET_LORA_PARAMETERS_RETURN_LEN      LORA_PARAMETERS_LEN
+    #define GET_UNIX_RETURN_LEN                 UNIX_TIME_LEN
     #define GET_MODE_MESSAGE_RETURN_LEN         (256)
-    #define GET_MODULE_STATUS_RETURN_LEN        (18)
+    #define GET_MODULE_STATUS_RETURN_LEN        MODULE_STATUS_LEN
+    #define GET_CHANNEL_STATS_RETURN_LEN        (13)
+    #define GET_HOPPING_STATS_RETURN_LEN        (11 + HOP_MAX_CHANNELS*4)                           // At most
+    #define GET_RADIO_PROFILES_RETURN_LEN       (1 + MAX_RADIO_PROFILES*(1 + PROFILE_NAME_LEN))
+    #define GET_TIME_SYNC_STATUS_RETURN_LEN     TIME_SYNC_STATUS_LEN
+    #define GET_TASK_STATS_RETURN_LEN           (1 + SCHEDULER_MAX_TASKS*TASK_STATS_RECORD_LEN)     // At most
+    #define GET_PERF_STATS_RETURN_LEN           PERF_STATS_LEN
+    #define GET_COMMAND_STATS_RETURN_LEN        (1 + COMMAND_COUNT*COMMAND_STATS_RECORD_LEN)       // At most
+    #define GET_ENERGY_STATUS_RETURN_LEN        ENERGY_STATUS_LEN
+    #define GET_STORE_FORWARD_STATUS_RETURN_LEN STORE_FORWARD_STATUS_LEN
+
+    /* GET_COMMAND_STATS records */
+    #define COMMAND_COUNT                       (SYSTEM_RESET + 1)                                  // Opcodes in the command table
+    #define COMMAND_STATS_RECORD_LEN            (5)                                                 // Opcode, count, worst time (us)
+
+    /* GET_PERF_STATS subcommands */
+    #define PERF_STATS_READ                     0x00
+    #define PERF_STATS_RESET                    0x01
 
     /* Status codes */
     #define CMD_OK                              0x0000
@@ -60,6 +138,36 @@
     #define CMD_INVALID_POWER                   0x0108
     #define CMD_INVALID_PREAMBLE_LENGTH         0x0109
     #define CMD_INVALID_CURRENT_LIMIT           0x0110
+    #define CMD_INVALID_CHANNEL_PLAN            0x0111
+
+
+/*-------------------------------------------------------------------------*\
+|                                    Types                                  |
+\*-------------------------------------------------------------------------*/
+
+
+    /*
+     * Every command handler takes the payload (command byte first) and its length, and the buffer for
+     * return data. The return length comes in preset to the table's, and only needs setting by handlers
+     * that return less. The return buffer is the Ack being built over the command, so handlers read their
+     * arguments before writing it.
+     */
+    typedef int16_t (*CommandHandler)(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen);
+
+    /* A command table entry, kept in flash */
+    struct CommandEntry{
+        uint8_t opcode;
+        CommandHandler handler;                 // NULL for unused opcodes
+        uint16_t minLen;                        // Payload length bounds, command byte included
+        uint16_t maxLen;
+        uint16_t returnLen;                     // Most return data the command produces
+    };
+
+    /* Per-command execution statistics */
+    struct CommandStats{
+        uint16_t count;
+        uint16_t worstMicros;
+    };
     
 
 /*-------------------------------------------------------------------------*\
@@ -86,12 +194,20 @@
 
     /*-------------------------------------------------------------------------------------*\
     |   Name:       executeCommand                                                          |
-    |   Purpose:    Executes the passed command.                                            |
+    |   Purpose:    Executes the passed command, looked up in the command table.            |
     |   Arguments:  void                                                                    |
     |   Returns:    int16_t                                                                 |
     \*-------------------------------------------------------------------------------------*/
     int16_t executeCommand(const uint8_t* buf, uint16_t bufLen, uint8_t* retBuf);
 
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       validateLoRaParameters                                                  |
+    |   Purpose:    Checks a full set of LoRa parameters against what the SX1262 accepts.   |
+    |   Arguments:  const RadioParameters&                                                  |
+    |   Returns:    int16_t (error code)                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t validateLoRaParameters(const RadioParameters& params);
+
     /* ---------------------------- Setters ---------------------------- */
 
     /*-------------------------------------------------------------------------------------*\
@@ -112,20 +228,22 @@
     |                                                                                       |
     |   Returns:    int16_t (error code)                                                    |
     \*-------------------------------------------------------------------------------------*/
-    int16_t setLoRaParameters(const uint8_t* buf, uint16_t len);
+    int16_t setLoRaParameters(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen);
 
     /*-------------------------------------------------------------------------------------*\
     |   Name:       setUNIX                                                                 |
-    |   Purpose:    Set the UNIX timestamp.                                                 |
-    |   Arguments:  Via buf,                                                                |
+    |   Purpose:    Set the UNIX timestamp. With the optional milliseconds, successive      |
+    |               updates are also used to estimate and correct crystal drift.            |
+    |   Arguments:  Via buf, uint16_t                                                       |
     |               Bytes               Field                                               |
     |               -------------------------------------------                             |
     |               0                   Command                                             |
     |               1-4                 Timestamp                                           |
+    |               5-6                 Milliseconds (optional)                             |
     |                                                                                       |
     |   Returns:    int16_t (error code)                                                    |
     \*-------------------------------------------------------------------------------------*/
-    int16_t setUnix(const uint8_t* buf, uint16_t len);
+    int16_t setUnix(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen);
 
     /*-------------------------------------------------------------------------------------*\
     |   Name:       setModeMessage                                                          |
@@ -139,7 +257,175 @@
     |                                                                                       |
     |   Returns:    int16_t (error code)                                                    |
     \*-------------------------------------------------------------------------------------*/
-    int16_t setModeMessage(const uint8_t* buf, uint16_t len);
+    int16_t setModeMessage(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       setListenBeforeTalk                                                     |
+    |   Purpose:    Enable or disable channel activity detection before each transmission. |
+    |   Arguments:  Via buf, uint16_t                                                       |
+    |               Bytes               Field                                               |
+    |               -------------------------------------------                             |
+    |               0                   Command                                             |
+    |               1                   Enable (0 or 1)                                     |
+    |                                                                                       |
+    |   Returns:    int16_t (error code)                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t setListenBeforeTalk(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       setHoppingParameters                                                    |
+    |   Purpose:    Enable or disable frequency hopping and load the seed and channel table.|
+    |   Arguments:  Via buf, uint16_t                                                       |
+    |               Bytes               Field                                               |
+    |               -------------------------------------------                             |
+    |               0                   Command                                             |
+    |               1                   Enable (0 or 1)                                     |
+    |               2-3                 Seed                                                |
+    |               4                   Channel count (N, 0 keeps the current table)        |
+    |               5-(4+4N)            Channel frequencies (902-928 MHz)                   |
+    |                                                                                       |
+    |   Returns:    int16_t (error code)                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t setHoppingParameters(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       defineRadioProfile                                                      |
+    |   Purpose:    Store a named set of LoRa parameters in an EEPROM profile slot.         |
+    |   Arguments:  Via buf, uint16_t                                                       |
+    |               Bytes               Field                                               |
+    |               -------------------------------------------                             |
+    |               0                   Command                                             |
+    |               1                   Profile index                                       |
+    |               2-9                 Name (zero padded)                                  |
+    |               10-27               LoRa parameters (as SET_LORA_PARAMETERS 1-18)       |
+    |                                                                                       |
+    |   Returns:    int16_t (error code)                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t defineRadioProfile(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       activateRadioProfile                                                    |
+    |   Purpose:    Apply a stored profile to the radio.                                    |
+    |   Arguments:  Via buf, uint16_t                                                       |
+    |               Bytes               Field                                               |
+    |               -------------------------------------------                             |
+    |               0                   Command                                             |
+    |               1                   Profile index                                       |
+    |                                                                                       |
+    |   Returns:    int16_t (error code)                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t activateRadioProfile(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       setBootProfile                                                          |
+    |   Purpose:    Select the profile the radio comes up on after a reset.                 |
+    |   Arguments:  Via buf, uint16_t                                                       |
+    |               Bytes               Field                                               |
+    |               -------------------------------------------                             |
+    |               0                   Command                                             |
+    |               1                   Profile index (0xFF for the defaults)               |
+    |                                                                                       |
+    |   Returns:    int16_t (error code)                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t setBootProfile(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       setHeaderExtension                                                      |
+    |   Purpose:    Enable or disable the millisecond field in outgoing packet headers.     |
+    |   Arguments:  Via buf, uint16_t                                                       |
+    |               Bytes               Field                                               |
+    |               -------------------------------------------                             |
+    |               0                   Command                                             |
+    |               1                   Enable (0 or 1)                                     |
+    |                                                                                       |
+    |   Returns:    int16_t (error code)                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t setHeaderExtension(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       setTimeSync                                                             |
+    |   Purpose:    Set the over-the-air time sync role and beacon period.                  |
+    |   Arguments:  Via buf, uint16_t                                                       |
+    |               Bytes               Field                                               |
+    |               -------------------------------------------                             |
+    |               0                   Command                                             |
+    |               1                   Mode (0 off, 1 master, 2 slave)                     |
+    |               2-3                 Beacon period (s)                                   |
+    |                                                                                       |
+    |   Returns:    int16_t (error code)                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t setTimeSync(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       setTrace                                                                |
+    |   Purpose:    Enable or disable latency tracing of outgoing messages. The receiving   |
+    |               module follows each traced message with a trace packet.                 |
+    |   Arguments:  Via buf, uint16_t                                                       |
+    |               Bytes               Field                                               |
+    |               -------------------------------------------                             |
+    |               0                   Command                                             |
+    |               1                   Enable (0 or 1)                                     |
+    |                                                                                       |
+    |   Returns:    int16_t (error code)                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t setTrace(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       setTelemetry                                                            |
+    |   Purpose:    Set where the module's own telemetry records (IMU, etc.) are sent.      |
+    |   Arguments:  Via buf, uint16_t                                                       |
+    |               Bytes               Field                                               |
+    |               -------------------------------------------                             |
+    |               0                   Command                                             |
+    |               1                   Destination (0 off, 1 UART, 2 radio)                |
+    |                                                                                       |
+    |   Returns:    int16_t (error code)                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t setTelemetry(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       setImu                                                                  |
+    |   Purpose:    Start or stop IMU sampling, batched into telemetry records.             |
+    |   Arguments:  Via buf, uint16_t                                                       |
+    |               Bytes               Field                                               |
+    |               -------------------------------------------                             |
+    |               0                   Command                                             |
+    |               1-2                 Sample rate (Hz, 0 stops, must divide 1000)         |
+    |               3                   Samples per record (0-8, 0 for summaries only)      |
+    |                                                                                       |
+    |   Returns:    int16_t (error code)                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t setImu(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       setImuSummary                                                           |
+    |   Purpose:    Set the window and fields of the IMU summary telemetry records.         |
+    |   Arguments:  Via buf, uint16_t                                                       |
+    |               Bytes               Field                                               |
+    |               -------------------------------------------                             |
+    |               0                   Command                                             |
+    |               1-2                 Window (ms, 100-60000)                              |
+    |               3                   Fields (IMU_SUMMARY_* bits, 0 off)                  |
+    |                                                                                       |
+    |   Returns:    int16_t (error code)                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t setImuSummary(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       setStoreForward                                                         |
+    |   Purpose:    Set whether radio telemetry is stored while the link is down, and how   |
+    |               long without a frame counts as down.                                    |
+    |   Arguments:  Via buf, uint16_t                                                       |
+    |               Bytes               Field                                               |
+    |               -------------------------------------------                             |
+    |               0                   Command                                             |
+    |               1                   Enable (0 transmits everything)                     |
+    |               2-3                 Link timeout (s, 1-65535 while enabled)             |
+    |               4-5                 Store interval (s per record of a type)             |
+    |                                                                                       |
+    |   Returns:    int16_t (error code)                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t setStoreForward(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen);
 
     /* ---------------------------- Getters ---------------------------- */
 
@@ -153,19 +439,21 @@
     |                                                                                       |
     |   Returns:    int16_t (error code)                                                    |
     \*-------------------------------------------------------------------------------------*/
-    int16_t getLoRaParameters(const uint8_t* buf, uint16_t len, uint8_t* retBuf);
+    int16_t getLoRaParameters(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen);
 
     /*-------------------------------------------------------------------------------------*\
     |   Name:       getUnix                                                                 |
-    |   Purpose:    Returns the current UNIX timestamp.                                     |
+    |   Purpose:    Returns the current UNIX timestamp and clock drift correction.          |
     |   Arguments:  Via buf, uint16_t, buf                                                  |
     |               Bytes               Field                                               |
     |               -------------------------------------------                             |
-    |               0-254               Return data                                         |
+    |               0-3                 Timestamp                                           |
+    |               4-5                 Milliseconds                                        |
+    |               6-7                 Drift correction (ppm, signed)                      |
     |                                                                                       |
     |   Returns:    int16_t (error code)                                                    |
     \*-------------------------------------------------------------------------------------*/
-    int16_t getUnix(const uint8_t* buf, uint16_t len, uint8_t* retBuf);
+    int16_t getUnix(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen);
 
     /*-------------------------------------------------------------------------------------*\
     |   Name:       getModeMessage                                                          |
@@ -177,7 +465,7 @@
     |                                                                                       |
     |   Returns:    int16_t (error code)                                                    |
     \*-------------------------------------------------------------------------------------*/
-    int16_t getModeMessage(const uint8_t* buf, uint16_t len, uint8_t* retBuf);
+    int16_t getModeMessage(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen);
 
     /*-------------------------------------------------------------------------------------*\
     |   Name:       getModuleStatus                                                         |
@@ -185,11 +473,195 @@
     |   Arguments:  Via buf, uint16_t, buf                                                  |
     |               Bytes               Field                                               |
     |               -------------------------------------------                             |
-    |               0-254               Return data                                         |
+    |               0                   LoRa set                                            |
+    |               1                   UNIX set                                            |
+    |               2-5                 Uptime (ms)                                         |
+    |               6-7                 Temperature (0.01 degrees C)                        |
+    |               8-11                Time on air of the last frame sent (us)             |
+    |               12-15               Data rate (bps)                                     |
+    |               16                  Reset cause (MCUSR flags)                           |
+    |               17-18               Reset count since power-on                          |
+    |               19-20               Free RAM now                                        |
+    |               21-22               Stack headroom (lowest free RAM since boot)         |
+    |               23-24               Static RAM (.data, .bss, .noinit)                   |
+    |               25-26               Battery voltage (mV)                                |
+    |               27-28               Battery current (mA drawn)                          |
+    |               29-30               Battery temperature (0.01 degrees C)                |
+    |               31                  Power flags (0x80 set if the above are current)     |
+    |               32                  Power policy level (0 normal, 1 low, 2 critical)    |
+    |               (MODULE_STATUS_SCHEMA, FLOAT_PAYLOADS sends the old floats)             |
+    |                                                                                       |
+    |   Returns:    int16_t (error code)                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t getModuleStatus(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getChannelStats                                                         |
+    |   Purpose:    Returns the listen-before-talk state and counters.                      |
+    |   Arguments:  Via buf, uint16_t, buf                                                  |
+    |               Bytes               Field                                               |
+    |               -------------------------------------------                             |
+    |               0                   LBT enabled                                         |
+    |               1-4                 Busy-channel deferrals                              |
+    |               5-8                 Collisions avoided                                  |
+    |               9-12                Transmissions abandoned                             |
+    |                                                                                       |
+    |   Returns:    int16_t (error code)                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t getChannelStats(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getHoppingStats                                                         |
+    |   Purpose:    Returns the hopping state and per-channel error statistics.             |
+    |   Arguments:  Via buf, uint16_t, buf                                                  |
+    |               Bytes               Field                                               |
+    |               -------------------------------------------                             |
+    |               0                   Enabled                                             |
+    |               1                   Synchronized                                        |
+    |               2-3                 Transmit frame counter                              |
+    |               4-5                 Expected receive frame counter                      |
+    |               6-7                 Blacklist mask                                      |
+    |               8-9                 Resync count                                        |
+    |               10                  Channel count (N)                                   |
+    |               11-(10+4N)          Per channel: good frames (2), errored frames (2)    |
+    |                                                                                       |
+    |   Returns:    int16_t (error code)                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t getHoppingStats(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getTimeSyncStatusCmd                                                    |
+    |   Purpose:    Returns the time sync state, offset, and accuracy.                      |
+    |   Arguments:  Via buf, uint16_t, buf                                                  |
+    |               Bytes               Field                                               |
+    |               -------------------------------------------                             |
+    |               0                   Mode                                                |
+    |               1                   Synchronized                                        |
+    |               2-3                 Beacon period (s)                                   |
+    |               4-5                 Beacons sent                                        |
+    |               6-7                 Beacons received                                    |
+    |               8-11                Last offset (ms, signed, remote - local)            |
+    |               12-13               Mean absolute offset (ms)                           |
+    |               14-15               Drift correction (ppm, signed)                      |
+    |               16-19               Time since last beacon (ms, 0xFFFFFFFF if none)     |
+    |                                                                                       |
+    |   Returns:    int16_t (error code)                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t getTimeSyncStatusCmd(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getTaskStatsCmd                                                         |
+    |   Purpose:    Returns the scheduler's per-task statistics, optionally clearing them.  |
+    |   Arguments:  Via buf, uint16_t, buf                                                  |
+    |               Bytes               Field                                               |
+    |               -------------------------------------------                             |
+    |               0                   Command                                             |
+    |               1                   Reset after reading (0/1, optional, 0 if absent)    |
+    |                                                                                       |
+    |               Return data                                                             |
+    |               0                   Task count                                          |
+    |               1-                  Per task: run count (4), worst execution (us, 2),   |
+    |                                   worst lateness (ms, 2), deadline misses (2),        |
+    |                                   period (ms, 2)                                      |
+    |                                                                                       |
+    |   Returns:    int16_t (error code)                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t getTaskStatsCmd(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getPerfStatsCmd                                                         |
+    |   Purpose:    Returns the performance counters and timers, or clears them.            |
+    |   Arguments:  Via buf, uint16_t, buf                                                  |
+    |               Bytes               Field                                               |
+    |               -------------------------------------------                             |
+    |               0                   Command                                             |
+    |               1                   Subcommand (PERF_STATS_READ/RESET, optional, read)  |
+    |                                                                                       |
+    |               Return data (read only, see getPerfStats)                               |
+    |               0                   Counter count (N)                                   |
+    |               1                   Timer count (M)                                     |
+    |               2-                  UART bytes in, UART bytes out, serial frames,       |
+    |                                   serial frames dropped, radio frames sent, radio     |
+    |                                   frames received, radio frames dropped (4 each)      |
+    |               2+4N-               Per timer (loop, radio transmit, LBT wait): min,    |
+    |                                   max, mean, samples (4 each, us)                     |
+    |                                                                                       |
+    |   Returns:    int16_t (error code)                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t getPerfStatsCmd(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getCommandStats                                                         |
+    |   Purpose:    Returns how often each command has run and its longest execution time,  |
+    |               optionally clearing them.                                               |
+    |   Arguments:  Via buf, uint16_t, buf                                                  |
+    |               Bytes               Field                                               |
+    |               -------------------------------------------                             |
+    |               0                   Command                                             |
+    |               1                   Reset after reading (0/1, optional, 0 if absent)    |
+    |                                                                                       |
+    |   Returns:    int16_t (error code)                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t getCommandStats(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getEnergyStatusCmd                                                      |
+    |   Purpose:    Returns the time spent in each radio and MCU state since boot, and the  |
+    |               charge it cost at the ENERGY_* currents.                                |
+    |   Arguments:  Via buf, uint16_t, buf                                                  |
+    |               Bytes               Field                                               |
+    |               -------------------------------------------                             |
+    |               0-3                 Uptime (ms)                                         |
+    |               4-7                 Transmitting, time on air (ms)                      |
+    |               8-11                Listening (ms)                                      |
+    |               12-15               Radio standby (ms)                                  |
+    |               16-19               MCU active (ms)                                     |
+    |               20-23               MCU idle (ms)                                       |
+    |               24-43               Charge in each of those states, same order (uAh)    |
+    |               44-47               Total charge (uAh)                                  |
+    |               (ENERGY_STATUS_SCHEMA, FLOAT_PAYLOADS sends the charges in mAh)         |
+    |                                                                                       |
+    |   Returns:    int16_t (error code)                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t getEnergyStatusCmd(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getStoreForwardStatusCmd                                                |
+    |   Purpose:    Returns the store-and-forward settings, link state, ring occupancy, and |
+    |               counts since boot.                                                      |
+    |   Arguments:  Via buf, uint16_t, buf                                                  |
+    |               Bytes               Field                                               |
+    |               -------------------------------------------                             |
+    |               0                   Enabled                                             |
+    |               1                   Link up                                             |
+    |               2-3                 Link timeout (s)                                    |
+    |               4-5                 Store interval (s)                                  |
+    |               6-9                 Since a frame was heard (ms, 0xFFFFFFFF never)      |
+    |               10                  Slots in the ring                                   |
+    |               11                  Slots pending                                       |
+    |               12-13               Next sequence                                       |
+    |               14-15               Records stored                                      |
+    |               16-17               Records forwarded                                   |
+    |               18-19               Overwritten while pending                           |
+    |               20-21               Dropped, too long for a slot                        |
+    |               (STORE_FORWARD_STATUS_SCHEMA)                                           |
+    |                                                                                       |
+    |   Returns:    int16_t (error code)                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t getStoreForwardStatusCmd(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getRadioProfiles                                                        |
+    |   Purpose:    Returns the boot selector and the name of each stored profile.          |
+    |   Arguments:  Via buf, uint16_t, buf                                                  |
+    |               Bytes               Field                                               |
+    |               -------------------------------------------                             |
+    |               0                   Boot profile index (0xFF for the defaults)          |
+    |               1-72                Per slot: valid (1), name (8)                       |
     |                                                                                       |
     |   Returns:    int16_t (error code)                                                    |
     \*-------------------------------------------------------------------------------------*/
-    int16_t getModuleStatus(const uint8_t* buf, uint16_t len, uint8_t* retBuf);
+    int16_t getRadioProfiles(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen);
 
     /* ------------------------- Miscellaneous ------------------------- */
 
@@ -203,7 +675,7 @@
     |                                                                                       |
     |   Returns:    int16_t (error code)                                                    |
     \*-------------------------------------------------------------------------------------*/
-    int16_t radioReset(uint16_t len);
+    int16_t radioReset(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen);
         
     /*-------------------------------------------------------------------------------------*\
     |   Name:       systemReset                                                             |
@@ -215,7 +687,7 @@
     |                                                                                       |
     |   Returns:    int16_t (error code)                                                    |
     \*-------------------------------------------------------------------------------------*/
-    int16_t systemReset(uint16_t len);
+    int16_t systemReset(const uint8_t* buf, uint16_t len, uint8_t* retBuf, uint16_t* retLen);
 
 
 #endif /* INC_COMMANDS_H_ */
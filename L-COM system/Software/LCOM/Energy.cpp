@@ -0,0 +1,111 @@
+#include "Energy.h"
+
+
+/*-------------------------------------------------------------------------*\
+|								   Variables					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /* Time in a state, whole ms and the us left over */
+    struct EnergyTime{
+        uint32_t ms;
+        uint16_t us;
+    };
+
+    /* Transmit charge varies with the power, so it's added up per frame */
+    #define ENERGY_CHARGE_PER_UAH           360000UL                // 0.1 mA x 100 us units in a uAh
+
+    EnergyTime txTime;
+    EnergyTime standbyTime;
+    EnergyTime idleTime;
+    uint32_t txCharge = 0;                                  // uAh
+    uint32_t txChargeRemainder = 0;                         // 0.1 mA x 100 us, under ENERGY_CHARGE_PER_UAH
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       addEnergyTime                                                           |
+    |   Purpose:    Adds to the time in a state.                                            |
+    |   Arguments:  EnergyTime&, uint32_t (us)                                              |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void addEnergyTime(EnergyTime& time, uint32_t elapsed){
+        elapsed += time.us;
+        time.ms += elapsed / 1000;
+        time.us = elapsed % 1000;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       chargeOf                                                                |
+    |   Purpose:    Returns the charge of a time at a constant current.                     |
+    |   Arguments:  uint32_t (ms), uint16_t (0.1 mA)                                        |
+    |   Returns:    uint32_t (uAh)                                                          |
+    \*-------------------------------------------------------------------------------------*/
+    uint32_t chargeOf(uint32_t ms, uint16_t current){
+        /* Whole 3.6 s steps first, so a long flight at the highest current can't overflow */
+        return (ms / 3600) * current / 10;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       accountRadioTransmit                                                    |
+    |   Purpose:    Counts one call of transmitRadio: its time on air as transmitting at    |
+    |               the given power and current limit, the rest of it as standby.           |
+    |   Arguments:  uint32_t (time on air, us), uint32_t (whole call, us), int8_t (dBm),    |
+    |               uint16_t (0.1 mA)                                                       |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void accountRadioTransmit(uint32_t timeOnAir, uint32_t elapsed, int8_t power, uint16_t currentLimit){
+        /* The estimate can run over a short frame's measured call, the frame still went out */
+        if(timeOnAir > elapsed) elapsed = timeOnAir;
+        addEnergyTime(txTime, timeOnAir);
+        addEnergyTime(standbyTime, elapsed - timeOnAir);
+
+        /* The PA draws more with the power, until the current limit holds it */
+        int16_t current = ENERGY_TX_CURRENT_0DBM + ENERGY_TX_CURRENT_PER_DBM*power;
+        if(current > (int16_t)currentLimit) current = currentLimit;
+        if(current < 0) current = 0;
+
+        txChargeRemainder += (timeOnAir / 100) * current;
+        txCharge += txChargeRemainder / ENERGY_CHARGE_PER_UAH;
+        txChargeRemainder %= ENERGY_CHARGE_PER_UAH;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       accountMcuIdle                                                          |
+    |   Purpose:    Counts time the MCU spent asleep.                                       |
+    |   Arguments:  uint32_t (us)                                                           |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void accountMcuIdle(uint32_t elapsed){
+        addEnergyTime(idleTime, elapsed);
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getEnergyStatus                                                         |
+    |   Purpose:    Returns the time in each state since boot and the charge it cost.       |
+    |   Arguments:  void                                                                    |
+    |   Returns:    EnergyStatus                                                            |
+    \*-------------------------------------------------------------------------------------*/
+    EnergyStatus getEnergyStatus(void){
+        EnergyStatus status;
+        status.uptime = millis();
+
+        /* Whatever isn't counted elsewhere is listening, or running */
+        status.txTime = txTime.ms;
+        status.standbyTime = standbyTime.ms;
+        status.rxTime = status.uptime - status.txTime - status.standbyTime;
+        status.mcuIdleTime = idleTime.ms;
+        status.mcuActiveTime = status.uptime - status.mcuIdleTime;
+
+        status.txCharge = txCharge;
+        status.rxCharge = chargeOf(status.rxTime, ENERGY_RX_CURRENT);
+        status.standbyCharge = chargeOf(status.standbyTime, ENERGY_STANDBY_CURRENT);
+        status.mcuActiveCharge = chargeOf(status.mcuActiveTime, ENERGY_MCU_ACTIVE_CURRENT);
+        status.mcuIdleCharge = chargeOf(status.mcuIdleTime, ENERGY_MCU_IDLE_CURRENT);
+        status.totalCharge = status.txCharge + status.rxCharge + status.standbyCharge + status.mcuActiveCharge + status.mcuIdleCharge;
+        return status;
+    }
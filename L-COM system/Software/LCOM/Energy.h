@@ -0,0 +1,75 @@
+#ifndef INC_ENERGY_H_
+#define INC_ENERGY_H_
+
+#include <Arduino.h>
+#include "Schemas.h"
+
+
+/*-------------------------------------------------------------------------*\
+|								  Definitions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*
+     * Time spent in each radio and MCU state since boot, and the charge it cost at each state's
+     * current. The transmitter is counted by the calculated time on air at the power the chip was
+     * given, the rest of transmitRadio as standby, and the rest of the uptime as listening; the
+     * MCU is idle while the scheduler sleeps and active otherwise. The radio is never put to
+     * sleep, so it has no sleep state. The currents are estimates, override them to match a board.
+     */
+
+    /* Radio currents (0.1 mA), SX1262 datasheet typicals */
+    #ifndef ENERGY_TX_CURRENT_0DBM
+    #define ENERGY_TX_CURRENT_0DBM          410                     // Transmitting, extrapolated to 0 dBm
+    #endif
+    #ifndef ENERGY_TX_CURRENT_PER_DBM
+    #define ENERGY_TX_CURRENT_PER_DBM       35                      // Added per dBm of output power, up to the current limit
+    #endif
+    #ifndef ENERGY_RX_CURRENT
+    #define ENERGY_RX_CURRENT               53                      // Listening, boosted gain
+    #endif
+    #ifndef ENERGY_STANDBY_CURRENT
+    #define ENERGY_STANDBY_CURRENT          12                      // Crystal running, between listening and transmitting
+    #endif
+
+    /* MCU currents (0.1 mA), ATmega328P at 8 MHz and 5 V */
+    #ifndef ENERGY_MCU_ACTIVE_CURRENT
+    #define ENERGY_MCU_ACTIVE_CURRENT       50
+    #endif
+    #ifndef ENERGY_MCU_IDLE_CURRENT
+    #define ENERGY_MCU_IDLE_CURRENT         15
+    #endif
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       accountRadioTransmit                                                    |
+    |   Purpose:    Counts one call of transmitRadio: its time on air as transmitting at    |
+    |               the given power and current limit, the rest of it as standby.           |
+    |   Arguments:  uint32_t (time on air, us), uint32_t (whole call, us), int8_t (dBm),    |
+    |               uint16_t (0.1 mA)                                                       |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void accountRadioTransmit(uint32_t timeOnAir, uint32_t elapsed, int8_t power, uint16_t currentLimit);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       accountMcuIdle                                                          |
+    |   Purpose:    Counts time the MCU spent asleep.                                       |
+    |   Arguments:  uint32_t (us)                                                           |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void accountMcuIdle(uint32_t elapsed);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getEnergyStatus                                                         |
+    |   Purpose:    Returns the time in each state since boot and the charge it cost.       |
+    |   Arguments:  void                                                                    |
+    |   Returns:    EnergyStatus                                                            |
+    \*-------------------------------------------------------------------------------------*/
+    EnergyStatus getEnergyStatus(void);
+
+#endif /* INC_ENERGY_H_ */
@@ -0,0 +1,317 @@
+#include "FrequencyHopping.h"
+
+
+/*-------------------------------------------------------------------------*\
+|								   Variables					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    bool hoppingEnabled = false;
+    uint16_t hopSeed = HOP_DEFAULT_SEED;
+    uint32_t hopChannels[HOP_MAX_CHANNELS];                 // kHz
+    uint8_t hopChannelCount = 0;
+
+    /* Sequence state, each direction of the link hops on the sender's own counter */
+    uint16_t txFrame = 0;
+    uint16_t rxFrame = 0;
+    bool hopSynced = false;
+    uint8_t hopTxChannel = HOP_HOME_CHANNEL;                // Channel of the frame going out
+    uint32_t lastHopTransmitTime = 0;                       // When the last frame finished going out
+    uint32_t hopTxGap = 0;                                  // ms between the last two frames sent, 0 if unknown
+    uint32_t lastHopReceiveTime = 0;
+    uint32_t hopRxGap = 0;                                  // ms between the last two consecutive frames heard, 0 if unknown
+    uint16_t resyncCount = 0;
+
+    /*
+     * Blacklists only ever grow, and each end ORs in the mask the other end advertises, so both converge.
+     * A mask change only takes effect one frame after it was advertised, so the receiver always knows it in time.
+     */
+    uint16_t localBlacklist = 0;
+    uint16_t peerBlacklist = 0;
+    uint16_t txMask = 0;
+    uint16_t txAdvertised = 0;                              // Mask in the frame going out, txMask once it has
+    uint16_t rxMask = 0;
+
+    /* Per-channel statistics */
+    uint8_t channelGood[HOP_MAX_CHANNELS];
+    uint8_t channelErrors[HOP_MAX_CHANNELS];
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       hopChannel                                                              |
+    |   Purpose:    Maps a frame counter to a channel using the seed, skipping blacklisted  |
+    |               channels. Every HOP_SYNC_INTERVAL frames maps to the home channel.      |
+    |   Arguments:  uint16_t, uint16_t                                                      |
+    |   Returns:    uint8_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    uint8_t hopChannel(uint16_t frame, uint16_t mask){
+        if(frame % HOP_SYNC_INTERVAL == 0) return HOP_HOME_CHANNEL;
+
+        /* 16-bit multiply/xorshift hash, cheap on the AVR */
+        uint16_t x = (frame ^ hopSeed) * 0x9E37;
+        x ^= x >> 7;
+        x *= 0x2F1B;
+        x ^= x >> 9;
+
+        /* Walk forward past blacklisted channels */
+        uint8_t ch = x % hopChannelCount;
+        for(uint8_t i = 0; i != hopChannelCount; i++){
+            if(!(mask & ((uint16_t)1 << ch))) return ch;
+            if(++ch == hopChannelCount) ch = 0;
+        }
+        return HOP_HOME_CHANNEL;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       hopParkTime                                                             |
+    |   Purpose:    Returns how long (ms) a receiver waits for the next frame before        |
+    |               parking, given the gap between the last two frames.                     |
+    |   Arguments:  uint32_t                                                                |
+    |   Returns:    uint32_t                                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint32_t hopParkTime(uint32_t gap){
+        if(gap == 0 || gap >= HOP_RESYNC_TIMEOUT / HOP_MISS_GAPS) return HOP_RESYNC_TIMEOUT;
+        return gap * HOP_MISS_GAPS;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       updateBlacklist                                                         |
+    |   Purpose:    Blacklists a channel once it has seen enough frames with too many       |
+    |               errors.                                                                 |
+    |   Arguments:  uint8_t                                                                 |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void updateBlacklist(uint8_t channel){
+        /* Keep the counters from wrapping, preserving the ratio */
+        if(channelGood[channel] == 0xFF || channelErrors[channel] == 0xFF){
+            channelGood[channel] >>= 1;
+            channelErrors[channel] >>= 1;
+        }
+
+        if(channel == HOP_HOME_CHANNEL) return;
+        uint32_t total = (uint32_t)channelGood[channel] + channelErrors[channel];
+        if(total < HOP_BLACKLIST_MIN_FRAMES) return;
+        if((uint32_t)channelErrors[channel] * 100 < (uint32_t)HOP_BLACKLIST_ERROR_PERCENT * total) return;
+
+        uint16_t bit = (uint16_t)1 << channel;
+        if(!(localBlacklist & bit)){
+            localBlacklist |= bit;
+            Log(F("[FHSS] Channel blacklisted:"));
+            Log((uint16_t)channel);
+        }
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       loadHoppingPlan                                                         |
+    |   Purpose:    Enables/disables hopping and loads the seed and channel table. Passing  |
+    |               a zero channel count keeps the current table. Resets sync and stats.    |
+    |   Arguments:  bool, uint16_t, const uint32_t* (kHz), uint8_t                          |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void loadHoppingPlan(bool enable, uint16_t seed, const uint32_t* channels, uint8_t count){
+        /* Load the channel table, falling back to the default plan if none was ever given */
+        if(count > HOP_MAX_CHANNELS) count = HOP_MAX_CHANNELS;
+        if(count > 0){
+            memcpy(hopChannels, channels, count * sizeof(hopChannels[0]));
+            hopChannelCount = count;
+        }
+        else if(hopChannelCount == 0){
+            for(uint8_t i = 0; i != HOP_DEFAULT_CHANNELS; i++){
+                hopChannels[i] = HOP_DEFAULT_BASE_FREQUENCY + i * HOP_DEFAULT_CHANNEL_SPACING;
+            }
+            hopChannelCount = HOP_DEFAULT_CHANNELS;
+        }
+
+        /* Reset the sequence, blacklist, and statistics */
+        hopSeed = seed;
+        txFrame = 0;
+        rxFrame = 0;
+        hopSynced = false;
+        hopTxGap = hopRxGap = 0;
+        resyncCount = 0;
+        localBlacklist = peerBlacklist = txMask = txAdvertised = rxMask = 0;
+        for(uint8_t i = 0; i != HOP_MAX_CHANNELS; i++) channelGood[i] = channelErrors[i] = 0;
+
+        /* Force the first frame onto the home channel */
+        lastHopTransmitTime = millis() - 2 * HOP_RESYNC_TIMEOUT - 1;
+
+        hoppingEnabled = enable;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getHoppingEnabled                                                       |
+    |   Purpose:    Returns whether frequency hopping is enabled.                           |
+    |   Returns:    bool                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    bool getHoppingEnabled(void){
+        return hoppingEnabled;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getHoppingPlan                                                          |
+    |   Purpose:    Copies out the seed and channel table, returning the channel count.     |
+    |   Arguments:  uint16_t*, uint32_t* (kHz)                                              |
+    |   Returns:    uint8_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    uint8_t getHoppingPlan(uint16_t* seed, uint32_t* channels){
+        *seed = hopSeed;
+        memcpy(channels, hopChannels, hopChannelCount * sizeof(hopChannels[0]));
+        return hopChannelCount;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getHopChannelFrequency                                                  |
+    |   Purpose:    Returns the frequency (kHz) of a channel table entry.                   |
+    |   Arguments:  uint8_t                                                                 |
+    |   Returns:    uint32_t                                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint32_t getHopChannelFrequency(uint8_t channel){
+        return hopChannels[channel];
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       nextHopTransmitChannel                                                  |
+    |   Purpose:    Writes the hop header for the next outgoing frame into buf and returns  |
+    |               the channel to send it on. Call hopTransmitDone once it is on air.      |
+    |   Arguments:  uint8_t*                                                                |
+    |   Returns:    uint8_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    uint8_t nextHopTransmitChannel(uint8_t* buf){
+        /* A sender idle long enough that the receiver has certainly parked goes straight to the home channel */
+        if((millis() - lastHopTransmitTime) > 2 * HOP_RESYNC_TIMEOUT) hopTxChannel = HOP_HOME_CHANNEL;
+        else hopTxChannel = hopChannel(txFrame, txMask);
+
+        /* Advertise the current blacklist, it takes effect from the next frame */
+        txAdvertised = localBlacklist | peerBlacklist;
+        buf[HOP_FRAME_INDEX]        = (txFrame & 0xFF00) >> 8;
+        buf[HOP_FRAME_INDEX+1]      = (txFrame & 0x00FF);
+        buf[HOP_BLACKLIST_INDEX]    = (txAdvertised & 0xFF00) >> 8;
+        buf[HOP_BLACKLIST_INDEX+1]  = (txAdvertised & 0x00FF);
+
+        return hopTxChannel;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       hopTransmitDone                                                         |
+    |   Purpose:    Advances the transmit frame counter past a frame that went on air, and  |
+    |               returns whether it must be repeated on the home channel.                |
+    |   Arguments:  void                                                                    |
+    |   Returns:    bool                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    bool hopTransmitDone(void){
+        /*
+         * The silence is timed end to end, after any LBT deferral, as the receiver times it. Half its park
+         * time leaves room for the receiver's polling latency and a gap that has changed since it last heard.
+         */
+        uint32_t silence = millis() - lastHopTransmitTime;
+        bool repeat = hopTxChannel != HOP_HOME_CHANNEL && silence > hopParkTime(hopTxGap) / 2;
+        hopTxGap = silence;
+        lastHopTransmitTime += silence;
+
+        txMask = txAdvertised;
+        txFrame++;
+        return repeat;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       isHopRepeat                                                             |
+    |   Purpose:    Returns whether a frame heard on the given channel is the home channel  |
+    |               copy of the frame just received on its hop channel.                     |
+    |   Arguments:  const uint8_t*, uint8_t                                                 |
+    |   Returns:    bool                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    bool isHopRepeat(const uint8_t* buf, uint8_t channel){
+        return hopSynced && channel == HOP_HOME_CHANNEL && (uint16_t)(extract_uint16_t(buf, HOP_FRAME_INDEX) + 1) == rxFrame;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       handleHopReceive                                                        |
+    |   Purpose:    Records the outcome of a frame received on the given channel, resyncs   |
+    |               to the sender's counter and blacklist when the header is valid, and     |
+    |               returns the channel to listen on next.                                  |
+    |   Arguments:  const uint8_t*, bool, uint8_t                                           |
+    |   Returns:    uint8_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    uint8_t handleHopReceive(const uint8_t* buf, bool valid, uint8_t channel){
+        if(valid){
+            channelGood[channel]++;
+
+            /* Lock onto the sender's sequence, timing its frames while they come in order */
+            uint16_t frame = extract_uint16_t(buf, HOP_FRAME_INDEX);
+            if(!hopSynced){
+                resyncCount++;
+                Log(F("[FHSS] Synchronized"));
+            }
+            else if(frame == rxFrame) hopRxGap = millis() - lastHopReceiveTime;
+            rxFrame = frame + 1;
+            rxMask = extract_uint16_t(buf, HOP_BLACKLIST_INDEX);
+            peerBlacklist |= rxMask & ~((uint16_t)1 << HOP_HOME_CHANNEL);
+            hopSynced = true;
+            lastHopReceiveTime = millis();
+        }
+        else{
+            /* The header can't be trusted, assume it was the expected frame and stay in step */
+            channelErrors[channel]++;
+            if(hopSynced){
+                rxFrame++;
+                lastHopReceiveTime = millis();
+            }
+        }
+
+        updateBlacklist(channel);
+        return getHopListenChannel();
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getHopListenChannel                                                     |
+    |   Purpose:    Returns the channel the next frame from the peer is expected on, or the |
+    |               home channel once HOP_RESYNC_TIMEOUT has passed without a frame or the  |
+    |               expected frame was missed.                                              |
+    |   Returns:    uint8_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    uint8_t getHopListenChannel(void){
+        /* A missed frame leaves the sender hopping on without us, so wait on the home channel for its next sync frame */
+        if(hopSynced && (millis() - lastHopReceiveTime) > hopParkTime(hopRxGap)){
+            hopSynced = false;
+            hopRxGap = 0;
+            Log(F("[FHSS] Sync lost, parking on home channel"));
+        }
+        if(!hopSynced) return HOP_HOME_CHANNEL;
+        return hopChannel(rxFrame, rxMask);
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getHopStats                                                             |
+    |   Purpose:    Writes the hopping state and per-channel statistics into buf.           |
+    |   Arguments:  uint8_t*                                                                |
+    |   Returns:    uint16_t (bytes written)                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint16_t getHopStats(uint8_t* buf){
+        uint16_t mask = localBlacklist | peerBlacklist;
+
+        buf[0]  = (uint8_t)hoppingEnabled;
+        buf[1]  = (uint8_t)hopSynced;
+        buf[2]  = (txFrame & 0xFF00) >> 8;
+        buf[3]  = (txFrame & 0x00FF);
+        buf[4]  = (rxFrame & 0xFF00) >> 8;
+        buf[5]  = (rxFrame & 0x00FF);
+        buf[6]  = (mask & 0xFF00) >> 8;
+        buf[7]  = (mask & 0x00FF);
+        buf[8]  = (resyncCount & 0xFF00) >> 8;
+        buf[9]  = (resyncCount & 0x00FF);
+        buf[10] = hopChannelCount;
+
+        uint16_t idx = 11;
+        for(uint8_t i = 0; i != hopChannelCount; i++){
+            buf[idx++] = 0;
+            buf[idx++] = channelGood[i];
+            buf[idx++] = 0;
+            buf[idx++] = channelErrors[i];
+        }
+        return idx;
+    }
@@ -0,0 +1,147 @@
+#ifndef INC_FREQUENCYHOPPING_H_
+#define INC_FREQUENCYHOPPING_H_
+
+#include <Arduino.h>
+#include "Utility.h"
+
+
+/*-------------------------------------------------------------------------*\
+|								  Definitions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /* Channel plan */
+    #define HOP_MAX_CHANNELS                16
+    #define HOP_DEFAULT_CHANNELS            16
+    #define HOP_DEFAULT_BASE_FREQUENCY      903000                  // kHz, 903.0 - 927.0 MHz, inside the 902-928 MHz band
+    #define HOP_DEFAULT_CHANNEL_SPACING     1600                    // kHz
+    #define HOP_DEFAULT_SEED                0x4C43                  // "LC"
+    #define HOP_HOME_CHANNEL                0                       // Table index used for sync frames and resync, never blacklisted
+
+    /* Framing */
+    // Hopped frames carry the sender's frame counter and blacklist in front of the message
+    #define HOP_HEADER_LEN                  4
+    #define HOP_FRAME_INDEX                 0
+    #define HOP_BLACKLIST_INDEX             2
+    #define HOP_SYNC_INTERVAL               16                      // Every 16th frame is sent on the home channel
+
+    /*
+     * Resync. A receiver parks on the home channel once the next frame is HOP_MISS_GAPS of the last frame gap
+     * late, or after HOP_RESYNC_TIMEOUT if that's sooner or the gap isn't known. The sender times the same gap,
+     * so a frame that went on air after more than half that silence is repeated on the home channel, and one
+     * sent after twice the timeout goes there alone. The receiver drops a repeat it has already heard.
+     */
+    #define HOP_RESYNC_TIMEOUT              5000                    // ms
+    #define HOP_MISS_GAPS                   4
+
+    /* Blacklisting */
+    #define HOP_BLACKLIST_MIN_FRAMES        8                       // Frames seen on a channel before it can be judged
+    #define HOP_BLACKLIST_ERROR_PERCENT     50
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       loadHoppingPlan                                                         |
+    |   Purpose:    Enables/disables hopping and loads the seed and channel table. Passing  |
+    |               a zero channel count keeps the current table. Resets sync and stats.    |
+    |   Arguments:  bool, uint16_t, const uint32_t* (kHz), uint8_t                          |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void loadHoppingPlan(bool enable, uint16_t seed, const uint32_t* channels, uint8_t count);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getHoppingEnabled                                                       |
+    |   Purpose:    Returns whether frequency hopping is enabled.                           |
+    |   Returns:    bool                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    bool getHoppingEnabled(void);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getHoppingPlan                                                          |
+    |   Purpose:    Copies out the seed and channel table, returning the channel count.     |
+    |   Arguments:  uint16_t*, uint32_t* (kHz)                                              |
+    |   Returns:    uint8_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    uint8_t getHoppingPlan(uint16_t* seed, uint32_t* channels);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getHopChannelFrequency                                                  |
+    |   Purpose:    Returns the frequency (kHz) of a channel table entry.                   |
+    |   Arguments:  uint8_t                                                                 |
+    |   Returns:    uint32_t                                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint32_t getHopChannelFrequency(uint8_t channel);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       nextHopTransmitChannel                                                  |
+    |   Purpose:    Writes the hop header for the next outgoing frame into buf and returns  |
+    |               the channel to send it on. Call hopTransmitDone once it is on air.      |
+    |   Arguments:  uint8_t*                                                                |
+    |   Returns:    uint8_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    uint8_t nextHopTransmitChannel(uint8_t* buf);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       hopTransmitDone                                                         |
+    |   Purpose:    Advances the transmit frame counter past a frame that went on air, and  |
+    |               returns whether the receiver may have parked since the last one, so the |
+    |               frame must be repeated on the home channel. A frame abandoned before    |
+    |               going on air keeps its counter for the next one.                        |
+    |   Arguments:  void                                                                    |
+    |   Returns:    bool                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    bool hopTransmitDone(void);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       isHopRepeat                                                             |
+    |   Purpose:    Returns whether a frame heard on the given channel is the home channel  |
+    |               copy of the frame just received on its hop channel.                     |
+    |   Arguments:  const uint8_t*, uint8_t                                                 |
+    |   Returns:    bool                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    bool isHopRepeat(const uint8_t* buf, uint8_t channel);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       handleHopReceive                                                        |
+    |   Purpose:    Records the outcome of a frame received on the given channel, resyncs   |
+    |               to the sender's counter and blacklist when the header is valid, and     |
+    |               returns the channel to listen on next.                                  |
+    |   Arguments:  const uint8_t*, bool, uint8_t                                           |
+    |   Returns:    uint8_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    uint8_t handleHopReceive(const uint8_t* buf, bool valid, uint8_t channel);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getHopListenChannel                                                     |
+    |   Purpose:    Returns the channel the next frame from the peer is expected on, or the |
+    |               home channel once the expected frame is overdue. A sender silent that   |
+    |               long also repeats its next frame on the home channel, so a link resyncs |
+    |               on the first frame after a pause, and within HOP_SYNC_INTERVAL frames   |
+    |               of a miss while busy.                                                   |
+    |   Returns:    uint8_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    uint8_t getHopListenChannel(void);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getHopStats                                                             |
+    |   Purpose:    Writes the hopping state and per-channel statistics into buf.           |
+    |               Bytes               Field                                               |
+    |               -------------------------------------------                             |
+    |               0                   Enabled                                             |
+    |               1                   Synchronized                                        |
+    |               2-3                 Transmit frame counter                              |
+    |               4-5                 Expected receive frame counter                      |
+    |               6-7                 Blacklist mask                                      |
+    |               8-9                 Resync count                                        |
+    |               10                  Channel count (N)                                   |
+    |               11-(10+4N)          Per channel: good frames (2), errored frames (2)    |
+    |   Arguments:  uint8_t*                                                                |
+    |   Returns:    uint16_t (bytes written)                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint16_t getHopStats(uint8_t* buf);
+
+#endif /* INC_FREQUENCYHOPPING_H_ */
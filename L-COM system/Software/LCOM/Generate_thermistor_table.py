@@ -0,0 +1,100 @@
+# Writes ThermistorTable.h, the temperature at evenly spaced ADC readings, from the divider and
+# Steinhart-Hart constants in Thermistor.h. Rerun whenever those change:
+#	python Generate_thermistor_table.py
+
+
+#--------------------------------------------------------------------------\
+#								  	Imports					   			   |
+#--------------------------------------------------------------------------/
+
+
+import math
+import os
+import re
+
+
+#--------------------------------------------------------------------------\
+#								  Definitions					   		   |
+#--------------------------------------------------------------------------/
+
+
+SCRIPT_DIR			= os.path.dirname(os.path.abspath(__file__))
+THERMISTOR_HEADER	= os.path.join(SCRIPT_DIR, "Thermistor.h")
+OUTPUT_FILE			= os.path.join(SCRIPT_DIR, "ThermistorTable.h")
+
+ADC_STEPS			= 1024
+ENTRIES_PER_LINE	= 8
+
+DEFINE				= re.compile(r"#define\s+(\w+)\s+([-+.\w]+)")
+
+
+#--------------------------------------------------------------------------\
+#								   Functions					   		   |
+#--------------------------------------------------------------------------/
+
+
+# Returns the numeric #defines of a header by name
+def readDefines(_path):
+	defines = {}
+	with open(_path) as header:
+		for line in header:
+			match = DEFINE.search(line)
+			if (match):
+				try:
+					defines[match.group(1)] = float(match.group(2))
+				except ValueError:
+					pass
+	return defines
+
+# Temperature (0.01 degrees C) at an ADC reading, exactly as the firmware used to compute it
+def temperature(_d, _reading):
+	# The ends of the range have no finite resistance, pin them one count in
+	reading = min(max(_reading, 1), _d["ANALOG_MAX_VALUE"] - 1)
+	logR1 = math.log(_d["R2_OHM"] * (_d["ANALOG_MAX_VALUE"] / reading - 1.0))
+	Tc = (1.0 / (_d["C1"] + _d["C2"]*logR1 + _d["C3"]*logR1**3)) - _d["KELVIN_CELCIUS_DIFFERENCE"]
+	return max(-32768, min(32767, int(round(Tc * 100))))
+
+def writeTable(_d, _path):
+	spacing = int(2**_d["THERMISTOR_TABLE_SHIFT"] / _d["THERMISTOR_OVERSAMPLE"])
+	entries = [temperature(_d, i*spacing) for i in range(ADC_STEPS//spacing + 1)]
+
+	lines = [
+		"/*",
+		"*   Generated by Generate_thermistor_table.py from Thermistor.h, do not edit",
+		"*/",
+		"",
+		"#ifndef INC_THERMISTORTABLE_H_",
+		"#define INC_THERMISTORTABLE_H_",
+		"",
+		"#include <Arduino.h>",
+		"#include <avr/pgmspace.h>",
+		"",
+		"",
+		"    /* Temperature (0.01 degrees C) every %d ADC counts, from 0 to %d, only include from Thermistor.cpp */" % (spacing, ADC_STEPS),
+		"    #define THERMISTOR_TABLE_LEN            %d" % len(entries),
+		"",
+		"    const int16_t thermistorTable[THERMISTOR_TABLE_LEN] PROGMEM = {"
+	]
+	for i in range(0, len(entries), ENTRIES_PER_LINE):
+		row = ", ".join("%6d" % t for t in entries[i:i+ENTRIES_PER_LINE])
+		separator = "," if i + ENTRIES_PER_LINE < len(entries) else ""
+		lines.append("        %s%s" % (row, separator))
+	lines += [
+		"    };",
+		"",
+		"#endif /* INC_THERMISTORTABLE_H_ */"
+	]
+
+	with open(_path, "w") as output:
+		output.write("\n".join(lines) + "\n")
+	return entries
+
+
+#--------------------------------------------------------------------------\
+#								     Main					   		   	   |
+#--------------------------------------------------------------------------/
+
+
+if __name__ == "__main__":
+	entries = writeTable(readDefines(THERMISTOR_HEADER), OUTPUT_FILE)
+	print("Wrote %d entries to %s" % (len(entries), OUTPUT_FILE))
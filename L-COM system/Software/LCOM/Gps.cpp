@@ -0,0 +1,445 @@
+#include "Gps.h"
+#include <SoftwareSerial.h>
+
+
+/*-------------------------------------------------------------------------*\
+|								   Variables					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    SoftwareSerial gpsSerial(GPS_RX_PIN, GPS_TX_PIN);
+    uint32_t gpsQuietUntil = 0;                             // millis, while the listener is off
+
+    /* Parser states */
+    #define GPS_STATE_IDLE              0                   // Between messages
+    #define GPS_STATE_NMEA              1                   // After '$', up to '*'
+    #define GPS_STATE_NMEA_CHECKSUM_HI  2
+    #define GPS_STATE_NMEA_CHECKSUM_LO  3
+    #define GPS_STATE_UBX_SYNC          4                   // After the first sync byte
+    #define GPS_STATE_UBX_HEADER        5                   // Class, ID, and length
+    #define GPS_STATE_UBX_PAYLOAD       6
+    #define GPS_STATE_UBX_CK_A          7
+    #define GPS_STATE_UBX_CK_B          8
+
+    /* Messages the parser takes fields from, the rest are only checked */
+    #define GPS_MESSAGE_OTHER           0
+    #define GPS_MESSAGE_GGA             1
+    #define GPS_MESSAGE_RMC             2
+    #define GPS_MESSAGE_UBX_NAV         3                   // Class matched, ID not yet
+    #define GPS_MESSAGE_NAV_PVT         4
+
+    /* NMEA */
+    #define GPS_NMEA_START              '$'
+    #define GPS_NMEA_CHECKSUM           '*'
+    #define GPS_NMEA_GGA                (((uint32_t)'G' << 16) | ((uint32_t)'G' << 8) | 'A')
+    #define GPS_NMEA_RMC                (((uint32_t)'R' << 16) | ((uint32_t)'M' << 8) | 'C')
+    #define GPS_NO_POINT                0xFF
+    #define GPS_MAX_DECIMALS            5                   // Later digits are dropped, ddmm.mmmmm stays within 32 bits
+
+    /* UBX */
+    #define GPS_UBX_SYNC_1              0xB5
+    #define GPS_UBX_SYNC_2              0x62
+    #define GPS_UBX_CLASS_NAV           0x01
+    #define GPS_UBX_ID_PVT              0x07
+    #define GPS_UBX_PVT_LEN             92
+    #define GPS_UBX_MAX_LEN             1024                // Longer is taken as a false sync
+    #define GPS_UBX_FIX_OK              0x01                // NAV-PVT flags
+
+    uint8_t gpsState = GPS_STATE_IDLE;
+    uint8_t gpsMessage = GPS_MESSAGE_OTHER;
+    uint8_t gpsChecksumA = 0;                               // NMEA's XOR, or UBX's CK_A
+    uint8_t gpsChecksumB = 0;
+    uint8_t gpsField = 0;                                   // NMEA field, the talker and sentence are 0
+    uint16_t gpsIndex = 0;                                  // UBX header or payload byte
+    uint16_t gpsLength = 0;                                 // UBX payload length
+
+    /* The field being parsed: NMEA digits so far, or a UBX field's bytes so far */
+    uint32_t gpsValue = 0;
+    uint8_t gpsDecimals = GPS_NO_POINT;
+    bool gpsNegative = false;
+    uint8_t gpsChar = 0;                                    // Last non-numeric character, hemispheres and status
+
+    /* Filled in field by field, sent only once the checksum passes */
+    GpsFix gpsPending;
+
+    /* From the last good RMC, GGA has no speed or course */
+    uint16_t gpsSpeed = 0;
+    uint16_t gpsCourse = 0;
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       scaleGpsValue                                                           |
+    |   Purpose:    Returns the NMEA field as an integer with the given number of digits    |
+    |               after the point.                                                        |
+    |   Arguments:  uint8_t                                                                 |
+    |   Returns:    uint32_t                                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint32_t scaleGpsValue(uint8_t decimals){
+        uint32_t v = gpsValue;
+        uint8_t have = (gpsDecimals == GPS_NO_POINT) ? 0 : gpsDecimals;
+        for(; have < decimals; have++) v *= 10;
+        for(; have > decimals; have--) v /= 10;
+        return v;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getGpsDegrees                                                           |
+    |   Purpose:    Converts the NMEA field, (d)ddmm.mmmmm, to 1e-7 degrees.                |
+    |   Arguments:  void                                                                    |
+    |   Returns:    int32_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    int32_t getGpsDegrees(void){
+        uint32_t v = scaleGpsValue(GPS_MAX_DECIMALS);
+        uint32_t degrees = v / 10000000;
+        uint32_t minutes = v - degrees*10000000;            // 1e-5 minutes
+        return degrees*10000000 + (minutes*100 + 30) / 60;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getGpsTime                                                              |
+    |   Purpose:    Converts the NMEA field, hhmmss.sss, to ms since midnight.              |
+    |   Arguments:  void                                                                    |
+    |   Returns:    uint32_t                                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint32_t getGpsTime(void){
+        uint32_t v = scaleGpsValue(3);
+        uint32_t hours = v / 10000000;
+        uint32_t minutes = (v / 100000) % 100;
+        return (hours*60 + minutes)*60000 + v % 100000;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       hexDigit                                                                |
+    |   Purpose:    Returns the value of a hex digit, 0xFF if it isn't one.                 |
+    |   Arguments:  uint8_t                                                                 |
+    |   Returns:    uint8_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    uint8_t hexDigit(uint8_t c){
+        if(c >= '0' && c <= '9') return c - '0';
+        if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return 0xFF;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       sendGpsFix                                                              |
+    |   Purpose:    Sends the pending fix as a telemetry record.                            |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void sendGpsFix(void){
+        PERF_COUNT(PERF_GPS_FIXES);
+        gpsPending.time = millis();
+
+        if(!telemetryRecordDue(TELEMETRY_GPS_FIX)) return;
+        uint8_t* record = beginTelemetryRecord(TELEMETRY_GPS_FIX);
+        if(record == NULL) return;
+        sendTelemetryRecord(encodeGpsFix(record, gpsPending) - record);
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       startNmeaField                                                          |
+    |   Purpose:    Clears the field accumulator for the next NMEA field.                   |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void startNmeaField(void){
+        gpsValue = 0;
+        gpsDecimals = GPS_NO_POINT;
+        gpsNegative = false;
+        gpsChar = 0;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       takeNmeaChar                                                            |
+    |   Purpose:    Folds one character into the field being parsed.                        |
+    |   Arguments:  uint8_t                                                                 |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void takeNmeaChar(uint8_t c){
+        /* The talker and sentence, only the last three letters are kept */
+        if(gpsField == 0) gpsValue = (gpsValue << 8) | c;
+        else if(c >= '0' && c <= '9'){
+            if(gpsDecimals == GPS_NO_POINT) gpsValue = gpsValue*10 + (c - '0');
+            else if(gpsDecimals < GPS_MAX_DECIMALS){
+                gpsValue = gpsValue*10 + (c - '0');
+                gpsDecimals++;
+            }
+        }
+        else if(c == '.') gpsDecimals = 0;
+        else if(c == '-') gpsNegative = true;
+        else gpsChar = c;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       endNmeaField                                                            |
+    |   Purpose:    Stores the field just parsed into the pending fix, by sentence and      |
+    |               field number. Empty fields store 0.                                     |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void endNmeaField(void){
+        if(gpsField == 0){
+            uint32_t sentence = gpsValue & 0xFFFFFF;
+            if(sentence == GPS_NMEA_GGA) gpsMessage = GPS_MESSAGE_GGA;
+            else if(sentence == GPS_NMEA_RMC) gpsMessage = GPS_MESSAGE_RMC;
+            return;
+        }
+
+        if(gpsMessage == GPS_MESSAGE_GGA){
+            switch(gpsField){
+                case 1: gpsPending.utcTime = getGpsTime(); break;
+                case 2: gpsPending.latitude = getGpsDegrees(); break;
+                case 3: if(gpsChar == 'S') gpsPending.latitude = -gpsPending.latitude; break;
+                case 4: gpsPending.longitude = getGpsDegrees(); break;
+                case 5: if(gpsChar == 'W') gpsPending.longitude = -gpsPending.longitude; break;
+                case 6:
+                    if(gpsValue == 0) gpsPending.fixType = GPS_FIX_NONE;
+                    else if(gpsValue == 6) gpsPending.fixType = GPS_FIX_DEAD_RECKONING;
+                    else gpsPending.fixType = GPS_FIX_3D;
+                    break;
+                case 7: gpsPending.satellites = gpsValue; break;
+                case 9:
+                    gpsPending.altitude = scaleGpsValue(2);
+                    if(gpsNegative) gpsPending.altitude = -gpsPending.altitude;
+                    break;
+            }
+        }
+        else if(gpsMessage == GPS_MESSAGE_RMC){
+            switch(gpsField){
+                case 2: gpsPending.fixType = (gpsChar == 'A') ? GPS_FIX_3D : GPS_FIX_NONE; break;
+                case 7: gpsPending.speed = (scaleGpsValue(3)*463 + 4500) / 9000; break;    // 0.001 knots to cm/s
+                case 8: gpsPending.course = scaleGpsValue(2); break;
+            }
+        }
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       endNmeaSentence                                                         |
+    |   Purpose:    Acts on a sentence whose checksum passed. RMC's speed and course are    |
+    |               kept for the GGA that follows, GGA sends the fix.                       |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void endNmeaSentence(void){
+        if(gpsMessage == GPS_MESSAGE_RMC){
+            bool moving = gpsPending.fixType != GPS_FIX_NONE;
+            gpsSpeed = moving ? gpsPending.speed : 0;
+            gpsCourse = moving ? gpsPending.course : 0;
+        }
+        else if(gpsMessage == GPS_MESSAGE_GGA && gpsPending.fixType != GPS_FIX_NONE){
+            gpsPending.speed = gpsSpeed;
+            gpsPending.course = gpsCourse;
+            sendGpsFix();
+        }
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       takeUbxByte                                                             |
+    |   Purpose:    Stores one byte of a NAV-PVT payload into the pending fix. Four-byte    |
+    |               fields are built up little-endian and stored on their last byte.        |
+    |   Arguments:  uint16_t (payload offset), uint8_t                                      |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void takeUbxByte(uint16_t index, uint8_t c){
+        switch(index){
+            case 8: gpsPending.utcTime = (uint32_t)c * 3600000; break;                       // hour
+            case 9: gpsPending.utcTime += (uint32_t)c * 60000; break;                        // min
+            case 10: gpsPending.utcTime += (uint32_t)c * 1000; break;                        // sec
+            case 20:                                                                         // fixType
+                if(c == 1) gpsPending.fixType = GPS_FIX_DEAD_RECKONING;
+                else if(c == 2) gpsPending.fixType = GPS_FIX_2D;
+                else if(c == 3 || c == 4) gpsPending.fixType = GPS_FIX_3D;
+                else gpsPending.fixType = GPS_FIX_NONE;
+                break;
+            case 21: if(!(c & GPS_UBX_FIX_OK)) gpsPending.fixType = GPS_FIX_NONE; break;     // flags
+            case 23: gpsPending.satellites = c; break;                                       // numSV
+        }
+
+        if(index < 16) return;
+        uint8_t shift = (index & 3) * 8;
+        if(shift == 0) gpsValue = 0;
+        gpsValue |= (uint32_t)c << shift;
+        if(shift != 24) return;
+
+        switch(index - 3){
+            case 16:{                                                                        // nano, can be negative
+                int32_t ms = (int32_t)gpsValue / 1000000;
+                gpsPending.utcTime = (ms < 0 && gpsPending.utcTime < (uint32_t)-ms) ? 0 : gpsPending.utcTime + ms;
+                break;
+            }
+            case 24: gpsPending.longitude = (int32_t)gpsValue; break;                        // lon, 1e-7 degrees
+            case 28: gpsPending.latitude = (int32_t)gpsValue; break;                         // lat, 1e-7 degrees
+            case 36: gpsPending.altitude = (int32_t)gpsValue / 10; break;                    // hMSL, mm
+            case 60:                                                                         // gSpeed, mm/s
+                gpsPending.speed = ((int32_t)gpsValue < 0) ? 0 : (gpsValue/10 > UINT16_MAX) ? UINT16_MAX : gpsValue/10;
+                break;
+            case 64: gpsPending.course = (int32_t)gpsValue / 1000; break;                    // headMot, 1e-5 degrees
+        }
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       initializeGps                                                           |
+    |   Purpose:    Opens the software serial port to the receiver.                         |
+    |   Arguments:  void                                                                    |
+    |   Returns:    int16_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t initializeGps(void){
+        gpsSerial.begin(GPS_BAUD);
+
+        /* A u-blox receiver stops the sentences nothing here reads, every byte received costs a
+         * millisecond with interrupts off. Other receivers ignore these. */
+        gpsSerial.print(F("$PUBX,40,GLL,0,0,0,0,0,0*5C\r\n"));
+        gpsSerial.print(F("$PUBX,40,GSA,0,0,0,0,0,0*4E\r\n"));
+        gpsSerial.print(F("$PUBX,40,GSV,0,0,0,0,0,0*59\r\n"));
+        gpsSerial.print(F("$PUBX,40,VTG,0,0,0,0,0,0*5E\r\n"));
+        return GPS_OK;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       parseGpsByte                                                            |
+    |   Purpose:    Feeds one byte of receiver output through the parser, sending a fix     |
+    |               record when it completes a GGA sentence or a NAV-PVT message.           |
+    |   Arguments:  uint8_t                                                                 |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void parseGpsByte(uint8_t c){
+        /* A sentence start always starts over, a cut-off message is simply never completed */
+        if(c == GPS_NMEA_START && gpsState < GPS_STATE_UBX_HEADER){
+            if(gpsState != GPS_STATE_IDLE) PERF_COUNT(PERF_GPS_ERRORS);
+            gpsState = GPS_STATE_NMEA;
+            gpsMessage = GPS_MESSAGE_OTHER;
+            gpsChecksumA = 0;
+            gpsField = 0;
+            startNmeaField();
+            return;
+        }
+
+        switch(gpsState){
+            case GPS_STATE_IDLE:
+                if(c == GPS_UBX_SYNC_1) gpsState = GPS_STATE_UBX_SYNC;
+                break;
+
+            case GPS_STATE_NMEA:
+                if(c == GPS_NMEA_CHECKSUM){
+                    endNmeaField();
+                    gpsState = GPS_STATE_NMEA_CHECKSUM_HI;
+                }
+                else if(c < ' ' || c > '~'){
+                    PERF_COUNT(PERF_GPS_ERRORS);
+                    gpsState = GPS_STATE_IDLE;
+                }
+                else{
+                    gpsChecksumA ^= c;
+                    if(c == ','){
+                        endNmeaField();
+                        gpsField++;
+                        startNmeaField();
+                    }
+                    else if(gpsField == 0 || gpsMessage != GPS_MESSAGE_OTHER) takeNmeaChar(c);
+                }
+                break;
+
+            case GPS_STATE_NMEA_CHECKSUM_HI:
+                gpsValue = hexDigit(c);
+                gpsState = GPS_STATE_NMEA_CHECKSUM_LO;
+                break;
+
+            case GPS_STATE_NMEA_CHECKSUM_LO:
+                if(gpsValue <= 0x0F && hexDigit(c) <= 0x0F && ((gpsValue << 4) | hexDigit(c)) == gpsChecksumA) endNmeaSentence();
+                else PERF_COUNT(PERF_GPS_ERRORS);
+                gpsState = GPS_STATE_IDLE;
+                break;
+
+            case GPS_STATE_UBX_SYNC:
+                gpsState = (c == GPS_UBX_SYNC_2) ? GPS_STATE_UBX_HEADER : GPS_STATE_IDLE;
+                gpsChecksumA = 0;
+                gpsChecksumB = 0;
+                gpsIndex = 0;
+                break;
+
+            case GPS_STATE_UBX_HEADER:
+                gpsChecksumA += c;
+                gpsChecksumB += gpsChecksumA;
+                if(gpsIndex == 0) gpsMessage = (c == GPS_UBX_CLASS_NAV) ? GPS_MESSAGE_UBX_NAV : GPS_MESSAGE_OTHER;
+                else if(gpsIndex == 1) gpsMessage = (gpsMessage == GPS_MESSAGE_UBX_NAV && c == GPS_UBX_ID_PVT) ? GPS_MESSAGE_NAV_PVT : GPS_MESSAGE_OTHER;
+                else if(gpsIndex == 2) gpsLength = c;
+                else{
+                    gpsLength |= (uint16_t)c << 8;
+                    if(gpsLength > GPS_UBX_MAX_LEN){
+                        PERF_COUNT(PERF_GPS_ERRORS);
+                        gpsState = GPS_STATE_IDLE;
+                        break;
+                    }
+                    if(gpsMessage == GPS_MESSAGE_NAV_PVT && gpsLength != GPS_UBX_PVT_LEN) gpsMessage = GPS_MESSAGE_OTHER;
+                    gpsState = (gpsLength != 0) ? GPS_STATE_UBX_PAYLOAD : GPS_STATE_UBX_CK_A;
+                    gpsIndex = 0;
+                    break;
+                }
+                gpsIndex++;
+                break;
+
+            case GPS_STATE_UBX_PAYLOAD:
+                gpsChecksumA += c;
+                gpsChecksumB += gpsChecksumA;
+                if(gpsMessage == GPS_MESSAGE_NAV_PVT) takeUbxByte(gpsIndex, c);
+                if(++gpsIndex == gpsLength) gpsState = GPS_STATE_UBX_CK_A;
+                break;
+
+            case GPS_STATE_UBX_CK_A:
+                if(c == gpsChecksumA) gpsState = GPS_STATE_UBX_CK_B;
+                else{
+                    PERF_COUNT(PERF_GPS_ERRORS);
+                    gpsState = GPS_STATE_IDLE;
+                }
+                break;
+
+            case GPS_STATE_UBX_CK_B:
+                if(c != gpsChecksumB) PERF_COUNT(PERF_GPS_ERRORS);
+                else if(gpsMessage == GPS_MESSAGE_NAV_PVT && gpsPending.fixType != GPS_FIX_NONE) sendGpsFix();
+                gpsState = GPS_STATE_IDLE;
+                break;
+        }
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       serviceGps                                                              |
+    |   Purpose:    Scheduler task. Parses what the receiver sent since the last run, and   |
+    |               listens again once a quiet time is over.                                |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void serviceGps(void){
+        /* The sentence the listener was stopped in can't complete, the parser waits for the next */
+        if(!gpsSerial.isListening()){
+            if((int32_t)(millis() - gpsQuietUntil) < 0) return;
+            gpsState = GPS_STATE_IDLE;
+            gpsSerial.listen();
+            return;
+        }
+        if(!gpsSerial.available()) return;
+
+        PERF_TIMER_START(PERF_GPS_PARSE);
+        uint8_t n = 0;
+        while(n != GPS_MAX_BYTES_PER_SERVICE && gpsSerial.available()){
+            parseGpsByte(gpsSerial.read());
+            n++;
+        }
+        PERF_ADD(PERF_GPS_BYTES, n);
+        PERF_TIMER_STOP(PERF_GPS_PARSE);
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       quietGps                                                                |
+    |   Purpose:    Stops listening to the receiver for at least the given time (ms).       |
+    |   Arguments:  uint16_t                                                                |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void quietGps(uint16_t ms){
+        uint32_t until = millis() + ms;
+        if(gpsSerial.stopListening() || (int32_t)(until - gpsQuietUntil) > 0) gpsQuietUntil = until;
+    }
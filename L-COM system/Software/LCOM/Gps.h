@@ -0,0 +1,87 @@
+#ifndef INC_GPS_H_
+#define INC_GPS_H_
+
+#include <Arduino.h>
+#include "Perf.h"
+#include "Schemas.h"
+#include "Telemetry.h"
+
+
+/*-------------------------------------------------------------------------*\
+|								  Definitions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*
+     * The receiver's output is parsed a byte at a time as it's read, NMEA GGA/RMC and UBX NAV-PVT alike.
+     * Numbers are accumulated into integers digit by digit and checksums are run as the bytes go by, so
+     * nothing is buffered or copied and a fix goes out as a telemetry record the moment its checksum
+     * passes. Anything else the receiver sends is checked and skipped.
+     */
+
+    /* Wiring, on a software serial port since the hardware UART is the host's */
+    #define GPS_RX_PIN                      4                       // Receiver TX
+    #define GPS_TX_PIN                      5                       // Receiver RX
+    #define GPS_BAUD                        9600
+    #define GPS_MAX_BYTES_PER_SERVICE       64                      // Bounds one run of serviceGps, a full software serial buffer
+
+    /*
+     * The software serial port keeps interrupts off for a millisecond for every byte it takes in, long
+     * enough for the UART to overrun at SERIAL_BAUD and for DIO1 to be timestamped late. There's no
+     * hardware for it to move to, pins 8 and 9 that AltSoftSerial needs are the radio's BUSY and NRST,
+     * so the listener is turned off with quietGps while the host is sending, while the radio transmits,
+     * and around the beacon a time sync slave expects. serviceGps turns it back on once the quiet time
+     * is over. What the receiver sends meanwhile is lost, a fix is skipped but never wrong.
+     */
+    #define GPS_HOST_QUIET                  1000                    // ms after each host byte, longer than a host's retry after an overrun
+
+    /* Fix types, UBX NAV-PVT's, NMEA's GGA quality maps onto them */
+    #define GPS_FIX_NONE                    0
+    #define GPS_FIX_DEAD_RECKONING          1
+    #define GPS_FIX_2D                      2
+    #define GPS_FIX_3D                      3                       // Every GGA fix, GGA doesn't say whether it's 2D
+
+    /* Status codes */
+    #define GPS_OK                          0x0000
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       initializeGps                                                           |
+    |   Purpose:    Opens the software serial port to the receiver.                         |
+    |   Arguments:  void                                                                    |
+    |   Returns:    int16_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t initializeGps(void);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       parseGpsByte                                                            |
+    |   Purpose:    Feeds one byte of receiver output through the parser, sending a fix     |
+    |               record when it completes a GGA sentence or a NAV-PVT message.           |
+    |   Arguments:  uint8_t                                                                 |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void parseGpsByte(uint8_t c);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       serviceGps                                                              |
+    |   Purpose:    Scheduler task. Parses what the receiver sent since the last run, and   |
+    |               listens again once a quiet time is over.                                |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void serviceGps(void);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       quietGps                                                                |
+    |   Purpose:    Stops listening to the receiver for at least the given time (ms).       |
+    |   Arguments:  uint16_t                                                                |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void quietGps(uint16_t ms);
+
+#endif /* INC_GPS_H_ */
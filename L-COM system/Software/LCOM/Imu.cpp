@@ -0,0 +1,305 @@
+#include "Imu.h"
+#include "ImuSummary.h"
+#include "SpscQueue.h"
+
+
+/*-------------------------------------------------------------------------*\
+|								   Variables					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    bool imuPresent = false;
+    uint16_t imuRate = 0;                                   // Hz, 0 while stopped
+    uint8_t imuBatch = IMU_DEFAULT_BATCH;                   // 0 while only summaries are sent
+
+    /* Written by the INT pin interrupt, every sample the IMU takes is numbered here whether it's read or not */
+    volatile uint16_t imuProduced = 0;
+    volatile uint32_t imuProducedMillis = 0;                // When the last one was taken
+
+    /* Samples read out of the FIFO, waiting to be batched */
+    SpscQueue<ImuSample, IMU_QUEUE_LEN> imuQueue;
+    uint16_t imuSequence = 0;                               // Number of the next sample the FIFO gives up, the queue holds those just before it
+    uint16_t imuStampSequence = 0;                          // A sample number and when it was taken, for timing batches
+    uint32_t imuStampMillis = 0;
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       imuDataReady                                                            |
+    |   Purpose:    INT pin interrupt, counts one sample. This is the watermark: the FIFO   |
+    |               itself is only touched once enough have been counted.                   |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void imuDataReady(void){
+        imuProduced++;
+        imuProducedMillis = millis();
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       writeImuRegister                                                        |
+    |   Purpose:    Writes one MPU9250 register.                                            |
+    |   Arguments:  uint8_t, uint8_t                                                        |
+    |   Returns:    bool (false if the IMU didn't acknowledge)                              |
+    \*-------------------------------------------------------------------------------------*/
+    bool writeImuRegister(uint8_t reg, uint8_t value){
+        uint8_t data[2] = { reg, value };
+        TwiTransfer transfer = { IMU_ADDRESS, data, 2, NULL, 0, TWI_OK };
+        return runTwiTransfer(&transfer) == TWI_OK;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       readImuRegisters                                                        |
+    |   Purpose:    Burst reads from an MPU9250 register. The FIFO_R_W register gives up    |
+    |               successive FIFO bytes.                                                  |
+    |   Arguments:  uint8_t, uint8_t*, uint8_t                                              |
+    |   Returns:    bool (false if the IMU didn't acknowledge or came up short)             |
+    \*-------------------------------------------------------------------------------------*/
+    bool readImuRegisters(uint8_t reg, uint8_t* buf, uint8_t len){
+        TwiTransfer transfer = { IMU_ADDRESS, &reg, 1, buf, len, TWI_OK };
+        return runTwiTransfer(&transfer) == TWI_OK;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       resetImuFifo                                                            |
+    |   Purpose:    Empties the FIFO and returns the number of the first sample it takes    |
+    |               after. A sample taken while the write is on the bus may land either     |
+    |               side of the reset, so the reset is tried again if one was counted.      |
+    |   Arguments:  void                                                                    |
+    |   Returns:    uint16_t (sample number)                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint16_t resetImuFifo(void){
+        uint16_t before, after;
+        uint8_t tries = IMU_FIFO_RESET_TRIES;
+        do{
+            noInterrupts();
+            before = imuProduced;
+            interrupts();
+            writeImuRegister(IMU_REG_USER_CTRL, IMU_FIFO_ENABLE | IMU_FIFO_RESET);
+            noInterrupts();
+            after = imuProduced;
+            interrupts();
+        } while(before != after && --tries != 0);
+        return after;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       restartImuFifo                                                          |
+    |   Purpose:    Empties the FIFO and the queue and picks the count back up at the next  |
+    |               sample. Whatever was in either is counted lost.                         |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void restartImuFifo(void){
+        uint16_t produced = resetImuFifo();
+        PERF_ADD(PERF_IMU_SAMPLES_LOST, (uint16_t)(produced - imuSequence) + imuQueue.count());
+        imuQueue.clear();
+        imuSequence = produced;
+        restartImuSummary(imuRate);
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       drainImuFifo                                                            |
+    |   Purpose:    Reads every whole sample in the FIFO that the queue has room for, each  |
+    |               one summarised too. The rest wait in the FIFO, which then fills up      |
+    |               rather than the queue skipping samples, so a batch never spans a gap.   |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void drainImuFifo(void){
+        uint8_t buf[IMU_READ_SAMPLES*IMU_SAMPLE_LEN];
+
+        /* A full FIFO has stopped taking samples, start over from the next one */
+        if(!readImuRegisters(IMU_REG_INT_STATUS, buf, 1)) return;
+        if(buf[0] & IMU_FIFO_OVERFLOW){
+            Log(F("IMU FIFO overflowed"));
+            restartImuFifo();
+            return;
+        }
+
+        if(!readImuRegisters(IMU_REG_FIFO_COUNTH, buf, 2)) return;
+        uint16_t available = (((uint16_t)buf[0] << 8) | buf[1]) / IMU_SAMPLE_LEN;
+        uint8_t room = IMU_QUEUE_LEN - imuQueue.count();
+        if(imuBatch != 0 && available > room) available = room;
+
+        /* Burst reads, the FIFO holds samples in IMU_SAMPLE_SCHEMA's layout already */
+        while(available != 0){
+            uint8_t n = (available < IMU_READ_SAMPLES) ? available : IMU_READ_SAMPLES;
+            if(!readImuRegisters(IMU_REG_FIFO_R_W, buf, n*IMU_SAMPLE_LEN)){
+                restartImuFifo();
+                return;
+            }
+
+            ImuSample sample;
+            for(uint8_t i = 0; i != n; i++){
+                decodeImuSample(buf + i*IMU_SAMPLE_LEN, &sample);
+                addImuSummarySample(sample, imuSequence + i);
+                if(imuBatch != 0) imuQueue.push(sample);
+            }
+            imuSequence += n;
+            available -= n;
+            PERF_ADD(PERF_IMU_SAMPLES, n);
+        }
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       sendImuBatch                                                            |
+    |   Purpose:    Sends the oldest imuBatch samples as one telemetry record. They're      |
+    |               dropped if telemetry is off or the record isn't due, and kept if no     |
+    |               block is free.                                                          |
+    |   Arguments:  void                                                                    |
+    |   Returns:    bool (false if they're kept)                                            |
+    \*-------------------------------------------------------------------------------------*/
+    bool sendImuBatch(void){
+        ImuBatch header;
+        header.sequence = imuSequence - imuQueue.count();
+        header.time = getImuSampleTime(header.sequence);
+        header.rate = imuRate;
+        header.count = imuBatch;
+
+        ImuSample sample = ImuSample();
+        if(getTelemetryDestination() == TELEMETRY_OFF || !telemetryRecordDue(TELEMETRY_IMU_BATCH)){
+            for(uint8_t i = 0; i != imuBatch && imuQueue.pop(sample); i++);
+            return true;
+        }
+
+        uint8_t* record = beginTelemetryRecord(TELEMETRY_IMU_BATCH);
+        if(record == NULL) return false;
+
+        /* The header goes in last, counting only the samples that were really there */
+        uint8_t* p = record + IMU_BATCH_LEN;
+        header.count = 0;
+        while(header.count != imuBatch && imuQueue.pop(sample)){
+            p = encodeImuSample(p, sample);
+            header.count++;
+        }
+        encodeImuBatch(record, header);
+        sendTelemetryRecord(p - record);
+        return true;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       initializeImu                                                           |
+    |   Purpose:    Looks for the MPU9250 on the I2C bus, leaving it asleep until           |
+    |               configureImu gives it a rate. initializeTwi must have run.              |
+    |   Arguments:  void                                                                    |
+    |   Returns:    int16_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t initializeImu(void){
+        pinMode(IMU_INT_PIN, INPUT);
+
+        uint8_t id;
+        imuPresent = readImuRegisters(IMU_REG_WHO_AM_I, &id, 1) &&
+                     (id == IMU_WHO_AM_I_MPU9250 || id == IMU_WHO_AM_I_MPU9255);
+        if(!imuPresent){
+            Log(F("IMU not found"));
+            return IMU_NOT_FOUND;
+        }
+
+        writeImuRegister(IMU_REG_PWR_MGMT_1, IMU_RESET);
+        delay(IMU_RESET_TIME);
+        writeImuRegister(IMU_REG_PWR_MGMT_1, IMU_SLEEP);
+        return IMU_OK;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       configureImu                                                            |
+    |   Purpose:    Starts sampling into the FIFO at the given rate, sent on as telemetry   |
+    |               records of the given number of samples (0 for summaries only), or       |
+    |               stops it with rate 0. The rate must divide IMU_INTERNAL_RATE.           |
+    |   Arguments:  uint16_t (Hz), uint8_t                                                  |
+    |   Returns:    int16_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t configureImu(uint16_t rate, uint8_t batch){
+        if(rate != 0 && (rate < IMU_MIN_RATE || rate > IMU_INTERNAL_RATE || IMU_INTERNAL_RATE % rate != 0)) return IMU_INVALID_RATE;
+        if(batch > IMU_QUEUE_LEN) return IMU_INVALID_BATCH;
+        if(!imuPresent) return IMU_NOT_FOUND;
+
+        /* Stop, whatever was queued goes */
+        detachInterrupt(digitalPinToInterrupt(IMU_INT_PIN));
+        writeImuRegister(IMU_REG_INT_ENABLE, 0);
+        writeImuRegister(IMU_REG_USER_CTRL, IMU_FIFO_RESET);
+        writeImuRegister(IMU_REG_PWR_MGMT_1, IMU_SLEEP);
+        imuQueue.clear();
+        imuRate = 0;
+        imuBatch = batch;
+        restartImuSummary(0);
+        if(rate == 0) return IMU_OK;
+
+        /* Accel and gyro into the FIFO at the new rate, the INT pin pulsing once per sample */
+        writeImuRegister(IMU_REG_PWR_MGMT_1, IMU_CLOCK_PLL);
+        writeImuRegister(IMU_REG_CONFIG, IMU_FIFO_MODE_KEEP_OLDEST | IMU_DLPF_184HZ);
+        writeImuRegister(IMU_REG_SMPLRT_DIV, IMU_INTERNAL_RATE / rate - 1);
+        writeImuRegister(IMU_REG_GYRO_CONFIG, IMU_GYRO_500DPS);
+        writeImuRegister(IMU_REG_ACCEL_CONFIG, IMU_ACCEL_4G);
+        writeImuRegister(IMU_REG_ACCEL_CONFIG2, IMU_DLPF_184HZ);
+        writeImuRegister(IMU_REG_INT_PIN_CFG, 0);
+        writeImuRegister(IMU_REG_FIFO_EN, IMU_FIFO_ACCEL_GYRO);
+
+        /* Counting first, so the FIFO starts at a counted sample */
+        noInterrupts();
+        imuProduced = 0;
+        imuProducedMillis = millis();
+        interrupts();
+        attachInterrupt(digitalPinToInterrupt(IMU_INT_PIN), imuDataReady, RISING);
+        writeImuRegister(IMU_REG_INT_ENABLE, IMU_RAW_READY_ENABLE);
+
+        imuSequence = resetImuFifo();
+        imuStampSequence = imuSequence;
+        imuStampMillis = millis();
+        imuRate = rate;
+        restartImuSummary(rate);
+        return IMU_OK;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getImuRate                                                              |
+    |   Purpose:    Returns the sample rate, 0 if the IMU is stopped.                       |
+    |   Arguments:  void                                                                    |
+    |   Returns:    uint16_t (Hz)                                                           |
+    \*-------------------------------------------------------------------------------------*/
+    uint16_t getImuRate(void){
+        return imuRate;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getImuSampleTime                                                        |
+    |   Purpose:    Returns when the given sample was taken, worked back from the last one  |
+    |               the interrupt stamped. It must be a recent sample at the current rate.  |
+    |   Arguments:  uint16_t (sample number)                                                |
+    |   Returns:    uint32_t (ms uptime)                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    uint32_t getImuSampleTime(uint16_t sequence){
+        if(imuRate == 0) return imuStampMillis;
+        return imuStampMillis - (uint32_t)(uint16_t)(imuStampSequence - sequence) * 1000 / imuRate;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       serviceImu                                                              |
+    |   Purpose:    Scheduler task. Drains the FIFO in one burst once the interrupt has     |
+    |               counted IMU_FIFO_WATERMARK samples, and sends every full batch.         |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void serviceImu(void){
+        if(imuRate == 0) return;
+
+        noInterrupts();
+        uint16_t produced = imuProduced;
+        uint32_t producedMillis = imuProducedMillis;
+        interrupts();
+
+        if((uint16_t)(produced - imuSequence) >= IMU_FIFO_WATERMARK){
+            PERF_TIMER_START(PERF_IMU_DRAIN);
+            imuStampSequence = produced - 1;
+            imuStampMillis = producedMillis;
+            drainImuFifo();
+            PERF_TIMER_STOP(PERF_IMU_DRAIN);
+        }
+
+        while(imuBatch != 0 && imuQueue.count() >= imuBatch && sendImuBatch());
+    }
@@ -0,0 +1,124 @@
+#ifndef INC_IMU_H_
+#define INC_IMU_H_
+
+#include <Arduino.h>
+#include "Perf.h"
+#include "Schemas.h"
+#include "Telemetry.h"
+#include "Twi.h"
+#include "Utility.h"
+
+
+/*-------------------------------------------------------------------------*\
+|								  Definitions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /* MPU9250 wiring */
+    #define IMU_ADDRESS                     0x68                    // AD0 low
+    #define IMU_INT_PIN                     3                       // INT1, DIO1 has INT0
+    #define IMU_RESET_TIME                  100                     // ms
+
+    /* MPU9250 registers */
+    #define IMU_REG_SMPLRT_DIV              0x19
+    #define IMU_REG_CONFIG                  0x1A
+    #define IMU_REG_GYRO_CONFIG             0x1B
+    #define IMU_REG_ACCEL_CONFIG            0x1C
+    #define IMU_REG_ACCEL_CONFIG2           0x1D
+    #define IMU_REG_FIFO_EN                 0x23
+    #define IMU_REG_INT_PIN_CFG             0x37
+    #define IMU_REG_INT_ENABLE              0x38
+    #define IMU_REG_INT_STATUS              0x3A
+    #define IMU_REG_USER_CTRL               0x6A
+    #define IMU_REG_PWR_MGMT_1              0x6B
+    #define IMU_REG_FIFO_COUNTH             0x72
+    #define IMU_REG_FIFO_R_W                0x74
+    #define IMU_REG_WHO_AM_I                0x75
+
+    /* MPU9250 register values */
+    #define IMU_WHO_AM_I_MPU9250            0x71
+    #define IMU_WHO_AM_I_MPU9255            0x73
+    #define IMU_RESET                       0x80                    // PWR_MGMT_1
+    #define IMU_SLEEP                       0x40                    // PWR_MGMT_1
+    #define IMU_CLOCK_PLL                   0x01                    // PWR_MGMT_1
+    #define IMU_FIFO_MODE_KEEP_OLDEST       0x40                    // CONFIG, a full FIFO drops new samples so it stays sample-aligned
+    #define IMU_DLPF_184HZ                  0x01                    // CONFIG and ACCEL_CONFIG2, 1 kHz internal rate
+    #define IMU_GYRO_500DPS                 0x08
+    #define IMU_ACCEL_4G                    0x08
+    #define IMU_FIFO_ACCEL_GYRO             0x78                    // FIFO_EN, accel then gyro XYZ, the order of IMU_SAMPLE_SCHEMA
+    #define IMU_FIFO_ENABLE                 0x40                    // USER_CTRL
+    #define IMU_FIFO_RESET                  0x04                    // USER_CTRL
+    #define IMU_RAW_READY_ENABLE            0x01                    // INT_ENABLE, INT pulses once per sample
+    #define IMU_FIFO_OVERFLOW               0x10                    // INT_STATUS
+
+    /* Scaling of the raw samples */
+    #define IMU_ACCEL_LSB_PER_G             8192
+    #define IMU_GYRO_LSB_PER_DPS            65.5
+
+    /* Sampling */
+    #define IMU_INTERNAL_RATE               1000                    // Hz, divided down by SMPLRT_DIV
+    #define IMU_MIN_RATE                    4                       // Largest divider (256) rounded up
+    #define IMU_FIFO_WATERMARK              8                       // Samples the interrupt counts before the FIFO is drained
+    #define IMU_READ_SAMPLES                2                       // Per I2C read, into a buffer on the stack
+    #define IMU_QUEUE_LEN                   8                       // Samples waiting to be batched, a power of two
+    #define IMU_DEFAULT_BATCH               8                       // Samples per telemetry record
+    #define IMU_FIFO_RESET_TRIES            4                       // A reset raced by a sample is tried again, see resetImuFifo
+
+    /* Status codes */
+    #define IMU_OK                          0x0000
+    #define IMU_NOT_FOUND                   0x0800
+    #define IMU_INVALID_RATE                0x0801
+    #define IMU_INVALID_BATCH               0x0802
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       initializeImu                                                           |
+    |   Purpose:    Looks for the MPU9250 on the I2C bus, leaving it asleep until           |
+    |               configureImu gives it a rate. initializeTwi must have run.              |
+    |   Arguments:  void                                                                    |
+    |   Returns:    int16_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t initializeImu(void);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       configureImu                                                            |
+    |   Purpose:    Starts sampling into the FIFO at the given rate, sent on as telemetry   |
+    |               records of the given number of samples (0 for summaries only), or       |
+    |               stops it with rate 0. The rate must divide IMU_INTERNAL_RATE.           |
+    |   Arguments:  uint16_t (Hz), uint8_t                                                  |
+    |   Returns:    int16_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t configureImu(uint16_t rate, uint8_t batch);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getImuRate                                                              |
+    |   Purpose:    Returns the sample rate, 0 if the IMU is stopped.                       |
+    |   Arguments:  void                                                                    |
+    |   Returns:    uint16_t (Hz)                                                           |
+    \*-------------------------------------------------------------------------------------*/
+    uint16_t getImuRate(void);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getImuSampleTime                                                        |
+    |   Purpose:    Returns when the given sample was taken, worked back from the last one  |
+    |               the interrupt stamped. It must be a recent sample at the current rate.  |
+    |   Arguments:  uint16_t (sample number)                                                |
+    |   Returns:    uint32_t (ms uptime)                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    uint32_t getImuSampleTime(uint16_t sequence);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       serviceImu                                                              |
+    |   Purpose:    Scheduler task. Drains the FIFO in one burst once the interrupt has     |
+    |               counted IMU_FIFO_WATERMARK samples, and sends every full batch.         |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void serviceImu(void);
+
+#endif /* INC_IMU_H_ */
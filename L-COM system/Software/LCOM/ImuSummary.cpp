@@ -0,0 +1,197 @@
+#include "ImuSummary.h"
+#include "Imu.h"
+
+
+/*-------------------------------------------------------------------------*\
+|								     Types					   			    |
+\*-------------------------------------------------------------------------*/
+
+
+    /* Running state of one window, per axis in IMU_SAMPLE_SCHEMA order */
+    struct ImuWindow{
+        int32_t sum[6];
+        uint64_t sumSquares[6];                             // Raw counts squared, 32 bits would overflow within a second at 1 kHz
+        int16_t min[6];
+        int16_t max[6];
+        uint32_t accelPeak;                                 // Squared magnitudes, rooted when the window closes
+        uint32_t gyroPeak;
+        uint16_t accelPeakOffset;                           // Samples after the first
+        uint16_t gyroPeakOffset;
+        uint16_t first;                                     // Sample number
+        uint16_t count;
+    };
+
+    static_assert(sizeof(ImuWindow) <= IMU_SUMMARY_WINDOW_SIZE, "IMU_SUMMARY_WINDOW_SIZE is out of date");
+
+
+/*-------------------------------------------------------------------------*\
+|								   Variables					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    uint8_t summaryFields = 0;                              // 0 while off
+    uint16_t summaryWindow = IMU_SUMMARY_DEFAULT_WINDOW;    // ms
+    uint16_t summaryWindowSamples = 0;
+    ImuWindow window;
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       squareRoot                                                              |
+    |   Purpose:    Integer square root, rounded down, bit by bit with no multiplies.       |
+    |   Arguments:  uint32_t                                                                |
+    |   Returns:    uint16_t                                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint16_t squareRoot(uint32_t x){
+        uint32_t root = 0;
+        uint32_t bit = (uint32_t)1 << 30;
+        while(bit > x) bit >>= 2;
+        while(bit != 0){
+            if(x >= root + bit){
+                x -= root + bit;
+                root = (root >> 1) + bit;
+            }
+            else root >>= 1;
+            bit >>= 2;
+        }
+        return root;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       encodeAxes                                                              |
+    |   Purpose:    Writes six per-axis values in the layout of an IMU sample.              |
+    |   Arguments:  uint8_t*, const int16_t*                                                |
+    |   Returns:    uint8_t* (the byte after them)                                          |
+    \*-------------------------------------------------------------------------------------*/
+    uint8_t* encodeAxes(uint8_t* p, const int16_t* axes){
+        ImuSample sample = { axes[0], axes[1], axes[2], axes[3], axes[4], axes[5] };
+        return encodeImuSample(p, sample);
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       sendImuSummary                                                          |
+    |   Purpose:    Divides out the window and sends it as one telemetry record.            |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void sendImuSummary(void){
+        if(!telemetryRecordDue(TELEMETRY_IMU_SUMMARY)) return;
+        uint8_t* record = beginTelemetryRecord(TELEMETRY_IMU_SUMMARY);
+        if(record == NULL) return;
+
+        ImuSummary header;
+        header.sequence = window.first;
+        header.time = getImuSampleTime(window.first);
+        header.count = window.count;
+        header.included = summaryFields;
+        uint8_t* p = encodeImuSummary(record, header);
+
+        /* Each statistic goes out in the layout of a sample */
+        int16_t axes[6];
+        if(summaryFields & IMU_SUMMARY_MEAN){
+            for(uint8_t i = 0; i != 6; i++){
+                int32_t half = (window.sum[i] < 0) ? -(int32_t)(window.count/2) : window.count/2;
+                axes[i] = (window.sum[i] + half) / (int32_t)window.count;
+            }
+            p = encodeAxes(p, axes);
+        }
+        if(summaryFields & IMU_SUMMARY_MIN) p = encodeAxes(p, window.min);
+        if(summaryFields & IMU_SUMMARY_MAX) p = encodeAxes(p, window.max);
+        if(summaryFields & IMU_SUMMARY_RMS){
+            for(uint8_t i = 0; i != 6; i++){
+                uint16_t rms = squareRoot(window.sumSquares[i] / window.count);
+                axes[i] = (rms > INT16_MAX) ? INT16_MAX : rms;
+            }
+            p = encodeAxes(p, axes);
+        }
+        if(summaryFields & IMU_SUMMARY_PEAKS){
+            ImuPeaks peaks;
+            peaks.accelPeak = squareRoot(window.accelPeak);
+            peaks.accelPeakTime = getImuSampleTime(window.first + window.accelPeakOffset) - header.time;
+            peaks.gyroPeak = squareRoot(window.gyroPeak);
+            peaks.gyroPeakTime = getImuSampleTime(window.first + window.gyroPeakOffset) - header.time;
+            p = encodeImuPeaks(p, peaks);
+        }
+
+        sendTelemetryRecord(p - record);
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       configureImuSummary                                                     |
+    |   Purpose:    Sets the window and the fields summarised, fields 0 turns summaries     |
+    |               off. The current window is dropped.                                     |
+    |   Arguments:  uint16_t (ms), uint8_t                                                  |
+    |   Returns:    int16_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t configureImuSummary(uint16_t window, uint8_t fields){
+        if(window < IMU_SUMMARY_MIN_WINDOW || window > IMU_SUMMARY_MAX_WINDOW) return IMU_SUMMARY_INVALID_WINDOW;
+        if(fields & ~IMU_SUMMARY_ALL) return IMU_SUMMARY_INVALID_FIELDS;
+
+        summaryWindow = window;
+        summaryFields = fields;
+        restartImuSummary(getImuRate());
+        return IMU_SUMMARY_OK;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       restartImuSummary                                                       |
+    |   Purpose:    Drops the current window and starts the next at the next sample, with   |
+    |               the window's sample count worked out for the given rate.                |
+    |   Arguments:  uint16_t (Hz)                                                           |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void restartImuSummary(uint16_t rate){
+        summaryWindowSamples = (uint32_t)summaryWindow * rate / 1000;
+        if(summaryWindowSamples == 0) summaryWindowSamples = 1;
+        window.count = 0;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       addImuSummarySample                                                     |
+    |   Purpose:    Folds one sample into the window, and sends the window's record once    |
+    |               it's full.                                                              |
+    |   Arguments:  const ImuSample&, uint16_t (sample number)                              |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void addImuSummarySample(const ImuSample& sample, uint16_t sequence){
+        if(summaryFields == 0) return;
+
+        const int16_t axes[6] = { sample.accelX, sample.accelY, sample.accelZ, sample.gyroX, sample.gyroY, sample.gyroZ };
+        if(window.count == 0){
+            memset(&window, 0, sizeof(window));
+            for(uint8_t i = 0; i != 6; i++){
+                window.min[i] = INT16_MAX;
+                window.max[i] = INT16_MIN;
+            }
+            window.first = sequence;
+        }
+
+        /* Sums, extremes, and the squared magnitudes of accel (0-2) and gyro (3-5) */
+        uint32_t magnitude[2] = {0, 0};
+        for(uint8_t i = 0; i != 6; i++){
+            int16_t v = axes[i];
+            uint32_t square = (int32_t)v * v;
+            window.sum[i] += v;
+            window.sumSquares[i] += square;
+            if(v < window.min[i]) window.min[i] = v;
+            if(v > window.max[i]) window.max[i] = v;
+            magnitude[i / 3] += square;
+        }
+        if(magnitude[0] > window.accelPeak){
+            window.accelPeak = magnitude[0];
+            window.accelPeakOffset = window.count;
+        }
+        if(magnitude[1] > window.gyroPeak){
+            window.gyroPeak = magnitude[1];
+            window.gyroPeakOffset = window.count;
+        }
+
+        if(++window.count == summaryWindowSamples){
+            sendImuSummary();
+            window.count = 0;
+        }
+    }
@@ -0,0 +1,72 @@
+#ifndef INC_IMUSUMMARY_H_
+#define INC_IMUSUMMARY_H_
+
+#include <Arduino.h>
+#include "Schemas.h"
+#include "Telemetry.h"
+
+
+/*-------------------------------------------------------------------------*\
+|								  Definitions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*
+     * Reduces the IMU stream to one record per window, a few dozen bytes where raw batches would need
+     * kilobytes. Everything is accumulated in integers as samples arrive, in constant memory whatever
+     * the window length, and only divided out when the window closes.
+     */
+
+    /* Fields, a summary record carries the ones selected in this order */
+    #define IMU_SUMMARY_MEAN                0x01                    // IMU_SAMPLE_SCHEMA, rounded
+    #define IMU_SUMMARY_MIN                 0x02                    // IMU_SAMPLE_SCHEMA
+    #define IMU_SUMMARY_MAX                 0x04                    // IMU_SAMPLE_SCHEMA
+    #define IMU_SUMMARY_RMS                 0x08                    // IMU_SAMPLE_SCHEMA, gravity included, std. dev. is sqrt(RMS^2 - mean^2)
+    #define IMU_SUMMARY_PEAKS               0x10                    // IMU_PEAKS_SCHEMA
+    #define IMU_SUMMARY_ALL                 0x1F
+
+    /* Window */
+    #define IMU_SUMMARY_MIN_WINDOW          100                     // ms
+    #define IMU_SUMMARY_MAX_WINDOW          60000                   // ms, keeps the sample count and sums in range at 1 kHz
+    #define IMU_SUMMARY_DEFAULT_WINDOW      1000                    // ms, for the UART, over the air from SF8 up every field wants 3-30 s (Tests/ImuSummaryModel.cpp)
+    #define IMU_SUMMARY_WINDOW_SIZE         112                     // Bytes of accumulators, for the RAM budget
+
+    /* Status codes */
+    #define IMU_SUMMARY_OK                  0x0000
+    #define IMU_SUMMARY_INVALID_WINDOW      0x0803
+    #define IMU_SUMMARY_INVALID_FIELDS      0x0804
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       configureImuSummary                                                     |
+    |   Purpose:    Sets the window and the fields summarised, fields 0 turns summaries     |
+    |               off. The current window is dropped.                                     |
+    |   Arguments:  uint16_t (ms), uint8_t                                                  |
+    |   Returns:    int16_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t configureImuSummary(uint16_t window, uint8_t fields);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       restartImuSummary                                                       |
+    |   Purpose:    Drops the current window and starts the next at the next sample, with   |
+    |               the window's sample count worked out for the given rate.                |
+    |   Arguments:  uint16_t (Hz)                                                           |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void restartImuSummary(uint16_t rate);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       addImuSummarySample                                                     |
+    |   Purpose:    Folds one sample into the window, and sends the window's record once    |
+    |               it's full.                                                              |
+    |   Arguments:  const ImuSample&, uint16_t (sample number)                              |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void addImuSummarySample(const ImuSample& sample, uint16_t sequence);
+
+#endif /* INC_IMUSUMMARY_H_ */
@@ -43,9 +43,22 @@
 
     #include <avr/wdt.h>
     #include "Commands.h"
+    #include "Gps.h"
+    #include "Imu.h"
+    #include "Memory.h"
+    #include "PacketArena.h"
+    #include "Perf.h"
+    #include "PowerBoard.h"
     #include "RadioController.h"
+    #include "Scheduler.h"
     #include "SerialInterface.h"
+    #include "StoreForward.h"
+    #include "Thermistor.h"
+    #include "TimeSync.h"
+    #include "Trace.h"
+    #include "Twi.h"
     #include "Utility.h"
+    #include "WarmRestart.h"
 
 
 /*-------------------------------------------------------------------------*\
@@ -55,27 +68,40 @@
 
     #define READ_SERIAL_PERIOD      1
     #define READ_RADIO_PERIOD       100
+    #define TIME_SYNC_PERIOD        100
+    #define IMU_SERVICE_PERIOD      5
+    #define GPS_SERVICE_PERIOD      20                      // The software serial buffer fills in 66 ms at 9600 baud
+    #define POWER_POLL_PERIOD       1000
     
 
 /*-------------------------------------------------------------------------*\
-|                                  Variables                                |
+|                             Function prototypes                           |
 \*-------------------------------------------------------------------------*/
 
 
-    // Task timing
-    uint32_t lastReadSerialTime = 0;
-    uint32_t lastReadRadioTime = 0;
+    // Tasks
+    void readSerial();
+    void readRadio();
+    void handleSerialPacket(uint8_t block, uint8_t* buf, uint16_t bufLen);
 
 
 /*-------------------------------------------------------------------------*\
-|                             Function prototypes                           |
+|                                  Variables                                |
 \*-------------------------------------------------------------------------*/
 
 
-    // Tasks
-    void readSerial();
-    void readRadio();
-    void handleSerialPacket(uint8_t* buf);
+    // Task table in flash: function, period (ms), allowed lateness (ms), priority (0 highest)
+    const SchedulerTask taskTable[] PROGMEM = {
+        {readSerial,           READ_SERIAL_PERIOD,         5,      0},
+        {readRadio,            READ_RADIO_PERIOD,          20,     1},
+        {serviceImu,           IMU_SERVICE_PERIOD,         10,     2},
+        {serviceGps,           GPS_SERVICE_PERIOD,         20,     2},
+        {serviceTimeSync,      TIME_SYNC_PERIOD,           50,     2},
+        {servicePowerBoard,    POWER_POLL_PERIOD,          100,    3},
+        {saveWarmState,        WARM_STATE_SAVE_PERIOD,     250,    3},
+        {serviceStoreForward,  STORE_SERVICE_PERIOD,       250,    3}
+    };
+    static_assert(sizeof(taskTable)/sizeof(taskTable[0]) <= SCHEDULER_MAX_TASKS, "Task table is larger than SCHEDULER_MAX_TASKS");
 
 
 /*-------------------------------------------------------------------------*\
@@ -84,19 +110,46 @@
 
 
     void setup(){
-        // Enable the watchdog on a 4s timeout
-        MCUSR=0;
+        // Enable the watchdog on a 4s timeout (MCUSR was already captured and cleared in .init3)
         wdt_enable(WDTO_4S);
         
         // Begin serial communication
         Serial.begin(SERIAL_BAUD);
-        while(!Serial);
 
         enableDebug();
 
         // Initialize the radio
         initializeRadio();
 
+        // Hand the ADC to background temperature sampling (after initializeRadio, which seeds random from analogRead)
+        initializeThermistor();
+
+        // The I2C bus, shared by the IMU and the power board
+        initializeTwi();
+
+        // Look for the IMU, it stays asleep until SET_IMU starts it
+        initializeImu();
+
+        // Start listening to the GPS receiver, fixes are sent as telemetry
+        initializeGps();
+
+        // Pick up the telemetry stored in EEPROM before the reset, it's forwarded once the link is up
+        initializeStoreForward();
+
+        // Pick the link back up after a watchdog or external reset, only a cold start waits for the host
+        if(!restoreWarmState()) while(!Serial);
+
+        // Start the periodic tasks
+        int16_t res = initializeScheduler(taskTable, sizeof(taskTable)/sizeof(taskTable[0]));
+        if(res != SCHEDULER_OK) Log(F("Scheduler initialization failed"), res);
+
+        // Static data and the heap are all in place, check they leave the stack its reserve
+        int16_t margin = getRamMargin();
+        if(margin < 0){
+            Log(F("RAM short of the stack reserve (bytes):"));
+            Log((uint16_t)-margin);
+        }
+
         Serial.flush();
     }
     
@@ -107,14 +160,18 @@
 
 
     void loop(){
-        /* Read serial every 1ms */
-        readSerial();
-        
-        /* Read LoRa radio every 100ms */
-        readRadio();
+        PERF_TIMER_START(PERF_LOOP);
+
+        /* Run whichever task is due */
+        runScheduler();
 
         /* Give the watchdog a kick */
         wdt_reset();
+
+        PERF_TIMER_STOP(PERF_LOOP);
+
+        /* Sleep until the next interrupt if nothing is due, the millis() tick wakes it well inside the watchdog timeout */
+        idleScheduler();
     }
 
     
@@ -125,56 +182,58 @@
 
     /* ----------------------------- Tasks ----------------------------- */
     void readSerial(){
-        if((lastReadSerialTime - millis()) > READ_SERIAL_PERIOD){
-            lastReadSerialTime = millis();
-            /* Update task interval */
-
-            /* Attempt to read new serial data */
-            int16_t res = readSerialData();
-            if(res == PACKET_COMPLETE){
-                uint8_t* pBuf = getSerialReadBuffer();
-                uint16_t bufLen = getSerialReadBufferLength();
-                
-                Log(F("Complete packet received. Length:"));
-                Log(bufLen);
-
-                // Handle the packet
-                handleSerialPacket(pBuf, bufLen);
-            }
-            else if(res != NO_NEW_SERIAL_DATA){
-                // Generally this is the parial message
-                //Log(F("Info"), res);
-            }
+        /* Drain what arrived since the last run, up to the end of a packet */
+        int16_t res;
+        do{
+            res = readSerialData();
+        } while(res == NEW_PARTIAL_SERIAL_DATA);
+
+        /* Handle the complete packets, each one's Ack or radio frame is built in the same block */
+        SerialFrame frame;
+        while(takeSerialFrame(&frame)){
+            Log(F("Complete packet received. Length:"));
+            Log(frame.length);
+
+            handleSerialPacket(frame.block, frame.packet, frame.length);
+            releaseBlock(frame.block);
         }
     }
 
     void readRadio(){
-        if((lastReadRadioTime - millis()) > READ_RADIO_PERIOD){
-            lastReadRadioTime = millis();
-            /* Update task interval */
-
-            /* Attempt to read new radio data */
-            int16_t res = readRadioData();
-            if(res != NO_NEW_RADIO_DATA){ //NEW_RADIO_DATA_BUFFERED
-                // Get the radio data
-                uint8_t* pBuf = getRadioData();
-                uint16_t bufLen = getRadioDataLength();
-
-                Serial.printf(F("Radio data received. Data length: %u\r\n"), bufLen);
-                Serial.print(F("Message: "));
-                Serial.println((const char*)pBuf);
-
-                // Format into serial packet and send it
-                // Insert res, RSSI, and SNR via function call to create a message packet
-                float RSSI = getMessageRSSI();
-                float SNR = getMessageSNR();
-                createMessagePacket(res, RSSI, SNR, pBuf, bufLen+10);               
+        /* Attempt to read new radio data */
+        int16_t res = readRadioData();
+        if(res != NO_NEW_RADIO_DATA){ //NEW_RADIO_DATA_BUFFERED
+            // Get the radio data
+            uint8_t* pBuf = getRadioData();
+            uint16_t bufLen = getRadioDataLength();
+
+            Serial.printf(F("Radio data received. Data length: %u\r\n"), bufLen);
+            Serial.print(F("Message: "));
+            Serial.println((const char*)pBuf);
+
+            // Format into serial packet and send it
+            // Insert res, RSSI, and SNR via function call to create a message packet, in front of the data
+            uint8_t block = getRadioBlock();
+            handoffBlock(block, ARENA_OWNER_UART_TX);
+            int16_t RSSI, SNR;
+            getMessageSignal(&RSSI, &SNR);
+            createMessagePacket(res, RSSI, SNR, pBuf, bufLen);
+            traceMark(TRACE_MARK_UART_TX_START);
+            writeSerialPacket();
+
+            // A traced frame is followed by its per-stage latency record, built in the block just sent
+            if(getTracePending()){
+                uint8_t* traceRecord = getBlock(block) + ARENA_PAYLOAD_OFFSET;
+                uint16_t traceRecordLen = getTraceRecord(traceRecord);
+                createPacket(TRACE_PACKET, traceRecord, traceRecordLen);
+                writeSerialPacket();
             }
+            releaseBlock(block);
         }
     }
 
     /* ----------------------- Helper functions ------------------------ */
-    void handleSerialPacket(uint8_t* buf, uint16_t bufLen){
+    void handleSerialPacket(uint8_t block, uint8_t* buf, uint16_t bufLen){
         // Print out the cyclic ID
         Serial.print(F("Packet ID: ")); Serial.println(buf[TYPE_CYCLIC_FIELD_INDEX] & 0b00011111);
 
@@ -207,30 +266,32 @@
                 {
                     Log(F("Received command packet"));
 
-                    // Execute the command
-                    int16_t res = executeCommand(buf+PKT_HEADER_LEN, bufLen - PKT_HEADER_TRAILER_LEN, buf);
-                    Log("Command executed", res);
+                    // Execute the command, the return data goes where the Ack's will be, over the command
+                    uint8_t* retBuf = buf + PKT_HEADER_LEN + ACK_RESULT_LEN;
+                    int16_t res = executeCommand(buf+PKT_HEADER_LEN, bufLen - PKT_HEADER_TRAILER_LEN, retBuf);
+                    Log(F("Command executed"), res);
 
                     // Create and send the Ack packet
                     uint16_t retBufLen = getReturnBufferLength();
-                    uint8_t* sendBuf = createAckPacket(res, buf, retBufLen+2);
-                    uint16_t sendBufferLength = getSendBufferLen();
-                    Serial.write((char*)sendBuf, sendBufferLength);
+                    handoffBlock(block, ARENA_OWNER_UART_TX);
+                    createAckPacket(res, retBuf, retBufLen);
+                    writeSerialPacket();
                 }
                 break;
             case MESSAGE_PACKET:
                 {
                     Log(F("Received message packet"));
                     
-                    char floatBuf[10];
-                    dtostrf(extract_float(buf, 8), 5, 3, floatBuf);
-                    Serial.print(F("\tRSSI: ")); Serial.println(floatBuf);
-                    dtostrf(extract_float(buf, 12), 5, 3, floatBuf);
-                    Serial.print(F("\tSNR: ")); Serial.println(floatBuf);
-                    Serial.print(F("\tResult ID: ")); Serial.println(extract_uint16_t(buf, 16), HEX);
+                    MessageFields fields;
+                    decodeMessageFields(buf+PAYLOAD_INDEX, &fields);
+                    Serial.print(F("\tRSSI (0.01 dBm): ")); Serial.println(fields.RSSI);
+                    Serial.print(F("\tSNR (0.01 dB): ")); Serial.println(fields.SNR);
+                    Serial.print(F("\tResult ID: ")); Serial.println((uint16_t)fields.result, HEX);
 					
-					// Extract the data (just copy it to the start of the same buffer), then send it over the radio
-                    int16_t res = transmitRadio(buf+MESSAGE_INDEX, bufLen-MESSAGE_INDEX-PKT_TRAILER_LEN);
+					// Send the data over the radio, its frame headers are written in front of it
+                    handoffBlock(block, ARENA_OWNER_RADIO_TX);
+                    int16_t res = transmitRadio(buf+MESSAGE_INDEX, bufLen-MESSAGE_INDEX-PKT_TRAILER_LEN, getTraceEnabled() ? AIR_FRAME_TRACED_DATA : AIR_FRAME_DATA);
+                    if(res != ERR_NONE) Log(F("Message transmit failed"), res);
                 }
                 break;
             default:
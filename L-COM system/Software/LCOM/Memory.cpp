@@ -0,0 +1,142 @@
+#include "Memory.h"
+#include "Imu.h"
+#include "ImuSummary.h"
+#include "PacketArena.h"
+#include "Perf.h"
+#include "RadioController.h"
+#include "TimeSync.h"
+#include "WarmRestart.h"
+#include <SoftwareSerial.h>
+
+
+/*-------------------------------------------------------------------------*\
+|								 Memory budget				   			    |
+\*-------------------------------------------------------------------------*/
+
+
+    /* The large buffers, grow any of these and this is where it shows */
+    #define MEMORY_LARGE_BUFFERS            (ARENA_BLOCK_COUNT*ARENA_BLOCK_SIZE         /* Packet arena */                        \
+                                             + RADIO_TX_HEADROOM + TIME_BEACON_LEN      /* beaconBuffer */                        \
+                                             + IMU_QUEUE_LEN*IMU_SAMPLE_LEN             /* imuQueue */                            \
+                                             + IMU_SUMMARY_WINDOW_SIZE                  /* Summary window */                      \
+                                             + SOFTWARE_SERIAL_BUFFER_SIZE)             /* GPS */
+
+    /* Sized by the compiler, HardwareSerial holds its ring buffers, and the radio's Module is on the heap behind malloc's 2 bytes */
+    #define MEMORY_OBJECTS                  (sizeof(HardwareSerial) + sizeof(SoftwareSerial)                                      \
+                                             + sizeof(SX1262) + sizeof(Module) + 2                                                \
+                                             + sizeof(WarmState))                       /* .noinit */
+
+    #define MEMORY_STATIC_TOTAL             (MEMORY_LARGE_BUFFERS + MEMORY_OBJECTS + MEMORY_SMALL_STATIC + MEMORY_LIBRARY_STATIC \
+                                             + PERF_ENABLED*MEMORY_PERF_STATIC)
+
+    static_assert(MEMORY_STATIC_TOTAL + MEMORY_STACK_RESERVE <= MEMORY_RAM_SIZE, "Static data and the heap leave the stack less than MEMORY_STACK_RESERVE");
+
+
+/*-------------------------------------------------------------------------*\
+|								   Variables					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /* Linker symbols, the end of static data and the top of the heap (0 until the first allocation) */
+    extern uint8_t __heap_start;
+    extern void* __brkval;
+
+    /* For paintStack, which can only use basic asm */
+    #define MEMORY_STRING(x)                #x
+    #define MEMORY_CANARY_STRING(x)         MEMORY_STRING(x)
+    #define MEMORY_SPL_IO                   "0x3D"                  // SPL, I/O space, SPH follows
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       paintStack                                                              |
+    |   Purpose:    Runs from .init3, before main and the constructors that use the heap.   |
+    |               Fills everything between static data and the stack pointer with the     |
+    |               canary, so getStackHeadroom can find how deep the stack has gone.       |
+    |               Naked, so basic asm only, using call-clobbered registers. Falls through |
+    |               to the next init section.                                               |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void paintStack(void) __attribute__((naked, used, section(".init3")));
+    void paintStack(void){
+        __asm__ __volatile__(
+            "ldi  r30, lo8(__heap_start)\n\t"
+            "ldi  r31, hi8(__heap_start)\n\t"
+            "in   r26, " MEMORY_SPL_IO "\n\t"
+            "in   r27, " MEMORY_SPL_IO "+1\n\t"
+            "ldi  r24, " MEMORY_CANARY_STRING(STACK_CANARY) "\n\t"
+            "rjmp 2f\n\t"
+            "1:\n\t"
+            "st   Z+, r24\n\t"
+            "2:\n\t"
+            "cp   r30, r26\n\t"                                     // Up to but not including SP,
+            "cpc  r31, r27\n\t"                                     // the first free byte
+            "brlo 1b\n\t"
+        );
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       heapTop                                                                 |
+    |   Purpose:    Returns the first byte above the heap.                                  |
+    |   Arguments:  void                                                                    |
+    |   Returns:    uint8_t*                                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint8_t* heapTop(void){
+        return __brkval ? (uint8_t*)__brkval : &__heap_start;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getFreeRam                                                              |
+    |   Purpose:    Returns the bytes between the top of the heap and the stack pointer.    |
+    |   Arguments:  void                                                                    |
+    |   Returns:    uint16_t                                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint16_t getFreeRam(void){
+        return (uint8_t*)SP - heapTop();
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getStackHeadroom                                                        |
+    |   Purpose:    Returns the bytes above the heap the stack has never reached since      |
+    |               boot, i.e. the lowest free RAM has ever been.                           |
+    |   Arguments:  void                                                                    |
+    |   Returns:    uint16_t                                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint16_t getStackHeadroom(void){
+        /* A local value can match the canary by chance, so this can only ever overstate the depth */
+        const uint8_t* p = heapTop();
+        const uint8_t* sp = (const uint8_t*)SP;
+        uint16_t headroom = 0;
+        while(p < sp && *p == STACK_CANARY){
+            p++;
+            headroom++;
+        }
+        return headroom;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getStaticRam                                                            |
+    |   Purpose:    Returns the bytes taken by .data, .bss, and .noinit.                    |
+    |   Arguments:  void                                                                    |
+    |   Returns:    uint16_t                                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint16_t getStaticRam(void){
+        return &__heap_start - (uint8_t*)RAMSTART;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getRamMargin                                                            |
+    |   Purpose:    Returns the RAM left once static data, the heap, and the stack reserve  |
+    |               are taken, negative if the stack can run into the heap. Call once setup |
+    |               is done, the heap doesn't grow after that.                              |
+    |   Arguments:  void                                                                    |
+    |   Returns:    int16_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t getRamMargin(void){
+        return (int16_t)(MEMORY_RAM_SIZE - MEMORY_STACK_RESERVE) - (int16_t)(heapTop() - (uint8_t*)RAMSTART);
+    }
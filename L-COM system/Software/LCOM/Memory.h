@@ -0,0 +1,71 @@
+#ifndef INC_MEMORY_H_
+#define INC_MEMORY_H_
+
+#include <Arduino.h>
+
+
+/*-------------------------------------------------------------------------*\
+|								  Definitions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    #define STACK_CANARY                    0xC5                    // Painted over free RAM at boot
+
+    /*
+     * RAM budget, checked at compile time in Memory.cpp and measured at boot by getRamMargin. The large
+     * buffers, the serial ports, RadioLib's objects, and the warm restart state are added up there by sizeof.
+     * Everything else is a tally, taken from a host build's symbols at AVR sizes: each global the firmware
+     * defines, the core's and libraries' own variables, and what the perf probes add. A new global has to be
+     * added to the tally, the boot check catches any that aren't.
+     */
+    #define MEMORY_RAM_SIZE                 (RAMEND - RAMSTART + 1)
+    #define MEMORY_STACK_RESERVE            512                     // Not measured yet, check against getStackHeadroom
+    #define MEMORY_SMALL_STATIC             659                     // The firmware's other globals, with resetFlags in .noinit
+    #define MEMORY_LIBRARY_STATIC           44                      // millis(), malloc, SPI, SoftwareSerial's state, Log's format strings
+    #define MEMORY_PERF_STATIC              368                     // Counters, timers, and command and task statistics
+
+    /* SoftwareSerial's receive buffer, a static member shared by every port */
+    #define SOFTWARE_SERIAL_BUFFER_SIZE     64
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getFreeRam                                                              |
+    |   Purpose:    Returns the bytes between the top of the heap and the stack pointer.    |
+    |   Arguments:  void                                                                    |
+    |   Returns:    uint16_t                                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint16_t getFreeRam(void);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getStackHeadroom                                                        |
+    |   Purpose:    Returns the bytes above the heap the stack has never reached since      |
+    |               boot, i.e. the lowest free RAM has ever been.                           |
+    |   Arguments:  void                                                                    |
+    |   Returns:    uint16_t                                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint16_t getStackHeadroom(void);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getStaticRam                                                            |
+    |   Purpose:    Returns the bytes taken by .data, .bss, and .noinit.                    |
+    |   Arguments:  void                                                                    |
+    |   Returns:    uint16_t                                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint16_t getStaticRam(void);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getRamMargin                                                            |
+    |   Purpose:    Returns the RAM left once static data, the heap, and the stack reserve  |
+    |               are taken, negative if the stack can run into the heap. Call once setup |
+    |               is done, the heap doesn't grow after that.                              |
+    |   Arguments:  void                                                                    |
+    |   Returns:    int16_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t getRamMargin(void);
+
+#endif /* INC_MEMORY_H_ */
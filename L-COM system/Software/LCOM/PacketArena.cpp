@@ -0,0 +1,108 @@
+#include "PacketArena.h"
+#include "RadioController.h"
+#include "SerialInterface.h"
+#include "Telemetry.h"
+
+
+/*-------------------------------------------------------------------------*\
+|								  Layout checks				   			    |
+\*-------------------------------------------------------------------------*/
+
+
+    static_assert(ARENA_PAYLOAD_OFFSET == PKT_HEADROOM, "Payloads must leave room for an extended header");
+    static_assert(ARENA_SERIAL_RX_OFFSET + PKT_HEADER_LEN >= PKT_HEADROOM, "Received payloads must leave room for an extended Ack header");
+    static_assert(ARENA_BLOCK_SIZE >= ARENA_SERIAL_RX_OFFSET + PKT_MAX_LEN, "A received packet must fit");
+    static_assert(ARENA_RADIO_RX_OFFSET == ARENA_PAYLOAD_OFFSET + MESSAGE_FIELDS_LEN, "A message packet must fit in front of a received frame");
+    static_assert(ARENA_BLOCK_SIZE >= ARENA_RADIO_RX_OFFSET + MAX_LORA_MESSAGE_SIZE + PKT_TRAILER_LEN, "A received frame and its message trailer must fit");
+    static_assert(ARENA_SERIAL_RX_OFFSET + PKT_HEADER_LEN + MESSAGE_FIELDS_LEN >= RADIO_TX_HEADROOM, "A received message must leave transmitRadio its headroom");
+    static_assert(ARENA_TELEMETRY_OFFSET >= ARENA_RADIO_RX_OFFSET, "A message packet must fit in front of a telemetry record");
+    static_assert(ARENA_TELEMETRY_OFFSET >= RADIO_TX_HEADROOM, "A telemetry record must leave transmitRadio its headroom");
+    static_assert(ARENA_BLOCK_SIZE >= ARENA_TELEMETRY_OFFSET + TELEMETRY_RECORD_HEADER_LEN + TELEMETRY_MAX_RECORD_LEN + PKT_TRAILER_LEN, "A telemetry record and its message trailer must fit");
+    static_assert(ARENA_BLOCK_COUNT < ARENA_NONE, "Block indices must fit below ARENA_NONE");
+
+
+/*-------------------------------------------------------------------------*\
+|								   Variables					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    uint8_t arena[ARENA_BLOCK_COUNT][ARENA_BLOCK_SIZE];
+    uint8_t blockOwner[ARENA_BLOCK_COUNT];
+    uint8_t blocksInUse = 0;
+    uint8_t blocksHighWater = 0;
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       acquireBlock                                                            |
+    |   Purpose:    Takes a free block for the given owner.                                 |
+    |   Arguments:  uint8_t                                                                 |
+    |   Returns:    uint8_t (block, ARENA_NONE if all are in use)                           |
+    \*-------------------------------------------------------------------------------------*/
+    uint8_t acquireBlock(uint8_t owner){
+        for(uint8_t i = 0; i != ARENA_BLOCK_COUNT; i++){
+            if(blockOwner[i] != ARENA_OWNER_FREE) continue;
+
+            blockOwner[i] = owner;
+            if(++blocksInUse > blocksHighWater) blocksHighWater = blocksInUse;
+            return i;
+        }
+        PERF_COUNT(PERF_ARENA_EXHAUSTED);
+        return ARENA_NONE;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       handoffBlock                                                            |
+    |   Purpose:    Passes a block on to its next owner.                                    |
+    |   Arguments:  uint8_t, uint8_t                                                        |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void handoffBlock(uint8_t block, uint8_t owner){
+        if(block >= ARENA_BLOCK_COUNT) return;
+        blockOwner[block] = owner;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       releaseBlock                                                            |
+    |   Purpose:    Returns a block to the arena. Its contents are left as they are.        |
+    |   Arguments:  uint8_t                                                                 |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void releaseBlock(uint8_t block){
+        if(block >= ARENA_BLOCK_COUNT || blockOwner[block] == ARENA_OWNER_FREE) return;
+        blockOwner[block] = ARENA_OWNER_FREE;
+        blocksInUse--;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getBlock                                                                |
+    |   Purpose:    Returns a pointer to the start of a block.                              |
+    |   Arguments:  uint8_t                                                                 |
+    |   Returns:    uint8_t*                                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint8_t* getBlock(uint8_t block){
+        return arena[block];
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getBlockOwner                                                           |
+    |   Purpose:    Returns the owner of a block.                                           |
+    |   Arguments:  uint8_t                                                                 |
+    |   Returns:    uint8_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    uint8_t getBlockOwner(uint8_t block){
+        return (block < ARENA_BLOCK_COUNT) ? blockOwner[block] : ARENA_OWNER_FREE;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getBlocksHighWater                                                      |
+    |   Purpose:    Returns the most blocks that have been in use at once.                  |
+    |   Returns:    uint8_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    uint8_t getBlocksHighWater(void){
+        return blocksHighWater;
+    }
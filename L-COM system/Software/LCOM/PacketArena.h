@@ -0,0 +1,98 @@
+#ifndef INC_PACKETARENA_H_
+#define INC_PACKETARENA_H_
+
+#include <Arduino.h>
+#include "Perf.h"
+#include "Schemas.h"
+
+
+/*-------------------------------------------------------------------------*\
+|								  Definitions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*
+     * Every packet, serial or radio, lives in one fixed-size block from start to finish, and is turned
+     * from one form into the next in place, e.g. a command into its Ack or a received frame into a
+     * message packet. Payloads are kept far enough in that any header, basic or extended, can be
+     * written in front of them. The offsets are checked against the packet formats in PacketArena.cpp.
+     *
+     * Tasks run to completion and none takes a second block, so at most one block is held by the running
+     * task (a packet being handled, a received frame, or a telemetry record) and one across runs (a serial
+     * packet part read). Tests/ArenaModel runs every owner at once under heavy traffic and checks that this
+     * is the most in use, and that nothing is dropped for want of a block.
+     */
+    #define ARENA_BLOCKS_ACROSS_RUNS        1                       // Serial packet part read between readSerial runs
+    #define ARENA_BLOCKS_PER_TASK           1
+    #define ARENA_BLOCK_COUNT               (ARENA_BLOCKS_ACROSS_RUNS + ARENA_BLOCKS_PER_TASK)
+    #define ARENA_BLOCK_SIZE                279                     // Largest serial packet (PKT_MAX_LEN), parsed ARENA_SERIAL_RX_OFFSET in
+    #define ARENA_PAYLOAD_OFFSET            10                      // Extended serial header length
+    #define ARENA_SERIAL_RX_OFFSET          3                       // Leaves a received payload room for an extended header, and a message transmitRadio's headroom
+    #define ARENA_RADIO_RX_OFFSET           (ARENA_PAYLOAD_OFFSET + CODEC_LEN(MESSAGE_FIELDS_SCHEMA))  // Room for a message packet's header and fields in front of the frame
+    #define ARENA_TELEMETRY_OFFSET          (ARENA_RADIO_RX_OFFSET + 1)                                // Room for a message packet or transmitRadio's headers in front of a record
+
+    #define ARENA_NONE                      0xFF
+
+    /* Owners, a block is only ever touched by the one it was handed to */
+    #define ARENA_OWNER_FREE                0x00
+    #define ARENA_OWNER_UART_RX             0x01                    // Serial parser, packet in progress
+    #define ARENA_OWNER_DISPATCH            0x02                    // Complete packet being handled
+    #define ARENA_OWNER_RADIO_TX            0x03
+    #define ARENA_OWNER_RADIO_RX            0x04
+    #define ARENA_OWNER_UART_TX             0x05
+    #define ARENA_OWNER_TELEMETRY           0x06                    // Telemetry record being built
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       acquireBlock                                                            |
+    |   Purpose:    Takes a free block for the given owner.                                 |
+    |   Arguments:  uint8_t                                                                 |
+    |   Returns:    uint8_t (block, ARENA_NONE if all are in use)                           |
+    \*-------------------------------------------------------------------------------------*/
+    uint8_t acquireBlock(uint8_t owner);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       handoffBlock                                                            |
+    |   Purpose:    Passes a block on to its next owner.                                    |
+    |   Arguments:  uint8_t, uint8_t                                                        |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void handoffBlock(uint8_t block, uint8_t owner);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       releaseBlock                                                            |
+    |   Purpose:    Returns a block to the arena. Its contents are left as they are.        |
+    |   Arguments:  uint8_t                                                                 |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void releaseBlock(uint8_t block);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getBlock                                                                |
+    |   Purpose:    Returns a pointer to the start of a block.                              |
+    |   Arguments:  uint8_t                                                                 |
+    |   Returns:    uint8_t*                                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint8_t* getBlock(uint8_t block);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getBlockOwner                                                           |
+    |   Purpose:    Returns the owner of a block.                                           |
+    |   Arguments:  uint8_t                                                                 |
+    |   Returns:    uint8_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    uint8_t getBlockOwner(uint8_t block);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getBlocksHighWater                                                      |
+    |   Purpose:    Returns the most blocks that have been in use at once.                  |
+    |   Returns:    uint8_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    uint8_t getBlocksHighWater(void);
+
+#endif /* INC_PACKETARENA_H_ */
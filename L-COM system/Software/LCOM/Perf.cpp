@@ -0,0 +1,114 @@
+#include "Perf.h"
+
+
+#if PERF_ENABLED
+
+/*-------------------------------------------------------------------------*\
+|								     Types					   			    |
+\*-------------------------------------------------------------------------*/
+
+
+    struct PerfTimer{
+        uint32_t min;
+        uint32_t max;
+        uint32_t mean;                                              // Scaled by 8 for the running average
+        uint32_t samples;
+    };
+
+
+/*-------------------------------------------------------------------------*\
+|								   Variables					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    volatile uint32_t perfCounters[PERF_COUNTER_COUNT];
+    PerfTimer perfTimers[PERF_TIMER_COUNT];
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       recordPerfTime                                                          |
+    |   Purpose:    Folds one measurement (us) into a timer's min, max, and running mean.   |
+    |   Arguments:  uint8_t, uint32_t                                                       |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void recordPerfTime(uint8_t timer, uint32_t elapsed){
+        PerfTimer& t = perfTimers[timer];
+        if(t.samples == 0){
+            t.min = t.max = elapsed;
+            t.mean = elapsed << 3;
+        }
+        else{
+            if(elapsed < t.min) t.min = elapsed;
+            if(elapsed > t.max) t.max = elapsed;
+            t.mean = t.mean - (t.mean >> 3) + elapsed;
+        }
+        t.samples++;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       resetPerfStats                                                          |
+    |   Purpose:    Clears all counters and timers.                                         |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void resetPerfStats(void){
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+            for(uint8_t i = 0; i != PERF_COUNTER_COUNT; i++) perfCounters[i] = 0;
+        }
+        memset(perfTimers, 0, sizeof(perfTimers));
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getPerfStats                                                            |
+    |   Purpose:    Writes the counters and timers into buf.                                |
+    |   Arguments:  uint8_t*                                                                |
+    |   Returns:    uint16_t (bytes written)                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint16_t getPerfStats(uint8_t* buf){
+        uint16_t pos = 0;
+        buf[pos++] = PERF_COUNTER_COUNT;
+        buf[pos++] = PERF_TIMER_COUNT;
+
+        /* Some counters are bumped from the DIO1 interrupt, so read them in one go */
+        uint32_t counters[PERF_COUNTER_COUNT];
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+            for(uint8_t i = 0; i != PERF_COUNTER_COUNT; i++) counters[i] = perfCounters[i];
+        }
+
+        for(uint8_t i = 0; i != PERF_COUNTER_COUNT; i++){
+            buf[pos++] = (counters[i] & 0xFF000000) >> 24;
+            buf[pos++] = (counters[i] & 0x00FF0000) >> 16;
+            buf[pos++] = (counters[i] & 0x0000FF00) >> 8;
+            buf[pos++] = (counters[i] & 0x000000FF);
+        }
+
+        for(uint8_t i = 0; i != PERF_TIMER_COUNT; i++){
+            uint32_t fields[4] = {perfTimers[i].min, perfTimers[i].max, perfTimers[i].mean >> 3, perfTimers[i].samples};
+            for(uint8_t j = 0; j != 4; j++){
+                buf[pos++] = (fields[j] & 0xFF000000) >> 24;
+                buf[pos++] = (fields[j] & 0x00FF0000) >> 16;
+                buf[pos++] = (fields[j] & 0x0000FF00) >> 8;
+                buf[pos++] = (fields[j] & 0x000000FF);
+            }
+        }
+        return pos;
+    }
+
+#else
+
+    void recordPerfTime(uint8_t timer, uint32_t elapsed){}
+
+    void resetPerfStats(void){}
+
+    uint16_t getPerfStats(uint8_t* buf){
+        buf[0] = 0;
+        buf[1] = 0;
+        return 2;
+    }
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef INC_PERF_H_
+#define INC_PERF_H_
+
+#include <Arduino.h>
+#include <util/atomic.h>
+
+
+/*-------------------------------------------------------------------------*\
+|								  Definitions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*
+     * Set to 1 for a diagnostic build. Off, every probe compiles to nothing, and the counters, timers, and
+     * command and task statistics give their MEMORY_PERF_STATIC bytes of RAM back.
+     */
+    #ifndef PERF_ENABLED
+    #define PERF_ENABLED                    0
+    #endif
+
+    /* Counters */
+    #define PERF_UART_BYTES_IN              0
+    #define PERF_UART_BYTES_OUT             1
+    #define PERF_SERIAL_FRAMES              2                       // Packets that passed verification
+    #define PERF_SERIAL_FRAMES_DROPPED      3                       // Malformed, overlong, timed out, or no free block
+    #define PERF_RADIO_FRAMES_TX            4
+    #define PERF_RADIO_FRAMES_RX            5
+    #define PERF_RADIO_FRAMES_DROPPED       6                       // Failed CRC/header, or arrived before the last was read
+    #define PERF_ARENA_EXHAUSTED            7                       // Packet block wanted with none free, a radio frame asks again each poll
+    #define PERF_IMU_SAMPLES                8                       // Read out of the IMU FIFO
+    #define PERF_IMU_SAMPLES_LOST           9                       // Taken by the IMU but never read, the FIFO overflowed
+    #define PERF_GPS_BYTES                  10                      // Parsed from the GPS receiver
+    #define PERF_GPS_FIXES                  11
+    #define PERF_GPS_ERRORS                 12                      // GPS messages failing their checksum or cut off
+    #define PERF_ARENA_DROPS                13                      // Serial packets and telemetry records lost with no block free
+    #define PERF_COUNTER_COUNT              14
+
+    /* Timers (us) */
+    #define PERF_LOOP                       0                       // One pass of the main loop
+    #define PERF_RADIO_TRANSMIT             1                       // Blocked in radio.transmit
+    #define PERF_LBT_WAIT                   2                       // Waiting for a clear channel
+    #define PERF_IMU_DRAIN                  3                       // Reading the IMU FIFO out, the IMU's share of the CPU with its sample rate
+    #define PERF_GPS_PARSE                  4                       // One run of serviceGps, the cost per byte with PERF_GPS_BYTES
+    #define PERF_IDLE                       5                       // Asleep between tasks, the idle share of the CPU with the samples
+    #define PERF_TIMER_COUNT                6
+
+    #define PERF_TIMER_RECORD_LEN           16                      // Per timer in getPerfStats
+    #define PERF_STATS_LEN                  (2 + PERF_COUNTER_COUNT*4 + PERF_TIMER_COUNT*PERF_TIMER_RECORD_LEN)
+
+    /* Probes, a counter an interrupt also bumps takes PERF_COUNT_ATOMIC outside the interrupt, as the 32-bit increment isn't atomic */
+    #if PERF_ENABLED
+        #define PERF_COUNT(counter)         (perfCounters[counter]++)
+        #define PERF_COUNT_ATOMIC(counter)  ATOMIC_BLOCK(ATOMIC_RESTORESTATE){ perfCounters[counter]++; }
+        #define PERF_ADD(counter, n)        (perfCounters[counter] += (n))
+        #define PERF_TIMER_START(timer)     uint32_t perfStart_##timer = micros()
+        #define PERF_TIMER_STOP(timer)      recordPerfTime(timer, micros() - perfStart_##timer)
+    #else
+        #define PERF_COUNT(counter)
+        #define PERF_COUNT_ATOMIC(counter)
+        #define PERF_ADD(counter, n)
+        #define PERF_TIMER_START(timer)
+        #define PERF_TIMER_STOP(timer)
+    #endif
+
+
+/*-------------------------------------------------------------------------*\
+|								   Variables					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    #if PERF_ENABLED
+    /* Exposed so a counter probe is a single increment */
+    extern volatile uint32_t perfCounters[PERF_COUNTER_COUNT];
+    #endif
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       recordPerfTime                                                          |
+    |   Purpose:    Folds one measurement (us) into a timer's min, max, and running mean.   |
+    |   Arguments:  uint8_t, uint32_t                                                       |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void recordPerfTime(uint8_t timer, uint32_t elapsed);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       resetPerfStats                                                          |
+    |   Purpose:    Clears all counters and timers.                                         |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void resetPerfStats(void);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getPerfStats                                                            |
+    |   Purpose:    Writes the counters and timers into buf. A build without the probes     |
+    |               reports zero of each.                                                   |
+    |               Bytes               Field                                               |
+    |               -------------------------------------------                             |
+    |               0                   Counter count (N)                                   |
+    |               1                   Timer count (M)                                     |
+    |               2-                  N counters (4 each)                                 |
+    |               2+4N-               M timers: min, max, mean, samples (4 each, us)      |
+    |   Arguments:  uint8_t*                                                                |
+    |   Returns:    uint16_t (bytes written)                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint16_t getPerfStats(uint8_t* buf);
+
+#endif /* INC_PERF_H_ */
@@ -0,0 +1,104 @@
+#include "PowerBoard.h"
+
+
+/*-------------------------------------------------------------------------*\
+|								   Variables					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /* The block read, register pointer first then every register */
+    const uint8_t powerFirstRegister = POWER_REG_ID;
+    uint8_t powerRegisters[POWER_REGISTERS_LEN];
+    TwiTransfer powerTransfer = { POWER_BOARD_ADDRESS, &powerFirstRegister, 1, powerRegisters, POWER_REGISTERS_LEN, TWI_OK };
+    bool powerPolling = false;                              // powerTransfer was started and not yet collected
+    uint32_t powerPollMillis = 0;
+
+    PowerStatus powerStatus;                                // Flags 0 until the board first answers
+    uint32_t powerRecordMillis = 0;
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       sendPowerRecord                                                         |
+    |   Purpose:    Sends the cached reading as a telemetry record.                         |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void sendPowerRecord(void){
+        if(!telemetryRecordDue(TELEMETRY_POWER)) return;
+        uint8_t* record = beginTelemetryRecord(TELEMETRY_POWER);
+        if(record == NULL) return;
+        sendTelemetryRecord(encodePowerStatus(record, powerStatus) - record);
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       storePowerReading                                                       |
+    |   Purpose:    Caches the registers the last poll read, or marks the cache stale if    |
+    |               the board didn't answer.                                                |
+    |   Arguments:  int16_t (the poll's result)                                             |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void storePowerReading(int16_t res){
+        bool valid = res == TWI_OK && powerRegisters[POWER_REG_ID] == POWER_BOARD_ID;
+        bool wasValid = powerStatus.powerFlags & POWER_READING_VALID;
+        if(!valid){
+            if(wasValid) Log(F("Power board stopped answering"), res);
+            powerStatus.powerFlags &= ~POWER_READING_VALID;
+            return;
+        }
+        if(!wasValid) Log(F("Power board answering"));
+
+        const uint8_t* p = powerRegisters + POWER_REG_FLAGS;
+        p = codecGet_U8(p, &powerStatus.powerFlags);
+        p = codecGet_U16(p, &powerStatus.batteryVoltage);
+        p = codecGet_I16(p, &powerStatus.batteryCurrent);
+        p = codecGet_I16(p, &powerStatus.batteryTemperature);
+        powerStatus.powerFlags |= POWER_READING_VALID;
+        powerStatus.time = powerPollMillis;
+
+        /* Only answered readings move the policy, a silent board leaves it where it was */
+        updatePowerPolicy(powerStatus.batteryVoltage);
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       servicePowerBoard                                                       |
+    |   Purpose:    Scheduler task. Caches the reading the last run started and starts the  |
+    |               next, sending a power record every POWER_TELEMETRY_PERIOD.              |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void servicePowerBoard(void){
+        /* The last poll finished long ago, unless the bus hung and the timeout hasn't passed */
+        if(powerPolling){
+            int16_t res = pollTwiTransfer(&powerTransfer);
+            if(res == TWI_PENDING) return;
+            powerPolling = false;
+            storePowerReading(res);
+
+            if((powerStatus.powerFlags & POWER_READING_VALID) && millis() - powerRecordMillis >= POWER_TELEMETRY_PERIOD){
+                powerRecordMillis = millis();
+                sendPowerRecord();
+            }
+        }
+
+        /* The interrupt reads the next in the background */
+        if(startTwiTransfer(&powerTransfer) == TWI_OK){
+            powerPolling = true;
+            powerPollMillis = millis();
+        }
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getPowerStatus                                                          |
+    |   Purpose:    Returns the cached power board reading. POWER_READING_VALID is clear    |
+    |               if the last poll went unanswered.                                       |
+    |   Arguments:  void                                                                    |
+    |   Returns:    PowerStatus                                                             |
+    \*-------------------------------------------------------------------------------------*/
+    PowerStatus getPowerStatus(void){
+        return powerStatus;
+    }
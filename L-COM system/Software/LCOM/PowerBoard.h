@@ -0,0 +1,64 @@
+#ifndef INC_POWERBOARD_H_
+#define INC_POWERBOARD_H_
+
+#include <Arduino.h>
+#include "PowerPolicy.h"
+#include "Schemas.h"
+#include "Telemetry.h"
+#include "Twi.h"
+#include "Utility.h"
+
+
+/*-------------------------------------------------------------------------*\
+|								  Definitions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*
+     * The power board is a second ATmega328P on the stack's I2C bus, reading the battery and running
+     * its heater. Its registers are read as one block in the background and cached, so status requests
+     * and telemetry never wait on the bus. The register map is the contract with the power board's
+     * firmware: multi-byte registers are big-endian, like everything else L-COM sends.
+     */
+
+    /* Power board registers */
+    #define POWER_BOARD_ADDRESS             0x30
+    #define POWER_REG_ID                    0x00                    // Reads POWER_BOARD_ID
+    #define POWER_REG_FLAGS                 0x01                    // POWER_HEATER_ON, etc.
+    #define POWER_REG_VOLTAGE               0x02                    // U16, battery mV
+    #define POWER_REG_CURRENT               0x04                    // I16, mA drawn from the battery, negative while charging
+    #define POWER_REG_TEMPERATURE           0x06                    // I16, battery pack 0.01 degrees C
+    #define POWER_REGISTERS_LEN             8
+    #define POWER_BOARD_ID                  0x50
+
+    /* Flags, the board's own and the one L-COM adds */
+    #define POWER_HEATER_ON                 0x01
+    #define POWER_READING_VALID             0x80                    // The last poll was answered, otherwise the cache is stale
+
+    #define POWER_TELEMETRY_PERIOD          10000                   // ms between power telemetry records
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       servicePowerBoard                                                       |
+    |   Purpose:    Scheduler task. Caches the reading the last run started and starts the  |
+    |               next, sending a power record every POWER_TELEMETRY_PERIOD.              |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void servicePowerBoard(void);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getPowerStatus                                                          |
+    |   Purpose:    Returns the cached power board reading. POWER_READING_VALID is clear    |
+    |               if the last poll went unanswered.                                       |
+    |   Arguments:  void                                                                    |
+    |   Returns:    PowerStatus                                                             |
+    \*-------------------------------------------------------------------------------------*/
+    PowerStatus getPowerStatus(void);
+
+#endif /* INC_POWERBOARD_H_ */
@@ -0,0 +1,87 @@
+#include "PowerPolicy.h"
+#include <avr/pgmspace.h>
+
+
+/*-------------------------------------------------------------------------*\
+|								   Variables					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /* Each level, entered below its voltage, kept in flash */
+    struct PowerLevel{
+        uint16_t voltage;                                   // mV
+        int8_t txPower;                                     // dBm
+        uint16_t currentLimit;                              // 0.1 mA
+        uint8_t telemetryStretch;
+    };
+    const PowerLevel powerLevels[POWER_LEVEL_COUNT] PROGMEM = {
+        {   0,                          MAX_OUTPUT_POWER,           MAX_CURRENT_LIMIT,              1                                   },
+        {   POWER_LOW_VOLTAGE,          POWER_LOW_TX_POWER,         POWER_LOW_CURRENT_LIMIT,        POWER_LOW_TELEMETRY_STRETCH         },
+        {   POWER_CRITICAL_VOLTAGE,     POWER_CRITICAL_TX_POWER,    POWER_CRITICAL_CURRENT_LIMIT,   POWER_CRITICAL_TELEMETRY_STRETCH    },
+    };
+
+    uint8_t powerLevel = POWER_LEVEL_NORMAL;
+    uint16_t powerVoltage = 0;                              // Averaged, 0 until the first reading
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       applyPowerLevel                                                         |
+    |   Purpose:    Moves to a level, capping the radio and stretching telemetry to match.  |
+    |   Arguments:  uint8_t                                                                 |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void applyPowerLevel(uint8_t level){
+        PowerLevel target;
+        memcpy_P(&target, &powerLevels[level], sizeof(PowerLevel));
+        Log(F("Power level, at battery (mV):"));
+        Log((uint16_t)level);
+        Log(powerVoltage);
+
+        int16_t res = setRadioPowerCap(target.txPower, target.currentLimit);
+        if(res != ERR_NONE){
+            /* Stay on the old level, the next reading tries again */
+            Log(F("Power level not applied"), res);
+            return;
+        }
+        setTelemetryStretch(target.telemetryStretch);
+        powerLevel = level;
+
+        Log(F("Transmit cap (dBm), current limit cap (0.1 mA), telemetry stretch:"));
+        Log((int16_t)target.txPower);
+        Log(target.currentLimit);
+        Log((uint16_t)target.telemetryStretch);
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       updatePowerPolicy                                                       |
+    |   Purpose:    Averages in a battery reading and moves to the level it calls for,      |
+    |               applying and logging the level's caps when it changes.                  |
+    |   Arguments:  uint16_t (mV)                                                           |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void updatePowerPolicy(uint16_t batteryVoltage){
+        if(powerVoltage == 0) powerVoltage = batteryVoltage;
+        else powerVoltage += ((int32_t)batteryVoltage - powerVoltage) >> POWER_VOLTAGE_FILTER;
+
+        /* Down past any threshold the average is under, back up only once clear of it */
+        uint8_t level = powerLevel;
+        while(level + 1 < POWER_LEVEL_COUNT && powerVoltage < pgm_read_word(&powerLevels[level + 1].voltage)) level++;
+        while(level > POWER_LEVEL_NORMAL && powerVoltage >= pgm_read_word(&powerLevels[level].voltage) + POWER_LEVEL_HYSTERESIS) level--;
+
+        if(level != powerLevel) applyPowerLevel(level);
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getPowerLevel                                                           |
+    |   Purpose:    Returns the policy's current level.                                     |
+    |   Arguments:  void                                                                    |
+    |   Returns:    uint8_t (POWER_LEVEL_*)                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    uint8_t getPowerLevel(void){
+        return powerLevel;
+    }
@@ -0,0 +1,69 @@
+#ifndef INC_POWERPOLICY_H_
+#define INC_POWERPOLICY_H_
+
+#include <Arduino.h>
+#include "RadioController.h"
+#include "Telemetry.h"
+#include "Utility.h"
+
+
+/*-------------------------------------------------------------------------*\
+|								  Definitions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*
+     * As the battery runs down, its voltage sags further under the transmitter's peak draw, and a
+     * sag past the regulator's dropout resets the board (Notes/Problems with the bad board.txt). The
+     * policy steps down through levels on the averaged battery voltage, each capping the transmit
+     * power and PA current limit and stretching radio telemetry, trading frames for staying up.
+     */
+
+    /* Levels */
+    #define POWER_LEVEL_NORMAL              0                       // No cap
+    #define POWER_LEVEL_LOW                 1
+    #define POWER_LEVEL_CRITICAL            2
+    #define POWER_LEVEL_COUNT               3
+
+    /* Thresholds, for the 12 V (3S lithium) supply the R-78C5.0 regulator runs from */
+    #ifndef POWER_LOW_VOLTAGE
+    #define POWER_LOW_VOLTAGE               10800                   // mV, 3.6 V a cell
+    #endif
+    #ifndef POWER_CRITICAL_VOLTAGE
+    #define POWER_CRITICAL_VOLTAGE          10200                   // mV, 3.4 V a cell
+    #endif
+    #define POWER_LEVEL_HYSTERESIS          200                     // mV above a threshold before climbing back over it
+    #define POWER_VOLTAGE_FILTER            3                       // Readings averaged over about 2^3, so transmit sags and ADC noise don't count (Tests/DischargeModel.cpp)
+
+    /* What each level allows */
+    #define POWER_LOW_TX_POWER              17                      // dBm
+    #define POWER_LOW_CURRENT_LIMIT         1000                    // 0.1 mA
+    #define POWER_LOW_TELEMETRY_STRETCH     2
+    #define POWER_CRITICAL_TX_POWER         DEFAULT_OUTPUT_POWER    // What the failing board held up at
+    #define POWER_CRITICAL_CURRENT_LIMIT    DEFAULT_CURRENT_LIMIT
+    #define POWER_CRITICAL_TELEMETRY_STRETCH 4
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       updatePowerPolicy                                                       |
+    |   Purpose:    Averages in a battery reading and moves to the level it calls for,      |
+    |               applying and logging the level's caps when it changes.                  |
+    |   Arguments:  uint16_t (mV)                                                           |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void updatePowerPolicy(uint16_t batteryVoltage);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getPowerLevel                                                           |
+    |   Purpose:    Returns the policy's current level.                                     |
+    |   Arguments:  void                                                                    |
+    |   Returns:    uint8_t (POWER_LEVEL_*)                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    uint8_t getPowerLevel(void);
+
+#endif /* INC_POWERPOLICY_H_ */
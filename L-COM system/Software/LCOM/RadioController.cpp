@@ -5,6 +5,13 @@
 
 
 #include "RadioController.h"
+#include "Energy.h"
+#include "Gps.h"
+#include "RadioProfiles.h"
+#include "SpscQueue.h"
+#include "StoreForward.h"
+#include "Telemetry.h"
+#include "TimeSync.h"
 
 
 /*-------------------------------------------------------------------------*\
@@ -12,21 +19,49 @@
 \*-------------------------------------------------------------------------*/
 
 
-    SX1262 radio = NULL;
-    volatile bool enableReceiveInterrupt = true;
-    volatile bool receivedFlag = false;
-    uint8_t radioReadBuffer[MAX_LORA_MESSAGE_SIZE];
+    /* RadioLib only hands the packet status out as floats, this reads it raw */
+    class LcomSX1262 : public SX1262{
+        public:
+            LcomSX1262(Module* mod) : SX1262(mod) {}
+            uint32_t readPacketStatus(void){ return getPacketStatus(); }
+    };
+
+    LcomSX1262 radio = new Module(NSS, DIO1, NRST, BUSY);   // Created once, resets reuse it
+    volatile bool radioReceiving = true;                    // False while transmitting, running CAD, or retuning
+
+    /* DIO1 events, queued by the interrupt and drained by readRadioData */
+    #define RADIO_EVENT_RX_DONE     0
+    #define RADIO_EVENT_TX_DONE     1                       // Also CAD done, anything while not receiving
+    #define RADIO_EVENT_QUEUE_LEN   4
+    struct RadioEvent{
+        uint8_t type;
+        uint32_t micros;                                    // Captured in the interrupt, for time sync and tracing
+    };
+    SpscQueue<RadioEvent, RADIO_EVENT_QUEUE_LEN> radioEvents;
+    uint8_t radioBlock = ARENA_NONE;                         // Holds the last frame read, until the caller takes it
+    uint8_t* radioReadBuffer = NULL;
+    uint8_t radioDataOffset = 0;
+    uint16_t radioDataLength = 0;
     bool LoRaSet = false;
+    uint16_t lastTransmitLength = 0;
 
-    /* Radio parameters */
-    float frequency         = DEFAULT_FREQUENCY;
-    float bandwidth         = DEFAULT_BANDWIDTH;  
-    uint8_t spreadingFactor = DEFAULT_SPREADING_FACTOR;
-    uint8_t codingRate      = DEFAULT_CODING_RATE;
-    uint8_t syncWord        = DEFAULT_SYNC_WORD;
-    int8_t power            = DEFAULT_OUTPUT_POWER;
-    uint16_t preambleLength = DEFAULT_PREAMBLE_LENGTH;
-    float currentLimit      = DEFAULT_CURRENT_LIMIT;
+    /* Frequency hopping, HOP_NO_CHANNEL while sitting on the fixed frequency */
+    #define HOP_NO_CHANNEL 0xFF
+    uint8_t currentHopChannel = HOP_NO_CHANNEL;
+
+    /* Listen-before-talk */
+    bool LBTEnabled = false;
+    uint32_t busyDeferrals = 0;
+    uint32_t collisionsAvoided = 0;
+    uint32_t transmissionsAbandoned = 0;
+
+    /* Radio parameters, only ever updated once the chip has accepted the whole set */
+    const RadioParameters defaultRadioParameters PROGMEM = DEFAULT_RADIO_PARAMETERS;
+    RadioParameters radioParameters = DEFAULT_RADIO_PARAMETERS;
+
+    /* Transmit cap, the chip gets the lower of it and the parameters */
+    int8_t radioPowerCap = MAX_OUTPUT_POWER;
+    uint16_t radioCurrentCap = MAX_CURRENT_LIMIT;
 
 
 /*-------------------------------------------------------------------------*\
@@ -35,20 +70,63 @@
 
 
     /*-------------------------------------------------------------------------------------*\
-    |   Name:       initializeRadio                                                         |
-    |   Purpose:    Initializes the LoRa radio pins, current limit, and starts listening.   |
+    |   Name:       tuneHopChannel                                                          |
+    |   Purpose:    Retunes to a hop channel. Image calibration is done once for the whole  |
+    |               band in startHopping, so each hop is only a standby and a frequency     |
+    |               write, and nothing is sent at all if already on the channel.            |
+    |   Arguments:  uint8_t                                                                 |
+    |   Returns:    int16_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t tuneHopChannel(uint8_t channel){
+        if(channel == currentHopChannel) return ERR_NONE;
+        radio.standby();
+        int16_t res = radio.setFrequency(RADIOLIB_MHZ(getHopChannelFrequency(channel)), false);
+        if(res == ERR_NONE) currentHopChannel = channel;
+        return res;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       startHopping                                                            |
+    |   Purpose:    Calibrates for the band and parks on the home channel to wait for sync. |
     |   Arguments:  void                                                                    |
-    |   Returns:    void                                                                    |
+    |   Returns:    int16_t                                                                 |
     \*-------------------------------------------------------------------------------------*/
-    int16_t initializeRadio(void){
-        /* Create the radio object */
-        radio = new Module(NSS, DIO1, NRST, BUSY);
+    int16_t startHopping(void){
+        radio.standby();
+        int16_t res = radio.setFrequency(RADIOLIB_MHZ(getHopChannelFrequency(HOP_HOME_CHANNEL)), true);
+        if(res != ERR_NONE) return res;
+        currentHopChannel = HOP_HOME_CHANNEL;
+        return tuneHopChannel(getHopListenChannel());
+    }
 
-        //radio.reset();
-    
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       cappedRadioParameters                                                   |
+    |   Purpose:    Returns the parameters as the chip gets them, under the transmit cap.   |
+    |   Arguments:  const RadioParameters&                                                  |
+    |   Returns:    RadioParameters                                                         |
+    \*-------------------------------------------------------------------------------------*/
+    RadioParameters cappedRadioParameters(const RadioParameters& params){
+        RadioParameters capped = params;
+        if(capped.power > radioPowerCap) capped.power = radioPowerCap;
+        if(capped.currentLimit > radioCurrentCap) capped.currentLimit = radioCurrentCap;
+        return capped;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       configureRadio                                                          |
+    |   Purpose:    Brings the chip up with the current parameters and starts listening.    |
+    |               begin() pulses NRST itself, so this doubles as the soft reset.          |
+    |   Arguments:  void                                                                    |
+    |   Returns:    int16_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t configureRadio(void){
         /* LoRa initialization */
         Log(F("[SX1262] Initializing radio..."));
-        int16_t res = radio.begin(frequency, bandwidth, spreadingFactor, codingRate, syncWord, power, preambleLength);
+        RadioParameters chip = cappedRadioParameters(radioParameters);
+        int16_t res = radio.begin(
+            RADIOLIB_MHZ(chip.frequency), RADIOLIB_KHZ(chip.bandwidth), chip.spreadingFactor, chip.codingRate,
+            chip.syncWord, chip.power, chip.preambleLength
+        );
         if(res != ERR_NONE) {
             Log(F("Initialization failed"), res);     
             return res;
@@ -57,22 +135,27 @@
     
         /* Set the current limit */
         Log(F("[SX1262] Setting current limit..."));
-        res = radio.setCurrentLimit(DEFAULT_CURRENT_LIMIT);
+        res = radio.setCurrentLimit(RADIOLIB_MA(chip.currentLimit));
         if (res != ERR_NONE) {
             Log(F("Current limit set failed"), res);     
             return res;
         }
         Log(F("Current limit set success"));
-    
-        /* Set RF switch pins */
-        radio.setRfSwitchPins(RX, TX);
-    
-        /* Enable the receive callback */
-        radio.setDio1Action(receiveCallback);
+
+        /* Return to the hopping sequence if it was enabled */
+        currentHopChannel = HOP_NO_CHANNEL;
+        if(getHoppingEnabled()){
+            res = startHopping();
+            if(res != ERR_NONE){
+                Log(F("Hopping start failed"), res);
+                return res;
+            }
+        }
     
         /* Start listening in interrupt mode */
         Log(F("[SX1262] Starting to listen in interrupt mode..."));
         res = radio.startReceive();
+        radioEvents.clear();
         if (res != ERR_NONE) {
             Log(F("Listening start failed"), res);     
             return res;
@@ -83,67 +166,175 @@
         return ERR_NONE;
     }
 
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       initializeRadio                                                         |
+    |   Purpose:    Initializes the LoRa radio pins, current limit, and starts listening.   |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t initializeRadio(void){
+        /* Set RF switch pins, these and the DIO1 action live in the module object and survive a soft reset */
+        radio.setRfSwitchPins(RX, TX);
+    
+        /* Enable the receive callback */
+        radio.setDio1Action(receiveCallback);
+
+        /* Seed the backoff generator, floating pin noise keeps identical modules from backing off in lockstep */
+        randomSeed(micros() ^ analogRead(A1));
+
+        /* Come up on the stored boot profile rather than the compile-time defaults */
+        uint8_t bootProfile = getBootProfile();
+        if(bootProfile != PROFILE_NONE){
+            RadioParameters params;
+            if(loadRadioProfile(bootProfile, NULL, &params) == ERR_NONE){
+                radioParameters = params;
+                LoRaSet = (memcmp_P(&radioParameters, &defaultRadioParameters, sizeof(RadioParameters)) != 0);
+                Log(F("Using boot profile:"));
+                Log((uint16_t)bootProfile);
+            }
+        }
+
+        /* Bring up the chip */
+        return configureRadio();
+    }
+
     /*-------------------------------------------------------------------------------------*\
     |   Name:       receiveCallback                                                         |
-    |   Purpose:    Handles the interrupt from the LoRa module.                             |
+    |   Purpose:    Handles the interrupt from the LoRa module, queueing it for the loop.   |
     |   Arguments:  void                                                                    |
     |   Returns:    void                                                                    |
     \*-------------------------------------------------------------------------------------*/
     void receiveCallback(void){
-        if(!enableReceiveInterrupt) {
-            return;
-        }
-        
-        /* Set the received flag */
-        receivedFlag = true;    
+        RadioEvent event;
+        event.type = radioReceiving ? RADIO_EVENT_RX_DONE : RADIO_EVENT_TX_DONE;
+        event.micros = micros();
+
+        /* Only a frame is lost when the queue is full, other events are just acknowledgements */
+        if(!radioEvents.push(event) && event.type == RADIO_EVENT_RX_DONE) PERF_COUNT(PERF_RADIO_FRAMES_DROPPED);
     }
 
     /*-------------------------------------------------------------------------------------*\
     |   Name:       readRadioData                                                           |
-    |   Purpose:    Reads back data from the radio into a buffer.                           |
+    |   Purpose:    Reads back data from the radio into an arena block. Data passed up is   |
+    |               left in the block for getRadioBlock, anything else releases it.         |
     |   Arguments:  void                                                                    |
     |   Returns:    int16_t                                                                 |
     \*-------------------------------------------------------------------------------------*/
     int16_t readRadioData(void){
-        /* If LoRa data received */
-        if(receivedFlag){
-
-            /* Disable the interrupt and reset the flag before processing data */
-            enableReceiveInterrupt = false;
-            receivedFlag = false;
-
-            /* Empty the buffer */
-            for(uint16_t i = 0; i != (sizeof radioReadBuffer); i++){
-                radioReadBuffer[i] = 0;
+        /* If the radio has raised anything */
+        if(!radioEvents.empty()){
+
+            /* Take a block to read into, with none free the events wait in the queue and the frame in the radio */
+            releaseBlock(radioBlock);
+            radioBlock = acquireBlock(ARENA_OWNER_RADIO_RX);
+            if(radioBlock == ARENA_NONE) return NO_NEW_RADIO_DATA;
+
+            /* The radio only holds the latest frame, any received before it were overwritten */
+            RadioEvent event;
+            bool received = false;
+            uint32_t receiveMicros = 0;
+            while(radioEvents.pop(event)){
+                if(event.type != RADIO_EVENT_RX_DONE) continue;
+                if(received) PERF_COUNT_ATOMIC(PERF_RADIO_FRAMES_DROPPED);
+                received = true;
+                receiveMicros = event.micros;
+            }
+            if(!received){
+                releaseBlock(radioBlock);
+                radioBlock = ARENA_NONE;
+                return NO_NEW_RADIO_DATA;
             }
 
-            // Read the data
-            int16_t res = radio.readData(radioReadBuffer, sizeof radioReadBuffer);                 
+            // Read the data, far enough into the block for a message packet to be built in front of it
+            traceMark(TRACE_MARK_RADIO_READ);
+            radioReadBuffer = getBlock(radioBlock) + ARENA_RADIO_RX_OFFSET;
+            int16_t res = radio.readData(radioReadBuffer, MAX_LORA_MESSAGE_SIZE);                 
+            radioDataLength = radio.getPacketLength();
+            radioDataOffset = 0;
+            radioReadBuffer[radioDataLength] = 0;   // Terminated for printing
             Log(F("[SX1262] Received packet"), res);
+            if(res == ERR_NONE) PERF_COUNT(PERF_RADIO_FRAMES_RX);
+            else PERF_COUNT_ATOMIC(PERF_RADIO_FRAMES_DROPPED);
             if(res == ERR_NONE){
+                // Anything heard intact means the link is up
+                noteLinkHeard();
+
                 // Print data
                 Log(F("[SX1262] Data:"));
                 Log((char*)radioReadBuffer);
             }
         
-            // Print RSSI (Received Signal Strength Indicator)
-            Log(F("[SX1262] RSSI (dBm):"));
-            Log(radio.getRSSI());
-    
-            // Print SNR (Signal-to-Noise Ratio)
-            Log(F("[SX1262] SNR (dB):"));
-            Log(radio.getSNR());    
+            // Print RSSI (Received Signal Strength Indicator) and SNR (Signal-to-Noise Ratio)
+            int16_t RSSI, SNR;
+            getMessageSignal(&RSSI, &SNR);
+            Log(F("[SX1262] RSSI (0.01 dBm):"));
+            Log(RSSI);
+            Log(F("[SX1262] SNR (0.01 dB):"));
+            Log(SNR);
+
+            /* Strip the hop header and move to the channel the next frame will be on */
+            uint16_t frameLength = radioDataLength;
+            if(getHoppingEnabled()){
+                bool valid = (res == ERR_NONE && radioDataLength >= HOP_HEADER_LEN);
+                if(valid && isHopRepeat(radioReadBuffer, currentHopChannel)){
+                    Log(F("[FHSS] Repeated frame dropped"));
+                    res = NO_NEW_RADIO_DATA;
+                }
+                else tuneHopChannel(handleHopReceive(radioReadBuffer, valid, currentHopChannel));
+                if(valid){
+                    radioDataOffset = HOP_HEADER_LEN;
+                    radioDataLength -= HOP_HEADER_LEN;
+                }
+            }
+
+            /* Strip the frame type, anything that isn't data is handled here rather than passed up */
+            uint8_t frameType = AIR_FRAME_DATA;
+            if(res == ERR_NONE && radioDataLength >= AIR_HEADER_LEN){
+                frameType = radioReadBuffer[radioDataOffset];
+                radioDataOffset += AIR_HEADER_LEN;
+                radioDataLength -= AIR_HEADER_LEN;
+            }
+            if(frameType == AIR_FRAME_TIME_BEACON){
+                uint32_t delay = getTimeOnAir(frameLength) + TIME_SYNC_FIXED_LATENCY + (micros() - receiveMicros);
+                handleTimeBeacon(radioReadBuffer + radioDataOffset, radioDataLength, delay);
+                res = NO_NEW_RADIO_DATA;
+            }
+            else if(frameType == AIR_FRAME_TRACED_DATA && radioDataLength >= TRACE_HEADER_LEN){
+                readTraceHeader(radioReadBuffer + radioDataOffset, frameLength, getTimeOnAir(frameLength), receiveMicros);
+                radioDataOffset += TRACE_HEADER_LEN;
+                radioDataLength -= TRACE_HEADER_LEN;
+            }
+            else if(frameType == AIR_FRAME_TELEMETRY){
+                res = TELEMETRY_RECORD;
+            }
+            else if(frameType != AIR_FRAME_DATA){
+                Log(F("[SX1262] Unknown frame type dropped"));
+                res = NO_NEW_RADIO_DATA;
+            }
+            
+            /* Nothing to pass up, the block goes straight back */
+            if(res == NO_NEW_RADIO_DATA){
+                releaseBlock(radioBlock);
+                radioBlock = ARENA_NONE;
+            }
             
             /* Start listening in interrupt mode */
             radio.startReceive();
 
-            /* Reenable the interrupt */
-            enableReceiveInterrupt = true;
-
             /* Return the result */
             return res;
         }
         else{
+            /* Fall back to the home channel if the hopping sequence was lost */
+            if(getHoppingEnabled()){
+                uint8_t channel = getHopListenChannel();
+                if(channel != currentHopChannel){
+                    radioReceiving = false;
+                    tuneHopChannel(channel);
+                    radio.startReceive();
+                    radioReceiving = true;
+                }
+            }
             return NO_NEW_RADIO_DATA;
         }
     }
@@ -155,7 +346,20 @@
     |   Returns:    uint8_t*                                                                |
     \*-------------------------------------------------------------------------------------*/
     uint8_t* getRadioData(void){
-        return radioReadBuffer;
+        return radioReadBuffer + radioDataOffset;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getRadioBlock                                                           |
+    |   Purpose:    Takes ownership of the block holding the last radio data. The caller    |
+    |               releases it when done.                                                  |
+    |   Arguments:  void                                                                    |
+    |   Returns:    uint8_t (ARENA_NONE if there is none)                                   |
+    \*-------------------------------------------------------------------------------------*/
+    uint8_t getRadioBlock(void){
+        uint8_t block = radioBlock;
+        radioBlock = ARENA_NONE;
+        return block;
     }
 
     /*-------------------------------------------------------------------------------------*\
@@ -165,65 +369,319 @@
     |   Returns:    uint16_t                                                                |
     \*-------------------------------------------------------------------------------------*/
     uint16_t getRadioDataLength(void){
-        return radio.getPacketLength();
+        return radioDataLength;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       waitForClearChannel                                                     |
+    |   Purpose:    Runs CAD until the channel is free, backing off a random number of      |
+    |               slots from an exponentially growing window while it is busy.            |
+    |   Arguments:  void                                                                    |
+    |   Returns:    int16_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t waitForClearChannel(void){
+        uint32_t deferred = 0;
+        uint8_t attempt = 0;
+
+        while(true){
+            /* Scan for a LoRa preamble, leaves the radio in standby */
+            int16_t res = radio.scanChannel();
+            if(res == CHANNEL_FREE){
+                if(attempt > 0) collisionsAvoided++;
+                return ERR_NONE;
+            }
+            if(res != PREAMBLE_DETECTED) return res;
+
+            /* Channel busy, back off */
+            busyDeferrals++;
+            if(attempt < LBT_MAX_BACKOFF_EXPONENT) attempt++;
+            uint32_t backoff = (uint32_t)random(1, (1 << attempt) + 1) * LBT_SLOT_TIME;
+            if(deferred + backoff > LBT_MAX_DEFERRAL){
+                transmissionsAbandoned++;
+                return RADIO_CHANNEL_BUSY;
+            }
+            deferred += backoff;
+            delay(backoff);
+        }
     }
 
     /*-------------------------------------------------------------------------------------*\
     |   Name:       transmitRadio                                                           |
     |   Purpose:    Transmits the data in the buffer over the radio.                        |
-    |   Arguments:  uint8_t*, uint16_t                                                      |
+    |   Arguments:  uint8_t*, uint16_t, uint8_t                                             |
     |   Returns:    int16_t                                                                 |
     \*-------------------------------------------------------------------------------------*/
-    int16_t transmitRadio(uint8_t* buf, uint16_t len){
-        /* Disable the interrupt */
-        enableReceiveInterrupt = false;
+    int16_t transmitRadio(uint8_t* buf, uint16_t len, uint8_t frameType){
+        traceMark(TRACE_MARK_TRANSMIT_ENTRY);
+        uint32_t transmitStart = micros();
+
+        /* DIO1 means transmit or CAD done from here on, and the GPS receiver is kept off it until serviceGps runs next */
+        radioReceiving = false;
+        quietGps(0);
 
-        Serial.print("Transmitting data: \"");
+        Serial.print(F("Transmitting data: \""));
         Serial.write((char*)buf, len);
-        Serial.println("\"");
+        Serial.println(F("\""));
+
+        /* Prepend the trace header, if any, and the frame type in the headroom */
+        uint8_t* payload = buf;
+        uint16_t traceLen = (frameType == AIR_FRAME_TRACED_DATA) ? TRACE_HEADER_LEN : 0;
+        if(len + traceLen + AIR_HEADER_LEN + (getHoppingEnabled() ? HOP_HEADER_LEN : 0) > MAX_LORA_MESSAGE_SIZE){
+            radioReceiving = true;
+            return ERR_PACKET_TOO_LONG;
+        }
+        buf -= traceLen;
+        len += traceLen;
+        buf -= AIR_HEADER_LEN;
+        len += AIR_HEADER_LEN;
+        buf[0] = frameType;
+
+        /* Prepend the hop header and move to this frame's channel, a frame is never sent on the wrong one */
+        int16_t res = ERR_NONE;
+        if(getHoppingEnabled()){
+            buf -= HOP_HEADER_LEN;
+            len += HOP_HEADER_LEN;
+            res = tuneHopChannel(nextHopTransmitChannel(buf));
+            if(res != ERR_NONE) Log(F("Hop retune failed, transmission abandoned"), res);
+        }
 
-        /* Transmit the data */
-        int16_t res = radio.transmit(buf, len);
-        Log("Transmission finished", res);
+        /* Listen before talk, CAD done also raises DIO1 but is queued as transmit or CAD done and dropped below */
+        if(LBTEnabled && res == ERR_NONE){
+            PERF_TIMER_START(PERF_LBT_WAIT);
+            res = waitForClearChannel();
+            PERF_TIMER_STOP(PERF_LBT_WAIT);
+            if(res != ERR_NONE) Log(F("Channel busy, transmission abandoned"), res);
+        }
+
+        /* Transmit the data, a beacon's time is taken as close to the start of transmission as possible */
+        if(res == ERR_NONE){
+            if(frameType == AIR_FRAME_TIME_BEACON) stampTimeBeacon(payload);
+            else if(frameType == AIR_FRAME_TRACED_DATA) writeTraceHeader(payload - TRACE_HEADER_LEN);
+            lastTransmitLength = len;
+            PERF_TIMER_START(PERF_RADIO_TRANSMIT);
+            res = radio.transmit(buf, len);
+            PERF_TIMER_STOP(PERF_RADIO_TRANSMIT);
+            if(res == ERR_NONE) PERF_COUNT(PERF_RADIO_FRAMES_TX);
+            Log(F("Transmission finished"), res);
+        }
+
+        /* After a pause long enough for the peer to have parked, the frame goes out again on the home channel */
+        uint8_t sent = (res == ERR_NONE) ? 1 : 0;
+        if(sent && getHoppingEnabled() && hopTransmitDone()){
+            int16_t repeatRes = tuneHopChannel(HOP_HOME_CHANNEL);
+            if(LBTEnabled && repeatRes == ERR_NONE) repeatRes = waitForClearChannel();
+            if(repeatRes == ERR_NONE){
+                if(frameType == AIR_FRAME_TIME_BEACON) stampTimeBeacon(payload);
+                else if(frameType == AIR_FRAME_TRACED_DATA) writeTraceHeader(payload - TRACE_HEADER_LEN);
+                repeatRes = radio.transmit(buf, len);
+            }
+            if(repeatRes == ERR_NONE) sent++;
+            else Log(F("Home channel repeat failed"), repeatRes);
+        }
 
-        /* Enable the interrupt */
-        enableReceiveInterrupt = true;
-        receivedFlag = false;
+        /* Back to receiving, dropping the transmit and CAD done events so they can't crowd out a frame */
+        radioEvents.clear();
+        radioReceiving = true;
+
+        /* Go back to where the peer's next frame is expected, the transmission's result still stands if this fails */
+        if(getHoppingEnabled()){
+            int16_t tuneRes = tuneHopChannel(getHopListenChannel());
+            if(tuneRes != ERR_NONE) Log(F("Hop retune to listen channel failed"), tuneRes);
+        }
 
         /* Start listening in interrupt mode */
         radio.startReceive();    
 
+        /* Count the time on air at the power the chip was given, and the rest as standby */
+        RadioParameters chip = cappedRadioParameters(radioParameters);
+        accountRadioTransmit(sent * getTimeOnAir(len), micros() - transmitStart, chip.power, chip.currentLimit);
+
         /* Return */
         return res;
     }
 
     /*-------------------------------------------------------------------------------------*\
-    |   Name:       setRadioParameters                                                      |
-    |   Purpose:    Sets the radio parameters.                                              |
-    |   Arguments:  void                                                                    |
+    |   Name:       configureHopping                                                        |
+    |   Purpose:    Loads the hopping parameters and retunes the radio to match.            |
+    |   Arguments:  bool, uint16_t, const uint32_t* (kHz), uint8_t                          |
     |   Returns:    int16_t                                                                 |
     \*-------------------------------------------------------------------------------------*/
-    int16_t setRadioParameters(
-        float _frequency, float _bandwidth, uint8_t _spreadingFactor, uint8_t _codingRate,
-        uint8_t _syncWord, int8_t _power, uint16_t _preambleLength, float _currentLimit
-    ){
+    int16_t configureHopping(bool enable, uint16_t seed, const uint32_t* channels, uint8_t count){
+        radioReceiving = false;
+        loadHoppingPlan(enable, seed, channels, count);
+
+        /* Either start on the home channel or go back to the fixed frequency */
         int16_t res;
-        if((res = radio.setFrequency(_frequency))                != ERR_NONE) return res;
-            frequency = _frequency;
-        if((res = radio.setBandwidth(_bandwidth))                != ERR_NONE) return res;
-            bandwidth = _bandwidth;
-        if((res = radio.setSpreadingFactor(_spreadingFactor))    != ERR_NONE) return res;
-            spreadingFactor = _spreadingFactor;
-        if((res = radio.setCodingRate(_codingRate))              != ERR_NONE) return res;
-            codingRate = _codingRate;
-        if((res = radio.setSyncWord(_syncWord))                  != ERR_NONE) return res;
-            syncWord = _syncWord;
-        if((res = radio.setOutputPower(_power))                  != ERR_NONE) return res;
-            power = _power;
-        if((res = radio.setPreambleLength(_preambleLength))      != ERR_NONE) return res;
-            preambleLength = _preambleLength;
-        if((res = radio.setCurrentLimit(_currentLimit))          != ERR_NONE) return res;
-            currentLimit = _currentLimit;
+        if(enable){
+            res = startHopping();
+        }
+        else{
+            radio.standby();
+            res = radio.setFrequency(RADIOLIB_MHZ(radioParameters.frequency));
+            currentHopChannel = HOP_NO_CHANNEL;
+        }
+
+        radio.startReceive();
+        radioEvents.clear();
+        radioReceiving = true;
+        return res;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       setLBTEnabled                                                           |
+    |   Purpose:    Enables or disables channel activity detection before transmitting.     |
+    |   Arguments:  bool                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void setLBTEnabled(bool enable){
+        LBTEnabled = enable;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getLBTEnabled                                                           |
+    |   Purpose:    Returns whether listen-before-talk is enabled.                          |
+    |   Returns:    bool                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    bool getLBTEnabled(void){
+        return LBTEnabled;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getBusyDeferrals                                                        |
+    |   Purpose:    Returns the number of backoffs taken because the channel was busy.      |
+    |   Returns:    uint32_t                                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint32_t getBusyDeferrals(void){
+        return busyDeferrals;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getCollisionsAvoided                                                    |
+    |   Purpose:    Returns the number of transmissions sent after waiting out a busy       |
+    |               channel, i.e. ones that would have collided without LBT.                |
+    |   Returns:    uint32_t                                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint32_t getCollisionsAvoided(void){
+        return collisionsAvoided;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getTransmissionsAbandoned                                               |
+    |   Purpose:    Returns the number of transmissions dropped after LBT_MAX_DEFERRAL.     |
+    |   Returns:    uint32_t                                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint32_t getTransmissionsAbandoned(void){
+        return transmissionsAbandoned;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       applyRadioParameters                                                    |
+    |   Purpose:    Issues a setter only for the fields of target that differ from chip,    |
+    |               updating chip as each one succeeds so it always mirrors the hardware.   |
+    |               The fixed frequency is left alone while hopping owns the synthesizer.   |
+    |   Arguments:  const RadioParameters&, RadioParameters&                                |
+    |   Returns:    int16_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t applyRadioParameters(const RadioParameters& target, RadioParameters& chip){
+        int16_t res;
+        if(target.frequency != chip.frequency){
+            if(!getHoppingEnabled() && (res = radio.setFrequency(RADIOLIB_MHZ(target.frequency))) != ERR_NONE) return res;
+            chip.frequency = target.frequency;
+        }
+        if(target.bandwidth != chip.bandwidth){
+            if((res = radio.setBandwidth(RADIOLIB_KHZ(target.bandwidth))) != ERR_NONE) return res;
+            chip.bandwidth = target.bandwidth;
+        }
+        if(target.spreadingFactor != chip.spreadingFactor){
+            if((res = radio.setSpreadingFactor(target.spreadingFactor)) != ERR_NONE) return res;
+            chip.spreadingFactor = target.spreadingFactor;
+        }
+        if(target.codingRate != chip.codingRate){
+            if((res = radio.setCodingRate(target.codingRate)) != ERR_NONE) return res;
+            chip.codingRate = target.codingRate;
+        }
+        if(target.syncWord != chip.syncWord){
+            if((res = radio.setSyncWord(target.syncWord)) != ERR_NONE) return res;
+            chip.syncWord = target.syncWord;
+        }
+        if(target.power != chip.power){
+            if((res = radio.setOutputPower(target.power)) != ERR_NONE) return res;
+            chip.power = target.power;
+        }
+        if(target.preambleLength != chip.preambleLength){
+            if((res = radio.setPreambleLength(target.preambleLength)) != ERR_NONE) return res;
+            chip.preambleLength = target.preambleLength;
+        }
+        if(target.currentLimit != chip.currentLimit){
+            if((res = radio.setCurrentLimit(RADIOLIB_MA(target.currentLimit))) != ERR_NONE) return res;
+            chip.currentLimit = target.currentLimit;
+        }
+        return ERR_NONE;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       setRadioParameters                                                      |
+    |   Purpose:    Sets the radio parameters. Only changed fields are written, and if the  |
+    |               chip rejects one the fields already written are rolled back, leaving    |
+    |               both the chip and the cached parameters on the previous configuration.  |
+    |   Arguments:  const RadioParameters&                                                  |
+    |   Returns:    int16_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t setRadioParameters(const RadioParameters& params){
+        uint32_t startTime = micros();
+
+        /* Apply the delta, tracking what actually reached the chip */
+        RadioParameters chip = cappedRadioParameters(radioParameters);
+        int16_t res = applyRadioParameters(cappedRadioParameters(params), chip);
+        if(res != ERR_NONE){
+            Log(F("Radio reconfiguration failed, rolling back"), res);
+            int16_t rollbackRes = applyRadioParameters(cappedRadioParameters(radioParameters), chip);
+            if(rollbackRes != ERR_NONE) Log(F("Radio rollback failed"), rollbackRes);
+            return res;
+        }
+
+        /* Commit, structs are unpadded on the AVR so memcmp is a field-by-field compare */
+        radioParameters = params;
+        LoRaSet = (memcmp_P(&radioParameters, &defaultRadioParameters, sizeof(RadioParameters)) != 0);
+
+        Log(F("Radio reconfiguration time (us):"));
+        Log((uint32_t)(micros() - startTime));
+        return ERR_NONE;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getRadioParameters                                                      |
+    |   Purpose:    Returns the current radio parameters.                                   |
+    |   Returns:    RadioParameters                                                         |
+    \*-------------------------------------------------------------------------------------*/
+    RadioParameters getRadioParameters(void){
+        return radioParameters;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       setRadioPowerCap                                                        |
+    |   Purpose:    Caps the output power and current limit the chip is given, leaving the  |
+    |               parameters themselves (and what GET_LORA_PARAMETERS shows) alone.       |
+    |               MAX_OUTPUT_POWER and MAX_CURRENT_LIMIT lift the cap.                    |
+    |   Arguments:  int8_t (dBm), uint16_t (0.1 mA)                                         |
+    |   Returns:    int16_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t setRadioPowerCap(int8_t power, uint16_t currentLimit){
+        int8_t oldPowerCap = radioPowerCap;
+        uint16_t oldCurrentCap = radioCurrentCap;
+
+        /* Only the power and current limit can differ, so only they are written */
+        RadioParameters chip = cappedRadioParameters(radioParameters);
+        radioPowerCap = power;
+        radioCurrentCap = currentLimit;
+        int16_t res = applyRadioParameters(cappedRadioParameters(radioParameters), chip);
+        if(res != ERR_NONE){
+            Log(F("Transmit cap failed, rolling back"), res);
+            radioPowerCap = oldPowerCap;
+            radioCurrentCap = oldCurrentCap;
+            int16_t rollbackRes = applyRadioParameters(cappedRadioParameters(radioParameters), chip);
+            if(rollbackRes != ERR_NONE) Log(F("Radio rollback failed"), rollbackRes);
+        }
         return res;
     }
 
@@ -238,31 +696,33 @@
 
     /*-------------------------------------------------------------------------------------*\
     |   Name:       radioReset                                                              |
-    |   Purpose:    Resets the radio.                                                       |
+    |   Purpose:    Resets the radio, reusing the existing module object and re-applying    |
+    |               the current parameters.                                                 |
     |   Returns:    int16_t                                                                 |
     \*-------------------------------------------------------------------------------------*/
     int16_t resetRadio(void){
-        radio.reset();
-        //delete radio;
-        return initializeRadio();
+        radioReceiving = false;
+        int16_t res = configureRadio();
+        radioReceiving = true;
+        return res;
     }
 
     /*-------------------------------------------------------------------------------------*\
     |   Name:       getFrequency                                                            |
     |   Purpose:    Returns the current frequency of the radio.                             |
-    |   Returns:    float                                                                   |
+    |   Returns:    uint32_t (kHz)                                                          |
     \*-------------------------------------------------------------------------------------*/
-    float getFrequency(void){
-        return frequency;
+    uint32_t getFrequency(void){
+        return radioParameters.frequency;
     }
 
     /*-------------------------------------------------------------------------------------*\
     |   Name:       getBandwidth                                                            |
     |   Purpose:    Returns the current bandwidth of the radio.                             |
-    |   Returns:    float                                                                   |
+    |   Returns:    uint32_t (Hz)                                                           |
     \*-------------------------------------------------------------------------------------*/
-    float getBandwidth(void){
-        return bandwidth;
+    uint32_t getBandwidth(void){
+        return radioParameters.bandwidth;
     }
 
     /*-------------------------------------------------------------------------------------*\
@@ -271,7 +731,7 @@
     |   Returns:    uint8_t                                                                 |
     \*-------------------------------------------------------------------------------------*/
     uint8_t getSpreadingFactor(void){
-        return spreadingFactor;
+        return radioParameters.spreadingFactor;
     }
 
     /*-------------------------------------------------------------------------------------*\
@@ -280,7 +740,7 @@
     |   Returns:    uint8_t                                                                 |
     \*-------------------------------------------------------------------------------------*/
     uint8_t getCodingRate(void){
-        return codingRate;
+        return radioParameters.codingRate;
     }    
 
     /*-------------------------------------------------------------------------------------*\
@@ -289,7 +749,7 @@
     |   Returns:    uint8_t                                                                 |
     \*-------------------------------------------------------------------------------------*/
     uint8_t getSyncWord(void){
-        return syncWord;
+        return radioParameters.syncWord;
     }
 
     /*-------------------------------------------------------------------------------------*\
@@ -298,7 +758,7 @@
     |   Returns:    uint8_t                                                                 |
     \*-------------------------------------------------------------------------------------*/
     uint8_t getPower(void){
-        return power;
+        return radioParameters.power;
     }
 
     /*-------------------------------------------------------------------------------------*\
@@ -307,16 +767,16 @@
     |   Returns:    uint16_t                                                                |
     \*-------------------------------------------------------------------------------------*/
     uint16_t getPreambleLength(void){
-        return preambleLength;
+        return radioParameters.preambleLength;
     }
 
     /*-------------------------------------------------------------------------------------*\
     |   Name:       getCurrentLim                                                           |
     |   Purpose:    Returns the current current limit of the radio.                         |
-    |   Returns:    float                                                                   |
+    |   Returns:    uint16_t (0.1 mA)                                                       |
     \*-------------------------------------------------------------------------------------*/
-    float getCurrentLim(void){
-        return currentLimit;
+    uint16_t getCurrentLim(void){
+        return radioParameters.currentLimit;
     }
 
     /*-------------------------------------------------------------------------------------*\
@@ -325,33 +785,50 @@
     |   Returns:    uint32_t                                                                |
     \*-------------------------------------------------------------------------------------*/
     uint32_t getTOA(void){
-        //return radio.getTimeOnAir(); // Missing from the current library?
-        return 0;
+        return getTimeOnAir(lastTransmitLength);
     }
 
     /*-------------------------------------------------------------------------------------*\
-    |   Name:       getLoRaDataRate                                                         |
-    |   Purpose:    Returns the data rate of the last packet transmitted.                   |
-    |   Returns:    float                                                                   |
+    |   Name:       getTimeOnAir                                                            |
+    |   Purpose:    Returns the time-on-air (us) of a frame of the given length with the    |
+    |               current LoRa parameters.                                                |
+    |   Arguments:  uint16_t                                                                |
+    |   Returns:    uint32_t                                                                |
     \*-------------------------------------------------------------------------------------*/
-    float getLoRaDataRate(void){
-        return radio.getDataRate();
+    uint32_t getTimeOnAir(uint16_t len){
+        uint8_t sf = radioParameters.spreadingFactor;
+        uint32_t symbolTime = (1000000UL << sf) / radioParameters.bandwidth;                     // us, 10^6 << 12 still fits
+        bool ldro = (symbolTime >= LORA_LDRO_SYMBOL_TIME);
+
+        /* Payload symbols, SF5/6 use a shorter preamble sync and no +8 header term */
+        int32_t bits = 8L*len + 16 - 4L*sf + 20 + ((sf >= 7) ? 8 : 0);
+        int32_t bitsPerBlock = 4L*(sf - (ldro ? 2 : 0));
+        int32_t blocks = (bits > 0) ? (bits + bitsPerBlock - 1) / bitsPerBlock : 0;
+        uint32_t quarterSymbols = 4UL*radioParameters.preambleLength + ((sf >= 7) ? 17 : 25) + 4*8 + 4UL*blocks*radioParameters.codingRate;
+
+        return (quarterSymbols / 4) * symbolTime + (quarterSymbols % 4) * symbolTime / 4;
     }
 
     /*-------------------------------------------------------------------------------------*\
-    |   Name:       getMessageRSSI                                                          |
-    |   Purpose:    Returns the RSSI of the last packet transmitted.                        |
-    |   Returns:    float                                                                   |
+    |   Name:       getLoRaDataRate                                                         |
+    |   Purpose:    Returns the data rate of the last packet transmitted.                   |
+    |   Returns:    uint32_t (bps)                                                          |
     \*-------------------------------------------------------------------------------------*/
-    float getMessageRSSI(void){
-        return radio.getRSSI();
+    uint32_t getLoRaDataRate(void){
+        /* As RadioLib's getDataRate, bits over time on air, 255 bytes * 8 * 10^6 fits */
+        uint32_t timeOnAir = getTimeOnAir(lastTransmitLength);
+        return (timeOnAir != 0) ? (uint32_t)lastTransmitLength * 8000000UL / timeOnAir : 0;
     }
 
     /*-------------------------------------------------------------------------------------*\
-    |   Name:       getMessageSNR                                                           |
-    |   Purpose:    Returns the SNR of the last packet transmitted.                         |
-    |   Returns:    float                                                                   |
+    |   Name:       getMessageSignal                                                        |
+    |   Purpose:    Returns the RSSI and SNR of the last packet received, read in one       |
+    |               packet status transfer and without any float conversion.                |
+    |   Arguments:  int16_t* (0.01 dBm), int16_t* (0.01 dB)                                 |
+    |   Returns:    void                                                                    |
     \*-------------------------------------------------------------------------------------*/
-    float getMessageSNR(void){
-        return radio.getSNR();        
+    void getMessageSignal(int16_t* RSSI, int16_t* SNR){
+        uint32_t status = radio.readPacketStatus();
+        *RSSI = PACKET_STATUS_RSSI(status);
+        *SNR = PACKET_STATUS_SNR(status);
     }
@@ -9,6 +9,11 @@
 #include <Arduino.h>
 #include <RadioLib.h>
 #include "Utility.h"
+#include "FrequencyHopping.h"
+#include "PacketArena.h"
+#include "Schemas.h"
+#include "Perf.h"
+#include "Trace.h"
 //#include "Status_codes.h"
 
 
@@ -27,21 +32,62 @@
 
     /* Default parameters */
     // Nyquist formula: bit_rate = 2*BANDWIDTH*log(CODING_RATE)/LOG(2)
-    #define DEFAULT_FREQUENCY               915.0                   // Canadian unlicensed band
-    #define DEFAULT_BANDWIDTH               125.0
+    #define DEFAULT_FREQUENCY               915000                  // kHz, Canadian unlicensed band
+    #define DEFAULT_BANDWIDTH               125000                  // Hz
     #define DEFAULT_SPREADING_FACTOR        9
     #define DEFAULT_CODING_RATE             7
     #define DEFAULT_SYNC_WORD               0x12                    // (private network)
     #define DEFAULT_OUTPUT_POWER            14                      // (max 22 dBm)
     #define DEFAULT_PREAMBLE_LENGTH         8
-    #define DEFAULT_CURRENT_LIMIT           60.0                    // (max 140 mA)
+    #define DEFAULT_CURRENT_LIMIT           600                     // 0.1 mA (max 140 mA)
+    #define MAX_OUTPUT_POWER                22                      // dBm
+    #define MAX_CURRENT_LIMIT               1400                    // 0.1 mA
+    #define DEFAULT_RADIO_PARAMETERS        { DEFAULT_FREQUENCY, DEFAULT_BANDWIDTH, DEFAULT_SPREADING_FACTOR, DEFAULT_CODING_RATE, \
+                                              DEFAULT_SYNC_WORD, DEFAULT_OUTPUT_POWER, DEFAULT_PREAMBLE_LENGTH, DEFAULT_CURRENT_LIMIT }
 
     /* Message */
     #define MAX_LORA_MESSAGE_SIZE           255
+    #define RADIO_TX_HEADROOM               (HOP_HEADER_LEN + AIR_HEADER_LEN + TRACE_HEADER_LEN)    // Bytes transmitRadio may write in front of the passed buffer
+
+    /* Air framing, every frame carries a type byte after the hop header */
+    #define AIR_HEADER_LEN                  1
+    #define AIR_FRAME_DATA                  0x00
+    #define AIR_FRAME_TIME_BEACON           0x01
+    #define AIR_FRAME_TRACED_DATA           0x02                    // Data behind the sender's trace header
+    #define AIR_FRAME_TELEMETRY             0x03                    // A telemetry record, passed up with result TELEMETRY_RECORD
+
+    /*
+     * The parameters are kept in fixed point (see LORA_PARAMETERS_SCHEMA), RadioLib's setters take floats in
+     * MHz, kHz, and mA. Only reconfiguration and retuning cross this boundary, never the per-frame path.
+     */
+    #define RADIOLIB_MHZ(kHz)               ((kHz) / 1000.0f)
+    #define RADIOLIB_KHZ(Hz)                ((Hz) / 1000.0f)
+    #define RADIOLIB_MA(deciMa)             ((deciMa) / 10.0f)
+
+    /* SX126x GetPacketStatus (datasheet 13.5.3), RssiPkt is -dBm*2 and SnrPkt is signed dB*4 */
+    #define PACKET_STATUS_RSSI(status)      (-(int16_t)((status) & 0xFF) * 50)                 // 0.01 dBm
+    #define PACKET_STATUS_SNR(status)       ((int16_t)(int8_t)(((status) >> 8) & 0xFF) * 25)   // 0.01 dB
+
+    /* Time-on-air (SX126x datasheet 6.1.4), RadioLib always sends an explicit header and CRC */
+    #define LORA_LDRO_SYMBOL_TIME           16380                   // Low data rate optimization is on for symbols this long (us) and up
+
+    /* Listen-before-talk */
+    #define LBT_SLOT_TIME                   10                      // Backoff slot length (ms)
+    #define LBT_MAX_BACKOFF_EXPONENT        5                       // Contention window tops out at 2^5 slots
+    #define LBT_MAX_DEFERRAL                1000                    // Give up after deferring this long (ms), well under the watchdog
 
     /* Status codes */
     //#define NEW_RADIO_DATA_BUFFERED         0x0200
     #define NO_NEW_RADIO_DATA               0x0201
+    #define RADIO_CHANNEL_BUSY              0x0202
+    
+
+/*-------------------------------------------------------------------------*\
+|								     Types					   			    |
+\*-------------------------------------------------------------------------*/
+
+
+    /* A complete LoRa configuration, RadioParameters, is declared from its schema in Schemas.h */
     
 
 /*-------------------------------------------------------------------------*\
@@ -81,6 +127,15 @@
     \*-------------------------------------------------------------------------------------*/
     uint8_t* getRadioData(void);
 
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getRadioBlock                                                           |
+    |   Purpose:    Takes ownership of the block holding the last radio data. The caller    |
+    |               releases it when done.                                                  |
+    |   Arguments:  void                                                                    |
+    |   Returns:    uint8_t (ARENA_NONE if there is none)                                   |
+    \*-------------------------------------------------------------------------------------*/
+    uint8_t getRadioBlock(void);
+
     /*-------------------------------------------------------------------------------------*\
     |   Name:       getRadioDataLength                                                      |
     |   Purpose:    Returns the data length in bytes of the last received radio data.       |
@@ -92,21 +147,93 @@
     /*-------------------------------------------------------------------------------------*\
     |   Name:       transmitRadio                                                           |
     |   Purpose:    Transmits the data in the buffer over the radio.                        |
-    |   Arguments:  uint8_t*, uint16_t                                                      |
+    |               The caller must leave RADIO_TX_HEADROOM writable bytes before buf, the  |
+    |               air and hop headers are built there rather than copying the message.   |
+    |   Arguments:  uint8_t*, uint16_t, uint8_t                                             |
     |   Returns:    int16_t                                                                 |
     \*-------------------------------------------------------------------------------------*/
-    int16_t transmitRadio(uint8_t* buf, uint16_t len);
+    int16_t transmitRadio(uint8_t* buf, uint16_t len, uint8_t frameType = AIR_FRAME_DATA);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getTimeOnAir                                                            |
+    |   Purpose:    Returns the time-on-air (us) of a frame of the given length with the    |
+    |               current LoRa parameters.                                                |
+    |   Arguments:  uint16_t                                                                |
+    |   Returns:    uint32_t                                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint32_t getTimeOnAir(uint16_t len);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       configureHopping                                                        |
+    |   Purpose:    Loads the hopping parameters and retunes the radio to match.            |
+    |   Arguments:  bool, uint16_t, const uint32_t* (kHz), uint8_t                          |
+    |   Returns:    int16_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t configureHopping(bool enable, uint16_t seed, const uint32_t* channels, uint8_t count);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       setLBTEnabled                                                           |
+    |   Purpose:    Enables or disables channel activity detection before transmitting.     |
+    |   Arguments:  bool                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void setLBTEnabled(bool enable);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getLBTEnabled                                                           |
+    |   Purpose:    Returns whether listen-before-talk is enabled.                          |
+    |   Returns:    bool                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    bool getLBTEnabled(void);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getBusyDeferrals                                                        |
+    |   Purpose:    Returns the number of backoffs taken because the channel was busy.      |
+    |   Returns:    uint32_t                                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint32_t getBusyDeferrals(void);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getCollisionsAvoided                                                    |
+    |   Purpose:    Returns the number of transmissions sent after waiting out a busy       |
+    |               channel, i.e. ones that would have collided without LBT.                |
+    |   Returns:    uint32_t                                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint32_t getCollisionsAvoided(void);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getTransmissionsAbandoned                                               |
+    |   Purpose:    Returns the number of transmissions dropped after LBT_MAX_DEFERRAL.     |
+    |   Returns:    uint32_t                                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint32_t getTransmissionsAbandoned(void);
 
     /*-------------------------------------------------------------------------------------*\
     |   Name:       setRadioParameters                                                      |
-    |   Purpose:    Sets the radio parameters.                                              |
-    |   Arguments:  void                                                                    |
+    |   Purpose:    Sets the radio parameters. Only changed fields are written, and if the  |
+    |               chip rejects one the fields already written are rolled back, leaving    |
+    |               both the chip and the cached parameters on the previous configuration.  |
+    |   Arguments:  const RadioParameters&                                                  |
+    |   Returns:    int16_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t setRadioParameters(const RadioParameters& params);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getRadioParameters                                                      |
+    |   Purpose:    Returns the current radio parameters.                                   |
+    |   Returns:    RadioParameters                                                         |
+    \*-------------------------------------------------------------------------------------*/
+    RadioParameters getRadioParameters(void);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       setRadioPowerCap                                                        |
+    |   Purpose:    Caps the output power and current limit the chip is given, leaving the  |
+    |               parameters themselves (and what GET_LORA_PARAMETERS shows) alone.       |
+    |               MAX_OUTPUT_POWER and MAX_CURRENT_LIMIT lift the cap.                    |
+    |   Arguments:  int8_t (dBm), uint16_t (0.1 mA)                                         |
     |   Returns:    int16_t                                                                 |
     \*-------------------------------------------------------------------------------------*/
-    int16_t setRadioParameters(
-        float _frequency, float _bandwidth, uint8_t _spreadingFactor, uint8_t _codingRate,
-        uint8_t _syncWord, int8_t _power, uint16_t _preambleLength, float _currentLimit
-    );
+    int16_t setRadioPowerCap(int8_t power, uint16_t currentLimit);
 
     /*-------------------------------------------------------------------------------------*\
     |   Name:       getLoRaSet                                                              |
@@ -117,7 +244,8 @@
 
     /*-------------------------------------------------------------------------------------*\
     |   Name:       radioReset                                                              |
-    |   Purpose:    Resets the radio.                                                       |
+    |   Purpose:    Resets the radio, reusing the existing module object and re-applying    |
+    |               the current parameters.                                                 |
     |   Returns:    int16_t                                                                 |
     \*-------------------------------------------------------------------------------------*/
     int16_t resetRadio(void);
@@ -125,16 +253,16 @@
     /*-------------------------------------------------------------------------------------*\
     |   Name:       getFrequency                                                            |
     |   Purpose:    Returns the current frequency of the radio.                             |
-    |   Returns:    float                                                                   |
+    |   Returns:    uint32_t (kHz)                                                          |
     \*-------------------------------------------------------------------------------------*/
-    float getFrequency(void);
+    uint32_t getFrequency(void);
 
     /*-------------------------------------------------------------------------------------*\
     |   Name:       getBandwidth                                                            |
     |   Purpose:    Returns the current bandwidth of the radio.                             |
-    |   Returns:    float                                                                   |
+    |   Returns:    uint32_t (Hz)                                                           |
     \*-------------------------------------------------------------------------------------*/
-    float getBandwidth(void);
+    uint32_t getBandwidth(void);
 
     /*-------------------------------------------------------------------------------------*\
     |   Name:       getSpreadingFactor                                                      |
@@ -174,9 +302,9 @@
     /*-------------------------------------------------------------------------------------*\
     |   Name:       getCurrentLim                                                           |
     |   Purpose:    Returns the current current limit of the radio.                         |
-    |   Returns:    float                                                                   |
+    |   Returns:    uint16_t (0.1 mA)                                                       |
     \*-------------------------------------------------------------------------------------*/
-    float getCurrentLim(void);
+    uint16_t getCurrentLim(void);
 
 
     /*-------------------------------------------------------------------------------------*\
@@ -189,22 +317,17 @@
     /*-------------------------------------------------------------------------------------*\
     |   Name:       getLoRaDataRate                                                         |
     |   Purpose:    Returns the data rate of the last packet transmitted.                   |
-    |   Returns:    float                                                                   |
-    \*-------------------------------------------------------------------------------------*/
-    float getLoRaDataRate(void);
-
-    /*-------------------------------------------------------------------------------------*\
-    |   Name:       getMessageRSSI                                                          |
-    |   Purpose:    Returns the RSSI of the last packet transmitted.                        |
-    |   Returns:    float                                                                   |
+    |   Returns:    uint32_t (bps)                                                          |
     \*-------------------------------------------------------------------------------------*/
-    float getMessageRSSI(void);
+    uint32_t getLoRaDataRate(void);
 
     /*-------------------------------------------------------------------------------------*\
-    |   Name:       getMessageSNR                                                           |
-    |   Purpose:    Returns the SNR of the last packet transmitted.                         |
-    |   Returns:    float                                                                   |
+    |   Name:       getMessageSignal                                                        |
+    |   Purpose:    Returns the RSSI and SNR of the last packet received, read in one       |
+    |               packet status transfer and without any float conversion.               |
+    |   Arguments:  int16_t* (0.01 dBm), int16_t* (0.01 dB)                                 |
+    |   Returns:    void                                                                    |
     \*-------------------------------------------------------------------------------------*/
-    float getMessageSNR(void);
+    void getMessageSignal(int16_t* RSSI, int16_t* SNR);
     
 #endif /* INC_RADIOCONTROLLER_H_ */
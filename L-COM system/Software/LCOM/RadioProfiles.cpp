@@ -0,0 +1,102 @@
+#include "RadioProfiles.h"
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       profileCRC                                                              |
+    |   Purpose:    CRC-16 over a byte range.                                               |
+    |   Arguments:  const void*, uint16_t                                                   |
+    |   Returns:    uint16_t                                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint16_t profileCRC(const void* data, uint16_t len){
+        const uint8_t* bytes = (const uint8_t*)data;
+        uint16_t crc = 0xFFFF;
+        for(uint16_t i = 0; i != len; i++) crc = _crc16_update(crc, bytes[i]);
+        return crc;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       profileAddress                                                          |
+    |   Purpose:    Returns the EEPROM address of a profile slot.                           |
+    |   Arguments:  uint8_t                                                                 |
+    |   Returns:    uint16_t                                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint16_t profileAddress(uint8_t idx){
+        return PROFILE_TABLE_ADDRESS + sizeof(ProfileTableHeader) + idx*sizeof(StoredRadioProfile);
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       defineRadioProfile                                                      |
+    |   Purpose:    Stores a named profile in the given slot. Writes go through             |
+    |               EEPROM.update, so only bytes that actually changed are programmed.      |
+    |   Arguments:  uint8_t, const char*, const RadioParameters&                            |
+    |   Returns:    int16_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t defineRadioProfile(uint8_t idx, const char* name, const RadioParameters& params){
+        if(idx >= MAX_RADIO_PROFILES) return PROFILE_INVALID_INDEX;
+
+        StoredRadioProfile profile;
+        memcpy(profile.name, name, PROFILE_NAME_LEN);
+        profile.params = params;
+        profile.crc = profileCRC(&profile, offsetof(StoredRadioProfile, crc));
+
+        /* put() is built on update(), unchanged bytes cost no erase/write cycle */
+        EEPROM.put(profileAddress(idx), profile);
+        return ERR_NONE;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       loadRadioProfile                                                        |
+    |   Purpose:    Reads a profile slot, returning PROFILE_EMPTY if it fails its CRC.      |
+    |               Either output pointer may be NULL.                                      |
+    |   Arguments:  uint8_t, char*, RadioParameters*                                        |
+    |   Returns:    int16_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t loadRadioProfile(uint8_t idx, char* name, RadioParameters* params){
+        if(idx >= MAX_RADIO_PROFILES) return PROFILE_INVALID_INDEX;
+
+        StoredRadioProfile profile;
+        EEPROM.get(profileAddress(idx), profile);
+        if(profile.crc != profileCRC(&profile, offsetof(StoredRadioProfile, crc))) return PROFILE_EMPTY;
+
+        if(name) memcpy(name, profile.name, PROFILE_NAME_LEN);
+        if(params) *params = profile.params;
+        return ERR_NONE;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       setBootProfile                                                          |
+    |   Purpose:    Selects the profile applied by initializeRadio, or PROFILE_NONE.        |
+    |   Arguments:  uint8_t                                                                 |
+    |   Returns:    int16_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t setBootProfile(uint8_t idx){
+        if(idx != PROFILE_NONE){
+            int16_t res = loadRadioProfile(idx, NULL, NULL);
+            if(res != ERR_NONE) return res;
+        }
+
+        ProfileTableHeader header;
+        header.magic = PROFILE_TABLE_MAGIC;
+        header.bootProfile = idx;
+        header.crc = profileCRC(&header, offsetof(ProfileTableHeader, crc));
+        EEPROM.put(PROFILE_TABLE_ADDRESS, header);
+        return ERR_NONE;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getBootProfile                                                          |
+    |   Purpose:    Returns the boot profile selector, PROFILE_NONE if unset or corrupt.    |
+    |   Returns:    uint8_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    uint8_t getBootProfile(void){
+        ProfileTableHeader header;
+        EEPROM.get(PROFILE_TABLE_ADDRESS, header);
+        if(header.magic != PROFILE_TABLE_MAGIC) return PROFILE_NONE;
+        if(header.crc != profileCRC(&header, offsetof(ProfileTableHeader, crc))) return PROFILE_NONE;
+        return header.bootProfile;
+    }
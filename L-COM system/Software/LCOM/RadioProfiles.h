@@ -0,0 +1,87 @@
+#ifndef INC_RADIOPROFILES_H_
+#define INC_RADIOPROFILES_H_
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <util/crc16.h>
+#include "RadioController.h"
+#include "Utility.h"
+
+
+/*-------------------------------------------------------------------------*\
+|								  Definitions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /* Table layout (EEPROM) */
+    #define PROFILE_TABLE_ADDRESS           0
+    #define PROFILE_TABLE_MAGIC             0x5251                  // "RQ", changes with the layout of StoredRadioProfile
+    #define MAX_RADIO_PROFILES              8
+    #define PROFILE_NAME_LEN                8
+    #define PROFILE_NONE                    0xFF                    // Boot selector value for the compile-time defaults
+    #define PROFILE_TABLE_END               (PROFILE_TABLE_ADDRESS + sizeof(ProfileTableHeader) + MAX_RADIO_PROFILES*sizeof(StoredRadioProfile))
+
+    /* Status codes */
+    #define PROFILE_INVALID_INDEX           0x0400
+    #define PROFILE_EMPTY                   0x0401
+
+
+/*-------------------------------------------------------------------------*\
+|								     Types					   			    |
+\*-------------------------------------------------------------------------*/
+
+
+    /* Table header, holds the boot selector */
+    struct ProfileTableHeader{
+        uint16_t magic;
+        uint8_t bootProfile;
+        uint16_t crc;
+    };
+
+    /* One named profile, the CRC covers the name and parameters */
+    struct StoredRadioProfile{
+        char name[PROFILE_NAME_LEN];
+        RadioParameters params;
+        uint16_t crc;
+    };
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       defineRadioProfile                                                      |
+    |   Purpose:    Stores a named profile in the given slot. Writes go through             |
+    |               EEPROM.update, so only bytes that actually changed are programmed.      |
+    |   Arguments:  uint8_t, const char*, const RadioParameters&                            |
+    |   Returns:    int16_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t defineRadioProfile(uint8_t idx, const char* name, const RadioParameters& params);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       loadRadioProfile                                                        |
+    |   Purpose:    Reads a profile slot, returning PROFILE_EMPTY if it fails its CRC.      |
+    |               Either output pointer may be NULL.                                      |
+    |   Arguments:  uint8_t, char*, RadioParameters*                                        |
+    |   Returns:    int16_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t loadRadioProfile(uint8_t idx, char* name, RadioParameters* params);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       setBootProfile                                                          |
+    |   Purpose:    Selects the profile applied by initializeRadio, or PROFILE_NONE.        |
+    |   Arguments:  uint8_t                                                                 |
+    |   Returns:    int16_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t setBootProfile(uint8_t idx);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getBootProfile                                                          |
+    |   Purpose:    Returns the boot profile selector, PROFILE_NONE if unset or corrupt.    |
+    |   Returns:    uint8_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    uint8_t getBootProfile(void);
+
+#endif /* INC_RADIOPROFILES_H_ */
@@ -0,0 +1,178 @@
+#include "Scheduler.h"
+#include "Energy.h"
+#include "Perf.h"
+#include <avr/pgmspace.h>
+#include <avr/sleep.h>
+
+
+/*-------------------------------------------------------------------------*\
+|								   Variables					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    const SchedulerTask* tasks = NULL;                              // In program memory
+    uint8_t taskCount = 0;
+    uint32_t taskNextRun[SCHEDULER_MAX_TASKS];                      // millis() each task is next due
+    #if PERF_ENABLED
+    TaskStats taskStats[SCHEDULER_MAX_TASKS];                       // Only with the perf probes, getTaskStats reports zeros without
+    #endif
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       initializeScheduler                                                     |
+    |   Purpose:    Takes the task table, kept in program memory, and makes every task due  |
+    |               now.                                                                    |
+    |   Arguments:  const SchedulerTask*, uint8_t                                           |
+    |   Returns:    int16_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t initializeScheduler(const SchedulerTask* table, uint8_t count){
+        if(count > SCHEDULER_MAX_TASKS) return SCHEDULER_TOO_MANY_TASKS;
+
+        tasks = table;
+        taskCount = count;
+        resetTaskStats();
+
+        uint32_t now = millis();
+        for(uint8_t i = 0; i != taskCount; i++) taskNextRun[i] = now;
+        return SCHEDULER_OK;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       nextDueTask                                                             |
+    |   Purpose:    Finds the highest priority task that is due.                            |
+    |   Arguments:  uint32_t (millis())                                                     |
+    |   Returns:    int8_t (its index, -1 if none is due)                                   |
+    \*-------------------------------------------------------------------------------------*/
+    int8_t nextDueTask(uint32_t now){
+        /* The signed difference keeps this safe across millis() wrapping */
+        int8_t next = -1;
+        for(uint8_t i = 0; i != taskCount; i++){
+            if((int32_t)(now - taskNextRun[i]) < 0) continue;
+            if(next < 0 || pgm_read_byte(&tasks[i].priority) < pgm_read_byte(&tasks[next].priority)) next = i;
+        }
+        return next;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       runScheduler                                                            |
+    |   Purpose:    Runs the highest priority task that is due, if any. Call from the main  |
+    |               loop, one task per call keeps the loop (and watchdog kick) responsive.  |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void runScheduler(void){
+        uint32_t now = millis();
+        int8_t next = nextDueTask(now);
+        if(next < 0) return;
+
+        SchedulerTask task;
+        memcpy_P(&task, &tasks[next], sizeof(SchedulerTask));
+
+        /* How late the run is starting */
+        uint32_t lateness = now - taskNextRun[next];
+        #if PERF_ENABLED
+        TaskStats& stats = taskStats[next];
+        if(lateness > task.deadline) stats.deadlineMisses++;
+        if(lateness > stats.worstLateness) stats.worstLateness = (lateness > 0xFFFF) ? 0xFFFF : lateness;
+        #endif
+
+        /* Keep the task on its phase, unless a whole period was missed, then skip the backlog rather than burst */
+        if(lateness >= task.period) taskNextRun[next] = now + task.period;
+        else taskNextRun[next] += task.period;
+
+        /* Run it */
+        #if PERF_ENABLED
+        uint32_t start = micros();
+        #endif
+        task.run();
+
+        #if PERF_ENABLED
+        uint32_t execution = micros() - start;
+        stats.runCount++;
+        if(execution > stats.worstExecution) stats.worstExecution = (execution > 0xFFFF) ? 0xFFFF : execution;
+        #endif
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       idleScheduler                                                           |
+    |   Purpose:    Sleeps the CPU until the next interrupt if no task is due. Tasks only   |
+    |               fall due on a millis() tick, and what they wait on (UART, radio, GPS,   |
+    |               ADC, I2C) arrives by interrupt, so no task starts any later for it.     |
+    |               Call from the main loop after runScheduler.                             |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void idleScheduler(void){
+    #if SCHEDULER_IDLE_SLEEP
+        PERF_TIMER_START(PERF_IDLE);
+        uint32_t idleStart = micros();
+
+        /* Checked with interrupts off, a tick landing after the check then wakes the sleep straight away */
+        noInterrupts();
+        if(nextDueTask(millis()) >= 0){
+            interrupts();
+            return;
+        }
+
+        /* Idle keeps the timers, UART, SPI, TWI, and ADC running, and sei always lets sleep_cpu in first */
+        set_sleep_mode(SLEEP_MODE_IDLE);
+        sleep_enable();
+        interrupts();
+        sleep_cpu();
+        sleep_disable();
+
+        accountMcuIdle(micros() - idleStart);
+        PERF_TIMER_STOP(PERF_IDLE);
+    #endif
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       resetTaskStats                                                          |
+    |   Purpose:    Clears the run counts, worst case times, and deadline misses.           |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void resetTaskStats(void){
+    #if PERF_ENABLED
+        memset(taskStats, 0, sizeof(taskStats));
+    #endif
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getTaskStats                                                            |
+    |   Purpose:    Writes the task count, then a record per task in table order. A build   |
+    |               without the perf probes reports only the periods, the rest is zero.     |
+    |   Arguments:  uint8_t*                                                                |
+    |   Returns:    uint16_t (bytes written)                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint16_t getTaskStats(uint8_t* buf){
+        uint16_t pos = 0;
+        buf[pos++] = taskCount;
+
+        for(uint8_t i = 0; i != taskCount; i++){
+            #if PERF_ENABLED
+            const TaskStats& stats = taskStats[i];
+            #else
+            const TaskStats stats = {};
+            #endif
+            uint16_t period = pgm_read_word(&tasks[i].period);
+            buf[pos++] = (stats.runCount & 0xFF000000) >> 24;
+            buf[pos++] = (stats.runCount & 0x00FF0000) >> 16;
+            buf[pos++] = (stats.runCount & 0x0000FF00) >> 8;
+            buf[pos++] = (stats.runCount & 0x000000FF);
+            buf[pos++] = (stats.worstExecution & 0xFF00) >> 8;
+            buf[pos++] = (stats.worstExecution & 0x00FF);
+            buf[pos++] = (stats.worstLateness & 0xFF00) >> 8;
+            buf[pos++] = (stats.worstLateness & 0x00FF);
+            buf[pos++] = (stats.deadlineMisses & 0xFF00) >> 8;
+            buf[pos++] = (stats.deadlineMisses & 0x00FF);
+            buf[pos++] = (period & 0xFF00) >> 8;
+            buf[pos++] = (period & 0x00FF);
+        }
+        return pos;
+    }
@@ -0,0 +1,106 @@
+#ifndef INC_SCHEDULER_H_
+#define INC_SCHEDULER_H_
+
+#include <Arduino.h>
+#include "Utility.h"
+
+
+/*-------------------------------------------------------------------------*\
+|								  Definitions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    #define SCHEDULER_MAX_TASKS             8
+
+    /* Set to 0 to spin between tasks instead of sleeping (about 5 mA running, 1.5 mA idle at 8 MHz) */
+    #ifndef SCHEDULER_IDLE_SLEEP
+    #define SCHEDULER_IDLE_SLEEP            1
+    #endif
+    #define TASK_STATS_RECORD_LEN           12                      // Per task in getTaskStats
+
+    /* Status codes */
+    #define SCHEDULER_OK                    0x0000
+    #define SCHEDULER_TOO_MANY_TASKS        0x0600
+
+
+/*-------------------------------------------------------------------------*\
+|								     Types					   			    |
+\*-------------------------------------------------------------------------*/
+
+
+    /* One entry of the task table, fixed at compile time and kept in PROGMEM */
+    struct SchedulerTask{
+        void (*run)(void);
+        uint16_t period;                                            // ms between runs
+        uint16_t deadline;                                          // ms a run may start late before it counts as a miss
+        uint8_t priority;                                           // 0 is highest, ties go to the earlier entry
+    };
+
+    /* Statistics kept for each task, with the perf probes (Perf.h) */
+    struct TaskStats{
+        uint32_t runCount;
+        uint16_t worstExecution;                                    // us
+        uint16_t worstLateness;                                     // ms
+        uint16_t deadlineMisses;
+    };
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       initializeScheduler                                                     |
+    |   Purpose:    Takes the task table, kept in program memory, and makes every task due  |
+    |               now.                                                                    |
+    |   Arguments:  const SchedulerTask*, uint8_t                                           |
+    |   Returns:    int16_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t initializeScheduler(const SchedulerTask* table, uint8_t count);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       runScheduler                                                            |
+    |   Purpose:    Runs the highest priority task that is due, if any. Call from the main  |
+    |               loop, one task per call keeps the loop (and watchdog kick) responsive.  |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void runScheduler(void);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       idleScheduler                                                           |
+    |   Purpose:    Sleeps the CPU until the next interrupt if no task is due. Tasks only   |
+    |               fall due on a millis() tick, and what they wait on (UART, radio, GPS,   |
+    |               ADC, I2C) arrives by interrupt, so no task starts any later for it.     |
+    |               Call from the main loop after runScheduler.                             |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void idleScheduler(void);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       resetTaskStats                                                          |
+    |   Purpose:    Clears the run counts, worst case times, and deadline misses.           |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void resetTaskStats(void);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getTaskStats                                                            |
+    |   Purpose:    Writes the task count, then a record per task in table order. A build   |
+    |               without the perf probes reports only the periods, the rest is zero.     |
+    |               Bytes               Field                                               |
+    |               -------------------------------------------                             |
+    |               0-3                 Run count                                           |
+    |               4-5                 Worst case execution time (us)                      |
+    |               6-7                 Worst start lateness (ms)                           |
+    |               8-9                 Deadline misses                                     |
+    |               10-11               Period (ms)                                         |
+    |   Arguments:  uint8_t*                                                                |
+    |   Returns:    uint16_t (bytes written)                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint16_t getTaskStats(uint8_t* buf);
+
+#endif /* INC_SCHEDULER_H_ */
@@ -0,0 +1,221 @@
+#ifndef INC_SCHEMAS_H_
+#define INC_SCHEMAS_H_
+
+#include <Arduino.h>
+#include "Codec.h"
+
+
+/*-------------------------------------------------------------------------*\
+|								    Schemas					   			    |
+\*-------------------------------------------------------------------------*/
+
+
+    /*
+     * Fields in wire order, X(type, name). Python GUI/Schemas.py is generated from this file, so rerun
+     * Python GUI/Generate_schemas.py after changing anything here. Keep one field per line.
+     */
+
+    /* LoRa parameters, SET_LORA_PARAMETERS, DEFINE_RADIO_PROFILE, and GET_LORA_PARAMETERS */
+    #define LORA_PARAMETERS_SCHEMA(X)                                                               \
+        X(FIX3_U32, frequency)          /* kHz, shown in MHz */                                     \
+        X(FIX3_U32, bandwidth)          /* Hz, shown in kHz */                                      \
+        X(U8,       spreadingFactor)                                                                \
+        X(U8,       codingRate)                                                                     \
+        X(U8,       syncWord)                                                                       \
+        X(I8,       power)              /* dBm */                                                   \
+        X(U16,      preambleLength)     /* symbols */                                               \
+        X(FIX1_U16, currentLimit)       /* 0.1 mA */
+
+    /* GET_UNIX return */
+    #define UNIX_TIME_SCHEMA(X)                                                                     \
+        X(U32,      timestamp)                                                                      \
+        X(U16,      milliseconds)                                                                   \
+        X(I16,      drift)              /* ppm */
+
+    /* GET_MODULE_STATUS return */
+    #define MODULE_STATUS_SCHEMA(X)                                                                 \
+        X(U8,       loraSet)                                                                        \
+        X(U8,       unixSet)                                                                        \
+        X(U32,      uptime)             /* ms */                                                    \
+        X(FIX2_I16, temperature)        /* 0.01 degrees C */                                        \
+        X(U32,      timeOnAir)          /* us, last frame sent */                                   \
+        X(FIX0_U32, dataRate)           /* bps */                                                   \
+        X(U8,       resetCause)         /* MCUSR flags */                                           \
+        X(U16,      resetCount)         /* since power-on */                                        \
+        X(U16,      freeRam)                                                                        \
+        X(U16,      stackHeadroom)      /* lowest free RAM since boot */                            \
+        X(U16,      staticRam)          /* .data, .bss, and .noinit */                              \
+        X(U16,      batteryVoltage)     /* mV, from the power board */                              \
+        X(I16,      batteryCurrent)     /* mA drawn, negative while charging */                     \
+        X(FIX2_I16, batteryTemperature) /* 0.01 degrees C */                                        \
+        X(U8,       powerFlags)         /* POWER_*, POWER_READING_VALID clear if they're stale */   \
+        X(U8,       powerLevel)         /* POWER_LEVEL_* the power policy is at */
+
+    /* GET_TIME_SYNC_STATUS return */
+    #define TIME_SYNC_STATUS_SCHEMA(X)                                                              \
+        X(U8,       mode)               /* TIME_SYNC_* */                                           \
+        X(U8,       synced)                                                                         \
+        X(U16,      period)             /* s between beacons */                                     \
+        X(U16,      beaconsSent)                                                                    \
+        X(U16,      beaconsReceived)                                                                \
+        X(I32,      lastOffset)         /* ms, remote - local */                                    \
+        X(U16,      meanOffset)         /* ms, mean absolute */                                     \
+        X(I16,      drift)              /* ppm correction */                                        \
+        X(U32,      sinceBeacon)        /* ms, 0xFFFFFFFF if none */
+
+    /* Fields ahead of the data in a message packet */
+    #define MESSAGE_FIELDS_SCHEMA(X)                                                                \
+        X(FIX2_I16, RSSI)               /* 0.01 dBm */                                              \
+        X(FIX2_I16, SNR)                /* 0.01 dB */                                               \
+        X(I16,      result)
+
+    /* Header of an IMU batch telemetry record, the samples follow it */
+    #define IMU_BATCH_SCHEMA(X)                                                                     \
+        X(U16,      sequence)           /* First sample, numbered by the IMU interrupt */           \
+        X(U32,      time)               /* ms uptime the first sample was taken */                  \
+        X(U16,      rate)               /* Hz */                                                    \
+        X(U8,       count)
+
+    /* One IMU sample, raw counts (IMU_ACCEL_LSB_PER_G, IMU_GYRO_LSB_PER_DPS) */
+    #define IMU_SAMPLE_SCHEMA(X)                                                                    \
+        X(I16,      accelX)                                                                         \
+        X(I16,      accelY)                                                                         \
+        X(I16,      accelZ)                                                                         \
+        X(I16,      gyroX)                                                                          \
+        X(I16,      gyroY)                                                                          \
+        X(I16,      gyroZ)
+
+    /* Header of an IMU summary telemetry record, the fields it selects follow it */
+    #define IMU_SUMMARY_SCHEMA(X)                                                                   \
+        X(U16,      sequence)           /* First sample in the window */                            \
+        X(U32,      time)               /* ms uptime the first sample was taken */                  \
+        X(U16,      count)              /* Samples in the window */                                 \
+        X(U8,       included)           /* IMU_SUMMARY_* */
+
+    /* Largest accel and gyro magnitudes in an IMU summary's window, raw counts */
+    #define IMU_PEAKS_SCHEMA(X)                                                                     \
+        X(U16,      accelPeak)                                                                      \
+        X(U16,      accelPeakTime)      /* ms after the first sample */                             \
+        X(U16,      gyroPeak)                                                                       \
+        X(U16,      gyroPeakTime)       /* ms after the first sample */
+
+    /* GPS fix telemetry record */
+    #define GPS_FIX_SCHEMA(X)                                                                       \
+        X(U32,      time)               /* ms uptime the fix was parsed */                          \
+        X(U32,      utcTime)            /* ms since UTC midnight */                                 \
+        X(I32,      latitude)           /* 1e-7 degrees, north positive */                          \
+        X(I32,      longitude)          /* 1e-7 degrees, east positive */                           \
+        X(I32,      altitude)           /* cm above mean sea level */                               \
+        X(U16,      speed)              /* cm/s over the ground */                                  \
+        X(U16,      course)             /* 0.01 degrees from true north */                          \
+        X(U8,       satellites)                                                                     \
+        X(U8,       fixType)            /* GPS_FIX_* */
+
+    /* Power board reading, TELEMETRY_POWER record */
+    #define POWER_STATUS_SCHEMA(X)                                                                  \
+        X(U32,      time)               /* ms uptime the board was read */                          \
+        X(U16,      batteryVoltage)     /* mV */                                                    \
+        X(I16,      batteryCurrent)     /* mA drawn, negative while charging */                     \
+        X(FIX2_I16, batteryTemperature) /* 0.01 degrees C */                                        \
+        X(U8,       powerFlags)         /* POWER_* */
+
+    /* GET_ENERGY_STATUS return, since boot */
+    #define ENERGY_STATUS_SCHEMA(X)                                                                 \
+        X(U32,      uptime)             /* ms */                                                    \
+        X(U32,      txTime)             /* ms on air */                                             \
+        X(U32,      rxTime)             /* ms listening */                                          \
+        X(U32,      standbyTime)        /* ms around transmits, listen-before-talk and retuning */  \
+        X(U32,      mcuActiveTime)      /* ms */                                                    \
+        X(U32,      mcuIdleTime)        /* ms asleep between tasks */                               \
+        X(FIX3_U32, txCharge)           /* uAh, shown in mAh */                                     \
+        X(FIX3_U32, rxCharge)                                                                       \
+        X(FIX3_U32, standbyCharge)                                                                  \
+        X(FIX3_U32, mcuActiveCharge)                                                                \
+        X(FIX3_U32, mcuIdleCharge)                                                                  \
+        X(FIX3_U32, totalCharge)
+
+    /* TELEMETRY_STORED record, the original record (type first) follows */
+    #define STORED_RECORD_SCHEMA(X)                                                                 \
+        X(U16,      sequence)           /* stored order, gaps are records overwritten */
+
+    /* GET_STORE_FORWARD_STATUS return, counts since boot */
+    #define STORE_FORWARD_STATUS_SCHEMA(X)                                                          \
+        X(U8,       enabled)                                                                        \
+        X(U8,       linkUp)                                                                         \
+        X(U16,      linkTimeout)        /* s */                                                     \
+        X(U16,      storeInterval)      /* s */                                                     \
+        X(U32,      sinceHeard)         /* ms since a frame was heard, 0xFFFFFFFF never */          \
+        X(U8,       slots)              /* in the EEPROM ring */                                    \
+        X(U8,       pending)            /* stored and not yet forwarded */                          \
+        X(U16,      nextSequence)                                                                   \
+        X(U16,      stored)                                                                         \
+        X(U16,      forwarded)                                                                      \
+        X(U16,      overwritten)        /* pending when the ring came around */                     \
+        X(U16,      dropped)            /* too long for a slot */
+
+
+/*-------------------------------------------------------------------------*\
+|								  Definitions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    #define LORA_PARAMETERS_LEN             CODEC_LEN(LORA_PARAMETERS_SCHEMA)
+    #define UNIX_TIME_LEN                   CODEC_LEN(UNIX_TIME_SCHEMA)
+    #define MODULE_STATUS_LEN               CODEC_LEN(MODULE_STATUS_SCHEMA)
+    #define TIME_SYNC_STATUS_LEN            CODEC_LEN(TIME_SYNC_STATUS_SCHEMA)
+    #define IMU_BATCH_LEN                   CODEC_LEN(IMU_BATCH_SCHEMA)
+    #define IMU_SAMPLE_LEN                  CODEC_LEN(IMU_SAMPLE_SCHEMA)
+    #define IMU_SUMMARY_LEN                 CODEC_LEN(IMU_SUMMARY_SCHEMA)
+    #define IMU_PEAKS_LEN                   CODEC_LEN(IMU_PEAKS_SCHEMA)
+    #define GPS_FIX_LEN                     CODEC_LEN(GPS_FIX_SCHEMA)
+    #define POWER_STATUS_LEN                CODEC_LEN(POWER_STATUS_SCHEMA)
+    #define ENERGY_STATUS_LEN               CODEC_LEN(ENERGY_STATUS_SCHEMA)
+    #define STORED_RECORD_LEN               CODEC_LEN(STORED_RECORD_SCHEMA)
+    #define STORE_FORWARD_STATUS_LEN        CODEC_LEN(STORE_FORWARD_STATUS_SCHEMA)
+    /* MESSAGE_FIELDS_LEN is SerialInterface.h's */
+
+
+/*-------------------------------------------------------------------------*\
+|								     Types					   			    |
+\*-------------------------------------------------------------------------*/
+
+
+    /* A complete LoRa configuration */
+    CODEC_STRUCT(RadioParameters, LORA_PARAMETERS_SCHEMA)
+    CODEC_STRUCT(UnixTime, UNIX_TIME_SCHEMA)
+    CODEC_STRUCT(ModuleStatus, MODULE_STATUS_SCHEMA)
+    CODEC_STRUCT(TimeSyncStatus, TIME_SYNC_STATUS_SCHEMA)
+    CODEC_STRUCT(MessageFields, MESSAGE_FIELDS_SCHEMA)
+    CODEC_STRUCT(ImuBatch, IMU_BATCH_SCHEMA)
+    CODEC_STRUCT(ImuSample, IMU_SAMPLE_SCHEMA)
+    CODEC_STRUCT(ImuSummary, IMU_SUMMARY_SCHEMA)
+    CODEC_STRUCT(ImuPeaks, IMU_PEAKS_SCHEMA)
+    CODEC_STRUCT(GpsFix, GPS_FIX_SCHEMA)
+    CODEC_STRUCT(PowerStatus, POWER_STATUS_SCHEMA)
+    CODEC_STRUCT(EnergyStatus, ENERGY_STATUS_SCHEMA)
+    CODEC_STRUCT(StoredRecord, STORED_RECORD_SCHEMA)
+    CODEC_STRUCT(StoreForwardStatus, STORE_FORWARD_STATUS_SCHEMA)
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /* encode<Name> and decode<Name>, see CODEC_FUNCTIONS */
+    CODEC_FUNCTIONS(RadioParameters, LORA_PARAMETERS_SCHEMA)
+    CODEC_FUNCTIONS(UnixTime, UNIX_TIME_SCHEMA)
+    CODEC_FUNCTIONS(ModuleStatus, MODULE_STATUS_SCHEMA)
+    CODEC_FUNCTIONS(TimeSyncStatus, TIME_SYNC_STATUS_SCHEMA)
+    CODEC_FUNCTIONS(MessageFields, MESSAGE_FIELDS_SCHEMA)
+    CODEC_FUNCTIONS(ImuBatch, IMU_BATCH_SCHEMA)
+    CODEC_FUNCTIONS(ImuSample, IMU_SAMPLE_SCHEMA)
+    CODEC_FUNCTIONS(ImuSummary, IMU_SUMMARY_SCHEMA)
+    CODEC_FUNCTIONS(ImuPeaks, IMU_PEAKS_SCHEMA)
+    CODEC_FUNCTIONS(GpsFix, GPS_FIX_SCHEMA)
+    CODEC_FUNCTIONS(PowerStatus, POWER_STATUS_SCHEMA)
+    CODEC_FUNCTIONS(EnergyStatus, ENERGY_STATUS_SCHEMA)
+    CODEC_FUNCTIONS(StoredRecord, STORED_RECORD_SCHEMA)
+    CODEC_FUNCTIONS(StoreForwardStatus, STORE_FORWARD_STATUS_SCHEMA)
+
+#endif /* INC_SCHEMAS_H_ */
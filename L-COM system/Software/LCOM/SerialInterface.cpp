@@ -5,6 +5,8 @@
 
 
 #include "SerialInterface.h"
+#include "Gps.h"
+#include "SpscQueue.h"
 
 
 /*-------------------------------------------------------------------------*\
@@ -12,14 +14,17 @@
 \*-------------------------------------------------------------------------*/
 
 
-    uint8_t serialReadBuffer[PKT_MAX_LEN]; // Need separate buffers as the read buffer may fill over several loops
-    uint8_t serialSendBuffer[PKT_MAX_LEN];
+    uint8_t readBlock = ARENA_NONE;      // Packet being parsed, may fill over several loops
+    uint8_t* serialReadBuffer = NULL;
+    SpscQueue<SerialFrame, SERIAL_FRAME_QUEUE_LEN> serialFrames;     // Complete packets, parser to dispatcher
+    uint8_t* serialSendBuffer = NULL;    // Start of the last packet created, inside its payload's block
     bool startFlagFound = false;
     uint16_t rIdx = 0;
     uint16_t packetLen = 0;
     uint8_t cyclicID = 0;
     uint16_t sendBufferLen = 0;
     uint32_t lastCharReceivedTime = 0;
+    bool headerExtension = false;
 
 
 /*-------------------------------------------------------------------------*\
@@ -40,13 +45,26 @@
             // Read in the next character
             uint8_t newSerialByte = Serial.read();
             lastCharReceivedTime = millis();
+            PERF_COUNT(PERF_UART_BYTES_IN);
 
-            // If the start of a new packet was found, set the flag and prepare the buffer
+            // Stop the GPS receiver's interrupts from overrunning the UART while the host is sending
+            quietGps(GPS_HOST_QUIET);
+
+            // If the start of a new packet was found, set the flag and take a block for it. With none free the
+            // packet is dropped, and the bytes after the flag are skipped over like any other noise.
             if(!startFlagFound && newSerialByte == START_FLAG){
-                startFlagFound = true;
-                rIdx = 0;
-                packetLen = 0;
-                for(uint16_t i = 0; i != PKT_MAX_LEN; i++) serialReadBuffer[i] = 0; 
+                if(readBlock == ARENA_NONE) readBlock = acquireBlock(ARENA_OWNER_UART_RX);
+                if(readBlock != ARENA_NONE){
+                    startFlagFound = true;
+                    traceMark(TRACE_MARK_UART_START);
+                    serialReadBuffer = getBlock(readBlock) + ARENA_SERIAL_RX_OFFSET;
+                    rIdx = 0;
+                    packetLen = 0;
+                }
+                else{
+                    PERF_COUNT(PERF_SERIAL_FRAMES_DROPPED);
+                    PERF_COUNT(PERF_ARENA_DROPS);
+                }
             }
 
             // If the start flag was found
@@ -55,9 +73,10 @@
                 // Add the byte to the buffer
                 serialReadBuffer[rIdx++] = newSerialByte;
 
-                // Record the length of the packet
+                // Record the length of the packet, one too short to hold a header can never complete
                 if(rIdx == LENGTH_INDEX+2){
                     packetLen = extract_uint16_t(serialReadBuffer, LENGTH_INDEX);
+                    if(packetLen < PKT_HEADER_TRAILER_LEN) packetLen = PKT_MAX_LEN;
                 }
 
                 // If the end flag was found, verify the packet
@@ -66,17 +85,37 @@
                     // Reset the flag
                     startFlagFound = false;
 
-                    // If the packet is valid, handle it
+                    // If the packet is valid, queue its block to be dispatched
                     if(verifyPacket(serialReadBuffer)){
+                        stripHeaderExtension();
+                        traceMark(TRACE_MARK_PACKET_COMPLETE);
+                        SerialFrame frame;
+                        frame.block = readBlock;
+                        frame.packet = serialReadBuffer;
+                        frame.length = packetLen;
+                        readBlock = ARENA_NONE;
+                        handoffBlock(frame.block, ARENA_OWNER_DISPATCH);
+                        if(!serialFrames.push(frame)){
+                            releaseBlock(frame.block);
+                            PERF_COUNT(PERF_SERIAL_FRAMES_DROPPED);
+                            return MALFORMED_PACKET;
+                        }
+                        PERF_COUNT(PERF_SERIAL_FRAMES);
                         return PACKET_COMPLETE;
                     }
                     else{
+                        PERF_COUNT(PERF_SERIAL_FRAMES_DROPPED);
+                        releaseBlock(readBlock);
+                        readBlock = ARENA_NONE;
                         return MALFORMED_PACKET;                      
                     }
                 }
                 // Else if the end flag was not found and the buffer is full, reset the flag
                 else if(rIdx == PKT_MAX_LEN){                   
                     startFlagFound = 0;
+                    releaseBlock(readBlock);
+                    readBlock = ARENA_NONE;
+                    PERF_COUNT(PERF_SERIAL_FRAMES_DROPPED);
                     Log(F("Packet reading error"), MALFORMED_PACKET);
                     return MALFORMED_PACKET;
                 }
@@ -86,13 +125,36 @@
         else{
             if(startFlagFound && (millis() - lastCharReceivedTime) > SERIAL_PACKET_TIMEOUT){
                 startFlagFound = false;
+                releaseBlock(readBlock);
+                readBlock = ARENA_NONE;
                 Serial.flush();
+                PERF_COUNT(PERF_SERIAL_FRAMES_DROPPED);
                 Log(F("Packet timeout\r\n"));
             }
             return NO_NEW_SERIAL_DATA;
         }
     }
 
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       stripHeaderExtension                                                    |
+    |   Purpose:    Removes the millisecond header extension from a received packet, so the |
+    |               handlers always see the basic header. The header is moved up over the   |
+    |               extension, leaving the payload where it is.                             |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void stripHeaderExtension(void){
+        if(!(serialReadBuffer[TYPE_CYCLIC_FIELD_INDEX] & HEADER_EXTENSION_FLAG)) return;
+        if(packetLen < PKT_HEADER_TRAILER_LEN + PKT_HEADER_EXTENSION_LEN) return;
+
+        memmove(serialReadBuffer+PKT_HEADER_EXTENSION_LEN, serialReadBuffer, PKT_HEADER_LEN);
+        serialReadBuffer += PKT_HEADER_EXTENSION_LEN;
+        packetLen -= PKT_HEADER_EXTENSION_LEN;
+        serialReadBuffer[LENGTH_INDEX]   = (packetLen & 0xFF00) >> 8;
+        serialReadBuffer[LENGTH_INDEX+1] = (packetLen & 0x00FF);
+        serialReadBuffer[TYPE_CYCLIC_FIELD_INDEX] &= ~HEADER_EXTENSION_FLAG;
+    }
+
     /*-------------------------------------------------------------------------------------*\
     |   Name:       getSerialSebdBuffer                                                     |
     |   Purpose:    Returns a pointer to the outgoing serial data buffer.                   |
@@ -104,23 +166,14 @@
     //}
 
     /*-------------------------------------------------------------------------------------*\
-    |   Name:       getSerialReadBuffer                                                     |
-    |   Purpose:    Returns a pointer to the incoming serial data buffer.                   |
-    |   Arguments:  void                                                                    |
-    |   Returns:    int16_t                                                                 |
+    |   Name:       takeSerialFrame                                                         |
+    |   Purpose:    Takes the oldest complete packet, and ownership of its block. The       |
+    |               caller releases the block when done.                                    |
+    |   Arguments:  SerialFrame*                                                            |
+    |   Returns:    bool (false if there is none)                                           |
     \*-------------------------------------------------------------------------------------*/
-    uint8_t* getSerialReadBuffer(void){
-        return serialReadBuffer;
-    }
-
-    /*-------------------------------------------------------------------------------------*\
-    |   Name:       getSerialReadBufferLength                                                     |
-    |   Purpose:    Returns the data length in bytes of the last received serial data.      |
-    |   Arguments:  void                                                                    |
-    |   Returns:    int16_t                                                                 |
-    \*-------------------------------------------------------------------------------------*/
-    uint16_t getSerialReadBufferLength(void){
-        return packetLen;
+    bool takeSerialFrame(SerialFrame* frame){
+        return serialFrames.pop(*frame);
     }
 
     /*-------------------------------------------------------------------------------------*\
@@ -150,98 +203,87 @@
 
     /*-------------------------------------------------------------------------------------*\
     |   Name:       createPacket                                                            |
-    |   Purpose:    Creates a serial packet with a given payload.              				|
+    |   Purpose:    Creates a serial packet around a given payload, in place. The payload   |
+    |               needs PKT_HEADROOM free bytes in front of it and one behind it.         |
     |   Arguments:  uint8_t, uint8_t*, uint16_t                                             |
     |   Returns:    uint8_t*                                                                |
     \*-------------------------------------------------------------------------------------*/
     uint8_t* createPacket(uint8_t type, uint8_t* payloadBuf, uint16_t bufLen){
+        // Header length, the extension adds the milliseconds after the UNIX time
+        uint16_t headerLen = headerExtension ? (PKT_HEADER_LEN + PKT_HEADER_EXTENSION_LEN) : PKT_HEADER_LEN;
+        uint16_t pktLen = headerLen + bufLen + PKT_TRAILER_LEN;
+        serialSendBuffer = payloadBuf - headerLen;
+
         // Start flag
         serialSendBuffer[0] = START_FLAG;
         
         // Packet type and ID
-        serialSendBuffer[1] = ((type & 0b00000111) << 5) | (getPacketID() & 0b00011111);
+        serialSendBuffer[1] = (type & PACKET_TYPE_MASK) | (headerExtension ? HEADER_EXTENSION_FLAG : 0) | (getPacketID() & 0b00011111);
         
         // Packet length
-        serialSendBuffer[2] = (bufLen & 0xFF00) >> 8;
-        serialSendBuffer[3] = bufLen & 0x00FF;
+        serialSendBuffer[2] = (pktLen & 0xFF00) >> 8;
+        serialSendBuffer[3] = pktLen & 0x00FF;
 
-        // UNIX time
-        uint32_t curTime = getUnixTime();
+        // UNIX time, seconds and milliseconds from the same clock reading
+        uint32_t curTime;
+        uint16_t curMs;
+        getUnixTimeMs(&curTime, &curMs);
         serialSendBuffer[4] = (curTime & 0xFF000000) >> 24;
         serialSendBuffer[5] = (curTime & 0x00FF0000) >> 16;
         serialSendBuffer[6] = (curTime & 0x0000FF00) >> 8;
         serialSendBuffer[7] = (curTime & 0x000000FF);
-		
-        // Payload
-        memcpy(serialSendBuffer+PAYLOAD_INDEX, payloadBuf, bufLen);
+        if(headerExtension){
+            serialSendBuffer[UNIX_MS_INDEX]   = (curMs & 0xFF00) >> 8;
+            serialSendBuffer[UNIX_MS_INDEX+1] = (curMs & 0x00FF);
+        }
 
         // End flag
-        serialSendBuffer[bufLen+PAYLOAD_INDEX] = END_FLAG;
-				
-        // Clear the rest of the buffer       
-        for(uint16_t i = bufLen+PKT_HEADER_TRAILER_LEN; i != PKT_MAX_LEN; i++) serialSendBuffer[i] = 0;
+        serialSendBuffer[pktLen-1] = END_FLAG;
 
         // Set the send buffer length
-        sendBufferLen = bufLen+PKT_HEADER_TRAILER_LEN;
+        sendBufferLen = pktLen;
         
         return serialSendBuffer;
     }
-	
+
     /*-------------------------------------------------------------------------------------*\
     |   Name:       createAckPacket                                                         |
     |   Purpose:    Creates an Ack serial packet with the given result and return data.		|
+    |               The result goes in the 2 bytes in front of the return data, and the     |
+    |               header in front of that.                                                |
     |   Arguments:  int16_t, uint8_t*, uint16_t                                             |
     |   Returns:    uint8_t*                                                                |
     \*-------------------------------------------------------------------------------------*/	
     uint8_t* createAckPacket(int16_t res, uint8_t* retBuf, uint16_t bufLen){
-        // Shift all bytes forward twice for non-zero payloads
-        if(bufLen > 0){           
-            for(uint16_t i = bufLen-1; i >= 2; i--) retBuf[i] = retBuf[i-2];
-        }
-                
         // Set the result field
-        retBuf[0] = (res & 0xFF00) >> 8;
-        retBuf[1] = res & 0x00FF;
+        retBuf[-2] = (res & 0xFF00) >> 8;
+        retBuf[-1] = res & 0x00FF;
 		
         // Create and return the packet
-        return createPacket(ACK_PACKET, retBuf, bufLen+2);
+        return createPacket(ACK_PACKET, retBuf - ACK_RESULT_LEN, bufLen + ACK_RESULT_LEN);
     }
 
     /*-------------------------------------------------------------------------------------*\
     |   Name:       createMessagePacket                                                     |
-    |   Purpose:    Creates a message serial packet with the given result and return data.  |
-    |   Arguments:  uint16_t, float, float, uint8_t*, uint16_t                              |
+    |   Purpose:    Creates a message serial packet around received radio data, in place,   |
+    |               with its RSSI, SNR, and result ahead of it. The data needs              |
+    |               MESSAGE_FIELDS_LEN + PKT_HEADROOM free bytes in front of it.            |
+    |   Arguments:  int16_t, int16_t (0.01 dBm), int16_t (0.01 dB), uint8_t*, uint16_t      |
     |   Returns:    uint8_t*                                                                |
     \*-------------------------------------------------------------------------------------*/
-    uint8_t* createMessagePacket(int16_t res, float RSSI, float SNR, uint8_t* retBuf, uint16_t bufLen){       
-        // Buffer for the float->uint32_t bytes conversion
-        uint32_t fBytes;
-        
-        // Shift all bytes forward ten for non-zero payloads
-        if(bufLen > 0){           
-            for(uint16_t i = bufLen-1; i >= 10; i--) retBuf[i] = retBuf[i-2];
-        }
-        
-        // Set the result field
-        retBuf[0] = (res & 0xFF00) >> 8;
-        retBuf[1] = res & 0x00FF;
-
-        // Set the RSSI field
-        fBytes = *((uint32_t *) &RSSI);
-        retBuf[6] = (fBytes & 0xFF000000) >> 24;
-        retBuf[7] = (fBytes & 0x00FF0000) >> 16;
-        retBuf[8] = (fBytes & 0x0000FF00) >> 8;
-        retBuf[9] = (fBytes & 0x000000FF);
-
-        // Set the SNR field
-        fBytes = *((uint32_t *) &SNR);
-        retBuf[6] = (fBytes & 0xFF000000) >> 24;
-        retBuf[7] = (fBytes & 0x00FF0000) >> 16;
-        retBuf[8] = (fBytes & 0x0000FF00) >> 8;
-        retBuf[9] = (fBytes & 0x000000FF);
-        
-        // Create and return the packet
-        return createPacket(ACK_PACKET, retBuf, bufLen+10);
+    uint8_t* createMessagePacket(int16_t res, int16_t RSSI, int16_t SNR, uint8_t* data, uint16_t len){
+        // The fields go right in front of the data, and the header in front of them
+        uint8_t* payload = data - MESSAGE_FIELDS_LEN;
+        createPacket(MESSAGE_PACKET, payload, MESSAGE_FIELDS_LEN + len);
+
+        // Set the RSSI, SNR, and result fields, laid out by MESSAGE_FIELDS_SCHEMA
+        MessageFields fields;
+        fields.RSSI   = RSSI;
+        fields.SNR    = SNR;
+        fields.result = res;
+        encodeMessageFields(payload, fields);
+
+        return serialSendBuffer;
     }
 
 	/*-------------------------------------------------------------------------------------*\
@@ -255,6 +297,46 @@
         return cyclicID;
     }
 
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       setHeaderExtension                                                      |
+    |   Purpose:    Enables/disables the millisecond header extension on outgoing packets.  |
+    |   Arguments:  bool                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void setHeaderExtension(bool enable){
+        headerExtension = enable;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getHeaderExtension                                                      |
+    |   Purpose:    Returns whether outgoing packets carry the millisecond header extension.|
+    |   Arguments:  void                                                                    |
+    |   Returns:    bool                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    bool getHeaderExtension(){
+        return headerExtension;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getLastPacketID                                                         |
+    |   Purpose:    Returns the last packet ID handed out, without advancing it.            |
+    |   Arguments:  void                                                                    |
+    |   Returns:    uint8_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    uint8_t getLastPacketID(){
+        return cyclicID;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       setLastPacketID                                                         |
+    |   Purpose:    Resumes the packet ID sequence from a given ID.                         |
+    |   Arguments:  uint8_t                                                                 |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void setLastPacketID(uint8_t id){
+        cyclicID = id & 0b00011111;
+    }
+
     /*-------------------------------------------------------------------------------------*\
     |   Name:       getSendBufferLen                                                        |
     |   Purpose:    Returns the length of the last packet data in the send buffer.          |
@@ -264,3 +346,14 @@
     uint16_t getSendBufferLen(){
         return sendBufferLen;
     }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       writeSerialPacket                                                       |
+    |   Purpose:    Writes the last packet created in the send buffer out to the host.      |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void writeSerialPacket(void){
+        Serial.write((char*)serialSendBuffer, sendBufferLen);
+        PERF_ADD(PERF_UART_BYTES_OUT, sendBufferLen);
+    }
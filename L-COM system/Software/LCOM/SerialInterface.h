@@ -1,5 +1,3 @@
-#include <MPU9250.h>
-
 /*
 *   Author  :   Stephen Amey
 *   Date    :   Aug. 28, 2021
@@ -9,6 +7,10 @@
 #define INC_SERIALINTERFACE_H_
 
 #include <Arduino.h>
+#include "PacketArena.h"
+#include "Perf.h"
+#include "Schemas.h"
+#include "Trace.h"
 #include "Utility.h"
 
 
@@ -29,19 +31,27 @@
     #define PKT_TRAILER_LEN             1
     #define PKT_HEADER_TRAILER_LEN      (PKT_HEADER_LEN + PKT_TRAILER_LEN)
     //#define PKT_MAX_DATA_PAYLOAD_LEN  265
-    #define PKT_MAX_LEN                 274
+    #define PKT_MAX_LEN                 276     // Largest payload (265) plus the extended header
+    #define PKT_HEADER_EXTENSION_LEN    2
+    #define PKT_HEADROOM                (PKT_HEADER_LEN + PKT_HEADER_EXTENSION_LEN)    // Free bytes a payload needs in front of it to become a packet
+    #define ACK_RESULT_LEN              2
     
     // Field locations
     #define TYPE_CYCLIC_FIELD_INDEX     1
     #define LENGTH_INDEX                2
     #define UNIX_TIME_INDEX             4
     #define PAYLOAD_INDEX               8
-    #define MESSAGE_INDEX               18      // There are 10 bytes at the start of a message packet payload dedicated to RSSI, SNR, and result
+    #define UNIX_MS_INDEX               8       // Only with the header extension, the payload then starts 2 bytes later
+    #define MESSAGE_FIELDS_LEN          CODEC_LEN(MESSAGE_FIELDS_SCHEMA)        // RSSI, SNR, and result at the start of a message packet payload
+    #define MESSAGE_INDEX               (PAYLOAD_INDEX + MESSAGE_FIELDS_LEN)
     
-    // Packet type (Most-significant 3 bits identify type, last 5 bits are for cyclic frame count)
+    // Packet type (Most-significant bit flags the header extension, next 2 bits identify type, last 5 bits are for cyclic frame count)
     #define ACK_PACKET                  0b00000000 
 	#define COMMAND_PACKET              0b00100000
     #define MESSAGE_PACKET              0b01000000
+    #define TRACE_PACKET                0b01100000
+    #define PACKET_TYPE_MASK            0b01100000
+    #define HEADER_EXTENSION_FLAG       0b10000000
 
     /* Status codes */
     #define PACKET_COMPLETE             0x0300
@@ -50,8 +60,23 @@
     #define NEW_PARTIAL_SERIAL_DATA     0x0303
     #define MISPLACED_START_FLAG        0x0304
     #define MISPLACED_END_FLAG          0x0305
+
+    #define SERIAL_FRAME_QUEUE_LEN      2       // One per arena block, a power of two
     
 
+/*-------------------------------------------------------------------------*\
+|                                    Types                                  |
+\*-------------------------------------------------------------------------*/
+
+
+    /* A complete packet waiting to be handled */
+    struct SerialFrame{
+        uint8_t* packet;                    // Basic header first, inside its block
+        uint16_t length;
+        uint8_t block;
+    };
+
+
 /*-------------------------------------------------------------------------*\
 |                                  Functions                                |
 \*-------------------------------------------------------------------------*/
@@ -77,20 +102,13 @@
     //uint8_t* getSerialSendBuffer(void);
     
     /*-------------------------------------------------------------------------------------*\
-    |   Name:       getSerialReadBuffer                                                     |
-    |   Purpose:    Returns a pointer to the incoming serial data buffer.                   |
-    |   Arguments:  void                                                                    |
-    |   Returns:    uint8_t*                                                                |
+    |   Name:       takeSerialFrame                                                         |
+    |   Purpose:    Takes the oldest complete packet, and ownership of its block. The       |
+    |               caller releases the block when done.                                    |
+    |   Arguments:  SerialFrame*                                                            |
+    |   Returns:    bool (false if there is none)                                           |
     \*-------------------------------------------------------------------------------------*/
-    uint8_t* getSerialReadBuffer(void);
-
-    /*-------------------------------------------------------------------------------------*\
-    |   Name:       getSerialReadBufferLength                                               |
-    |   Purpose:    Returns the data length in bytes of the last received serial data.      |
-    |   Arguments:  void                                                                    |
-    |   Returns:    uint16_t                                                                |
-    \*-------------------------------------------------------------------------------------*/
-    uint16_t getSerialReadBufferLength(void);
+    bool takeSerialFrame(SerialFrame* frame);
 
     /*-------------------------------------------------------------------------------------*\
     |   Name:       verifyPacket                                                            |
@@ -101,9 +119,20 @@
     \*-------------------------------------------------------------------------------------*/
     bool verifyPacket(uint8_t* buf);
 
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       stripHeaderExtension                                                    |
+    |   Purpose:    Removes the millisecond header extension from a received packet, so the |
+    |               handlers always see the basic header. The header is moved up over the   |
+    |               extension, leaving the payload where it is.                             |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void stripHeaderExtension(void);
+
 	/*-------------------------------------------------------------------------------------*\
     |   Name:       createPacket                                                            |
-    |   Purpose:    Creates a serial packet with a given payload.              				|
+    |   Purpose:    Creates a serial packet around a given payload, in place. The payload   |
+    |               needs PKT_HEADROOM free bytes in front of it and one behind it.         |
     |   Arguments:  uint8_t, uint8_t*, uint16_t                                             |
     |   Returns:    uint8_t*                                                                |
     \*-------------------------------------------------------------------------------------*/
@@ -112,6 +141,8 @@
     /*-------------------------------------------------------------------------------------*\
     |   Name:       createAckPacket                                                         |
     |   Purpose:    Creates an Ack serial packet with the given result and return data.		|
+    |               The result goes in the 2 bytes in front of the return data, and the     |
+    |               header in front of that.                                                |
     |   Arguments:  int16_t, uint8_t*, uint16_t                                             |
     |   Returns:    uint8_t*                                                                |
     \*-------------------------------------------------------------------------------------*/
@@ -119,11 +150,13 @@
 
     /*-------------------------------------------------------------------------------------*\
     |   Name:       createMessagePacket                                                     |
-    |   Purpose:    Creates a message serial packet with the given result and return data.  |
-    |   Arguments:  uint16_t, float, float, uint8_t*, uint16_t                              |
+    |   Purpose:    Creates a message serial packet around received radio data, in place,   |
+    |               with its RSSI, SNR, and result ahead of it. The data needs              |
+    |               MESSAGE_FIELDS_LEN + PKT_HEADROOM free bytes in front of it.            |
+    |   Arguments:  int16_t, int16_t (0.01 dBm), int16_t (0.01 dB), uint8_t*, uint16_t      |
     |   Returns:    uint8_t*                                                                |
     \*-------------------------------------------------------------------------------------*/
-    uint8_t* createMessagePacket(int16_t res, float RSSI, float SNR, uint8_t* retBuf, uint16_t bufLen);
+    uint8_t* createMessagePacket(int16_t res, int16_t RSSI, int16_t SNR, uint8_t* data, uint16_t len);
 	
 	/*-------------------------------------------------------------------------------------*\
     |   Name:       getPacketID                                                             |
@@ -132,6 +165,38 @@
     |   Returns:    uint8_t                                                                 |
     \*-------------------------------------------------------------------------------------*/
 	uint8_t getPacketID();
+
+	/*-------------------------------------------------------------------------------------*\
+    |   Name:       setHeaderExtension                                                      |
+    |   Purpose:    Enables/disables the millisecond header extension on outgoing packets.  |
+    |   Arguments:  bool                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+	void setHeaderExtension(bool enable);
+
+	/*-------------------------------------------------------------------------------------*\
+    |   Name:       getHeaderExtension                                                      |
+    |   Purpose:    Returns whether outgoing packets carry the millisecond header extension.|
+    |   Arguments:  void                                                                    |
+    |   Returns:    bool                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+	bool getHeaderExtension();
+
+	/*-------------------------------------------------------------------------------------*\
+    |   Name:       getLastPacketID                                                         |
+    |   Purpose:    Returns the last packet ID handed out, without advancing it.            |
+    |   Arguments:  void                                                                    |
+    |   Returns:    uint8_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+	uint8_t getLastPacketID();
+
+	/*-------------------------------------------------------------------------------------*\
+    |   Name:       setLastPacketID                                                         |
+    |   Purpose:    Resumes the packet ID sequence from a given ID.                         |
+    |   Arguments:  uint8_t                                                                 |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+	void setLastPacketID(uint8_t id);
 	
     /*-------------------------------------------------------------------------------------*\
     |   Name:       getSendBufferLen                                                        |
@@ -141,5 +206,13 @@
     \*-------------------------------------------------------------------------------------*/
     uint16_t getSendBufferLen();
 
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       writeSerialPacket                                                       |
+    |   Purpose:    Writes the last packet created in the send buffer out to the host.      |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void writeSerialPacket(void);
+
     
 #endif /* INC_SERIALINTERFACE_H_ */
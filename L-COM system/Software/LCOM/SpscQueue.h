@@ -0,0 +1,113 @@
+#ifndef INC_SPSCQUEUE_H_
+#define INC_SPSCQUEUE_H_
+
+#include <Arduino.h>
+#ifndef __AVR__
+#include <atomic>
+#endif
+
+
+/*-------------------------------------------------------------------------*\
+|								  Definitions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*
+     * The AVR reads and writes a byte whole and in program order, so the indices only need the compiler
+     * kept from moving item accesses across an index update. Anywhere else (the host tests) the producer
+     * and consumer can be threads on different cores, and the indices are atomics with acquire/release.
+     */
+    #ifdef __AVR__
+        #define SPSC_BARRIER()              __asm__ __volatile__("" ::: "memory")
+
+        typedef volatile uint8_t SpscIndex;
+        static inline uint8_t spscLoad(const SpscIndex& index){ return index; }
+        static inline uint8_t spscLoadAcquire(const SpscIndex& index){ uint8_t v = index; SPSC_BARRIER(); return v; }
+        static inline void spscStoreRelease(SpscIndex& index, uint8_t v){ SPSC_BARRIER(); index = v; }
+    #else
+        typedef std::atomic<uint8_t> SpscIndex;
+        static inline uint8_t spscLoad(const SpscIndex& index){ return index.load(std::memory_order_relaxed); }
+        static inline uint8_t spscLoadAcquire(const SpscIndex& index){ return index.load(std::memory_order_acquire); }
+        static inline void spscStoreRelease(SpscIndex& index, uint8_t v){ index.store(v, std::memory_order_release); }
+    #endif
+
+
+/*-------------------------------------------------------------------------*\
+|								    Classes					   			    |
+\*-------------------------------------------------------------------------*/
+
+
+    /*
+     * Fixed-capacity ring for handing items from exactly one producer to exactly one consumer, e.g. an
+     * interrupt to the main loop. The producer only ever writes head and the consumer only ever writes
+     * tail, and both are single bytes, so neither side has to disable interrupts on AVR. The indices run
+     * freely and wrap at 256, which is why the capacity must be a power of two no larger than 128.
+     */
+    template <typename T, uint8_t N>
+    class SpscQueue{
+        static_assert(N != 0 && (N & (N - 1)) == 0, "SpscQueue capacity must be a power of two");
+        static_assert(N <= 128, "SpscQueue capacity must leave the 8-bit indices room to tell full from empty");
+
+        public:
+            SpscQueue() : head(0), tail(0) {}
+
+            /*-------------------------------------------------------------------------------------*\
+            |   Name:       push                                                                    |
+            |   Purpose:    Producer side. Copies an item in, if there is room.                     |
+            |   Arguments:  const T&                                                                |
+            |   Returns:    bool (false if full)                                                    |
+            \*-------------------------------------------------------------------------------------*/
+            bool push(const T& item){
+                uint8_t h = spscLoad(head);
+                if((uint8_t)(h - spscLoadAcquire(tail)) == N) return false;
+                items[h & (N - 1)] = item;
+                spscStoreRelease(head, h + 1);
+                return true;
+            }
+
+            /*-------------------------------------------------------------------------------------*\
+            |   Name:       pop                                                                     |
+            |   Purpose:    Consumer side. Copies the oldest item out, if there is one.             |
+            |   Arguments:  T&                                                                      |
+            |   Returns:    bool (false if empty)                                                   |
+            \*-------------------------------------------------------------------------------------*/
+            bool pop(T& item){
+                uint8_t t = spscLoad(tail);
+                if(spscLoadAcquire(head) == t) return false;
+                item = items[t & (N - 1)];
+                spscStoreRelease(tail, t + 1);
+                return true;
+            }
+
+            /*-------------------------------------------------------------------------------------*\
+            |   Name:       clear                                                                   |
+            |   Purpose:    Consumer side. Discards everything pushed so far.                       |
+            |   Arguments:  void                                                                    |
+            |   Returns:    void                                                                    |
+            \*-------------------------------------------------------------------------------------*/
+            void clear(void){
+                spscStoreRelease(tail, spscLoadAcquire(head));
+            }
+
+            /*-------------------------------------------------------------------------------------*\
+            |   Name:       count                                                                   |
+            |   Purpose:    Returns the number of items waiting. Exact for the consumer, may be     |
+            |               stale by the time the producer sees it, and vice versa.                 |
+            |   Arguments:  void                                                                    |
+            |   Returns:    uint8_t                                                                 |
+            \*-------------------------------------------------------------------------------------*/
+            uint8_t count(void) const{
+                return (uint8_t)(spscLoadAcquire(head) - spscLoadAcquire(tail));
+            }
+
+            bool empty(void) const{
+                return spscLoadAcquire(head) == spscLoadAcquire(tail);
+            }
+
+        private:
+            T items[N];
+            SpscIndex head;             // Next slot to fill, written by the producer only
+            SpscIndex tail;             // Next slot to empty, written by the consumer only
+    };
+
+#endif /* INC_SPSCQUEUE_H_ */
@@ -0,0 +1,383 @@
+#include "StoreForward.h"
+#include <avr/eeprom.h>
+
+
+/*-------------------------------------------------------------------------*\
+|								  Layout checks				   			    |
+\*-------------------------------------------------------------------------*/
+
+
+    static_assert(STORE_SLOT_COUNT >= 2 && STORE_SLOT_COUNT <= 0x7F, "The ring needs a few slots after the profile table");
+    static_assert(STORE_MAX_RECORD_LEN + STORED_RECORD_LEN <= TELEMETRY_MAX_RECORD_LEN, "A stored record must fit a telemetry record once forwarded");
+    static_assert(STORE_SLOT_LEN <= 0xFF, "A staged slot's length is a byte");
+
+
+/*-------------------------------------------------------------------------*\
+|								   Variables					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /* Configuration */
+    bool storeEnabled = false;
+    uint16_t linkTimeout = STORE_DEFAULT_LINK_TIMEOUT;
+    uint16_t storeInterval = STORE_DEFAULT_INTERVAL;
+
+    /* Link health */
+    bool linkHeard = false;                                 // Any frame since boot
+    uint32_t linkHeardMillis = 0;
+    bool linkWasUp = true;                                  // As serviceStoreForward last saw it, to log changes
+    uint32_t storeDrainMillis = 0;                          // When a record was last forwarded, or tried
+
+    /* Ring */
+    uint8_t storeNextSlot = 0;                              // Written next, the oldest slot once the ring is full
+    uint16_t storeSequence = 0;                             // Of the next record stored
+    uint32_t storeLastMillis[TELEMETRY_RECORD_TYPES];       // When each type was last stored, 0 if never
+
+    /* Staged records, oldest first */
+    StoreStagedSlot storeStaged[STORE_STAGED_SLOTS];
+    uint8_t storeStagedFirst = 0;
+    uint8_t storeStagedCount = 0;
+
+    /* Statistics */
+    uint16_t recordsStored = 0;
+    uint16_t recordsForwarded = 0;
+    uint16_t recordsOverwritten = 0;                        // Still pending when the ring came back around
+    uint16_t recordsDropped = 0;                            // Too long for a slot, or nowhere to stage it
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       storeSlotAddress                                                        |
+    |   Purpose:    Returns the EEPROM address of a slot.                                   |
+    |   Arguments:  uint8_t                                                                 |
+    |   Returns:    uint16_t                                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint16_t storeSlotAddress(uint8_t slot){
+        return STORE_RING_ADDRESS + slot*STORE_SLOT_LEN;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       storeSlotCRC                                                            |
+    |   Purpose:    CRC-16 over a slot's sequence, length, and record, the record read from |
+    |               the buffer if given and from the slot's EEPROM otherwise.               |
+    |   Arguments:  const StoreSlotHeader&, uint16_t, const uint8_t*                        |
+    |   Returns:    uint16_t                                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint16_t storeSlotCRC(const StoreSlotHeader& header, uint16_t address, const uint8_t* record){
+        uint16_t crc = 0xFFFF;
+        crc = _crc16_update(crc, header.sequence >> 8);
+        crc = _crc16_update(crc, header.sequence & 0xFF);
+        crc = _crc16_update(crc, header.len);
+        uint16_t recordAddress = address + sizeof(StoreSlotHeader);
+        for(uint8_t i = 0; i != header.len; i++) crc = _crc16_update(crc, record ? record[i] : EEPROM.read(recordAddress + i));
+        return crc;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       readStoreSlot                                                           |
+    |   Purpose:    Reads a slot's header, checking its record against the CRC.             |
+    |   Arguments:  uint8_t, StoreSlotHeader*                                               |
+    |   Returns:    bool (false if the slot is empty or corrupt)                            |
+    \*-------------------------------------------------------------------------------------*/
+    bool readStoreSlot(uint8_t slot, StoreSlotHeader* header){
+        uint16_t address = storeSlotAddress(slot);
+        EEPROM.get(address, *header);
+        if(header->state != STORE_SLOT_PENDING && header->state != STORE_SLOT_SENT) return false;
+        if(header->len == 0 || header->len > STORE_MAX_RECORD_LEN) return false;
+        return header->crc == storeSlotCRC(*header, address, NULL);
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       slotStaged                                                              |
+    |   Purpose:    Returns whether a slot has a staged record being written over it.       |
+    |   Arguments:  uint8_t                                                                 |
+    |   Returns:    bool                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    bool slotStaged(uint8_t slot){
+        for(uint8_t i = 0; i != storeStagedCount; i++){
+            if(storeStaged[(storeStagedFirst + i) % STORE_STAGED_SLOTS].slot == slot) return true;
+        }
+        return false;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       writeStagedSlots                                                        |
+    |   Purpose:    Writes the next byte of the staged records, oldest first, if the EEPROM |
+    |               is done with the last. The state byte of each goes once the rest of the |
+    |               slot is in.                                                             |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void writeStagedSlots(void){
+        /* A read or write waits out the one before, so neither is tried until it's done */
+        if(!eeprom_is_ready()) return;
+
+        while(storeStagedCount != 0){
+            StoreStagedSlot& staged = storeStaged[storeStagedFirst];
+            uint16_t address = storeSlotAddress(staged.slot);
+            if(staged.next == 1 && EEPROM.read(address) == STORE_SLOT_PENDING) recordsOverwritten++;
+
+            /* Bytes already holding their value cost nothing, as EEPROM.update */
+            uint8_t i = (staged.next < staged.len) ? staged.next : 0;
+            bool written = EEPROM.read(address + i) != staged.image[i];
+            if(written) EEPROM.write(address + i, staged.image[i]);
+            if(i != 0) staged.next++;
+            else{
+                storeStagedFirst = (storeStagedFirst + 1) % STORE_STAGED_SLOTS;
+                storeStagedCount--;
+                recordsStored++;
+            }
+            if(written) return;
+        }
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       oldestPendingSlot                                                       |
+    |   Purpose:    Finds the pending slot stored longest ago, going by state and sequence  |
+    |               alone; the CRC is checked when it's forwarded.                          |
+    |   Arguments:  uint8_t* (pending slots, may be NULL)                                   |
+    |   Returns:    int8_t (the slot, -1 if none is pending)                                |
+    \*-------------------------------------------------------------------------------------*/
+    int8_t oldestPendingSlot(uint8_t* pending){
+        int8_t oldest = -1;
+        uint16_t oldestAge = 0;
+        if(pending) *pending = 0;
+
+        StoreSlotHeader header;
+        for(uint8_t i = 0; i != STORE_SLOT_COUNT; i++){
+            EEPROM.get(storeSlotAddress(i), header);
+            if(header.state != STORE_SLOT_PENDING || slotStaged(i)) continue;
+            if(pending) (*pending)++;
+
+            /* Counted back from the next sequence, so this holds across wrapping */
+            uint16_t age = storeSequence - header.sequence;
+            if(oldest < 0 || age > oldestAge){
+                oldest = i;
+                oldestAge = age;
+            }
+        }
+        return oldest;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       initializeStoreForward                                                  |
+    |   Purpose:    Finds the newest slot in the ring, picking the sequence up after it.    |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void initializeStoreForward(void){
+        StoreSlotHeader header;
+        bool found = false;
+        for(uint8_t i = 0; i != STORE_SLOT_COUNT; i++){
+            if(!readStoreSlot(i, &header)) continue;
+            if(!found || (int16_t)(header.sequence - storeSequence) >= 0){
+                storeSequence = header.sequence + 1;
+                storeNextSlot = (i + 1) % STORE_SLOT_COUNT;
+                found = true;
+            }
+        }
+
+        uint8_t pending;
+        oldestPendingSlot(&pending);
+        if(pending != 0){
+            Log(F("Stored records waiting to be forwarded:"));
+            Log((uint16_t)pending);
+        }
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       configureStoreForward                                                   |
+    |   Purpose:    Enables or disables storing, with the link timeout and store interval   |
+    |               (s). Disabled, every record is transmitted and the backlog still        |
+    |               drains.                                                                 |
+    |   Arguments:  bool, uint16_t, uint16_t                                                |
+    |   Returns:    int16_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t configureStoreForward(bool enable, uint16_t timeout, uint16_t interval){
+        if(enable && timeout == 0) return STORE_INVALID_LINK_TIMEOUT;
+
+        storeEnabled = enable;
+        linkTimeout = timeout;
+        storeInterval = interval;
+        return STORE_OK;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       noteLinkHeard                                                           |
+    |   Purpose:    Marks the link up. Called for every frame received intact.              |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void noteLinkHeard(void){
+        linkHeard = true;
+        linkHeardMillis = millis();
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getLinkUp                                                               |
+    |   Purpose:    Returns whether a frame was heard within the link timeout, always true  |
+    |               while storing is disabled.                                              |
+    |   Arguments:  void                                                                    |
+    |   Returns:    bool                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    bool getLinkUp(void){
+        if(!storeEnabled) return true;
+        return linkHeard && (millis() - linkHeardMillis) < (uint32_t)linkTimeout*1000;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       storeTelemetryRecord                                                    |
+    |   Purpose:    Takes a radio record (type first) while the link is down, staging it    |
+    |               to be stored if its type is due, it fits a slot, and a staging slot is  |
+    |               free, and dropping it otherwise.                                        |
+    |   Arguments:  const uint8_t*, uint16_t                                                |
+    |   Returns:    bool (false if the link is up and the record should be transmitted)     |
+    \*-------------------------------------------------------------------------------------*/
+    bool storeTelemetryRecord(const uint8_t* record, uint16_t len){
+        uint8_t type = record[0];
+        if(getLinkUp() || type >= TELEMETRY_RECORD_TYPES || type == TELEMETRY_STORED) return false;
+
+        /* Thinned to one of each type per interval, so the ring covers a long outage */
+        if(storeLastMillis[type] != 0 && millis() - storeLastMillis[type] < (uint32_t)storeInterval*1000) return true;
+        if(len > STORE_MAX_RECORD_LEN || storeStagedCount == STORE_STAGED_SLOTS){
+            recordsDropped++;
+            return true;
+        }
+        storeLastMillis[type] = millis();
+
+        /* Staged whole, serviceStoreForward writes it out */
+        uint16_t address = storeSlotAddress(storeNextSlot);
+        StoreSlotHeader header;
+        header.state = STORE_SLOT_PENDING;
+        header.sequence = storeSequence++;
+        header.len = len;
+        header.crc = storeSlotCRC(header, address, record);
+
+        StoreStagedSlot& staged = storeStaged[(storeStagedFirst + storeStagedCount) % STORE_STAGED_SLOTS];
+        staged.slot = storeNextSlot;
+        staged.len = sizeof(StoreSlotHeader) + len;
+        staged.next = 1;
+        memcpy(staged.image, &header, sizeof(StoreSlotHeader));
+        memcpy(staged.image + sizeof(StoreSlotHeader), record, len);
+        storeStagedCount++;
+
+        storeNextSlot = (storeNextSlot + 1) % STORE_SLOT_COUNT;
+        return true;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       forwardStoredRecord                                                     |
+    |   Purpose:    Sends a slot as a TELEMETRY_STORED record, marking it sent once it's    |
+    |               out. A corrupt slot is emptied instead.                                 |
+    |   Arguments:  uint8_t                                                                 |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void forwardStoredRecord(uint8_t slot){
+        uint16_t address = storeSlotAddress(slot);
+        StoreSlotHeader header;
+        if(!readStoreSlot(slot, &header)){
+            EEPROM.update(address, STORE_SLOT_EMPTY);
+            return;
+        }
+
+        uint8_t* record = beginTelemetryRecord(TELEMETRY_STORED);
+        if(record == NULL) return;
+
+        StoredRecord stored;
+        stored.sequence = header.sequence;
+        uint8_t* p = encodeStoredRecord(record, stored);
+        for(uint8_t i = 0; i != header.len; i++) *p++ = EEPROM.read(address + sizeof(StoreSlotHeader) + i);
+
+        /* Left pending if the channel was busy, it goes next run */
+        if(sendTelemetryRecord(p - record) != TELEMETRY_OK) return;
+        EEPROM.update(address, STORE_SLOT_SENT);
+        recordsForwarded++;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       serviceStoreForward                                                     |
+    |   Purpose:    Scheduler task. Writes the next byte of the staged records, logs link   |
+    |               changes and, while the link is up, forwards the oldest stored record    |
+    |               every STORE_DRAIN_PERIOD. Never waits on the EEPROM.                    |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void serviceStoreForward(void){
+        bool linkUp = getLinkUp();
+        if(linkUp != linkWasUp){
+            linkWasUp = linkUp;
+            if(linkUp) Log(F("Link back, forwarding stored telemetry"));
+            else Log(F("Link lost, storing telemetry"));
+        }
+
+        /* UART telemetry doesn't depend on the link. Forwarding reads the ring, so it goes before a write starts */
+        uint8_t destination = getTelemetryDestination();
+        bool drain = destination == TELEMETRY_UART || (destination == TELEMETRY_RADIO && linkUp);
+        if(drain && millis() - storeDrainMillis >= STORE_DRAIN_PERIOD && eeprom_is_ready()){
+            storeDrainMillis = millis();
+            int8_t slot = oldestPendingSlot(NULL);
+            if(slot >= 0){
+                forwardStoredRecord(slot);
+                return;
+            }
+        }
+
+        writeStagedSlots();
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getStoreForwardEnabled                                                  |
+    |   Purpose:    Returns whether storing is enabled.                                     |
+    |   Arguments:  void                                                                    |
+    |   Returns:    bool                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    bool getStoreForwardEnabled(void){
+        return storeEnabled;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getLinkTimeout                                                          |
+    |   Purpose:    Returns the link timeout (s).                                           |
+    |   Arguments:  void                                                                    |
+    |   Returns:    uint16_t                                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint16_t getLinkTimeout(void){
+        return linkTimeout;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getStoreInterval                                                        |
+    |   Purpose:    Returns the store interval (s).                                         |
+    |   Arguments:  void                                                                    |
+    |   Returns:    uint16_t                                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint16_t getStoreInterval(void){
+        return storeInterval;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getStoreForwardStatus                                                   |
+    |   Purpose:    Returns the link state, ring occupancy, and counts since boot.          |
+    |   Arguments:  void                                                                    |
+    |   Returns:    StoreForwardStatus                                                      |
+    \*-------------------------------------------------------------------------------------*/
+    StoreForwardStatus getStoreForwardStatus(void){
+        StoreForwardStatus status;
+        status.enabled = storeEnabled;
+        status.linkUp = getLinkUp();
+        status.linkTimeout = linkTimeout;
+        status.storeInterval = storeInterval;
+        status.sinceHeard = linkHeard ? millis() - linkHeardMillis : 0xFFFFFFFF;
+        status.slots = STORE_SLOT_COUNT;
+        oldestPendingSlot(&status.pending);
+        status.nextSequence = storeSequence;
+        status.stored = recordsStored;
+        status.forwarded = recordsForwarded;
+        status.overwritten = recordsOverwritten;
+        status.dropped = recordsDropped;
+        return status;
+    }
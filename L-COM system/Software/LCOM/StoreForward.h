@@ -0,0 +1,174 @@
+#ifndef INC_STOREFORWARD_H_
+#define INC_STOREFORWARD_H_
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <util/crc16.h>
+#include "RadioProfiles.h"
+#include "Schemas.h"
+#include "Telemetry.h"
+#include "Utility.h"
+
+
+/*-------------------------------------------------------------------------*\
+|								  Definitions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*
+     * While nothing has been heard over the air for the link timeout, radio telemetry goes into a
+     * ring of EEPROM slots after the profile table instead of being transmitted into the void, at
+     * most one record of each type every store interval. Once a frame is heard again the backlog is
+     * sent oldest first, one TELEMETRY_STORED record per run of serviceStoreForward, in the gaps
+     * between live telemetry. Each slot carries its own sequence number and CRC, so the backlog
+     * survives any reset, power loss included, and a full ring overwrites its oldest slot.
+     *
+     * A record is staged in RAM when it's stored and written a byte each serviceStoreForward run,
+     * only once eeprom_is_ready says the last byte is in. Nothing ever waits on the EEPROM's 3.4 ms
+     * a byte, not whoever sent the record and not the tasks behind serviceStoreForward. A record
+     * still staged at a reset is lost.
+     */
+
+    /* Ring layout (EEPROM), from the end of the profile table to the end of the EEPROM */
+    #define STORE_RING_ADDRESS              PROFILE_TABLE_END
+    #define STORE_SLOT_LEN                  36                      // Header and record, a GPS fix and a power reading fit
+    #define STORE_SLOT_COUNT                ((E2END + 1 - STORE_RING_ADDRESS) / STORE_SLOT_LEN)
+    #define STORE_MAX_RECORD_LEN            (STORE_SLOT_LEN - sizeof(StoreSlotHeader))      // Type included
+    #define STORE_SLOT_PENDING              0xA5
+    #define STORE_SLOT_SENT                 0x00
+    #define STORE_SLOT_EMPTY                0xFF                    // As erased, any state but the two above is empty
+    #define STORE_STAGED_SLOTS              2                       // Records staged in RAM waiting to be written
+
+    /*
+     * Wear: an EEPROM cell lasts about 100,000 writes, and a slot's state byte takes two a record,
+     * pending then sent. Storing a GPS fix and a power reading every STORE_DEFAULT_INTERVAL brings
+     * the 22 slot ring round every 110 s, so the state bytes last about 64 days of outage; halving
+     * the interval halves that (Tests/StoreForwardTest.cpp).
+     */
+
+    /* Defaults */
+    #define STORE_DEFAULT_LINK_TIMEOUT      30                      // s without a frame before the link counts as down, 3 beacon periods
+    #define STORE_DEFAULT_INTERVAL          10                      // s between stored records of one type
+    #define STORE_DRAIN_PERIOD              500                     // ms between forwarded records
+    #define STORE_SERVICE_PERIOD            10                      // ms, the scheduler period of serviceStoreForward, a slot in 36 runs
+
+    /* Status codes */
+    #define STORE_OK                        0x0000
+    #define STORE_INVALID_LINK_TIMEOUT      0x0A00
+
+
+/*-------------------------------------------------------------------------*\
+|								     Types					   			    |
+\*-------------------------------------------------------------------------*/
+
+
+    /* Front of each slot, the record follows. The CRC covers the sequence, length, and record */
+    struct StoreSlotHeader{
+        uint8_t state;                                      // Written last and once, cut off mid-write a slot keeps its old state over a record failing the CRC
+        uint16_t sequence;
+        uint8_t len;
+        uint16_t crc;
+    };
+
+    /* A slot's image waiting in RAM to be written */
+    struct StoreStagedSlot{
+        uint8_t slot;
+        uint8_t len;                                        // Header and record
+        uint8_t next;                                       // Byte written next, the state byte at 0 goes once the rest is in
+        uint8_t image[STORE_SLOT_LEN];
+    };
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       initializeStoreForward                                                  |
+    |   Purpose:    Finds the newest slot in the ring, picking the sequence up after it.    |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void initializeStoreForward(void);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       configureStoreForward                                                   |
+    |   Purpose:    Enables or disables storing, with the link timeout and store interval   |
+    |               (s). Disabled, every record is transmitted and the backlog still        |
+    |               drains.                                                                 |
+    |   Arguments:  bool, uint16_t, uint16_t                                                |
+    |   Returns:    int16_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t configureStoreForward(bool enable, uint16_t linkTimeout, uint16_t interval);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       noteLinkHeard                                                           |
+    |   Purpose:    Marks the link up. Called for every frame received intact.              |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void noteLinkHeard(void);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getLinkUp                                                               |
+    |   Purpose:    Returns whether a frame was heard within the link timeout, always true  |
+    |               while storing is disabled.                                              |
+    |   Arguments:  void                                                                    |
+    |   Returns:    bool                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    bool getLinkUp(void);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       storeTelemetryRecord                                                    |
+    |   Purpose:    Takes a radio record (type first) while the link is down, staging it    |
+    |               to be stored if its type is due, it fits a slot, and a staging slot is  |
+    |               free, and dropping it otherwise.                                        |
+    |   Arguments:  const uint8_t*, uint16_t                                                |
+    |   Returns:    bool (false if the link is up and the record should be transmitted)     |
+    \*-------------------------------------------------------------------------------------*/
+    bool storeTelemetryRecord(const uint8_t* record, uint16_t len);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       serviceStoreForward                                                     |
+    |   Purpose:    Scheduler task. Writes the next byte of the staged records, logs link   |
+    |               changes and, while the link is up, forwards the oldest stored record    |
+    |               every STORE_DRAIN_PERIOD. Never waits on the EEPROM.                    |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void serviceStoreForward(void);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getStoreForwardEnabled                                                  |
+    |   Purpose:    Returns whether storing is enabled.                                     |
+    |   Arguments:  void                                                                    |
+    |   Returns:    bool                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    bool getStoreForwardEnabled(void);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getLinkTimeout                                                          |
+    |   Purpose:    Returns the link timeout (s).                                           |
+    |   Arguments:  void                                                                    |
+    |   Returns:    uint16_t                                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint16_t getLinkTimeout(void);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getStoreInterval                                                        |
+    |   Purpose:    Returns the store interval (s).                                         |
+    |   Arguments:  void                                                                    |
+    |   Returns:    uint16_t                                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint16_t getStoreInterval(void);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getStoreForwardStatus                                                   |
+    |   Purpose:    Returns the link state, ring occupancy, and counts since boot.          |
+    |   Arguments:  void                                                                    |
+    |   Returns:    StoreForwardStatus                                                      |
+    \*-------------------------------------------------------------------------------------*/
+    StoreForwardStatus getStoreForwardStatus(void);
+
+#endif /* INC_STOREFORWARD_H_ */
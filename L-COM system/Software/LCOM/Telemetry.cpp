@@ -0,0 +1,141 @@
+#include "Telemetry.h"
+#include "PacketArena.h"
+#include "RadioController.h"
+#include "SerialInterface.h"
+#include "StoreForward.h"
+
+
+/*-------------------------------------------------------------------------*\
+|								  Layout checks				   			    |
+\*-------------------------------------------------------------------------*/
+
+
+    static_assert(TELEMETRY_RECORD_HEADER_LEN + TELEMETRY_MAX_RECORD_LEN + AIR_HEADER_LEN + HOP_HEADER_LEN <= MAX_LORA_MESSAGE_SIZE, "A telemetry record must fit in one frame");
+
+
+/*-------------------------------------------------------------------------*\
+|								   Variables					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    uint8_t telemetryDestination = TELEMETRY_OFF;
+    uint8_t telemetryBlock = ARENA_NONE;                    // Block of the record being built
+    uint8_t telemetryStretch = 1;
+    uint8_t telemetrySkipped[TELEMETRY_RECORD_TYPES];       // Records of each type skipped since one was sent
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       setTelemetryDestination                                                 |
+    |   Purpose:    Sets where telemetry records go, or TELEMETRY_OFF to drop them.         |
+    |   Arguments:  uint8_t                                                                 |
+    |   Returns:    int16_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t setTelemetryDestination(uint8_t destination){
+        if(destination > TELEMETRY_RADIO) return TELEMETRY_INVALID_DESTINATION;
+
+        telemetryDestination = destination;
+        return TELEMETRY_OK;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getTelemetryDestination                                                 |
+    |   Purpose:    Returns where telemetry records go.                                     |
+    |   Arguments:  void                                                                    |
+    |   Returns:    uint8_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    uint8_t getTelemetryDestination(void){
+        return telemetryDestination;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       setTelemetryStretch                                                     |
+    |   Purpose:    Sends only one radio record of each type in every stretch, 1 sending    |
+    |               them all. Telemetry to the UART is never stretched.                     |
+    |   Arguments:  uint8_t                                                                 |
+    |   Returns:    int16_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t setTelemetryStretch(uint8_t stretch){
+        if(stretch == 0 || stretch > TELEMETRY_MAX_STRETCH) return TELEMETRY_INVALID_STRETCH;
+
+        telemetryStretch = stretch;
+        return TELEMETRY_OK;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       telemetryRecordDue                                                      |
+    |   Purpose:    Returns whether a record of the given type should be sent, counting     |
+    |               the ones the stretch skips. Asked before beginTelemetryRecord; it stays |
+    |               due until a record of the type is sent.                                 |
+    |   Arguments:  uint8_t                                                                 |
+    |   Returns:    bool                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    bool telemetryRecordDue(uint8_t type){
+        if(telemetryDestination != TELEMETRY_RADIO) return true;
+
+        /* The first record after a lowered stretch goes straight out */
+        if(telemetrySkipped[type] + 1 >= telemetryStretch) return true;
+        telemetrySkipped[type]++;
+        return false;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       beginTelemetryRecord                                                    |
+    |   Purpose:    Takes an arena block for a record of the given type and returns where   |
+    |               its contents go, up to TELEMETRY_MAX_RECORD_LEN bytes. Every record     |
+    |               begun must be sent.                                                     |
+    |   Arguments:  uint8_t                                                                 |
+    |   Returns:    uint8_t* (NULL if telemetry is off or no block is free)                 |
+    \*-------------------------------------------------------------------------------------*/
+    uint8_t* beginTelemetryRecord(uint8_t type){
+        if(telemetryDestination == TELEMETRY_OFF) return NULL;
+
+        telemetryBlock = acquireBlock(ARENA_OWNER_TELEMETRY);
+        if(telemetryBlock == ARENA_NONE){
+            PERF_COUNT(PERF_ARENA_DROPS);
+            return NULL;
+        }
+
+        uint8_t* record = getBlock(telemetryBlock) + ARENA_TELEMETRY_OFFSET;
+        record[0] = type;
+        return record + TELEMETRY_RECORD_HEADER_LEN;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       sendTelemetryRecord                                                     |
+    |   Purpose:    Sends the record begun last, with the given content length, and         |
+    |               returns its block.                                                      |
+    |   Arguments:  uint16_t                                                                |
+    |   Returns:    int16_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t sendTelemetryRecord(uint16_t len){
+        uint8_t* record = getBlock(telemetryBlock) + ARENA_TELEMETRY_OFFSET;
+        len += TELEMETRY_RECORD_HEADER_LEN;
+        telemetrySkipped[record[0]] = 0;
+
+        /* The headers go in front of the record, in the same block */
+        int16_t res = TELEMETRY_OK;
+        if(telemetryDestination == TELEMETRY_RADIO){
+            /* Kept for later while the link is down, not sent into the void */
+            if(storeTelemetryRecord(record, len)){
+                releaseBlock(telemetryBlock);
+                telemetryBlock = ARENA_NONE;
+                return TELEMETRY_OK;
+            }
+            handoffBlock(telemetryBlock, ARENA_OWNER_RADIO_TX);
+            res = transmitRadio(record, len, AIR_FRAME_TELEMETRY);
+        }
+        else{
+            handoffBlock(telemetryBlock, ARENA_OWNER_UART_TX);
+            createMessagePacket(TELEMETRY_RECORD, 0, 0, record, len);
+            writeSerialPacket();
+        }
+
+        releaseBlock(telemetryBlock);
+        telemetryBlock = ARENA_NONE;
+        return res;
+    }
@@ -0,0 +1,103 @@
+#ifndef INC_TELEMETRY_H_
+#define INC_TELEMETRY_H_
+
+#include <Arduino.h>
+
+
+/*-------------------------------------------------------------------------*\
+|								  Definitions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*
+     * Telemetry is what the module produces itself (IMU data, etc.), one record per frame: a record type
+     * byte, then the record. To the UART it goes as a message packet with result TELEMETRY_RECORD and no
+     * signal, over the air as an AIR_FRAME_TELEMETRY frame that the receiving module passes up the same
+     * way, so the host handles local and remote telemetry alike.
+     */
+
+    /* Destinations */
+    #define TELEMETRY_OFF                   0x00
+    #define TELEMETRY_UART                  0x01
+    #define TELEMETRY_RADIO                 0x02
+
+    /* Records */
+    #define TELEMETRY_RECORD_HEADER_LEN     1                       // Record type
+    #define TELEMETRY_MAX_RECORD_LEN        249                     // What a hopping frame has room for after the record type
+    #define TELEMETRY_IMU_BATCH             0x01                    // IMU_BATCH_SCHEMA, then IMU_SAMPLE_SCHEMA per sample
+    #define TELEMETRY_IMU_SUMMARY           0x02                    // IMU_SUMMARY_SCHEMA, then the fields it selects
+    #define TELEMETRY_GPS_FIX               0x03                    // GPS_FIX_SCHEMA
+    #define TELEMETRY_POWER                 0x04                    // POWER_STATUS_SCHEMA
+    #define TELEMETRY_STORED                0x05                    // STORED_RECORD_SCHEMA, then the stored record from its type on
+    #define TELEMETRY_RECORD_TYPES          6                       // Record types are below this
+
+    /* Stretching, radio telemetry sends one record of each type in every so many */
+    #define TELEMETRY_MAX_STRETCH           16
+
+    /* Status codes */
+    #define TELEMETRY_OK                    0x0000
+    #define TELEMETRY_RECORD                0x0700                  // Message packet result, the data is a telemetry record
+    #define TELEMETRY_INVALID_DESTINATION   0x0701
+    #define TELEMETRY_INVALID_STRETCH       0x0702
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       setTelemetryDestination                                                 |
+    |   Purpose:    Sets where telemetry records go, or TELEMETRY_OFF to drop them.         |
+    |   Arguments:  uint8_t                                                                 |
+    |   Returns:    int16_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t setTelemetryDestination(uint8_t destination);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getTelemetryDestination                                                 |
+    |   Purpose:    Returns where telemetry records go.                                     |
+    |   Arguments:  void                                                                    |
+    |   Returns:    uint8_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    uint8_t getTelemetryDestination(void);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       setTelemetryStretch                                                     |
+    |   Purpose:    Sends only one radio record of each type in every stretch, 1 sending    |
+    |               them all. Telemetry to the UART is never stretched.                     |
+    |   Arguments:  uint8_t                                                                 |
+    |   Returns:    int16_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t setTelemetryStretch(uint8_t stretch);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       telemetryRecordDue                                                      |
+    |   Purpose:    Returns whether a record of the given type should be sent, counting     |
+    |               the ones the stretch skips. Asked before beginTelemetryRecord; it stays |
+    |               due until a record of the type is sent.                                 |
+    |   Arguments:  uint8_t                                                                 |
+    |   Returns:    bool                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    bool telemetryRecordDue(uint8_t type);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       beginTelemetryRecord                                                    |
+    |   Purpose:    Takes an arena block for a record of the given type and returns where   |
+    |               its contents go, up to TELEMETRY_MAX_RECORD_LEN bytes. Every record     |
+    |               begun must be sent.                                                     |
+    |   Arguments:  uint8_t                                                                 |
+    |   Returns:    uint8_t* (NULL if telemetry is off or no block is free)                 |
+    \*-------------------------------------------------------------------------------------*/
+    uint8_t* beginTelemetryRecord(uint8_t type);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       sendTelemetryRecord                                                     |
+    |   Purpose:    Sends the record begun last, with the given content length, and         |
+    |               returns its block.                                                      |
+    |   Arguments:  uint16_t                                                                |
+    |   Returns:    int16_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t sendTelemetryRecord(uint16_t len);
+
+#endif /* INC_TELEMETRY_H_ */
@@ -0,0 +1,88 @@
+#include "Thermistor.h"
+#include "ThermistorTable.h"
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+
+
+/*-------------------------------------------------------------------------*\
+|								   Variables					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /* Written only by the ADC interrupt once initializeThermistor has run */
+    uint16_t adcSum = 0;                                    // Samples summed since the last filter update
+    uint8_t adcSamples = 0;
+    volatile uint32_t thermistorFilter = 0;                 // Oversampled reading (1/16 ADC counts) scaled by 2^THERMISTOR_FILTER_SHIFT
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       ADC_vect                                                                |
+    |   Purpose:    Sums THERMISTOR_OVERSAMPLE conversions and folds each sum into the      |
+    |               IIR filter, all in integers.                                            |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    ISR(ADC_vect){
+        adcSum += ADC;
+        if(++adcSamples < THERMISTOR_OVERSAMPLE) return;
+
+        uint32_t filter = thermistorFilter;
+        thermistorFilter = filter - (filter >> THERMISTOR_FILTER_SHIFT) + adcSum;
+        adcSum = 0;
+        adcSamples = 0;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       initializeThermistor                                                    |
+    |   Purpose:    Seeds the filter from one conversion, then leaves the ADC sampling the  |
+    |               thermistor in the background.                                           |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void initializeThermistor(void){
+        // AVcc reference, same as analogRead's default
+        ADMUX = _BV(REFS0) | THERMISTOR_ADC_CHANNEL;
+        DIDR0 |= _BV(THERMISTOR_ADC_CHANNEL);
+
+        // One blocking conversion, so the first status request doesn't read a filter still climbing from zero
+        ADCSRA = _BV(ADEN) | _BV(ADSC) | _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0);
+        while(ADCSRA & _BV(ADSC));
+        noInterrupts();
+        thermistorFilter = ((uint32_t)ADC * THERMISTOR_OVERSAMPLE) << THERMISTOR_FILTER_SHIFT;
+        adcSum = 0;
+        adcSamples = 0;
+        interrupts();
+
+        // From here on each Timer0 overflow starts a conversion and its interrupt collects it
+        ADCSRB = _BV(ADTS2);
+        ADCSRA = _BV(ADEN) | _BV(ADATE) | _BV(ADIE) | _BV(ADIF) | _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0);
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getModuleTemperature                                                    |
+    |   Purpose:    Returns the filtered temperature of the thermistor on the module,       |
+    |               converted through the lookup table. Never waits on the ADC.             |
+    |   Arguments:  void                                                                    |
+    |   Returns:    int16_t (0.01 degrees C)                                                |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t getModuleTemperature(void){
+        noInterrupts();
+        uint32_t filter = thermistorFilter;
+        interrupts();
+
+        // Table entry below the reading, then linear interpolation across the remaining bits
+        uint16_t reading = filter >> THERMISTOR_FILTER_SHIFT;
+        uint8_t index = reading >> THERMISTOR_TABLE_SHIFT;
+
+        // The last entry is the int16 clamp for a divider near short, not a temperature, so the top bin reads as its floor
+        if(index >= THERMISTOR_TABLE_LEN - 2) return (int16_t)pgm_read_word(&thermistorTable[THERMISTOR_TABLE_LEN - 2]);
+        uint8_t fraction = reading & ((1 << THERMISTOR_TABLE_SHIFT) - 1);
+        int16_t T0 = (int16_t)pgm_read_word(&thermistorTable[index]);
+        int16_t T1 = (int16_t)pgm_read_word(&thermistorTable[index + 1]);
+        return T0 + (int16_t)(((int32_t)(T1 - T0) * fraction) >> THERMISTOR_TABLE_SHIFT);
+    }
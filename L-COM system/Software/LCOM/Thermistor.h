@@ -0,0 +1,57 @@
+#ifndef INC_THERMISTOR_H_
+#define INC_THERMISTOR_H_
+
+#include <Arduino.h>
+
+
+/*-------------------------------------------------------------------------*\
+|								  Definitions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /* Thermistor divider and Steinhart-Hart coefficients, Generate_thermistor_table.py reads these */
+    #define THERMISTOR_PIN                  A0
+    #define ANALOG_MAX_VALUE                1023.0
+    #define KELVIN_CELCIUS_DIFFERENCE       273.15
+    #define R2_OHM                          10000               // Ohms
+    #define C1                              1.009249522e-03
+    #define C2                              2.378405444e-04
+    #define C3                              2.019202697e-07
+
+    /*
+     * Once initializeThermistor has run the ADC belongs to the thermistor, started by every Timer0 overflow
+     * (~488 Hz at 8 MHz, the millis() tick every 2.048 ms) rather than free-running at ~4.8 kHz, which would
+     * cost ten times the interrupts for nothing. Don't call analogRead after that.
+     */
+    #define THERMISTOR_ADC_CHANNEL          0                   // ADC0 is A0
+    #define THERMISTOR_OVERSAMPLE           16                  // Samples summed per filter update, 10 bits in, 14 bits out (~30 Hz)
+    #define THERMISTOR_FILTER_SHIFT         4                   // IIR weight of each update, 1/16 (~0.52 s time constant)
+
+    /* Lookup table, see ThermistorTable.h, one entry every 2^THERMISTOR_TABLE_SHIFT filtered counts */
+    #define THERMISTOR_TABLE_SHIFT          8                   // Every 16 ADC counts
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       initializeThermistor                                                    |
+    |   Purpose:    Seeds the filter from one conversion, then leaves the ADC sampling the  |
+    |               thermistor in the background.                                           |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void initializeThermistor(void);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getModuleTemperature                                                    |
+    |   Purpose:    Returns the filtered temperature of the thermistor on the module,       |
+    |               converted through the lookup table. Never waits on the ADC.             |
+    |   Arguments:  void                                                                    |
+    |   Returns:    int16_t (0.01 degrees C)                                                |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t getModuleTemperature(void);
+
+#endif /* INC_THERMISTOR_H_ */
@@ -0,0 +1,27 @@
+/*
+*   Generated by Generate_thermistor_table.py from Thermistor.h, do not edit
+*/
+
+#ifndef INC_THERMISTORTABLE_H_
+#define INC_THERMISTORTABLE_H_
+
+#include <Arduino.h>
+#include <avr/pgmspace.h>
+
+
+    /* Temperature (0.01 degrees C) every 16 ADC counts, from 0 to 1024, only include from Thermistor.cpp */
+    #define THERMISTOR_TABLE_LEN            65
+
+    const int16_t thermistorTable[THERMISTOR_TABLE_LEN] PROGMEM = {
+         -9762,  -5882,  -4713,  -3976,  -3423,  -2973,  -2590,  -2254,
+         -1952,  -1676,  -1421,  -1182,   -957,   -744,   -540,   -344,
+          -156,     27,    206,    379,    550,    717,    881,   1044,
+          1205,   1364,   1523,   1681,   1838,   1996,   2154,   2313,
+          2473,   2634,   2797,   2962,   3130,   3300,   3474,   3651,
+          3832,   4019,   4210,   4408,   4613,   4826,   5047,   5279,
+          5523,   5781,   6054,   6345,   6659,   6999,   7371,   7782,
+          8243,   8769,   9382,  10119,  11041,  12273,  14113,  17642,
+         32767
+    };
+
+#endif /* INC_THERMISTORTABLE_H_ */
@@ -0,0 +1,172 @@
+#include "TimeSync.h"
+#include "Gps.h"
+#include "RadioController.h"
+
+
+/*-------------------------------------------------------------------------*\
+|								   Variables					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    uint8_t timeSyncMode = TIME_SYNC_OFF;
+    uint16_t timeSyncPeriod = TIME_SYNC_DEFAULT_PERIOD;
+
+    /* Beacon buffer, with the headroom transmitRadio builds the air headers in */
+    uint8_t beaconBuffer[RADIO_TX_HEADROOM + TIME_BEACON_LEN];
+    uint32_t lastBeaconTime = 0;
+    bool beaconSeen = false;
+
+    /* Statistics */
+    uint16_t beaconsSent = 0;
+    uint16_t beaconsReceived = 0;
+    int32_t lastOffset = 0;
+    uint32_t meanAbsOffset = 0;                 // ms, scaled by 8 for the running average
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       configureTimeSync                                                       |
+    |   Purpose:    Sets the time sync mode and beacon period (s), and resets statistics.   |
+    |   Arguments:  uint8_t, uint16_t                                                       |
+    |   Returns:    int16_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t configureTimeSync(uint8_t mode, uint16_t period){
+        if(mode > TIME_SYNC_SLAVE || period == 0) return TIME_SYNC_INVALID_MODE;
+
+        timeSyncMode = mode;
+        timeSyncPeriod = period;
+        beaconSeen = false;
+        beaconsSent = beaconsReceived = 0;
+        lastOffset = 0;
+        meanAbsOffset = 0;
+
+        /* A master sends its first beacon straight away */
+        lastBeaconTime = millis() - (uint32_t)period*1000;
+        return ERR_NONE;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getTimeSyncMode                                                         |
+    |   Purpose:    Returns the time sync mode.                                             |
+    |   Returns:    uint8_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    uint8_t getTimeSyncMode(void){
+        return timeSyncMode;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getTimeSyncPeriod                                                       |
+    |   Purpose:    Returns the beacon period (s).                                          |
+    |   Returns:    uint16_t                                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint16_t getTimeSyncPeriod(void){
+        return timeSyncPeriod;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       serviceTimeSync                                                         |
+    |   Purpose:    Sends a beacon when one is due. Call from the main loop.                |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void serviceTimeSync(void){
+        /* A slave keeps the GPS receiver's interrupts away from DIO1 while a beacon may arrive, missed ones too */
+        if(timeSyncMode == TIME_SYNC_SLAVE && beaconSeen){
+            uint32_t phase = (millis() - lastBeaconTime + TIME_SYNC_GPS_GUARD) % ((uint32_t)timeSyncPeriod*1000);
+            if(phase < 2*TIME_SYNC_GPS_GUARD) quietGps(2*TIME_SYNC_GPS_GUARD - phase);
+        }
+
+        /* Only a master with a host-set clock has anything to give out */
+        if(timeSyncMode != TIME_SYNC_MASTER || !getUnixSet()) return;
+        if((millis() - lastBeaconTime) < (uint32_t)timeSyncPeriod*1000) return;
+        lastBeaconTime = millis();
+
+        /* The time itself is written by transmitRadio, just before the frame goes out */
+        int16_t res = transmitRadio(beaconBuffer + RADIO_TX_HEADROOM, TIME_BEACON_LEN, AIR_FRAME_TIME_BEACON);
+        if(res == ERR_NONE) beaconsSent++;
+        else Log(F("[Time sync] Beacon not sent"), res);
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       stampTimeBeacon                                                         |
+    |   Purpose:    Writes the current time into a beacon. Called by transmitRadio as late  |
+    |               as possible, after retuning and listen-before-talk.                     |
+    |   Arguments:  uint8_t*                                                                |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void stampTimeBeacon(uint8_t* buf){
+        uint32_t timestamp;
+        uint16_t milliseconds;
+        getUnixTimeMs(&timestamp, &milliseconds);
+
+        buf[0] = (timestamp & 0xFF000000) >> 24;
+        buf[1] = (timestamp & 0x00FF0000) >> 16;
+        buf[2] = (timestamp & 0x0000FF00) >> 8;
+        buf[3] = (timestamp & 0x000000FF);
+        buf[4] = (milliseconds & 0xFF00) >> 8;
+        buf[5] = (milliseconds & 0x00FF);
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       handleTimeBeacon                                                        |
+    |   Purpose:    Disciplines the clock from a received beacon. delay is the time (us)    |
+    |               from the sender's stamp to now: time-on-air, fixed latency, and how     |
+    |               long ago DIO1 captured the reception.                                   |
+    |   Arguments:  const uint8_t*, uint16_t, uint32_t                                      |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void handleTimeBeacon(const uint8_t* buf, uint16_t len, uint32_t delay){
+        if(timeSyncMode != TIME_SYNC_SLAVE || len != TIME_BEACON_LEN) return;
+
+        /* The sender's time now, rounded to the millisecond */
+        uint32_t timestamp = extract_uint32_t(buf, 0);
+        uint32_t milliseconds = extract_uint16_t(buf, 4) + (delay + 500)/1000;
+        timestamp += milliseconds / 1000;
+        milliseconds %= 1000;
+
+        /* How far this clock had wandered since the last beacon, the first one only sets it */
+        if(beaconSeen){
+            uint32_t localTimestamp;
+            uint16_t localMilliseconds;
+            getUnixTimeMs(&localTimestamp, &localMilliseconds);
+            int32_t seconds = (int32_t)(timestamp - localTimestamp);
+            if(seconds > 2000000L) lastOffset = INT32_MAX;
+            else if(seconds < -2000000L) lastOffset = INT32_MIN;
+            else lastOffset = seconds*1000L + ((int32_t)milliseconds - localMilliseconds);
+
+            uint32_t absOffset = (lastOffset < 0) ? -(uint32_t)lastOffset : (uint32_t)lastOffset;
+            if(absOffset > 0xFFFF) absOffset = 0xFFFF;
+            meanAbsOffset += (int32_t)(absOffset*8 - meanAbsOffset) / 8;
+        }
+
+        /* Discipline the clock, successive beacons also feed its drift estimate */
+        syncUnixTime(timestamp, milliseconds);
+        beaconSeen = true;
+        beaconsReceived++;
+        lastBeaconTime = millis();
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getTimeSyncStatus                                                       |
+    |   Purpose:    Returns the time sync state and statistics.                             |
+    |   Arguments:  void                                                                    |
+    |   Returns:    TimeSyncStatus                                                          |
+    \*-------------------------------------------------------------------------------------*/
+    TimeSyncStatus getTimeSyncStatus(void){
+        TimeSyncStatus status;
+        status.sinceBeacon = (beaconSeen || beaconsSent) ? (millis() - lastBeaconTime) : 0xFFFFFFFF;
+        status.synced = (timeSyncMode == TIME_SYNC_SLAVE) ? (beaconSeen && status.sinceBeacon < (uint32_t)timeSyncPeriod*1000*TIME_SYNC_LOST_PERIODS)
+                                                          : (timeSyncMode == TIME_SYNC_MASTER && getUnixSet());
+        status.mode = timeSyncMode;
+        status.period = timeSyncPeriod;
+        status.beaconsSent = beaconsSent;
+        status.beaconsReceived = beaconsReceived;
+        status.lastOffset = lastOffset;
+        status.meanOffset = meanAbsOffset / 8;
+        status.drift = getClockDrift();
+        return status;
+    }
@@ -0,0 +1,101 @@
+#ifndef INC_TIMESYNC_H_
+#define INC_TIMESYNC_H_
+
+#include <Arduino.h>
+#include "Schemas.h"
+#include "Utility.h"
+
+
+/*-------------------------------------------------------------------------*\
+|								  Definitions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /* Modes */
+    #define TIME_SYNC_OFF                   0x00
+    #define TIME_SYNC_MASTER                0x01                    // Broadcasts beacons from the host-set clock (ground)
+    #define TIME_SYNC_SLAVE                 0x02                    // Disciplines its clock from received beacons (balloon)
+
+    /* Beacons */
+    #define TIME_BEACON_LEN                 6                       // UNIX time (4), milliseconds (2)
+    #define TIME_SYNC_DEFAULT_PERIOD        10                      // s between beacons
+    #define TIME_SYNC_LOST_PERIODS          3                       // Missed beacons before a slave reports itself unsynchronized
+
+    /*
+     * Time from the sender's timestamp to the receiver's DIO1 capture that isn't time-on-air: the SPI
+     * buffer write and TX ramp on the sender, and RxDone processing on the receiver. Beacons are a fixed
+     * size, so this is a constant. Measure it once per hardware build by looping a beacon back.
+     */
+    #define TIME_SYNC_FIXED_LATENCY         600                     // us
+
+    /* A slave stops listening to the GPS receiver this long either side of when a beacon is due, a
+     * beacon is sent on a 100 ms task and read on another, and this covers both */
+    #define TIME_SYNC_GPS_GUARD             250                     // ms
+
+    /* Status codes */
+    #define TIME_SYNC_INVALID_MODE          0x0500
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       configureTimeSync                                                       |
+    |   Purpose:    Sets the time sync mode and beacon period (s), and resets statistics.   |
+    |   Arguments:  uint8_t, uint16_t                                                       |
+    |   Returns:    int16_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t configureTimeSync(uint8_t mode, uint16_t period);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getTimeSyncMode                                                         |
+    |   Purpose:    Returns the time sync mode.                                             |
+    |   Returns:    uint8_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    uint8_t getTimeSyncMode(void);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getTimeSyncPeriod                                                       |
+    |   Purpose:    Returns the beacon period (s).                                          |
+    |   Returns:    uint16_t                                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint16_t getTimeSyncPeriod(void);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       serviceTimeSync                                                         |
+    |   Purpose:    Sends a beacon when one is due. Call from the main loop.                |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void serviceTimeSync(void);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       stampTimeBeacon                                                         |
+    |   Purpose:    Writes the current time into a beacon. Called by transmitRadio as late  |
+    |               as possible, after retuning and listen-before-talk.                     |
+    |   Arguments:  uint8_t*                                                                |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void stampTimeBeacon(uint8_t* buf);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       handleTimeBeacon                                                        |
+    |   Purpose:    Disciplines the clock from a received beacon. delay is the time (us)    |
+    |               from the sender's stamp to now: time-on-air, fixed latency, and how     |
+    |               long ago DIO1 captured the reception.                                   |
+    |   Arguments:  const uint8_t*, uint16_t, uint32_t                                      |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void handleTimeBeacon(const uint8_t* buf, uint16_t len, uint32_t delay);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getTimeSyncStatus                                                       |
+    |   Purpose:    Returns the time sync state and statistics.                             |
+    |   Arguments:  void                                                                    |
+    |   Returns:    TimeSyncStatus                                                          |
+    \*-------------------------------------------------------------------------------------*/
+    TimeSyncStatus getTimeSyncStatus(void);
+
+#endif /* INC_TIMESYNC_H_ */
@@ -0,0 +1,128 @@
+#include "Trace.h"
+
+
+/*-------------------------------------------------------------------------*\
+|								   Variables					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    bool traceEnabled = false;
+    uint32_t traceMarks[TRACE_MARK_COUNT];
+
+    /* The last traced frame received */
+    bool tracePending = false;
+    uint8_t traceHeader[TRACE_HEADER_LEN];
+    uint16_t traceFrameLength = 0;
+    uint32_t traceTimeOnAir = 0;
+    uint32_t tracePollWait = 0;
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       setTraceEnabled                                                         |
+    |   Purpose:    Sets whether outgoing messages are sent as traced frames.               |
+    |   Arguments:  bool                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void setTraceEnabled(bool enable){
+        traceEnabled = enable;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getTraceEnabled                                                         |
+    |   Purpose:    Returns whether outgoing messages are sent as traced frames.            |
+    |   Returns:    bool                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    bool getTraceEnabled(void){
+        return traceEnabled;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       traceMark                                                               |
+    |   Purpose:    Records the time a message passed one of the TRACE_MARK_* points.       |
+    |   Arguments:  uint8_t                                                                 |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void traceMark(uint8_t mark){
+        traceMarks[mark] = micros();
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       writeTraceHeader                                                        |
+    |   Purpose:    Writes the sender's stage times into a traced frame. Called by          |
+    |               transmitRadio just before the frame goes out.                           |
+    |   Arguments:  uint8_t*                                                                |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void writeTraceHeader(uint8_t* buf){
+        uint32_t stages[3] = {
+            traceMarks[TRACE_MARK_PACKET_COMPLETE] - traceMarks[TRACE_MARK_UART_START],
+            traceMarks[TRACE_MARK_TRANSMIT_ENTRY] - traceMarks[TRACE_MARK_PACKET_COMPLETE],
+            micros() - traceMarks[TRACE_MARK_TRANSMIT_ENTRY]
+        };
+        for(uint8_t i = 0; i != 3; i++){
+            buf[i*4]   = (stages[i] & 0xFF000000) >> 24;
+            buf[i*4+1] = (stages[i] & 0x00FF0000) >> 16;
+            buf[i*4+2] = (stages[i] & 0x0000FF00) >> 8;
+            buf[i*4+3] = (stages[i] & 0x000000FF);
+        }
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       readTraceHeader                                                         |
+    |   Purpose:    Takes the sender's stage times from a received traced frame, with the   |
+    |               frame's time-on-air (us) and the micros() DIO1 fired at.                |
+    |   Arguments:  const uint8_t*, uint16_t, uint32_t, uint32_t                            |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void readTraceHeader(const uint8_t* buf, uint16_t frameLength, uint32_t timeOnAir, uint32_t receiveMicros){
+        memcpy(traceHeader, buf, TRACE_HEADER_LEN);
+        traceFrameLength = frameLength;
+        traceTimeOnAir = timeOnAir;
+        tracePollWait = traceMarks[TRACE_MARK_RADIO_READ] - receiveMicros;
+        tracePending = true;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getTracePending                                                         |
+    |   Purpose:    Returns whether a traced frame is waiting for its trace record.         |
+    |   Returns:    bool                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    bool getTracePending(void){
+        return tracePending;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getTraceRecord                                                          |
+    |   Purpose:    Writes the trace record for the last traced frame. Call once its        |
+    |               message packet has been written out.                                    |
+    |   Arguments:  uint8_t*                                                                |
+    |   Returns:    uint16_t (bytes written)                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint16_t getTraceRecord(uint8_t* buf){
+        uint32_t now = micros();
+        memcpy(buf, traceHeader, TRACE_HEADER_LEN);
+
+        uint32_t stages[4] = {
+            traceTimeOnAir,
+            tracePollWait,
+            traceMarks[TRACE_MARK_UART_TX_START] - traceMarks[TRACE_MARK_RADIO_READ],
+            now - traceMarks[TRACE_MARK_UART_TX_START]
+        };
+        uint16_t pos = TRACE_HEADER_LEN;
+        for(uint8_t i = 0; i != 4; i++){
+            buf[pos++] = (stages[i] & 0xFF000000) >> 24;
+            buf[pos++] = (stages[i] & 0x00FF0000) >> 16;
+            buf[pos++] = (stages[i] & 0x0000FF00) >> 8;
+            buf[pos++] = (stages[i] & 0x000000FF);
+        }
+        buf[pos++] = (traceFrameLength & 0xFF00) >> 8;
+        buf[pos++] = (traceFrameLength & 0x00FF);
+
+        tracePending = false;
+        return pos;
+    }
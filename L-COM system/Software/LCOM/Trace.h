@@ -0,0 +1,101 @@
+#ifndef INC_TRACE_H_
+#define INC_TRACE_H_
+
+#include <Arduino.h>
+
+
+/*-------------------------------------------------------------------------*\
+|								  Definitions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    #define TRACE_HEADER_LEN                12                      // Sender stages carried in a traced air frame
+    #define TRACE_RECORD_LEN                30                      // Payload of a trace serial packet
+
+    /* Marks, each one is the micros() a message passed a point */
+    #define TRACE_MARK_UART_START           0                       // Sender: start flag read
+    #define TRACE_MARK_PACKET_COMPLETE      1                       // Sender: packet verified
+    #define TRACE_MARK_TRANSMIT_ENTRY       2                       // Sender: transmitRadio called
+    #define TRACE_MARK_RADIO_READ           3                       // Receiver: frame read out of the radio
+    #define TRACE_MARK_UART_TX_START        4                       // Receiver: message packet write started
+    #define TRACE_MARK_COUNT                5
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       setTraceEnabled                                                         |
+    |   Purpose:    Sets whether outgoing messages are sent as traced frames.               |
+    |   Arguments:  bool                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void setTraceEnabled(bool enable);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getTraceEnabled                                                         |
+    |   Purpose:    Returns whether outgoing messages are sent as traced frames.            |
+    |   Returns:    bool                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    bool getTraceEnabled(void);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       traceMark                                                               |
+    |   Purpose:    Records the time a message passed one of the TRACE_MARK_* points.       |
+    |   Arguments:  uint8_t                                                                 |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void traceMark(uint8_t mark);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       writeTraceHeader                                                        |
+    |   Purpose:    Writes the sender's stage times into a traced frame. Called by          |
+    |               transmitRadio just before the frame goes out.                           |
+    |               Bytes               Field                                               |
+    |               -------------------------------------------                             |
+    |               0-3                 UART receive (us, start flag to verified packet)    |
+    |               4-7                 Dispatch (us, verified packet to transmitRadio)     |
+    |               8-11                Channel access (us, retune and listen-before-talk)  |
+    |   Arguments:  uint8_t*                                                                |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void writeTraceHeader(uint8_t* buf);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       readTraceHeader                                                         |
+    |   Purpose:    Takes the sender's stage times from a received traced frame, with the   |
+    |               frame's time-on-air (us) and the micros() DIO1 fired at.                |
+    |   Arguments:  const uint8_t*, uint16_t, uint32_t, uint32_t                            |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void readTraceHeader(const uint8_t* buf, uint16_t frameLength, uint32_t timeOnAir, uint32_t receiveMicros);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getTracePending                                                         |
+    |   Purpose:    Returns whether a traced frame is waiting for its trace record.         |
+    |   Returns:    bool                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    bool getTracePending(void);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getTraceRecord                                                          |
+    |   Purpose:    Writes the trace record for the last traced frame. Call once its        |
+    |               message packet has been written out.                                    |
+    |               Bytes               Field                                               |
+    |               -------------------------------------------                             |
+    |               0-3                 UART receive (us, sender)                           |
+    |               4-7                 Dispatch (us, sender)                               |
+    |               8-11                Channel access (us, sender)                         |
+    |               12-15               Time-on-air (us, computed)                          |
+    |               16-19               Poll wait (us, receiver, DIO1 to radio read)        |
+    |               20-23               Processing (us, receiver, radio read to UART)       |
+    |               24-27               UART transmit (us, receiver, message packet write)  |
+    |               28-29               Frame length                                        |
+    |   Arguments:  uint8_t*                                                                |
+    |   Returns:    uint16_t (bytes written)                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint16_t getTraceRecord(uint8_t* buf);
+
+#endif /* INC_TRACE_H_ */
@@ -0,0 +1,235 @@
+#include "Twi.h"
+#include "Utility.h"
+#include <avr/interrupt.h>
+#include <util/twi.h>
+
+
+/*-------------------------------------------------------------------------*\
+|								   Variables					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /* TWCR values, every one but TWI_STOP and TWI_RELEASE keeps the interrupt on */
+    #define TWI_CONTINUE            (_BV(TWINT) | _BV(TWEN) | _BV(TWIE))
+    #define TWI_ACK                 (TWI_CONTINUE | _BV(TWEA))
+    #define TWI_START               (TWI_CONTINUE | _BV(TWSTA))
+    #define TWI_STOP                (_BV(TWINT) | _BV(TWEN) | _BV(TWSTO))
+    #define TWI_RELEASE             (_BV(TWINT) | _BV(TWEN))
+
+    /* Written by the TWI interrupt while a transfer is on the bus */
+    TwiTransfer* volatile twiCurrent = NULL;
+    volatile uint8_t twiIndex = 0;                          // Next byte to write or read
+    volatile bool twiReading = false;
+    uint32_t twiStartMillis = 0;
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       finishTwiTransfer                                                       |
+    |   Purpose:    Ends the transfer on the bus with a result, and frees the bus.          |
+    |   Arguments:  int16_t, uint8_t (TWCR)                                                 |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void finishTwiTransfer(int16_t result, uint8_t control){
+        TWCR = control;
+        twiCurrent->result = result;
+        twiCurrent = NULL;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       TWI_vect                                                                |
+    |   Purpose:    Moves the transfer on the bus along by one step.                        |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    ISR(TWI_vect){
+        TwiTransfer* t = twiCurrent;
+        if(t == NULL){
+            TWCR = TWI_RELEASE;
+            return;
+        }
+
+        switch(TW_STATUS){
+            /* Address, writing first unless there's nothing to write */
+            case TW_START:
+            case TW_REP_START:
+                TWDR = (t->address << 1) | (twiReading ? TW_READ : TW_WRITE);
+                TWCR = TWI_CONTINUE;
+                break;
+
+            /* Writing, then a repeated start to read if there's anything to read */
+            case TW_MT_SLA_ACK:
+            case TW_MT_DATA_ACK:
+                if(twiIndex < t->txLen){
+                    TWDR = t->txBuf[twiIndex++];
+                    TWCR = TWI_CONTINUE;
+                }
+                else if(t->rxLen != 0){
+                    twiReading = true;
+                    twiIndex = 0;
+                    TWCR = TWI_START;
+                }
+                else finishTwiTransfer(TWI_OK, TWI_STOP);
+                break;
+
+            /* Reading, the last byte is NACKed */
+            case TW_MR_SLA_ACK:
+                TWCR = (t->rxLen > 1) ? TWI_ACK : TWI_CONTINUE;
+                break;
+            case TW_MR_DATA_ACK:
+                t->rxBuf[twiIndex++] = TWDR;
+                TWCR = (twiIndex < t->rxLen - 1) ? TWI_ACK : TWI_CONTINUE;
+                break;
+            case TW_MR_DATA_NACK:
+                t->rxBuf[twiIndex++] = TWDR;
+                finishTwiTransfer(TWI_OK, TWI_STOP);
+                break;
+
+            case TW_MT_SLA_NACK:
+            case TW_MR_SLA_NACK:
+                finishTwiTransfer(TWI_ADDRESS_NACK, TWI_STOP);
+                break;
+            case TW_MT_DATA_NACK:
+                finishTwiTransfer(TWI_DATA_NACK, TWI_STOP);
+                break;
+            case TW_MT_ARB_LOST:
+                finishTwiTransfer(TWI_BUS_ERROR, TWI_RELEASE);
+                break;
+            default:
+                finishTwiTransfer(TWI_BUS_ERROR, TWI_STOP);
+                break;
+        }
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       driveTwiPin                                                             |
+    |   Purpose:    Pulls a bus line low, or lets the pull-up take it high, as the TWI does |
+    |               it. The pin is never driven high, a slave may be holding it low.        |
+    |   Arguments:  uint8_t, bool (true to release)                                         |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void driveTwiPin(uint8_t pin, bool release){
+        if(release) pinMode(pin, INPUT_PULLUP);
+        else{
+            digitalWrite(pin, LOW);
+            pinMode(pin, OUTPUT);
+        }
+        delayMicroseconds(TWI_RECOVERY_HALF_PERIOD);
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       recoverTwiBus                                                           |
+    |   Purpose:    Frees a bus a slave has been left holding. With the TWI off, SCL is     |
+    |               clocked until the slave finishes its byte and lets SDA go, then a STOP  |
+    |               puts every slave back to idle and the TWI takes the pins again.         |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void recoverTwiBus(void){
+        TWCR = 0;
+        driveTwiPin(SDA, true);
+        driveTwiPin(SCL, true);
+
+        for(uint8_t i = 0; i != TWI_RECOVERY_CLOCKS && digitalRead(SDA) == LOW; i++){
+            driveTwiPin(SCL, false);
+            driveTwiPin(SCL, true);
+        }
+
+        /* STOP, SDA rising while SCL is high */
+        driveTwiPin(SCL, false);
+        driveTwiPin(SDA, false);
+        driveTwiPin(SCL, true);
+        driveTwiPin(SDA, true);
+
+        TWCR = _BV(TWEN);
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       initializeTwi                                                           |
+    |   Purpose:    Enables the TWI at TWI_CLOCK with the internal pull-ups on.             |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void initializeTwi(void){
+        digitalWrite(SDA, HIGH);
+        digitalWrite(SCL, HIGH);
+        TWSR = 0;                                           // Prescaler 1
+        TWBR = ((F_CPU / TWI_CLOCK) - 16) / 2;
+        TWCR = _BV(TWEN);
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       startTwiTransfer                                                        |
+    |   Purpose:    Puts a transfer on the bus and returns at once.                         |
+    |   Arguments:  TwiTransfer*                                                            |
+    |   Returns:    int16_t (TWI_BUSY if another transfer holds the bus)                    |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t startTwiTransfer(TwiTransfer* t){
+        noInterrupts();
+        bool busy = twiCurrent != NULL;
+        interrupts();
+        if(busy) return TWI_BUSY;
+
+        /* The last transfer's stop may still be going out */
+        while(TWCR & _BV(TWSTO));
+
+        t->result = TWI_PENDING;
+        twiIndex = 0;
+        twiReading = (t->txLen == 0);
+        twiStartMillis = millis();
+        twiCurrent = t;
+        TWCR = TWI_START;
+        return TWI_OK;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       pollTwiTransfer                                                         |
+    |   Purpose:    Returns a transfer's result, TWI_PENDING while it's on the bus. A       |
+    |               transfer past TWI_TIMEOUT is abandoned and the bus recovered.           |
+    |   Arguments:  TwiTransfer*                                                            |
+    |   Returns:    int16_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t pollTwiTransfer(TwiTransfer* t){
+        if(t->result == TWI_PENDING && millis() - twiStartMillis > TWI_TIMEOUT){
+            noInterrupts();
+            bool abandoned = t->result == TWI_PENDING;
+            if(abandoned){
+                TWCR = 0;
+                t->result = TWI_TIMEOUT_ERROR;
+                twiCurrent = NULL;
+            }
+            interrupts();
+
+            /* Off the bus with interrupts back on, the clocking takes around 100 us */
+            if(abandoned){
+                Log(F("I2C transfer timed out, recovering the bus"));
+                recoverTwiBus();
+            }
+        }
+        return t->result;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       runTwiTransfer                                                          |
+    |   Purpose:    Waits for the bus, then runs a transfer to completion.                  |
+    |   Arguments:  TwiTransfer*                                                            |
+    |   Returns:    int16_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t runTwiTransfer(TwiTransfer* t){
+        while(true){
+            noInterrupts();
+            TwiTransfer* current = twiCurrent;
+            interrupts();
+            if(current == NULL) break;
+            pollTwiTransfer(current);
+        }
+
+        int16_t res = startTwiTransfer(t);
+        if(res != TWI_OK) return res;
+        while(pollTwiTransfer(t) == TWI_PENDING);
+        return t->result;
+    }
@@ -0,0 +1,88 @@
+#ifndef INC_TWI_H_
+#define INC_TWI_H_
+
+#include <Arduino.h>
+
+
+/*-------------------------------------------------------------------------*\
+|								  Definitions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*
+     * Interrupt-driven I2C master, one transfer on the bus at a time. A transfer writes its bytes and
+     * then, after a repeated start, reads its bytes, straight from and into the caller's buffers. The
+     * interrupt moves it along a byte at a time, so startTwiTransfer returns at once and the caller
+     * polls for the result; runTwiTransfer is the blocking form for register access.
+     */
+
+    #define TWI_CLOCK                       400000                  // Hz, the IMU's fast mode
+    #define TWI_TIMEOUT                     10                      // ms a transfer may hold the bus
+    #define TWI_RECOVERY_CLOCKS             9                       // SCL pulses that finish any byte a slave was sending
+    #define TWI_RECOVERY_HALF_PERIOD        5                       // us, 100 kHz while the pins are driven by hand
+
+    /* Status codes */
+    #define TWI_OK                          0x0000
+    #define TWI_PENDING                     0x0900                  // Still on the bus
+    #define TWI_BUSY                        0x0901                  // Another transfer holds the bus
+    #define TWI_ADDRESS_NACK                0x0902                  // Nothing answered at the address
+    #define TWI_DATA_NACK                   0x0903
+    #define TWI_BUS_ERROR                   0x0904                  // Lost arbitration or illegal bus state
+    #define TWI_TIMEOUT_ERROR               0x0905
+
+
+/*-------------------------------------------------------------------------*\
+|								     Types					   			    |
+\*-------------------------------------------------------------------------*/
+
+
+    /* One transfer, owned by the caller and left alone until its result is no longer TWI_PENDING */
+    struct TwiTransfer{
+        uint8_t address;                                    // 7-bit
+        const uint8_t* txBuf;
+        uint8_t txLen;
+        uint8_t* rxBuf;
+        uint8_t rxLen;
+        volatile int16_t result;
+    };
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       initializeTwi                                                           |
+    |   Purpose:    Enables the TWI at TWI_CLOCK with the internal pull-ups on.             |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void initializeTwi(void);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       startTwiTransfer                                                        |
+    |   Purpose:    Puts a transfer on the bus and returns at once.                         |
+    |   Arguments:  TwiTransfer*                                                            |
+    |   Returns:    int16_t (TWI_BUSY if another transfer holds the bus)                    |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t startTwiTransfer(TwiTransfer* t);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       pollTwiTransfer                                                         |
+    |   Purpose:    Returns a transfer's result, TWI_PENDING while it's on the bus. A       |
+    |               transfer past TWI_TIMEOUT is abandoned and the bus recovered.           |
+    |   Arguments:  TwiTransfer*                                                            |
+    |   Returns:    int16_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t pollTwiTransfer(TwiTransfer* t);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       runTwiTransfer                                                          |
+    |   Purpose:    Waits for the bus, then runs a transfer to completion.                  |
+    |   Arguments:  TwiTransfer*                                                            |
+    |   Returns:    int16_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t runTwiTransfer(TwiTransfer* t);
+
+#endif /* INC_TWI_H_ */
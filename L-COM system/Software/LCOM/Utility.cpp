@@ -5,6 +5,7 @@
 
 
 #include "Utility.h"
+#include "Codec.h"
 
 
 /*-------------------------------------------------------------------------*\
@@ -14,9 +15,24 @@
 
     bool debugMode = false;
     bool UnixSet = false;
-    uint32_t currentTime = 0, lastMillis = 0;
+
+    /* Corrected clock, raw millis() is folded in every CLOCK_FOLD_INTERVAL with the drift correction applied */
+    uint32_t clockRawBase = 0;
+    uint32_t clockBase = 0;
+    int32_t clockResidual = 0;                  // Correction remainder (ppm*ms), carried between folds so none is lost
+    int16_t clockDrift = 0;
+
+    /* UNIX time is an offset on the corrected clock, unixBaseClock is the clock reading at unixBaseSeconds.000 */
+    uint32_t unixBaseSeconds = 0;
+    uint32_t unixBaseClock = 0;
+
+    /* Last host sync, for drift estimation */
+    bool hostSynced = false;
+    uint32_t lastSyncMillis = 0;
+    uint32_t lastSyncSeconds = 0;
+    uint16_t lastSyncMs = 0;
     uint8_t mode = NORMAL_MODE;
-    uint8_t repeaterMessage[1]; //MAX_REPEATER_MESSAGE_SIZE
+    uint8_t repeaterMessage[REPEATER_MESSAGE_BUFFER_LEN];
 
 /*-------------------------------------------------------------------------*\
 |								   Functions					   			|
@@ -47,6 +63,7 @@
     void Log(char* out, int16_t res)                        LOG_FUNCT
     void Log(uint8_t* out, int16_t res)                     LOG_FUNCT_CAST
     void Log(const uint16_t out, int16_t res)               LOG_FUNCT
+    void Log(const uint32_t out, int16_t res)               LOG_FUNCT
     void Log(const int16_t out, int16_t res)                LOG_FUNCT
     void Log(const float out, int16_t res)                  LOG_FUNCT
 
@@ -68,8 +85,9 @@
         return (uint8_t)buf[pos];
     }       
     float extract_float(const uint8_t *buf, uint16_t pos){
-        uint32_t uint_bytes = ((uint32_t)buf[pos] << 24) + ((uint32_t)buf[pos+1] << 16) + ((uint32_t)buf[pos+2] << 8) + ((uint32_t)buf[pos+3]);
-        return *((float *) &uint_bytes);
+        float f;
+        codecGet_F32(buf+pos, &f);
+        return f;
     }
 
     /*-------------------------------------------------------------------------------------*\
@@ -81,16 +99,121 @@
         return UnixSet;
     }
     
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       foldClock                                                               |
+    |   Purpose:    Folds the raw millis() elapsed since the last fold into the corrected   |
+    |               clock. Also done before the drift changes, so each interval is          |
+    |               corrected at the rate that applied during it.                           |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void foldClock(void){
+        uint32_t now = millis();
+        uint32_t raw = now - clockRawBase;
+        while(raw){
+            uint32_t step = (raw > CLOCK_FOLD_INTERVAL) ? CLOCK_FOLD_INTERVAL : raw;
+            int32_t correction = (int32_t)step * clockDrift + clockResidual;
+            clockBase += step + correction / 1000000L;
+            clockResidual = correction % 1000000L;
+            raw -= step;
+        }
+        clockRawBase = now;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       clockMillis                                                             |
+    |   Purpose:    Monotonic, drift-corrected milliseconds since startup. Never steps when |
+    |               the UNIX time is set.                                                   |
+    |   Arguments:  void                                                                    |
+    |   Returns:    uint32_t                                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint32_t clockMillis(void){
+        uint32_t raw = millis() - clockRawBase;
+        if(raw >= CLOCK_FOLD_INTERVAL){
+            foldClock();
+            raw = 0;
+        }
+        return clockBase + raw + ((int32_t)raw * clockDrift + clockResidual) / 1000000L;
+    }
+
     /*-------------------------------------------------------------------------------------*\
     |   Name:       setUnixTime                                                             |
     |   Purpose:    Sets the current UNIX time and enables timekeeping if not yet enabled.  |
-    |   Arguments:  uint32_t                                                                |
+    |   Arguments:  uint32_t, uint16_t                                                      |
     |   Returns:    void                                                                    |
     \*-------------------------------------------------------------------------------------*/
-    void setUnixTime(uint32_t timestamp){
+    void setUnixTime(uint32_t timestamp, uint16_t milliseconds){
         UnixSet = true;
-        currentTime = timestamp;
-        lastMillis = millis();
+        unixBaseSeconds = timestamp;
+        unixBaseClock = clockMillis() - milliseconds;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       syncUnixTime                                                            |
+    |   Purpose:    Sets the UNIX time from a millisecond-resolution update, and measures   |
+    |               against an earlier update at least CLOCK_DRIFT_MIN_INTERVAL back to     |
+    |               estimate crystal drift.                                                 |
+    |   Arguments:  uint32_t, uint16_t                                                      |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void syncUnixTime(uint32_t timestamp, uint16_t milliseconds){
+        uint32_t now = millis();
+
+        /* Compare the host's elapsed time against raw millis(), so the estimate doesn't depend on the current correction */
+        if(hostSynced){
+            uint32_t local = now - lastSyncMillis;
+
+            /* Frequent updates keep the older baseline until it is far enough back to measure against */
+            if(local < CLOCK_DRIFT_MIN_INTERVAL){
+                setUnixTime(timestamp, milliseconds);
+                return;
+            }
+            if(local < CLOCK_DRIFT_MAX_INTERVAL){
+                int32_t host = (int32_t)(timestamp - lastSyncSeconds) * 1000 + ((int32_t)milliseconds - lastSyncMs);
+                int32_t diff = host - (int32_t)local;
+                if(labs(diff) <= (int32_t)(local / (1000000L / CLOCK_MAX_DRIFT_PPM))){
+                    int32_t ppm = diff * 10000L / (int32_t)(local / 100);
+                    foldClock();
+                    clockDrift += (int16_t)((ppm - clockDrift) / CLOCK_DRIFT_SMOOTHING);
+                    Log(F("Clock drift (ppm):"));
+                    Log(clockDrift);
+                }
+                else Log(F("Host time stepped, drift estimate skipped"));
+            }
+        }
+        hostSynced = true;
+        lastSyncMillis = now;
+        lastSyncSeconds = timestamp;
+        lastSyncMs = milliseconds;
+
+        setUnixTime(timestamp, milliseconds);
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getUnixTimeMs                                                           |
+    |   Purpose:    Gets the current UNIX time with the millisecond part, both from the     |
+    |               same clock reading. Both are 0 if time-keeping not enabled.             |
+    |   Arguments:  uint32_t*, uint16_t*                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void getUnixTimeMs(uint32_t* timestamp, uint16_t* milliseconds){
+        // Return 0 if UNIX epoch not set
+        if(!UnixSet){
+            *timestamp = 0;
+            *milliseconds = 0;
+            return;
+        }
+
+        // Move the base forward a day at a time, so the offset never wraps
+        uint32_t elapsed = clockMillis() - unixBaseClock;
+        while(elapsed >= 86400000UL){
+            unixBaseSeconds += 86400UL;
+            unixBaseClock += 86400000UL;
+            elapsed -= 86400000UL;
+        }
+
+        *timestamp = unixBaseSeconds + elapsed / 1000;
+        *milliseconds = elapsed % 1000;
     }
 
     /*-------------------------------------------------------------------------------------*\
@@ -100,13 +223,33 @@
     |   Returns:    uint32_t                                                                |
     \*-------------------------------------------------------------------------------------*/
     uint32_t getUnixTime(void){
-        // Return 0 if UNIX epoch not set
-        if(!UnixSet) return 0;
+        uint32_t timestamp;
+        uint16_t milliseconds;
+        getUnixTimeMs(&timestamp, &milliseconds);
+        return timestamp;
+    }
 
-        // Find the new current time and return it
-        currentTime += (uint32_t)((millis() - lastMillis)/1000);
-        lastMillis = millis();
-        return currentTime;
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getClockDrift                                                           |
+    |   Purpose:    Returns the crystal drift correction (ppm, positive if running slow).   |
+    |   Returns:    int16_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t getClockDrift(void){
+        return clockDrift;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       setClockDrift                                                           |
+    |   Purpose:    Sets the crystal drift correction (ppm), e.g. restoring a previous      |
+    |               estimate.                                                               |
+    |   Arguments:  int16_t                                                                 |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void setClockDrift(int16_t ppm){
+        if(ppm > CLOCK_MAX_DRIFT_PPM) ppm = CLOCK_MAX_DRIFT_PPM;
+        if(ppm < -CLOCK_MAX_DRIFT_PPM) ppm = -CLOCK_MAX_DRIFT_PPM;
+        foldClock();
+        clockDrift = ppm;
     }
     
     /*-------------------------------------------------------------------------------------*\
@@ -116,7 +259,7 @@
     |   Returns:    void                                                                    |
     \*-------------------------------------------------------------------------------------*/
     void setMode(uint8_t _mode){
-        mode = mode;
+        mode = _mode;
     }
 
     /*-------------------------------------------------------------------------------------*\
@@ -138,17 +281,3 @@
     uint8_t* getRepeaterMessage(void){
         return repeaterMessage;
     }
-
-
-    /*-------------------------------------------------------------------------------------*\
-    |   Name:       getModuleTemperature                                                    |
-    |   Purpose:    Gets the temperature of a thermistor located on the module.             |
-    |   Arguments:  void                                                                    |
-    |   Returns:    float                                                                   |
-    \*-------------------------------------------------------------------------------------*/
-    float getModuleTemperature(void){
-        uint16_t Vth = analogRead(THERMISTOR_PIN);
-        float logR1 = log(R2_OHM * (ANALOG_MAX_VALUE / (float)Vth - 1.0));
-        float Tc = (1.0 / (C1 + C2*logR1 + C3*logR1*logR1*logR1)) - KELVIN_CELCIUS_DIFFERENCE;
-        return Tc;        
-    }
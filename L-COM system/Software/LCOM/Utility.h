@@ -18,15 +18,14 @@
     #define NORMAL_MODE                     0x00
     #define REPEATER_MODE                   0x01
     #define MAX_REPEATER_MESSAGE_SIZE       255
+    #define REPEATER_MESSAGE_BUFFER_LEN     1                   // Bytes of it kept in RAM, the full message doesn't fit the budget in Memory.h
 
-    /* Temperature */
-    #define THERMISTOR_PIN                  A0
-    #define ANALOG_MAX_VALUE                1023.0
-    #define KELVIN_CELCIUS_DIFFERENCE       273.15  
-    #define R2_OHM                          10000               // Ohms
-    #define C1                              1.009249522e-03
-    #define C2                              2.378405444e-04
-    #define C3                              2.019202697e-07    
+    /* Clock */
+    #define CLOCK_FOLD_INTERVAL             60000               // ms of raw millis() folded into the corrected clock at a time, keeps the correction in 32 bits
+    #define CLOCK_MAX_DRIFT_PPM             20000               // Larger measured drift is treated as a host time step, not drift
+    #define CLOCK_DRIFT_MIN_INTERVAL        60000               // ms between host syncs before drift is estimated from them
+    #define CLOCK_DRIFT_MAX_INTERVAL        10000000            // Longer intervals would overflow the estimate, the baseline restarts instead
+    #define CLOCK_DRIFT_SMOOTHING           4                   // Each estimate moves the correction 1/4 of the way
 
 
 /*-------------------------------------------------------------------------*\
@@ -55,6 +54,7 @@
     void Log(char* out, int16_t res = 0);   
     void Log(uint8_t* out, int16_t res = 0);  
     void Log(const uint16_t out, int16_t res = 0);
+    void Log(const uint32_t out, int16_t res = 0);
     void Log(const int16_t out, int16_t res = 0);
     void Log(const float out, int16_t res = 0);
 
@@ -78,13 +78,32 @@
     \*-------------------------------------------------------------------------------------*/
     bool getUnixSet(void);
 
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       clockMillis                                                             |
+    |   Purpose:    Monotonic, drift-corrected milliseconds since startup. Never steps when |
+    |               the UNIX time is set.                                                   |
+    |   Arguments:  void                                                                    |
+    |   Returns:    uint32_t                                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint32_t clockMillis(void);
+
     /*-------------------------------------------------------------------------------------*\
     |   Name:       setUnixTime                                                             |
     |   Purpose:    Sets the current UNIX time and enables timekeeping if not yet enabled.  |
-    |   Arguments:  uint32_t                                                                |
+    |   Arguments:  uint32_t, uint16_t                                                      |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void setUnixTime(uint32_t timestamp, uint16_t milliseconds = 0);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       syncUnixTime                                                            |
+    |   Purpose:    Sets the UNIX time from a millisecond-resolution update, and measures   |
+    |               against an earlier update at least CLOCK_DRIFT_MIN_INTERVAL back to     |
+    |               estimate crystal drift.                                                 |
+    |   Arguments:  uint32_t, uint16_t                                                      |
     |   Returns:    void                                                                    |
     \*-------------------------------------------------------------------------------------*/
-    void setUnixTime(uint32_t timestamp);
+    void syncUnixTime(uint32_t timestamp, uint16_t milliseconds);
 
     /*-------------------------------------------------------------------------------------*\
     |   Name:       getUnixTime                                                             |
@@ -93,6 +112,31 @@
     |   Returns:    uint32_t                                                                |
     \*-------------------------------------------------------------------------------------*/
     uint32_t getUnixTime(void);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getUnixTimeMs                                                           |
+    |   Purpose:    Gets the current UNIX time with the millisecond part, both from the     |
+    |               same clock reading. Both are 0 if time-keeping not enabled.             |
+    |   Arguments:  uint32_t*, uint16_t*                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void getUnixTimeMs(uint32_t* timestamp, uint16_t* milliseconds);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getClockDrift                                                           |
+    |   Purpose:    Returns the crystal drift correction (ppm, positive if running slow).   |
+    |   Returns:    int16_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t getClockDrift(void);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       setClockDrift                                                           |
+    |   Purpose:    Sets the crystal drift correction (ppm), e.g. restoring a previous      |
+    |               estimate.                                                               |
+    |   Arguments:  int16_t                                                                 |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void setClockDrift(int16_t ppm);
     
     /*-------------------------------------------------------------------------------------*\
     |   Name:       setMode                                                                 |
@@ -118,12 +162,4 @@
     \*-------------------------------------------------------------------------------------*/
     uint8_t* getRepeaterMessage(void);
 
-    /*-------------------------------------------------------------------------------------*\
-    |   Name:       getModuleTemperature                                                    |
-    |   Purpose:    Gets the temperature of a thermistor located on the module.             |
-    |   Arguments:  void                                                                    |
-    |   Returns:    float                                                                   |
-    \*-------------------------------------------------------------------------------------*/
-    float getModuleTemperature(void);
-
 #endif /* INC_UTILITY_H_ */
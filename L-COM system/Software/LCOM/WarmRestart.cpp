@@ -0,0 +1,154 @@
+#include "WarmRestart.h"
+
+
+/*-------------------------------------------------------------------------*\
+|								   Variables					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /* Neither of these is touched by the C runtime at startup, so they survive a reset with power held */
+    WarmState warmState __attribute__((section(".noinit")));
+    uint8_t resetFlags __attribute__((section(".noinit")));
+
+    /* ATmega328P register addresses for captureResetCause, which can only use basic asm */
+    #define WARM_MCUSR_IO                   "0x34"                  // MCUSR, I/O space
+    #define WARM_WDTCSR                     "0x60"                  // WDTCSR, data space
+    #define WARM_WDT_CHANGE                 "0x18"                  // WDCE | WDE, opens the timed sequence
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       captureResetCause                                                       |
+    |   Purpose:    Runs from .init3, before main. Saves and clears MCUSR and stops the     |
+    |               watchdog, which stays armed at its shortest timeout after it fires.     |
+    |               Optiboot clears MCUSR itself but hands the original value over in r2.   |
+    |               Naked, so basic asm only: there is no frame, and only r1 (zero) and the |
+    |               stack pointer have been set up. Falls through to the next init section. |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void captureResetCause(void) __attribute__((naked, used, section(".init3")));
+    void captureResetCause(void){
+        __asm__ __volatile__(
+            "in   r24, " WARM_MCUSR_IO "\n\t"
+            "tst  r24\n\t"
+            "brne 1f\n\t"
+            "mov  r24, r2\n\t"                                     // Cleared by Optiboot, take its copy
+            "1:\n\t"
+            "sts  resetFlags, r24\n\t"
+            "out  " WARM_MCUSR_IO ", r1\n\t"                        // WDRF has to clear before WDE can
+            "ldi  r24, " WARM_WDT_CHANGE "\n\t"
+            "sts  " WARM_WDTCSR ", r24\n\t"                         // Interrupts are still off, so the
+            "sts  " WARM_WDTCSR ", r1\n\t"                          // second store is within 4 cycles
+        );
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       warmStateCRC                                                            |
+    |   Purpose:    CRC-16 over the saved state, excluding the CRC itself.                  |
+    |   Arguments:  void                                                                    |
+    |   Returns:    uint16_t                                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint16_t warmStateCRC(void){
+        const uint8_t* bytes = (const uint8_t*)&warmState;
+        uint16_t crc = 0xFFFF;
+        for(uint16_t i = 0; i != offsetof(WarmState, crc); i++) crc = _crc16_update(crc, bytes[i]);
+        return crc;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       restoreWarmState                                                        |
+    |   Purpose:    Counts the reset and, if the saved state passes its checksum and the    |
+    |               reset did not drop power, restores the clock and its drift correction,  |
+    |               mode, packet header settings, time sync role, radio parameters,         |
+    |               listen-before-talk, and hopping plan. Call after initializeRadio.       |
+    |   Arguments:  void                                                                    |
+    |   Returns:    bool (true on a warm restart)                                           |
+    \*-------------------------------------------------------------------------------------*/
+    bool restoreWarmState(void){
+        /* RAM contents are undefined after a power-on or brown-out, whatever the checksum says */
+        bool valid = !(resetFlags & (RESET_CAUSE_POWER_ON | RESET_CAUSE_BROWN_OUT))
+                  && warmState.magic == WARM_STATE_MAGIC
+                  && warmState.crc == warmStateCRC();
+
+        if(!valid){
+            memset(&warmState, 0, sizeof(WarmState));
+            warmState.magic = WARM_STATE_MAGIC;
+            warmState.crc = warmStateCRC();
+            return false;
+        }
+        warmState.resetCount++;
+
+        /* Clock, the time spent stalled before the watchdog fired is unknown, so assume the full timeout */
+        setClockDrift(warmState.clockDrift);
+        if(warmState.unixSet){
+            uint32_t stall = (resetFlags & RESET_CAUSE_WATCHDOG) ? WARM_RESTART_STALL_TIME : 0;
+            uint32_t ms = warmState.unixMs + WARM_STATE_SAVE_PERIOD + stall;
+            setUnixTime(warmState.unixTime + ms/1000, ms%1000);
+        }
+
+        /* Mode and serial packet sequence */
+        setMode(warmState.mode);
+        setLastPacketID(warmState.packetID);
+        setHeaderExtension(warmState.headerExtension);
+        configureTimeSync(warmState.timeSyncMode, warmState.timeSyncPeriod);
+
+        /* Radio, only the parameters that differ from the boot profile are written */
+        int16_t res = setRadioParameters(warmState.radio);
+        if(res != ERR_NONE) Log(F("Warm restart could not restore radio parameters"), res);
+        setLBTEnabled(warmState.LBTEnabled);
+        if(warmState.hoppingEnabled){
+            res = configureHopping(true, warmState.hopSeed, warmState.hopChannels, warmState.hopChannelCount);
+            if(res != ERR_NONE) Log(F("Warm restart could not restore hopping"), res);
+        }
+
+        warmState.crc = warmStateCRC();
+        Log(F("Warm restart, reset count:"));
+        Log(warmState.resetCount);
+        return true;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       saveWarmState                                                           |
+    |   Purpose:    Checkpoints the current state into .noinit RAM. Scheduled every         |
+    |               WARM_STATE_SAVE_PERIOD.                                                 |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void saveWarmState(void){
+        warmState.unixSet = getUnixSet();
+        getUnixTimeMs(&warmState.unixTime, &warmState.unixMs);
+        warmState.clockDrift = getClockDrift();
+        warmState.mode = getMode();
+        warmState.packetID = getLastPacketID();
+        warmState.headerExtension = getHeaderExtension();
+        warmState.timeSyncMode = getTimeSyncMode();
+        warmState.timeSyncPeriod = getTimeSyncPeriod();
+        warmState.radio = getRadioParameters();
+        warmState.LBTEnabled = getLBTEnabled();
+        warmState.hoppingEnabled = getHoppingEnabled();
+        warmState.hopChannelCount = getHoppingPlan(&warmState.hopSeed, warmState.hopChannels);
+        warmState.crc = warmStateCRC();
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getResetCause                                                           |
+    |   Purpose:    Returns the MCUSR flags captured at startup (RESET_CAUSE_*).            |
+    |   Returns:    uint8_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    uint8_t getResetCause(void){
+        return resetFlags;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getResetCount                                                           |
+    |   Purpose:    Returns the number of resets since the last power-on.                   |
+    |   Returns:    uint16_t                                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint16_t getResetCount(void){
+        return warmState.resetCount;
+    }
@@ -0,0 +1,98 @@
+#ifndef INC_WARMRESTART_H_
+#define INC_WARMRESTART_H_
+
+#include <Arduino.h>
+#include <avr/wdt.h>
+#include <util/crc16.h>
+#include "FrequencyHopping.h"
+#include "RadioController.h"
+#include "SerialInterface.h"
+#include "TimeSync.h"
+#include "Utility.h"
+
+
+/*-------------------------------------------------------------------------*\
+|								  Definitions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /* Saved state */
+    #define WARM_STATE_MAGIC                0x574E                  // "WN", changes with the layout of WarmState
+    #define WARM_STATE_SAVE_PERIOD          250                     // ms between checkpoints, the scheduler period of saveWarmState
+    #define WARM_RESTART_STALL_TIME         4000                    // ms assumed lost to the watchdog timeout, added to the restored clock
+
+    /* Reset causes (MCUSR bits) */
+    #define RESET_CAUSE_POWER_ON            0x01
+    #define RESET_CAUSE_EXTERNAL            0x02
+    #define RESET_CAUSE_BROWN_OUT           0x04
+    #define RESET_CAUSE_WATCHDOG            0x08
+
+
+/*-------------------------------------------------------------------------*\
+|								     Types					   			    |
+\*-------------------------------------------------------------------------*/
+
+
+    /* Everything needed to pick the link back up, kept in .noinit RAM across resets */
+    struct WarmState{
+        uint16_t magic;
+        uint16_t resetCount;
+        bool unixSet;
+        uint32_t unixTime;
+        uint16_t unixMs;
+        int16_t clockDrift;
+        uint8_t mode;
+        uint8_t packetID;
+        bool headerExtension;
+        uint8_t timeSyncMode;
+        uint16_t timeSyncPeriod;
+        RadioParameters radio;
+        bool LBTEnabled;
+        bool hoppingEnabled;
+        uint16_t hopSeed;
+        uint8_t hopChannelCount;
+        uint32_t hopChannels[HOP_MAX_CHANNELS];
+        uint16_t crc;
+    };
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       restoreWarmState                                                        |
+    |   Purpose:    Counts the reset and, if the saved state passes its checksum and the    |
+    |               reset did not drop power, restores the clock and its drift correction,  |
+    |               mode, packet header settings, time sync role, radio parameters,         |
+    |               listen-before-talk, and hopping plan. Call after initializeRadio.       |
+    |   Arguments:  void                                                                    |
+    |   Returns:    bool (true on a warm restart)                                           |
+    \*-------------------------------------------------------------------------------------*/
+    bool restoreWarmState(void);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       saveWarmState                                                           |
+    |   Purpose:    Checkpoints the current state into .noinit RAM. Scheduled every         |
+    |               WARM_STATE_SAVE_PERIOD.                                                 |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void saveWarmState(void);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getResetCause                                                           |
+    |   Purpose:    Returns the MCUSR flags captured at startup (RESET_CAUSE_*).            |
+    |   Returns:    uint8_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    uint8_t getResetCause(void);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       getResetCount                                                           |
+    |   Purpose:    Returns the number of resets since the last power-on.                   |
+    |   Returns:    uint16_t                                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint16_t getResetCount(void);
+
+#endif /* INC_WARMRESTART_H_ */
@@ -8,6 +8,7 @@
 
 from scapy.all import *
 from Serial_packet import *	
+from Schemas import *			# Generated from the firmware's Schemas.h by Generate_schemas.py
 
 
 #--------------------------------------------------------------------------\
@@ -24,11 +25,32 @@ CMD_OK						= 0x00
 SET_LORA_PARAMETERS			= 0x00
 SET_UNIX					= 0x01
 SET_MODE_MESSAGE			= 0x02
+SET_LISTEN_BEFORE_TALK		= 0x03
+SET_HOPPING_PARAMETERS		= 0x04
+DEFINE_RADIO_PROFILE		= 0x05
+ACTIVATE_RADIO_PROFILE		= 0x06
+SET_BOOT_PROFILE			= 0x07
+SET_HEADER_EXTENSION		= 0x08
+SET_TIME_SYNC				= 0x09
+SET_TRACE					= 0x0A
+SET_TELEMETRY				= 0x0B
+SET_IMU						= 0x0C
+SET_IMU_SUMMARY				= 0x0D
+SET_STORE_FORWARD			= 0x0E
 
 GET_LORA_PARAMETERS			= 0x10
 GET_UNIX					= 0x11
 GET_MODE_MESSAGE			= 0x12
 GET_MODULE_STATUS			= 0x13
+GET_CHANNEL_STATS			= 0x14
+GET_HOPPING_STATS			= 0x15
+GET_RADIO_PROFILES			= 0x16
+GET_TIME_SYNC_STATUS		= 0x17
+GET_TASK_STATS				= 0x18
+GET_PERF_STATS				= 0x19
+GET_COMMAND_STATS			= 0x1A
+GET_ENERGY_STATUS			= 0x1B
+GET_STORE_FORWARD_STATUS	= 0x1C
 
 RADIO_RESET					= 0x20
 SYSTEM_RESET				= 0x21
@@ -42,6 +64,76 @@ stringModeDict 				= {'Normal':NORMAL_MODE, 'Repeater':REPEATER_MODE}
 # Messages and commands
 MAX_LORA_MESSAGE_LENGTH		= 255
 
+# Frequency hopping
+HOP_MAX_CHANNELS			= 16
+HOP_DEFAULT_SEED			= 0x4C43
+
+# Radio profiles
+MAX_RADIO_PROFILES			= 8
+PROFILE_NAME_LEN			= 8
+PROFILE_NONE				= 0xFF
+
+# Time sync
+TIME_SYNC_OFF				= 0x00
+TIME_SYNC_MASTER			= 0x01
+TIME_SYNC_SLAVE				= 0x02
+TIME_SYNC_DEFAULT_PERIOD	= 10
+
+# Telemetry destinations
+TELEMETRY_OFF				= 0x00
+TELEMETRY_UART				= 0x01
+TELEMETRY_RADIO				= 0x02
+
+# Telemetry records, sent as message packets with this result and the record type first
+TELEMETRY_RECORD			= 0x0700
+TELEMETRY_IMU_BATCH			= 0x01
+TELEMETRY_IMU_SUMMARY		= 0x02
+TELEMETRY_GPS_FIX			= 0x03
+TELEMETRY_POWER				= 0x04
+TELEMETRY_STORED			= 0x05
+
+# IMU
+IMU_INTERNAL_RATE			= 1000
+IMU_MIN_RATE				= 4
+IMU_QUEUE_LEN				= 8
+IMU_DEFAULT_BATCH			= 8
+IMU_ACCEL_LSB_PER_G			= 8192
+IMU_GYRO_LSB_PER_DPS		= 65.5
+
+# IMU summary fields and windows
+IMU_SUMMARY_MEAN			= 0x01
+IMU_SUMMARY_MIN				= 0x02
+IMU_SUMMARY_MAX				= 0x04
+IMU_SUMMARY_RMS				= 0x08
+IMU_SUMMARY_PEAKS			= 0x10
+IMU_SUMMARY_ALL				= 0x1F
+IMU_SUMMARY_MIN_WINDOW		= 100
+IMU_SUMMARY_MAX_WINDOW		= 60000
+IMU_SUMMARY_DEFAULT_WINDOW	= 1000
+
+# GPS fix types
+GPS_FIX_NONE				= 0
+GPS_FIX_DEAD_RECKONING		= 1
+GPS_FIX_2D					= 2
+GPS_FIX_3D					= 3
+
+# Power board flags, in module status and power records
+POWER_HEATER_ON				= 0x01
+POWER_READING_VALID			= 0x80
+
+# Power policy levels, in module status
+POWER_LEVEL_NORMAL			= 0
+POWER_LEVEL_LOW				= 1
+POWER_LEVEL_CRITICAL		= 2
+
+# Store and forward, in seconds
+STORE_DEFAULT_LINK_TIMEOUT	= 30
+STORE_DEFAULT_INTERVAL		= 10
+
+# Performance statistics subcommands
+PERF_STATS_READ				= 0x00
+PERF_STATS_RESET			= 0x01
+
 # LoRa parameters
 DEFAULT_FREQUENCY 			= 915.0
 DEFAULT_BANDWIDTH           = 125.0
@@ -52,6 +144,7 @@ DEFAULT_POWER        		= 14                      # (max 22 dBm)
 DEFAULT_CURRENT_LIMIT       = 60.0                    # (max 140 mA)
 DEFAULT_PREAMBLE_LENGTH     = 8
 DEFAULT_CURRENT_LIMIT     	= 60.0
+VALID_BANDWIDTHS			= [7.8, 10.4, 15.6, 20.8, 31.25, 41.7, 62.5, 125.0, 250.0, 500.0]	# kHz, all the SX1262 supports
 
 
 #--------------------------------------------------------------------------\
@@ -88,13 +181,84 @@ class ackPayload(Packet):
 # Message
 class messagePayload(Packet):
     name = "messageProtocol"
-    fields_desc=[
-		IntField("RSSI", 0),
-		IntField("SNR", 0),
-		ShortField("result", CMD_OK),	# e.g. notifies if there are CRC errors or anything. Keeps it in one packet instead of sending a second ACK packet.
+    fields_desc= MESSAGE_FIELDS_SCHEMA + [	# RSSI, SNR, and result, e.g. notifies if there are CRC errors or anything. Keeps it in one packet instead of sending a second ACK packet.
 		StrLenField("message", "Default message") # Don't pad this, want to keep the size reduced as much as possible when transmitting
 	]	
 	
+# Returned data, decode an Ack's data with e.g. moduleStatusReturn(ack.data)
+class loRaParametersReturn(Packet):
+    name = "loRaParametersReturn"
+    fields_desc= LORA_PARAMETERS_SCHEMA
+
+class unixTimeReturn(Packet):
+    name = "unixTimeReturn"
+    fields_desc= UNIX_TIME_SCHEMA
+
+class moduleStatusReturn(Packet):
+    name = "moduleStatusReturn"
+    fields_desc= MODULE_STATUS_SCHEMA
+
+class timeSyncStatusReturn(Packet):
+    name = "timeSyncStatusReturn"
+    fields_desc= TIME_SYNC_STATUS_SCHEMA
+
+class energyStatusReturn(Packet):
+    name = "energyStatusReturn"
+    fields_desc= ENERGY_STATUS_SCHEMA
+
+class storeForwardStatusReturn(Packet):
+    name = "storeForwardStatusReturn"
+    fields_desc= STORE_FORWARD_STATUS_SCHEMA
+
+# Telemetry records, decode a message packet's data with e.g. imuBatchRecord(message.message[1:])
+class imuSample(Packet):
+    name = "imuSample"
+    fields_desc= IMU_SAMPLE_SCHEMA
+
+    def extract_padding(self, s):
+        return b"", s
+
+class imuBatchRecord(Packet):
+    name = "imuBatchRecord"
+    fields_desc= IMU_BATCH_SCHEMA + [
+		PacketListField("samples", [], imuSample, count_from=lambda pkt: pkt.count)
+	]
+
+class imuPeaks(Packet):
+    name = "imuPeaks"
+    fields_desc= IMU_PEAKS_SCHEMA
+
+    def extract_padding(self, s):
+        return b"", s
+
+# Only the fields the summary includes are present, each in a sample's layout except the peaks
+class imuSummaryRecord(Packet):
+    name = "imuSummaryRecord"
+    fields_desc= IMU_SUMMARY_SCHEMA + [
+		ConditionalField(PacketField("mean", None, imuSample), lambda pkt: pkt.included & IMU_SUMMARY_MEAN),
+		ConditionalField(PacketField("min", None, imuSample), lambda pkt: pkt.included & IMU_SUMMARY_MIN),
+		ConditionalField(PacketField("max", None, imuSample), lambda pkt: pkt.included & IMU_SUMMARY_MAX),
+		ConditionalField(PacketField("rms", None, imuSample), lambda pkt: pkt.included & IMU_SUMMARY_RMS),
+		ConditionalField(PacketField("peaks", None, imuPeaks), lambda pkt: pkt.included & IMU_SUMMARY_PEAKS)
+	]
+
+# Latitude and longitude in 1e-7 degrees, altitude in cm, speed in cm/s, course in 0.01 degrees
+class gpsFixRecord(Packet):
+    name = "gpsFixRecord"
+    fields_desc= GPS_FIX_SCHEMA
+
+class powerRecord(Packet):
+    name = "powerRecord"
+    fields_desc= POWER_STATUS_SCHEMA
+
+# Stored while the link was down, decode the record by its type, e.g. gpsFixRecord(stored.record)
+class storedRecord(Packet):
+    name = "storedRecord"
+    fields_desc= STORED_RECORD_SCHEMA + [
+		ByteField("type", 0),
+		StrField("record", b"")
+	]
+	
 #-------------------------------------------------------\
 #Commands-----------------------------------------------|	
 
@@ -103,16 +267,8 @@ class messagePayload(Packet):
 class setLoRaParametersPayload(Packet):
     name = "setLoRaParametersProtocol"
     fields_desc=[
-		ByteField("command", SET_LORA_PARAMETERS),
-		IEEEFloatField("frequency", DEFAULT_FREQUENCY),
-		IEEEFloatField("bandwidth", DEFAULT_BANDWIDTH),
-		ByteField("spreadingFactor", DEFAULT_SPREADING_FACTOR),
-		ByteField("codingRate", DEFAULT_CODING_RATE),
-		ByteField("syncWord", DEFAULT_SYNC_WORD),
-		ByteField("power", DEFAULT_POWER),
-		ShortField("preambleLength", DEFAULT_PREAMBLE_LENGTH),
-		IEEEFloatField("currentLimit", DEFAULT_CURRENT_LIMIT)
-	]
+		ByteField("command", SET_LORA_PARAMETERS)
+	] + LORA_PARAMETERS_SCHEMA
 	
 # Set UNIX time command
 class setUNIXPayload(Packet):
@@ -122,6 +278,15 @@ class setUNIXPayload(Packet):
 		IntField("timestamp", int(time.time()))
 	]
 	
+# Set UNIX time command with milliseconds (lets the module estimate its clock drift)
+class setUNIXMsPayload(Packet):
+    name = "setUNIXMsProtocol"
+    fields_desc=[
+		ByteField("command", SET_UNIX),
+		IntField("timestamp", int(time.time())),
+		ShortField("milliseconds", 0)
+	]
+	
 # Set mode command
 class setModeMessagePayload(Packet):
     name = "setModeMessageProtocol"
@@ -131,6 +296,112 @@ class setModeMessagePayload(Packet):
 		StrLenField("message", "Default message") # Don't pad this, want to keep the size reduced as much as possible
 	]
 	
+# Set listen-before-talk command
+class setListenBeforeTalkPayload(Packet):
+    name = "setListenBeforeTalkProtocol"
+    fields_desc=[
+		ByteField("command", SET_LISTEN_BEFORE_TALK),
+		ByteField("enable", 0)
+	]
+	
+# Set frequency hopping command
+class setHoppingParametersPayload(Packet):
+    name = "setHoppingParametersProtocol"
+    fields_desc=[
+		ByteField("command", SET_HOPPING_PARAMETERS),
+		ByteField("enable", 0),
+		ShortField("seed", HOP_DEFAULT_SEED),
+		FieldLenField("count", None, count_of="channels", fmt="B"),
+		FieldListField("channels", [], FIX3_U32Field("frequency", DEFAULT_FREQUENCY), count_from=lambda pkt: pkt.count)
+	]
+	
+# Define radio profile command
+class defineRadioProfilePayload(Packet):
+    name = "defineRadioProfileProtocol"
+    fields_desc=[
+		ByteField("command", DEFINE_RADIO_PROFILE),
+		ByteField("index", 0),
+		StrFixedLenField("name", b"", PROFILE_NAME_LEN)
+	] + LORA_PARAMETERS_SCHEMA
+	
+# Activate radio profile command
+class activateRadioProfilePayload(Packet):
+    name = "activateRadioProfileProtocol"
+    fields_desc=[
+		ByteField("command", ACTIVATE_RADIO_PROFILE),
+		ByteField("index", 0)
+	]
+	
+# Set boot profile command
+class setBootProfilePayload(Packet):
+    name = "setBootProfileProtocol"
+    fields_desc=[
+		ByteField("command", SET_BOOT_PROFILE),
+		ByteField("index", PROFILE_NONE)
+	]
+	
+	
+# Set header extension command
+class setHeaderExtensionPayload(Packet):
+    name = "setHeaderExtensionProtocol"
+    fields_desc=[
+		ByteField("command", SET_HEADER_EXTENSION),
+		ByteField("enable", 0)
+	]
+	
+# Set time sync command
+class setTimeSyncPayload(Packet):
+    name = "setTimeSyncProtocol"
+    fields_desc=[
+		ByteField("command", SET_TIME_SYNC),
+		ByteField("mode", TIME_SYNC_OFF),
+		ShortField("period", TIME_SYNC_DEFAULT_PERIOD)
+	]
+	
+# Set trace command
+class setTracePayload(Packet):
+    name = "setTraceProtocol"
+    fields_desc=[
+		ByteField("command", SET_TRACE),
+		ByteField("enable", 0)
+	]
+	
+# Set telemetry command
+class setTelemetryPayload(Packet):
+    name = "setTelemetryProtocol"
+    fields_desc=[
+		ByteField("command", SET_TELEMETRY),
+		ByteField("destination", TELEMETRY_OFF)
+	]
+	
+# Set IMU command
+class setImuPayload(Packet):
+    name = "setImuProtocol"
+    fields_desc=[
+		ByteField("command", SET_IMU),
+		ShortField("rate", 0),
+		ByteField("batch", IMU_DEFAULT_BATCH)
+	]
+	
+# Set IMU summary command
+class setImuSummaryPayload(Packet):
+    name = "setImuSummaryProtocol"
+    fields_desc=[
+		ByteField("command", SET_IMU_SUMMARY),
+		ShortField("window", IMU_SUMMARY_DEFAULT_WINDOW),
+		ByteField("included", 0)
+	]
+	
+# Set store and forward command
+class setStoreForwardPayload(Packet):
+    name = "setStoreForwardProtocol"
+    fields_desc=[
+		ByteField("command", SET_STORE_FORWARD),
+		ByteField("enable", 0),
+		ShortField("linkTimeout", STORE_DEFAULT_LINK_TIMEOUT),
+		ShortField("interval", STORE_DEFAULT_INTERVAL)
+	]
+	
 	
 #------------Get commands------------#		
 # Get LoRa parameters command
@@ -161,6 +432,72 @@ class getStatusPayload(Packet):
 		ByteField("command", GET_MODULE_STATUS),
 	]
 	
+# Get channel stats command
+class getChannelStatsPayload(Packet):
+    name = "getChannelStatsProtocol"
+    fields_desc=[
+		ByteField("command", GET_CHANNEL_STATS)
+	]
+	
+# Get frequency hopping stats command
+class getHoppingStatsPayload(Packet):
+    name = "getHoppingStatsProtocol"
+    fields_desc=[
+		ByteField("command", GET_HOPPING_STATS)
+	]
+	
+# Get radio profiles command
+class getRadioProfilesPayload(Packet):
+    name = "getRadioProfilesProtocol"
+    fields_desc=[
+		ByteField("command", GET_RADIO_PROFILES)
+	]
+	
+# Get time sync status command
+class getTimeSyncStatusPayload(Packet):
+    name = "getTimeSyncStatusProtocol"
+    fields_desc=[
+		ByteField("command", GET_TIME_SYNC_STATUS)
+	]
+	
+# Get task stats command
+class getTaskStatsPayload(Packet):
+    name = "getTaskStatsProtocol"
+    fields_desc=[
+		ByteField("command", GET_TASK_STATS),
+		ByteField("reset", 0)
+	]
+	
+# Get performance statistics command
+class getPerfStatsPayload(Packet):
+    name = "getPerfStatsProtocol"
+    fields_desc=[
+		ByteField("command", GET_PERF_STATS),
+		ByteField("subcommand", PERF_STATS_READ)
+	]
+	
+# Get command statistics command
+class getCommandStatsPayload(Packet):
+    name = "getCommandStatsProtocol"
+    fields_desc=[
+		ByteField("command", GET_COMMAND_STATS),
+		ByteField("reset", 0)
+	]
+	
+# Get energy status command
+class getEnergyStatusPayload(Packet):
+    name = "getEnergyStatusProtocol"
+    fields_desc=[
+		ByteField("command", GET_ENERGY_STATUS)
+	]
+	
+# Get store and forward status command
+class getStoreForwardStatusPayload(Packet):
+    name = "getStoreForwardStatusProtocol"
+    fields_desc=[
+		ByteField("command", GET_STORE_FORWARD_STATUS)
+	]
+	
 	
 #-------Miscellaneous commands-------#	
 # Radio reset command
@@ -241,23 +578,29 @@ def messagePacket(_message):
 #Commands-----------------------------------------------|	
 
 #------------Set commands------------#
-def setLoRaParametersPacket(_frequency, _bandwidth, _spreadingFactor, _codingRate, _syncWord, _power, _preambleLength, _currentLimit):
+def validLoRaParameters(_frequency, _bandwidth, _spreadingFactor, _codingRate, _syncWord, _power, _preambleLength, _currentLimit):
 	# Perform validity checks on the parameters
 	if (_frequency < 150.0 or _frequency > 960.0):
-		return None
-	elif (_bandwidth < 0.0 or _bandwidth > 510.0):
-		return None
+		return False
+	elif (not any(abs(_bandwidth - bw) < 0.01 for bw in VALID_BANDWIDTHS)):
+		return False
 	elif (_spreadingFactor < 5 or _spreadingFactor > 12):
-		return None
+		return False
 	elif (_codingRate < 5 or _codingRate > 8):
-		return None
+		return False
 	elif (_syncWord < 0 or _syncWord > 255 or _syncWord == 0x34): # LoRaWAN sync word
-		return None
+		return False
 	elif (_power < -17 or _power > 22):
-		return None
+		return False
 	elif (_preambleLength < 6 or _preambleLength > 65535):
-		return None
+		return False
 	elif (_currentLimit < 0 or _currentLimit > 140):
+		return False
+	return True
+
+def setLoRaParametersPacket(_frequency, _bandwidth, _spreadingFactor, _codingRate, _syncWord, _power, _preambleLength, _currentLimit):
+	# Perform validity checks on the parameters
+	if (not validLoRaParameters(_frequency, _bandwidth, _spreadingFactor, _codingRate, _syncWord, _power, _preambleLength, _currentLimit)):
 		return None
 
 	# Create the payload
@@ -275,15 +618,23 @@ def setLoRaParametersPacket(_frequency, _bandwidth, _spreadingFactor, _codingRat
 	# Create and return the serial packet
 	return createPacket(raw(payload), "command")
 	
-def setUNIXPacket(_timestamp):
+def setUNIXPacket(_timestamp, _milliseconds=None):
     # Perform validity checks on the parameters
 	if (_timestamp < 0):
 		return None
+	elif (_milliseconds != None and (_milliseconds < 0 or _milliseconds > 999)):
+		return None
 
 	# Create the payload
-	payload = setUNIXPayload(
-		timestamp 		= _timestamp
-	)	
+	if (_milliseconds == None):
+		payload = setUNIXPayload(
+			timestamp 		= _timestamp
+		)
+	else:
+		payload = setUNIXMsPayload(
+			timestamp 		= _timestamp,
+			milliseconds	= _milliseconds
+		)
 
 	# Create and return the serial packet
 	return createPacket(raw(payload), "command")
@@ -306,6 +657,183 @@ def setModeMessagePacket(_mode, _message):
 
 	# Create and return the serial packet
 	return createPacket(raw(payload), "command")
+	
+def setListenBeforeTalkPacket(_enable):
+	# Create the payload
+	payload = setListenBeforeTalkPayload(
+		enable			= 1 if _enable else 0
+	)
+
+	# Create and return the serial packet
+	return createPacket(raw(payload), "command")
+	
+def setHoppingParametersPacket(_enable, _seed, _channels):
+	# Perform validity checks on the parameters (an empty channel list keeps the module's current table)
+	if (_seed < 0 or _seed > 0xFFFF):
+		return None
+	elif (len(_channels) > HOP_MAX_CHANNELS):
+		return None
+	elif (any(f < 902.0 or f > 928.0 for f in _channels)):
+		return None
+
+	# Create the payload
+	payload = setHoppingParametersPayload(
+		enable			= 1 if _enable else 0,
+		seed			= _seed,
+		channels		= list(_channels)
+	)
+
+	# Create and return the serial packet
+	return createPacket(raw(payload), "command")
+	
+def defineRadioProfilePacket(_index, _name, _frequency, _bandwidth, _spreadingFactor, _codingRate, _syncWord, _power, _preambleLength, _currentLimit):
+	# Perform validity checks on the parameters
+	if (_index < 0 or _index >= MAX_RADIO_PROFILES):
+		return None
+	elif (len(_name) > PROFILE_NAME_LEN):
+		return None
+	elif (not validLoRaParameters(_frequency, _bandwidth, _spreadingFactor, _codingRate, _syncWord, _power, _preambleLength, _currentLimit)):
+		return None
+
+	# Create the payload
+	payload = defineRadioProfilePayload(
+		index				= _index,
+		name				= _name,
+		frequency 			= _frequency,
+		bandwidth 			= _bandwidth,
+		spreadingFactor 	= _spreadingFactor,
+		codingRate 			= _codingRate,
+		syncWord 			= _syncWord,
+		power 				= _power,
+		preambleLength 		= _preambleLength,
+		currentLimit 		= _currentLimit
+	)
+
+	# Create and return the serial packet
+	return createPacket(raw(payload), "command")
+	
+def activateRadioProfilePacket(_index):
+	# Perform validity checks on the parameters
+	if (_index < 0 or _index >= MAX_RADIO_PROFILES):
+		return None
+
+	# Create the payload
+	payload = activateRadioProfilePayload(
+		index			= _index
+	)
+
+	# Create and return the serial packet
+	return createPacket(raw(payload), "command")
+	
+def setBootProfilePacket(_index):
+	# Perform validity checks on the parameters (PROFILE_NONE boots on the defaults)
+	if (_index != PROFILE_NONE and (_index < 0 or _index >= MAX_RADIO_PROFILES)):
+		return None
+
+	# Create the payload
+	payload = setBootProfilePayload(
+		index			= _index
+	)
+
+	# Create and return the serial packet
+	return createPacket(raw(payload), "command")
+
+	
+def setHeaderExtensionPacket(_enable):
+	# Create the payload
+	payload = setHeaderExtensionPayload(
+		enable			= 1 if _enable else 0
+	)
+
+	# Create and return the serial packet
+	return createPacket(raw(payload), "command")
+	
+def setTimeSyncPacket(_mode, _period):
+	# Perform validity checks on the parameters
+	if (_mode not in (TIME_SYNC_OFF, TIME_SYNC_MASTER, TIME_SYNC_SLAVE)):
+		return None
+	elif (_period < 1 or _period > 0xFFFF):
+		return None
+
+	# Create the payload
+	payload = setTimeSyncPayload(
+		mode			= _mode,
+		period			= _period
+	)
+
+	# Create and return the serial packet
+	return createPacket(raw(payload), "command")
+	
+def setTracePacket(_enable):
+	# Create the payload
+	payload = setTracePayload(
+		enable			= 1 if _enable else 0
+	)
+
+	# Create and return the serial packet
+	return createPacket(raw(payload), "command")
+	
+def setTelemetryPacket(_destination):
+	# Perform validity checks on the parameters
+	if (_destination not in (TELEMETRY_OFF, TELEMETRY_UART, TELEMETRY_RADIO)):
+		return None
+
+	# Create the payload
+	payload = setTelemetryPayload(
+		destination		= _destination
+	)
+
+	# Create and return the serial packet
+	return createPacket(raw(payload), "command")
+	
+def setImuPacket(_rate, _batch = IMU_DEFAULT_BATCH):
+	# Perform validity checks on the parameters (rate 0 stops the IMU, batch 0 sends summaries only)
+	if (_rate != 0 and (_rate < IMU_MIN_RATE or _rate > IMU_INTERNAL_RATE or IMU_INTERNAL_RATE % _rate != 0)):
+		return None
+	elif (_batch < 0 or _batch > IMU_QUEUE_LEN):
+		return None
+
+	# Create the payload
+	payload = setImuPayload(
+		rate			= _rate,
+		batch			= _batch
+	)
+
+	# Create and return the serial packet
+	return createPacket(raw(payload), "command")
+	
+def setImuSummaryPacket(_window = IMU_SUMMARY_DEFAULT_WINDOW, _included = IMU_SUMMARY_ALL):
+	# Perform validity checks on the parameters (no fields turns summaries off)
+	if (_window < IMU_SUMMARY_MIN_WINDOW or _window > IMU_SUMMARY_MAX_WINDOW):
+		return None
+	elif (_included & ~IMU_SUMMARY_ALL):
+		return None
+
+	# Create the payload
+	payload = setImuSummaryPayload(
+		window			= _window,
+		included		= _included
+	)
+
+	# Create and return the serial packet
+	return createPacket(raw(payload), "command")
+
+def setStoreForwardPacket(_enable = True, _linkTimeout = STORE_DEFAULT_LINK_TIMEOUT, _interval = STORE_DEFAULT_INTERVAL):
+	# Perform validity checks on the parameters
+	if (_linkTimeout < 0 or _linkTimeout > 0xFFFF or (_enable and _linkTimeout == 0)):
+		return None
+	elif (_interval < 0 or _interval > 0xFFFF):
+		return None
+
+	# Create the payload
+	payload = setStoreForwardPayload(
+		enable			= 1 if _enable else 0,
+		linkTimeout		= _linkTimeout,
+		interval		= _interval
+	)
+
+	# Create and return the serial packet
+	return createPacket(raw(payload), "command")
 
 	
 #------------Get commands------------#	
@@ -336,6 +864,75 @@ def getModuleStatusPacket():
 
 	# Create and return the serial packet
 	return createPacket(raw(payload), "command")	
+
+def getChannelStatsPacket():
+	# Create the payload
+	payload = getChannelStatsPayload()
+
+	# Create and return the serial packet
+	return createPacket(raw(payload), "command")
+
+def getHoppingStatsPacket():
+	# Create the payload
+	payload = getHoppingStatsPayload()
+
+	# Create and return the serial packet
+	return createPacket(raw(payload), "command")
+
+def getRadioProfilesPacket():
+	# Create the payload
+	payload = getRadioProfilesPayload()
+
+	# Create and return the serial packet
+	return createPacket(raw(payload), "command")
+
+def getTimeSyncStatusPacket():
+	# Create the payload
+	payload = getTimeSyncStatusPayload()
+
+	# Create and return the serial packet
+	return createPacket(raw(payload), "command")
+
+def getTaskStatsPacket(_reset = False):
+	# Create the payload
+	payload = getTaskStatsPayload(
+		reset			= 1 if _reset else 0
+	)
+
+	# Create and return the serial packet
+	return createPacket(raw(payload), "command")
+
+def getPerfStatsPacket(_reset = False):
+	# Create the payload
+	payload = getPerfStatsPayload(
+		subcommand		= PERF_STATS_RESET if _reset else PERF_STATS_READ
+	)
+
+	# Create and return the serial packet
+	return createPacket(raw(payload), "command")
+
+def getCommandStatsPacket(_reset = False):
+	# Create the payload
+	payload = getCommandStatsPayload(
+		reset			= 1 if _reset else 0
+	)
+
+	# Create and return the serial packet
+	return createPacket(raw(payload), "command")
+
+def getEnergyStatusPacket():
+	# Create the payload
+	payload = getEnergyStatusPayload()
+
+	# Create and return the serial packet
+	return createPacket(raw(payload), "command")
+
+def getStoreForwardStatusPacket():
+	# Create the payload
+	payload = getStoreForwardStatusPayload()
+
+	# Create and return the serial packet
+	return createPacket(raw(payload), "command")
 	
 	
 #-------Miscellaneous commands-------#	
@@ -0,0 +1,126 @@
+# Writes Schemas.py from the payload schemas in the firmware's Schemas.h, so the GUI and the module
+# always agree on field order, types, and lengths. Rerun whenever Schemas.h changes:
+#	python Generate_schemas.py
+# Add --float-payloads for firmware built with FLOAT_PAYLOADS 1.
+
+
+#--------------------------------------------------------------------------\
+#								  	Imports					   			   |
+#--------------------------------------------------------------------------/
+
+
+import os
+import re
+import sys
+
+
+#--------------------------------------------------------------------------\
+#								  Definitions					   		   |
+#--------------------------------------------------------------------------/
+
+
+SCRIPT_DIR			= os.path.dirname(os.path.abspath(__file__))
+SCHEMA_HEADER		= os.path.join(SCRIPT_DIR, "..", "LCOM", "Schemas.h")
+OUTPUT_FILE			= os.path.join(SCRIPT_DIR, "Schemas.py")
+
+# Codec.h field types, as (scapy field, extra arguments, default, size on the wire)
+FIELD_TYPES = {
+	"U8":		("ByteField",			"",										"0",	1),
+	"I8":		("SignedByteField",		"",										"0",	1),
+	"U16":		("ShortField",			"",										"0",	2),
+	"I16":		("SignedShortField",	"",										"0",	2),
+	"U32":		("IntField",			"",										"0",	4),
+	"I32":		("SignedIntField",		"",										"0",	4),
+	"F32":		("IEEEFloatField",		"",										"0.0",	4),
+
+	# Fixed point, scaled so the GUI still works in the units it shows (MHz, kHz, mA, dB, degrees C)
+	"FIX0_U32":	("ScalingField",		", scaling=1, ndigits=0, fmt=\"!I\"",		"0",	4),
+	"FIX1_U16":	("ScalingField",		", scaling=0.1, ndigits=1, fmt=\"!H\"",	"0.0",	2),
+	"FIX2_I16":	("ScalingField",		", scaling=0.01, ndigits=2, fmt=\"!h\"",	"0.0",	2),
+	"FIX3_U32":	("ScalingField",		", scaling=0.001, ndigits=3, fmt=\"!I\"",	"0.0",	4)
+}
+
+# The same fixed-point types in a FLOAT_PAYLOADS build
+FLOAT_FIELD_TYPE	= ("IEEEFloatField",	"",										"0.0",	4)
+
+SCHEMA_START		= re.compile(r"#define\s+(\w+)_SCHEMA\(X\)")
+SCHEMA_FIELD		= re.compile(r"X\(\s*(\w+)\s*,\s*(\w+)\s*\)")
+
+
+#--------------------------------------------------------------------------\
+#								   Functions					   		   |
+#--------------------------------------------------------------------------/
+
+
+# Returns [(name, [(type, field), ...]), ...] in the order the schemas appear
+def readSchemas(_path):
+	schemas = []
+	fields = None
+	with open(_path) as header:
+		for line in header:
+			start = SCHEMA_START.search(line)
+			if (start):
+				fields = []
+				schemas.append((start.group(1), fields))
+				continue
+			if (fields is None):
+				continue
+
+			field = SCHEMA_FIELD.search(line)
+			if (field):
+				if (field.group(1) not in FIELD_TYPES):
+					raise ValueError("Unknown field type %s in %s" % (field.group(1), line.strip()))
+				fields.append((field.group(1), field.group(2)))
+
+			# The schema ends on its first line without a continuation
+			if (not line.rstrip().endswith("\\")):
+				fields = None
+	return schemas
+
+# Returns the (scapy field, extra arguments, default, size) a field type is sent as
+def fieldType(_type, _floatPayloads):
+	if (_floatPayloads and _type.startswith("FIX")):
+		return FLOAT_FIELD_TYPE
+	return FIELD_TYPES[_type]
+
+def writeSchemas(_schemas, _path, _floatPayloads):
+	lines = [
+		"# Generated by Generate_schemas.py from LCOM/Schemas.h, do not edit",
+		"",
+		"from scapy.all import *",
+		"",
+		"FLOAT_PAYLOADS = %s" % _floatPayloads,
+		"",
+		"# Fixed-point fields outside the schemas, e.g. hop channel frequencies (FIX3_U32)"
+	]
+	for typeName in sorted(FIELD_TYPES):
+		if (typeName.startswith("FIX")):
+			scapyField, arguments, _, _ = fieldType(typeName, _floatPayloads)
+			lines.append("def %sField(_name, _default):" % typeName)
+			lines.append("\treturn %s(_name, _default%s)" % (scapyField, arguments))
+
+	for name, fields in _schemas:
+		length = sum(fieldType(t, _floatPayloads)[3] for t, _ in fields)
+		lines.append("")
+		lines.append("%s_LEN = %d" % (name, length))
+		lines.append("%s_SCHEMA = [" % name)
+		for i, (t, field) in enumerate(fields):
+			scapyField, arguments, default, _ = fieldType(t, _floatPayloads)
+			separator = "," if i < len(fields) - 1 else ""
+			lines.append("\t%s(\"%s\", %s%s)%s" % (scapyField, field, default, arguments, separator))
+		lines.append("]")
+
+	with open(_path, "w") as output:
+		output.write("\n".join(lines) + "\n")
+
+
+#--------------------------------------------------------------------------\
+#								     Main					   		   	   |
+#--------------------------------------------------------------------------/
+
+
+if __name__ == "__main__":
+	floatPayloads = ("--float-payloads" in sys.argv[1:])
+	schemas = readSchemas(SCHEMA_HEADER)
+	writeSchemas(schemas, OUTPUT_FILE, floatPayloads)
+	print("Wrote %d schemas to %s" % (len(schemas), OUTPUT_FILE))
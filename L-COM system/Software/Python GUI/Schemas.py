@@ -0,0 +1,167 @@
+# Generated by Generate_schemas.py from LCOM/Schemas.h, do not edit
+
+from scapy.all import *
+
+FLOAT_PAYLOADS = False
+
+# Fixed-point fields outside the schemas, e.g. hop channel frequencies (FIX3_U32)
+def FIX0_U32Field(_name, _default):
+	return ScalingField(_name, _default, scaling=1, ndigits=0, fmt="!I")
+def FIX1_U16Field(_name, _default):
+	return ScalingField(_name, _default, scaling=0.1, ndigits=1, fmt="!H")
+def FIX2_I16Field(_name, _default):
+	return ScalingField(_name, _default, scaling=0.01, ndigits=2, fmt="!h")
+def FIX3_U32Field(_name, _default):
+	return ScalingField(_name, _default, scaling=0.001, ndigits=3, fmt="!I")
+
+LORA_PARAMETERS_LEN = 16
+LORA_PARAMETERS_SCHEMA = [
+	ScalingField("frequency", 0.0, scaling=0.001, ndigits=3, fmt="!I"),
+	ScalingField("bandwidth", 0.0, scaling=0.001, ndigits=3, fmt="!I"),
+	ByteField("spreadingFactor", 0),
+	ByteField("codingRate", 0),
+	ByteField("syncWord", 0),
+	SignedByteField("power", 0),
+	ShortField("preambleLength", 0),
+	ScalingField("currentLimit", 0.0, scaling=0.1, ndigits=1, fmt="!H")
+]
+
+UNIX_TIME_LEN = 8
+UNIX_TIME_SCHEMA = [
+	IntField("timestamp", 0),
+	ShortField("milliseconds", 0),
+	SignedShortField("drift", 0)
+]
+
+MODULE_STATUS_LEN = 33
+MODULE_STATUS_SCHEMA = [
+	ByteField("loraSet", 0),
+	ByteField("unixSet", 0),
+	IntField("uptime", 0),
+	ScalingField("temperature", 0.0, scaling=0.01, ndigits=2, fmt="!h"),
+	IntField("timeOnAir", 0),
+	ScalingField("dataRate", 0, scaling=1, ndigits=0, fmt="!I"),
+	ByteField("resetCause", 0),
+	ShortField("resetCount", 0),
+	ShortField("freeRam", 0),
+	ShortField("stackHeadroom", 0),
+	ShortField("staticRam", 0),
+	ShortField("batteryVoltage", 0),
+	SignedShortField("batteryCurrent", 0),
+	ScalingField("batteryTemperature", 0.0, scaling=0.01, ndigits=2, fmt="!h"),
+	ByteField("powerFlags", 0),
+	ByteField("powerLevel", 0)
+]
+
+TIME_SYNC_STATUS_LEN = 20
+TIME_SYNC_STATUS_SCHEMA = [
+	ByteField("mode", 0),
+	ByteField("synced", 0),
+	ShortField("period", 0),
+	ShortField("beaconsSent", 0),
+	ShortField("beaconsReceived", 0),
+	SignedIntField("lastOffset", 0),
+	ShortField("meanOffset", 0),
+	SignedShortField("drift", 0),
+	IntField("sinceBeacon", 0)
+]
+
+MESSAGE_FIELDS_LEN = 6
+MESSAGE_FIELDS_SCHEMA = [
+	ScalingField("RSSI", 0.0, scaling=0.01, ndigits=2, fmt="!h"),
+	ScalingField("SNR", 0.0, scaling=0.01, ndigits=2, fmt="!h"),
+	SignedShortField("result", 0)
+]
+
+IMU_BATCH_LEN = 9
+IMU_BATCH_SCHEMA = [
+	ShortField("sequence", 0),
+	IntField("time", 0),
+	ShortField("rate", 0),
+	ByteField("count", 0)
+]
+
+IMU_SAMPLE_LEN = 12
+IMU_SAMPLE_SCHEMA = [
+	SignedShortField("accelX", 0),
+	SignedShortField("accelY", 0),
+	SignedShortField("accelZ", 0),
+	SignedShortField("gyroX", 0),
+	SignedShortField("gyroY", 0),
+	SignedShortField("gyroZ", 0)
+]
+
+IMU_SUMMARY_LEN = 9
+IMU_SUMMARY_SCHEMA = [
+	ShortField("sequence", 0),
+	IntField("time", 0),
+	ShortField("count", 0),
+	ByteField("included", 0)
+]
+
+IMU_PEAKS_LEN = 8
+IMU_PEAKS_SCHEMA = [
+	ShortField("accelPeak", 0),
+	ShortField("accelPeakTime", 0),
+	ShortField("gyroPeak", 0),
+	ShortField("gyroPeakTime", 0)
+]
+
+GPS_FIX_LEN = 26
+GPS_FIX_SCHEMA = [
+	IntField("time", 0),
+	IntField("utcTime", 0),
+	SignedIntField("latitude", 0),
+	SignedIntField("longitude", 0),
+	SignedIntField("altitude", 0),
+	ShortField("speed", 0),
+	ShortField("course", 0),
+	ByteField("satellites", 0),
+	ByteField("fixType", 0)
+]
+
+POWER_STATUS_LEN = 11
+POWER_STATUS_SCHEMA = [
+	IntField("time", 0),
+	ShortField("batteryVoltage", 0),
+	SignedShortField("batteryCurrent", 0),
+	ScalingField("batteryTemperature", 0.0, scaling=0.01, ndigits=2, fmt="!h"),
+	ByteField("powerFlags", 0)
+]
+
+ENERGY_STATUS_LEN = 48
+ENERGY_STATUS_SCHEMA = [
+	IntField("uptime", 0),
+	IntField("txTime", 0),
+	IntField("rxTime", 0),
+	IntField("standbyTime", 0),
+	IntField("mcuActiveTime", 0),
+	IntField("mcuIdleTime", 0),
+	ScalingField("txCharge", 0.0, scaling=0.001, ndigits=3, fmt="!I"),
+	ScalingField("rxCharge", 0.0, scaling=0.001, ndigits=3, fmt="!I"),
+	ScalingField("standbyCharge", 0.0, scaling=0.001, ndigits=3, fmt="!I"),
+	ScalingField("mcuActiveCharge", 0.0, scaling=0.001, ndigits=3, fmt="!I"),
+	ScalingField("mcuIdleCharge", 0.0, scaling=0.001, ndigits=3, fmt="!I"),
+	ScalingField("totalCharge", 0.0, scaling=0.001, ndigits=3, fmt="!I")
+]
+
+STORED_RECORD_LEN = 2
+STORED_RECORD_SCHEMA = [
+	ShortField("sequence", 0)
+]
+
+STORE_FORWARD_STATUS_LEN = 22
+STORE_FORWARD_STATUS_SCHEMA = [
+	ByteField("enabled", 0),
+	ByteField("linkUp", 0),
+	ShortField("linkTimeout", 0),
+	ShortField("storeInterval", 0),
+	IntField("sinceHeard", 0),
+	ByteField("slots", 0),
+	ByteField("pending", 0),
+	ShortField("nextSequence", 0),
+	ShortField("stored", 0),
+	ShortField("forwarded", 0),
+	ShortField("overwritten", 0),
+	ShortField("dropped", 0)
+]
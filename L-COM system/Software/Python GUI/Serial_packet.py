@@ -17,7 +17,7 @@ START_FLAG					= 0x7E
 END_FLAG					= 0x7F
 
 # Packet, header, and payload lengths
-PKT_MAX_LEN					= 274
+PKT_MAX_LEN					= 276 # Includes the header extension
 PKT_HEADER_LEN				= 9 # This includes the 1 byte trailer
 PKT_MAX_DATA_PAYLOAD_LEN	= 265 # PKT_MAX_LEN - PKT_HEADER_LEN
 
@@ -26,12 +26,16 @@ TYPE_CYCLIC_FIELD_INDEX		= 1
 LENGTH_INDEX				= 2
 UNIX_TIME_INDEX				= 4
 PAYLOAD_INDEX				= 8
+UNIX_MS_INDEX				= 8 # Only with the header extension, the payload then starts 2 bytes later
 
-# Packet type (Most-significant 3 bits identify type, last 5 bits are for cyclic frame count)
+# Packet type (Most-significant bit flags the header extension, next 2 bits identify type, last 5 bits are for cyclic frame count)
 #STATUS_PACKET 				= 0b00000000
 ACK_PACKET 					= 0b00000000
 COMMAND_PACKET 				= 0b00100000
 MESSAGE_PACKET 				= 0b01000000
+TRACE_PACKET 				= 0b01100000
+PACKET_TYPE_MASK			= 0b01100000
+HEADER_EXTENSION_FLAG		= 0b10000000
 
 
 #--------------------------------------------------------------------------\
@@ -55,6 +59,7 @@ class Packet(Packet):
 		ByteField("packet_typeCyclic", (ACK_PACKET | _cyclicID)),
 		ShortField("packetLength", 0),
 		IntField("UNIXTime", int(time.time())),
+		ConditionalField(ShortField("UNIXMillis", 0), lambda pkt: pkt.packet_typeCyclic & HEADER_EXTENSION_FLAG),
 		StrLenField("payloadData", None),
 		#PadField(StrLenField("payloadData", ""), PKT_MAX_DATA_PAYLOAD_LEN),
 		ByteField("endFlag", END_FLAG)
@@ -66,12 +71,14 @@ class Packet(Packet):
 #--------------------------------------------------------------------------/				
 
 
-def createPacket(_payload, _type):
+def createPacket(_payload, _type, _extended=False):
 	# Declare the global variables
 	global _cyclicID
 	
 	# Variables
-	currentTime = int(time.time()) 					# Get the current time
+	now = time.time()
+	currentTime = int(now) 							# Get the current time
+	currentMillis = int((now - currentTime) * 1000)
 
 	# Increment the cyclic frame count
 	_cyclicID = (_cyclicID + 1) % 32	
@@ -88,13 +95,16 @@ def createPacket(_payload, _type):
 	else:
 		return
 
-	_packetIdentifier = (packetType & 0b11100000) | (_cyclicID & 0b00011111)
+	_packetIdentifier = (packetType & PACKET_TYPE_MASK) | (_cyclicID & 0b00011111)
+	if _extended:
+		_packetIdentifier |= HEADER_EXTENSION_FLAG
 	
 	# Create the packet
 	packet = Packet(
 		packet_typeCyclic 	= _packetIdentifier,	
 		packetLength 		= 0,
 		UNIXTime 			= currentTime,
+		UNIXMillis 			= currentMillis,
 		payloadData 		= _payload[:PKT_MAX_DATA_PAYLOAD_LEN],
 	)
 
@@ -0,0 +1,157 @@
+#--------------------------------------------------------------------------\
+#								  	Imports					   			   |
+#--------------------------------------------------------------------------/
+
+
+import os
+import struct
+import sys
+import time
+import serial
+
+
+#--------------------------------------------------------------------------\
+#								  Definitions					   		   |
+#--------------------------------------------------------------------------/
+
+
+# Serial framing (see Serial_packet.py)
+START_FLAG					= 0x7E
+END_FLAG					= 0x7F
+PKT_HEADER_LEN				= 8
+PKT_HEADER_EXTENSION_LEN	= 2
+PKT_MAX_LEN					= 276
+PACKET_TYPE_MASK			= 0b01100000
+HEADER_EXTENSION_FLAG		= 0b10000000
+TRACE_PACKET 				= 0b01100000
+
+# Trace record, all stage times in microseconds
+TRACE_RECORD_FORMAT			= ">7IH"
+TRACE_RECORD_LEN			= struct.calcsize(TRACE_RECORD_FORMAT)
+STAGES						= ["UART receive", "Dispatch", "Channel access", "Time-on-air", "Poll wait", "Processing", "UART transmit"]
+
+# Histogram bins (upper edges, us), the last bin catches everything above
+BIN_EDGES					= [100, 300, 1000, 3000, 10000, 30000, 100000, 300000, 1000000]
+BAR_WIDTH					= 40
+
+
+#--------------------------------------------------------------------------\
+#								   Functions					   		   |
+#--------------------------------------------------------------------------/
+
+
+def readPackets(_stream, _live):
+	# Yields complete packets, resynchronizing on the start flag. A live port yields None when idle.
+	buf = b''
+	while True:
+		data = _stream.read(64)
+		if not data:
+			if not _live:
+				return
+			yield None
+			continue
+		buf += data
+
+		while True:
+			start = buf.find(bytes([START_FLAG]))
+			if start < 0:
+				buf = b''
+				break
+			buf = buf[start:]
+			if len(buf) < 4:
+				break
+
+			length = struct.unpack(">H", buf[2:4])[0]
+			if length < PKT_HEADER_LEN + 1 or length > PKT_MAX_LEN:
+				buf = buf[1:]
+				continue
+			if len(buf) < length:
+				break
+
+			packet, buf = buf[:length], buf[length:]
+			if packet[-1] == END_FLAG:
+				yield packet
+
+def traceRecord(_packet):
+	# Returns the stage times and frame length of a trace packet, or None for anything else
+	if (_packet[1] & PACKET_TYPE_MASK) != TRACE_PACKET:
+		return None
+	payloadIndex = PKT_HEADER_LEN + (PKT_HEADER_EXTENSION_LEN if _packet[1] & HEADER_EXTENSION_FLAG else 0)
+	payload = _packet[payloadIndex:-1]
+	if len(payload) != TRACE_RECORD_LEN:
+		return None
+	fields = struct.unpack(TRACE_RECORD_FORMAT, payload)
+	return fields[:-1], fields[-1]
+
+def binLabel(_i):
+	if _i == 0:
+		return "< %d us" % BIN_EDGES[0]
+	if _i == len(BIN_EDGES):
+		return ">= %d us" % BIN_EDGES[-1]
+	return "%d-%d us" % (BIN_EDGES[_i-1], BIN_EDGES[_i])
+
+def printHistograms(_samples):
+	count = len(_samples[0])
+	print("\n%d traced messages" % count)
+	if count == 0:
+		return
+
+	# Stage summary, largest mean first shows where the time goes
+	means = [sum(s) / count for s in _samples]
+	total = sum(means)
+	print("\n%-16s %10s %10s %10s %7s" % ("Stage", "Mean (us)", "Max (us)", "Min (us)", "Share"))
+	for i in sorted(range(len(STAGES)), key=lambda i: -means[i]):
+		print("%-16s %10d %10d %10d %6.1f%%" % (STAGES[i], means[i], max(_samples[i]), min(_samples[i]), 100 * means[i] / total if total else 0))
+
+	# Per-stage histograms
+	for i, stage in enumerate(STAGES):
+		bins = [0] * (len(BIN_EDGES) + 1)
+		for value in _samples[i]:
+			b = 0
+			while b < len(BIN_EDGES) and value >= BIN_EDGES[b]:
+				b += 1
+			bins[b] += 1
+
+		print("\n" + stage)
+		peak = max(bins)
+		for b, n in enumerate(bins):
+			if n:
+				print("  %-18s %6d %s" % (binLabel(b), n, '#' * max(1, n * BAR_WIDTH // peak)))
+
+
+#--------------------------------------------------------------------------\
+#								  Program run					   		   |
+#--------------------------------------------------------------------------/
+
+
+if __name__ == '__main__':
+	# Either a port on the receiving module (e.g. COM3, /dev/ttyUSB0) or a file of captured serial output
+	if len(sys.argv) < 2:
+		print("Usage: Trace_histogram.py <port | capture file> [seconds]")
+		sys.exit(1)
+	source = sys.argv[1]
+	duration = float(sys.argv[2]) if len(sys.argv) > 2 else None
+
+	# A regular file is a capture, anything else is opened as a port
+	live = not os.path.isfile(source)
+	if live:
+		stream = serial.Serial(source, 115200, timeout=1)
+		print(stream.name + ' is open, Ctrl+C to stop...')
+	else:
+		stream = open(source, 'rb')
+
+	samples = [[] for _ in STAGES]
+	started = time.time()
+	try:
+		for packet in readPackets(stream, live):
+			record = traceRecord(packet) if packet else None
+			if record is not None:
+				stages, frameLength = record
+				for i, value in enumerate(stages):
+					samples[i].append(value)
+			if duration and time.time() - started > duration:
+				break
+	except KeyboardInterrupt:
+		pass
+
+	printHistograms(samples)
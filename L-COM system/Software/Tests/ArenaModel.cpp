@@ -0,0 +1,255 @@
+/*
+*   Purpose :   Packet arena occupancy model. Every owner of an arena block runs at once, the way
+*               LCOM.ino's tasks use them: host packets arriving at 115200 baud and spanning many
+*               readSerial runs, some cut off mid-packet, commands answered with an Ack and
+*               messages sent over the radio, frames received and passed up, and telemetry to the
+*               UART, then to the radio with the link down and records stored, then with it up and
+*               the stored records forwarded. The most blocks ever in use is the pool's worst case,
+*               and nothing may be dropped for want of a block.
+*/
+
+
+#include "HostTest.h"
+#include "HostArduino.h"
+#include "PacketArena.h"
+#include "Perf.h"
+#include "RadioController.h"
+#include "SerialInterface.h"
+#include "StoreForward.h"
+#include "Telemetry.h"
+#include <random>
+#include <vector>
+
+
+/*-------------------------------------------------------------------------*\
+|								  Definitions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    #define MODEL_PHASE_DURATION            (3ULL * 60 * 1000)      // ms of each telemetry phase
+    #define MODEL_BYTE_MICROS               87                      // One byte at SERIAL_BAUD
+    #define MODEL_PACKET_GAP                30                      // ms, mean idle time between host packets
+    #define MODEL_MESSAGE_MAX               64                      // Longest message the host sends, bytes
+    #define MODEL_CUT_OFF                   0.02                    // Fraction of host packets that stop mid-packet
+    #define MODEL_FRAME_GAP                 150                     // ms, mean time between received frames
+    #define MODEL_TELEMETRY_PERIOD          40                      // ms between telemetry records
+    #define MODEL_READ_SERIAL_PERIOD        1                       // LCOM.ino's READ_SERIAL_PERIOD
+    #define MODEL_READ_RADIO_PERIOD         100                     // LCOM.ino's READ_RADIO_PERIOD
+    #define MODEL_SEED                      37
+
+
+/*-------------------------------------------------------------------------*\
+|								   Variables					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    std::mt19937 rng(MODEL_SEED);
+    std::vector<uint8_t> hostBytes;                                 // Host packets not yet on the line
+    uint64_t nextByte = 0;                                          // us
+    uint32_t packetsSent = 0;
+    uint32_t acksSent = 0;
+    uint32_t messagesSent = 0;
+    uint32_t framesPassedUp = 0;
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       queueHostPacket                                                         |
+    |   Purpose:    Queues the host's next packet, three in four a command and the rest a   |
+    |               message of random length, sometimes cut off before its end.             |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void queueHostPacket(void){
+        std::vector<uint8_t> payload;
+        uint8_t type;
+        if(rng() % 4){
+            type = COMMAND_PACKET;
+            payload.resize(2, 0);
+        }
+        else{
+            type = MESSAGE_PACKET;
+            payload.resize(MESSAGE_FIELDS_LEN, 0);
+            uint16_t len = 1 + rng() % MODEL_MESSAGE_MAX;
+            for(uint16_t i = 0; i != len; i++) payload.push_back('a' + i % 26);
+        }
+
+        uint16_t len = PKT_HEADER_TRAILER_LEN + payload.size();
+        uint8_t header[PKT_HEADER_LEN] = { START_FLAG, type, (uint8_t)(len >> 8), (uint8_t)len, 0, 0, 0, 0 };
+        hostBytes.insert(hostBytes.end(), header, header + PKT_HEADER_LEN);
+        hostBytes.insert(hostBytes.end(), payload.begin(), payload.end());
+        hostBytes.push_back(END_FLAG);
+        if(std::uniform_real_distribution<double>(0, 1)(rng) < MODEL_CUT_OFF) hostBytes.resize(hostBytes.size() - 1 - rng() % payload.size());
+        packetsSent++;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       modelReadSerial                                                         |
+    |   Purpose:    As LCOM.ino's readSerial and handleSerialPacket, answering a command    |
+    |               with an Ack carrying the perf stats, and sending a message over the     |
+    |               radio, each in its own block.                                           |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void modelReadSerial(void){
+        int16_t res;
+        do{
+            res = readSerialData();
+        } while(res == NEW_PARTIAL_SERIAL_DATA);
+
+        SerialFrame frame;
+        while(takeSerialFrame(&frame)){
+            uint8_t* buf = frame.packet;
+            if((buf[TYPE_CYCLIC_FIELD_INDEX] & PACKET_TYPE_MASK) == COMMAND_PACKET){
+                uint8_t* retBuf = buf + PKT_HEADER_LEN + ACK_RESULT_LEN;
+                uint16_t retLen = getPerfStats(retBuf);
+                handoffBlock(frame.block, ARENA_OWNER_UART_TX);
+                createAckPacket(ERR_NONE, retBuf, retLen);
+                writeSerialPacket();
+                acksSent++;
+            }
+            else{
+                handoffBlock(frame.block, ARENA_OWNER_RADIO_TX);
+                CHECK_EQUAL(transmitRadio(buf + MESSAGE_INDEX, frame.length - MESSAGE_INDEX - PKT_TRAILER_LEN), ERR_NONE);
+                messagesSent++;
+            }
+            releaseBlock(frame.block);
+        }
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       modelReadRadio                                                          |
+    |   Purpose:    As LCOM.ino's readRadio, passing a received frame up as a message       |
+    |               packet built in its block.                                              |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void modelReadRadio(void){
+        int16_t res = readRadioData();
+        if(res == NO_NEW_RADIO_DATA) return;
+
+        uint8_t* data = getRadioData();
+        uint16_t len = getRadioDataLength();
+        uint8_t block = getRadioBlock();
+        handoffBlock(block, ARENA_OWNER_UART_TX);
+        createMessagePacket(res, 0, 0, data, len);
+        writeSerialPacket();
+        releaseBlock(block);
+        framesPassedUp++;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       modelTelemetry                                                          |
+    |   Purpose:    Sends a power record, as servicePowerBoard does after a poll.           |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void modelTelemetry(void){
+        uint8_t* record = beginTelemetryRecord(TELEMETRY_POWER);
+        CHECK(record != NULL);
+        if(record == NULL) return;
+        memset(record, 0, POWER_STATUS_LEN);
+        sendTelemetryRecord(POWER_STATUS_LEN);
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       runPhase                                                                |
+    |   Purpose:    Runs every owner for MODEL_PHASE_DURATION, with frames arriving or not. |
+    |   Arguments:  bool                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void runPhase(bool framesArrive){
+        std::exponential_distribution<double> packetGap(1.0 / MODEL_PACKET_GAP);
+        std::exponential_distribution<double> frameGap(1.0 / MODEL_FRAME_GAP);
+        uint32_t end = millis() + MODEL_PHASE_DURATION;
+        uint32_t nextFrame = millis() + (uint32_t)frameGap(rng);
+        uint32_t nextPacket = millis();
+        uint32_t nextTelemetry = millis();
+        uint32_t nextRadio = millis();
+        uint32_t nextStore = millis();
+
+        while((int32_t)(millis() - end) < 0){
+            /* The host's bytes, as the UART takes them in */
+            if(hostBytes.empty() && (int32_t)(millis() - nextPacket) >= 0){
+                queueHostPacket();
+                nextByte = hostMicros();
+            }
+            while(!hostBytes.empty() && nextByte <= hostMicros()){
+                hostSerialFeed(&hostBytes[0], 1);
+                hostBytes.erase(hostBytes.begin());
+                nextByte += MODEL_BYTE_MICROS;
+                if(hostBytes.empty()) nextPacket = millis() + 1 + (uint32_t)packetGap(rng);
+            }
+
+            /* A frame from the peer */
+            if(framesArrive && (int32_t)(millis() - nextFrame) >= 0){
+                uint8_t frame[AIR_HEADER_LEN + 24];
+                frame[0] = AIR_FRAME_DATA;
+                memset(frame + AIR_HEADER_LEN, 'f', sizeof(frame) - AIR_HEADER_LEN);
+                hostRadioReceive(frame, sizeof(frame));
+                nextFrame = millis() + 1 + (uint32_t)frameGap(rng);
+            }
+
+            /* The tasks, each run to completion */
+            modelReadSerial();
+            if((int32_t)(millis() - nextRadio) >= 0){
+                modelReadRadio();
+                nextRadio = millis() + MODEL_READ_RADIO_PERIOD;
+            }
+            if((int32_t)(millis() - nextTelemetry) >= 0){
+                modelTelemetry();
+                nextTelemetry = millis() + MODEL_TELEMETRY_PERIOD;
+            }
+            if((int32_t)(millis() - nextStore) >= 0){
+                serviceStoreForward();
+                nextStore = millis() + STORE_SERVICE_PERIOD;
+            }
+
+            hostSerialClear();
+            hostAdvanceMicros(MODEL_READ_SERIAL_PERIOD * 1000);
+        }
+    }
+
+
+/*-------------------------------------------------------------------------*\
+|								     Main					   			    |
+\*-------------------------------------------------------------------------*/
+
+
+    int main(void){
+        hostEepromErase();
+        CHECK_EQUAL(initializeRadio(), ERR_NONE);
+        initializeStoreForward();
+        CHECK_EQUAL(configureStoreForward(true, STORE_DEFAULT_LINK_TIMEOUT, STORE_DEFAULT_INTERVAL), STORE_OK);
+        hostRadio.transmitMicros = getTimeOnAir(MODEL_MESSAGE_MAX);
+        resetPerfStats();
+
+        /* Telemetry to the UART, then to the radio with the link down, then up and forwarding */
+        CHECK_EQUAL(setTelemetryDestination(TELEMETRY_UART), TELEMETRY_OK);
+        runPhase(true);
+        CHECK_EQUAL(setTelemetryDestination(TELEMETRY_RADIO), TELEMETRY_OK);
+        hostAdvanceMicros(STORE_DEFAULT_LINK_TIMEOUT * 1000000ULL);
+        runPhase(false);
+        StoreForwardStatus stored = getStoreForwardStatus();
+        runPhase(true);
+        StoreForwardStatus forwarded = getStoreForwardStatus();
+
+        printf("%lu host packets, %lu Acks, %lu messages sent, %lu frames passed up\n", (unsigned long)packetsSent,
+            (unsigned long)acksSent, (unsigned long)messagesSent, (unsigned long)framesPassedUp);
+        printf("%lu records stored with the link down, %lu forwarded\n", (unsigned long)stored.stored, (unsigned long)forwarded.forwarded);
+        printf("Blocks: %u in the pool, at most %u in use, %lu wanted with none free, %lu packets or records dropped\n",
+            ARENA_BLOCK_COUNT, getBlocksHighWater(), (unsigned long)perfCounters[PERF_ARENA_EXHAUSTED],
+            (unsigned long)perfCounters[PERF_ARENA_DROPS]);
+
+        CHECK(acksSent > 0 && messagesSent > 0 && framesPassedUp > 0);
+        CHECK(stored.stored > 0 && forwarded.forwarded > 0);
+        CHECK_EQUAL(getBlocksHighWater(), ARENA_BLOCK_COUNT);
+        CHECK_EQUAL(perfCounters[PERF_ARENA_EXHAUSTED], 0);
+        CHECK_EQUAL(perfCounters[PERF_ARENA_DROPS], 0);
+
+        return hostTestResult();
+    }
@@ -0,0 +1,275 @@
+/*
+*   Purpose :   Discharge model for the power policy. A 3S lithium pack runs down under the board's
+*               load, second by second: the firmware sends its telemetry over the radio and counts
+*               the charge in Energy.cpp, the pack's open circuit voltage follows a cell curve, and
+*               each reading L-COM takes from the power board is that voltage less the sag of
+*               whatever was drawing at the time, a transmit if one was on air, plus noise.
+*
+*               Every reading goes through updatePowerPolicy, and the levels it moves through, the
+*               caps the radio was given, and how long the pack lasted are checked against the
+*               same flight with the policy left out. A pack swap and a noisier power board follow.
+*/
+
+
+#include "HostTest.h"
+#include "HostArduino.h"
+#include "Energy.h"
+#include "PowerPolicy.h"
+#include "RadioController.h"
+#include "Telemetry.h"
+#include <math.h>
+#include <random>
+
+
+/*-------------------------------------------------------------------------*\
+|								  Definitions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /* The pack */
+    #define MODEL_CELLS                     3
+    #define MODEL_CAPACITY                  3400                    // mAh, an 18650 cell
+    #define MODEL_RESISTANCE                450                     // mOhm, three cold cells and the wiring
+    #define MODEL_CUTOFF_VOLTAGE            9000                    // mV under load, 3.0 V a cell, where the flight ends
+
+    /* The board */
+    #define MODEL_RAIL_VOLTAGE              5000                    // mV, the R-78C5.0's output
+    #define MODEL_REGULATOR_EFFICIENCY      0.85
+    #define MODEL_PAYLOAD_CURRENT           300                     // 0.1 mA, GPS and IMU, which Energy.cpp doesn't count
+
+    /* The flight, at the settings the notes call max range */
+    #define MODEL_SPREADING_FACTOR          10
+    #define MODEL_OUTPUT_POWER              MAX_OUTPUT_POWER
+    #define MODEL_CURRENT_LIMIT             MAX_CURRENT_LIMIT
+    #define MODEL_GPS_PERIOD                5                       // s between each record type
+    #define MODEL_SUMMARY_PERIOD            10
+    #define MODEL_POWER_PERIOD              30
+    #define MODEL_NOISE                     20                      // mV rms on each reading
+    #define MODEL_NOISY_NOISE               80                      // mV rms, a power board with a noisy ADC
+    #define MODEL_SEED                      47
+
+
+/*-------------------------------------------------------------------------*\
+|								     Types					   			    |
+\*-------------------------------------------------------------------------*/
+
+
+    struct Flight{
+        uint32_t seconds;                                           // Until the pack hit the cutoff under load
+        uint32_t levelEntered[POWER_LEVEL_COUNT];                   // s, 0 for a level never entered
+        uint32_t levelSeconds[POWER_LEVEL_COUNT];
+        uint32_t framesAtLevel[POWER_LEVEL_COUNT];
+        uint32_t descents;
+        uint32_t climbs;
+        uint32_t capErrors;                                         // Level changes the radio's power or limit didn't follow
+        double charge;                                              // mAh drawn from the pack
+        double finalSag;                                            // mV, under the transmit that ended it
+    };
+
+
+/*-------------------------------------------------------------------------*\
+|								   Variables					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /* Open circuit voltage of a cell (mV) from empty to full in tenths, a typical 18650 at 0.2 C */
+    const uint16_t cellCurve[11] = { 3000, 3450, 3600, 3680, 3740, 3790, 3850, 3920, 3990, 4080, 4200 };
+
+    /* Each level's caps, as PowerPolicy.cpp's table gives them */
+    const int8_t levelPower[POWER_LEVEL_COUNT] = { MAX_OUTPUT_POWER, POWER_LOW_TX_POWER, POWER_CRITICAL_TX_POWER };
+    const uint16_t levelCurrentLimit[POWER_LEVEL_COUNT] = { MAX_CURRENT_LIMIT, POWER_LOW_CURRENT_LIMIT, POWER_CRITICAL_CURRENT_LIMIT };
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       packVoltage                                                             |
+    |   Purpose:    Returns the pack's open circuit voltage at a state of charge.           |
+    |   Arguments:  double (0 to 1)                                                         |
+    |   Returns:    double (mV)                                                             |
+    \*-------------------------------------------------------------------------------------*/
+    double packVoltage(double charge){
+        if(charge <= 0) return MODEL_CELLS * cellCurve[0];
+        if(charge >= 1) return MODEL_CELLS * cellCurve[10];
+        int i = (int)(charge * 10);
+        double within = charge * 10 - i;
+        return MODEL_CELLS * (cellCurve[i] + within * (cellCurve[i + 1] - cellCurve[i]));
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       loadedVoltage                                                           |
+    |   Purpose:    Returns the pack's voltage with the rail drawing the given current      |
+    |               through the regulator.                                                  |
+    |   Arguments:  double (open circuit, mV), double (rail, 0.1 mA)                        |
+    |   Returns:    double (mV)                                                             |
+    \*-------------------------------------------------------------------------------------*/
+    double loadedVoltage(double openCircuit, double railCurrent){
+        double batteryCurrent = railCurrent / 10 * MODEL_RAIL_VOLTAGE / (MODEL_REGULATOR_EFFICIENCY * openCircuit);
+        return openCircuit - batteryCurrent * MODEL_RESISTANCE / 1000;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       transmitCurrent                                                         |
+    |   Purpose:    Returns what the rail draws mid-transmit at the power and current limit |
+    |               the chip was given, by Energy.cpp's figures.                            |
+    |   Arguments:  void                                                                    |
+    |   Returns:    double (0.1 mA)                                                         |
+    \*-------------------------------------------------------------------------------------*/
+    double transmitCurrent(void){
+        double pa = ENERGY_TX_CURRENT_0DBM + ENERGY_TX_CURRENT_PER_DBM * hostRadio.power;
+        pa = std::min(pa, (double)hostRadio.currentLimit * 10);
+        return pa + ENERGY_MCU_ACTIVE_CURRENT + MODEL_PAYLOAD_CURRENT;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       sendRecord                                                              |
+    |   Purpose:    Sends a record of the given type and length, if the stretch lets it,    |
+    |               the radio taking its time on air.                                       |
+    |   Arguments:  uint8_t, uint16_t                                                       |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void sendRecord(uint8_t type, uint16_t len){
+        if(!telemetryRecordDue(type)) return;
+        uint8_t* record = beginTelemetryRecord(type);
+        if(record == NULL) return;
+        memset(record, 0, len);
+        hostRadio.transmitMicros = getTimeOnAir(AIR_HEADER_LEN + TELEMETRY_RECORD_HEADER_LEN + len);
+        sendTelemetryRecord(len);
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       fly                                                                     |
+    |   Purpose:    Runs a full pack down to the cutoff, taking a reading every second as   |
+    |               servicePowerBoard does and, with the policy, passing it on.             |
+    |   Arguments:  bool (policy), double (noise, mV rms), std::mt19937&                    |
+    |   Returns:    Flight                                                                  |
+    \*-------------------------------------------------------------------------------------*/
+    Flight fly(bool policy, double noise, std::mt19937& random){
+        std::uniform_real_distribution<double> uniform(0, 1);
+        std::normal_distribution<double> readingNoise(0, noise);
+        const uint16_t summaryLen = IMU_SUMMARY_LEN + 4*IMU_SAMPLE_LEN + IMU_PEAKS_LEN;
+
+        Flight flight = Flight();
+        double openCircuit = packVoltage(1);
+        uint64_t startMicros = hostMicros();
+        uint8_t level = getPowerLevel();
+
+        for(uint32_t second = 0; ; second++){
+            EnergyStatus before = getEnergyStatus();
+            uint32_t frames = hostRadio.txCount;
+            if(second % MODEL_GPS_PERIOD == 0) sendRecord(TELEMETRY_GPS_FIX, GPS_FIX_LEN);
+            if(second % MODEL_SUMMARY_PERIOD == 0) sendRecord(TELEMETRY_IMU_SUMMARY, summaryLen);
+            if(second % MODEL_POWER_PERIOD == 0) sendRecord(TELEMETRY_POWER, POWER_STATUS_LEN);
+            hostSetMicros(std::max(hostMicros(), startMicros + (uint64_t)(second + 1) * 1000000));
+            hostSerialClear();
+
+            EnergyStatus after = getEnergyStatus();
+            flight.levelSeconds[level]++;
+            flight.framesAtLevel[level] += hostRadio.txCount - frames;
+
+            /* The rail's charge this second, the payload's added, drawn from the pack through the regulator */
+            double railCharge = (after.totalCharge - before.totalCharge + MODEL_PAYLOAD_CURRENT / 36.0) / 1000;
+            flight.charge += railCharge * MODEL_RAIL_VOLTAGE / (MODEL_REGULATOR_EFFICIENCY * openCircuit);
+            openCircuit = packVoltage(1 - flight.charge / MODEL_CAPACITY);
+
+            /* The transmitter's peak ends the flight once it pulls the pack under the cutoff */
+            if(hostRadio.txCount != frames){
+                double peak = loadedVoltage(openCircuit, transmitCurrent());
+                if(peak < MODEL_CUTOFF_VOLTAGE){
+                    flight.seconds = second;
+                    flight.finalSag = openCircuit - peak;
+                    return flight;
+                }
+            }
+            if(!policy) continue;
+
+            /* The power board's reading lands mid-transmit as often as the radio was on air */
+            double share = (after.txTime - before.txTime) / 1000.0;
+            double draw = (uniform(random) < share) ? transmitCurrent() : ENERGY_RX_CURRENT + ENERGY_MCU_ACTIVE_CURRENT + MODEL_PAYLOAD_CURRENT;
+            updatePowerPolicy((uint16_t)lround(loadedVoltage(openCircuit, draw) + readingNoise(random)));
+
+            uint8_t next = getPowerLevel();
+            if(next == level) continue;
+            if(next > level) flight.descents++;
+            else flight.climbs++;
+            if(flight.levelEntered[next] == 0) flight.levelEntered[next] = second;
+            level = next;
+
+            int8_t expectedPower = std::min((int8_t)MODEL_OUTPUT_POWER, levelPower[level]);
+            uint16_t expectedLimit = std::min((uint16_t)MODEL_CURRENT_LIMIT, levelCurrentLimit[level]);
+            if(hostRadio.power != expectedPower || lround(hostRadio.currentLimit * 10) != expectedLimit) flight.capErrors++;
+        }
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       printFlight                                                             |
+    |   Purpose:    Prints a flight's levels, frames, and endurance.                        |
+    |   Arguments:  const char*, const Flight&                                              |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void printFlight(const char* name, const Flight& flight){
+        printf("  %-22s %7.2f h  %7.0f mAh  %6.0f mV", name, flight.seconds / 3600.0, flight.charge, flight.finalSag);
+        for(int level = 0; level < POWER_LEVEL_COUNT; level++){
+            printf("  %6.2f h %6lu", flight.levelSeconds[level] / 3600.0, (unsigned long)flight.framesAtLevel[level]);
+        }
+        printf("  %3lu / %lu\n", (unsigned long)flight.descents, (unsigned long)flight.climbs);
+    }
+
+
+/*-------------------------------------------------------------------------*\
+|								     Main					   			    |
+\*-------------------------------------------------------------------------*/
+
+
+    int main(void){
+        hostEepromErase();
+        CHECK_EQUAL(initializeRadio(), ERR_NONE);
+        RadioParameters params = getRadioParameters();
+        params.spreadingFactor = MODEL_SPREADING_FACTOR;
+        params.power = MODEL_OUTPUT_POWER;
+        params.currentLimit = MODEL_CURRENT_LIMIT;
+        CHECK_EQUAL(setRadioParameters(params), ERR_NONE);
+        CHECK_EQUAL(setTelemetryDestination(TELEMETRY_RADIO), TELEMETRY_OK);
+        CHECK_EQUAL(hostRadio.power, MODEL_OUTPUT_POWER);
+
+        std::mt19937 random(MODEL_SEED);
+        printf("%u mAh 3S pack, cutoff %u mV under load, SF%u at %d dBm, records every %u, %u and %u s\n\n", MODEL_CAPACITY,
+            MODEL_CUTOFF_VOLTAGE, MODEL_SPREADING_FACTOR, MODEL_OUTPUT_POWER, MODEL_GPS_PERIOD, MODEL_SUMMARY_PERIOD, MODEL_POWER_PERIOD);
+        printf("  %-22s %9s  %11s  %9s  %15s  %15s  %15s  %s\n", "", "endurance", "charge", "last sag", "normal, frames", "low, frames",
+            "critical, frames", "down / up");
+
+        /* The same pack with the policy left out, then through it */
+        Flight uncapped = fly(false, MODEL_NOISE, random);
+        printFlight("no policy", uncapped);
+        Flight capped = fly(true, MODEL_NOISE, random);
+        printFlight("policy", capped);
+
+        /* Down through each level once, in order, with the radio following, and no climbing back on a falling pack */
+        CHECK_EQUAL(capped.descents, POWER_LEVEL_COUNT - 1);
+        CHECK_EQUAL(capped.climbs, 0);
+        CHECK_EQUAL(capped.capErrors, 0);
+        CHECK(capped.levelEntered[POWER_LEVEL_LOW] > 0);
+        CHECK(capped.levelEntered[POWER_LEVEL_CRITICAL] > capped.levelEntered[POWER_LEVEL_LOW]);
+        CHECK(capped.seconds > uncapped.seconds);
+        CHECK(capped.finalSag < uncapped.finalSag);
+
+        /* A fresh pack: back up to normal, and the radio uncapped */
+        for(int i = 0; i < 20; i++) updatePowerPolicy(MODEL_CELLS * cellCurve[10]);
+        CHECK_EQUAL(getPowerLevel(), POWER_LEVEL_NORMAL);
+        CHECK_EQUAL(hostRadio.power, MODEL_OUTPUT_POWER);
+
+        /* A noisier reading still steps down once a level */
+        Flight noisy = fly(true, MODEL_NOISY_NOISE, random);
+        printFlight("policy, noisy reading", noisy);
+        CHECK_EQUAL(noisy.descents, POWER_LEVEL_COUNT - 1);
+        CHECK_EQUAL(noisy.climbs, 0);
+        CHECK_EQUAL(noisy.capErrors, 0);
+
+        printf("\nLow entered %.2f h in, critical %.2f h in; the policy adds %.2f h (%.1f %%)\n", capped.levelEntered[POWER_LEVEL_LOW] / 3600.0,
+            capped.levelEntered[POWER_LEVEL_CRITICAL] / 3600.0, (capped.seconds - uncapped.seconds) / 3600.0,
+            100.0 * ((double)capped.seconds / uncapped.seconds - 1));
+        return hostTestResult();
+    }
@@ -0,0 +1,505 @@
+/*
+*   Purpose :   GPS parser benchmark over an NMEA log. data/balloon_ascent.nmea is five minutes of a
+*               u-blox receiver's default output (RMC, VTG, GGA, GSA, three GSV, and GLL each second)
+*               through a fix at 15 s and an ascent at 5 m/s, with the line noise of a recording: a
+*               bit error, a sentence cut off, a stray control byte, and a bad GSV checksum.
+*
+*               The log is first parsed straight through and every fix sent is checked against a
+*               reference parse of the same lines in doubles. Then each second's burst arrives at
+*               9600 baud into the 64 byte software serial buffer with serviceGps on LCOM.ino's
+*               period, steady and with a 370 ms transmission blocking the loop about every 10 s,
+*               for all of the log and for the RMC and GGA that initializeGps leaves a u-blox
+*               sending. Last, the parser's cost per byte is timed on the host; on the module it's
+*               PERF_GPS_PARSE over PERF_GPS_BYTES.
+*
+*               Then the host sends at the same time, exchanges of packets back to back at 115200 baud.
+*               Each byte the software serial port takes keeps interrupts off for most of a millisecond,
+*               and host bytes after the two the UART holds are lost meanwhile. A packet is answered
+*               once readSerial has it, or sent again by the host after BENCH_HOST_RETRY. Only a
+*               packet that starts an exchange may be lost, the listener is off for the rest of it and
+*               for every retry, and the receiver's output lost while it's off only costs fixes.
+*/
+
+
+#include "HostTest.h"
+#include "HostArduino.h"
+#include "Gps.h"
+#include "Perf.h"
+#include "PacketArena.h"
+#include "Scheduler.h"
+#include "SerialInterface.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <math.h>
+#include <random>
+#include <string>
+#include <vector>
+
+
+/*-------------------------------------------------------------------------*\
+|								  Definitions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    #define BENCH_LOG                       "data/balloon_ascent.nmea"
+    #define BENCH_BYTE_MICROS               (10e6 / GPS_BAUD)       // One start, eight data, one stop bit
+    #define BENCH_SERVICE_PERIOD            20                      // ms, LCOM.ino's GPS_SERVICE_PERIOD
+    #define BENCH_BLOCK_PERIOD              10137                   // ms between transmissions in the blocking case, drifting across the second
+    #define BENCH_BLOCK_TIME                370                     // ms, a 40 byte frame at SF9
+    #define BENCH_TIMING_PASSES             50
+    #define BENCH_FIX_LEN                   (TELEMETRY_RECORD_HEADER_LEN + GPS_FIX_LEN)
+    #define BENCH_GPS_INTERRUPT_MICROS      (9.5e6 / GPS_BAUD)      // Start bit edge to the middle of the stop bit, interrupts off
+    #define BENCH_HOST_BYTE_MICROS          (10e6 / SERIAL_BAUD)
+    #define BENCH_UART_HELD                 2                       // Bytes the UART keeps while its interrupt waits, later ones overrun
+    #define BENCH_EXCHANGE_GAP              4000                    // ms, mean time from one host exchange to the next
+    #define BENCH_EXCHANGE_PACKETS          4                       // Most packets in an exchange
+    #define BENCH_HOST_PAYLOAD              40                      // Longest packet payload the host sends
+    #define BENCH_HOST_TURNAROUND           10                      // ms from an answer to the host's next packet
+    #define BENCH_HOST_RETRY                600                     // ms the host waits for an answer, past SERIAL_PACKET_TIMEOUT
+    #define BENCH_SEED                      45
+
+
+/*-------------------------------------------------------------------------*\
+|								   Variables					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    std::vector<uint8_t> nmeaLog;
+    std::vector<size_t> epochs;                                     // Where each second's output starts, at its RMC
+    size_t feedIndex = 0;
+    size_t nextEpoch = 0;
+    double liveStart = 0;                                           // us
+    double nextByte = 0;
+    uint32_t overflowed = 0;                                        // Bytes the software serial buffer had no room for
+    uint32_t quietDropped = 0;                                      // Bytes sent while the listener was off
+    double interruptEnd = 0;                                        // us, when the software serial interrupt returns
+    uint8_t uartHeld = 0;                                           // Host bytes arrived while it ran
+
+    /* The host */
+    std::mt19937 rng(BENCH_SEED);
+    bool hostSending = false;
+    std::vector<uint8_t> hostPacket;                                // The packet on the line, or waiting for its answer
+    size_t hostIndex = 0;
+    double hostNextByte = 0;                                        // us
+    uint8_t hostPacketsLeft = 0;                                    // In this exchange, after the one on the line
+    bool hostFirstPacket = false;                                   // The one on the line started the exchange
+    bool hostAnswered = false;
+    uint32_t hostNextExchange = 0;                                  // ms
+    uint32_t exchanges = 0;
+    uint32_t hostPackets = 0;
+    uint32_t hostBytesLost = 0;
+    uint32_t firstsLost = 0;                                        // Packets that started an exchange and were sent again
+    uint32_t othersLost = 0;                                        // Any other packet sent again
+
+    void benchBlocker(void);
+    void benchReadSerial(void);
+    bool blocking = false;
+
+    const SchedulerTask benchTable[] PROGMEM = {
+        {serviceGps,           BENCH_SERVICE_PERIOD,   20,     2},
+        {benchBlocker,         BENCH_BLOCK_PERIOD,     1000,   1}
+    };
+
+    const SchedulerTask benchHostTable[] PROGMEM = {
+        {benchReadSerial,      1,                      5,      0},
+        {serviceGps,           BENCH_SERVICE_PERIOD,   20,     2}
+    };
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       parseMinutes                                                            |
+    |   Purpose:    Converts an NMEA ddmm.mmmmm field to 1e-7 degrees.                      |
+    |   Arguments:  const std::string&, char (hemisphere)                                   |
+    |   Returns:    int32_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    int32_t parseMinutes(const std::string& field, char hemisphere){
+        double v = atof(field.c_str());
+        double degrees = floor(v / 100);
+        int32_t result = (int32_t)llround((degrees + (v - degrees * 100) / 60) * 1e7);
+        return (hemisphere == 'S' || hemisphere == 'W') ? -result : result;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       referenceParse                                                          |
+    |   Purpose:    Parses the log a line at a time, with the library's string functions,   |
+    |               into the fixes the firmware should send and the lines it should reject. |
+    |   Arguments:  std::vector<GpsFix>&                                                    |
+    |   Returns:    uint32_t (lines rejected)                                               |
+    \*-------------------------------------------------------------------------------------*/
+    uint32_t referenceParse(std::vector<GpsFix>& fixes){
+        uint32_t rejected = 0;
+        uint16_t speed = 0, course = 0;
+        std::string text(nmeaLog.begin(), nmeaLog.end());
+
+        size_t start = 0;
+        while(start < text.size()){
+            size_t end = text.find('\n', start);
+            std::string line = text.substr(start, end - start);
+            start = end + 1;
+            if(!line.empty() && line.back() == '\r') line.pop_back();
+
+            /* Printable, with a checksum that matches */
+            size_t star = line.find('*');
+            bool good = line.size() > 1 && line[0] == '$' && star != std::string::npos && star + 3 == line.size();
+            for(size_t i = 0; good && i < line.size(); i++) good = line[i] >= ' ' && line[i] <= '~';
+            uint8_t checksum = 0;
+            for(size_t i = 1; good && i < star; i++) checksum ^= line[i];
+            if(good) good = strtoul(line.substr(star + 1).c_str(), NULL, 16) == checksum;
+            if(!good){
+                rejected++;
+                continue;
+            }
+
+            std::vector<std::string> fields;
+            size_t from = 1;
+            for(size_t comma; (comma = line.find(',', from)) < star; from = comma + 1) fields.push_back(line.substr(from, comma - from));
+            fields.push_back(line.substr(from, star - from));
+            std::string sentence = fields[0].substr(fields[0].size() - 3);
+
+            if(sentence == "RMC"){
+                bool valid = fields[2] == "A";
+                speed = valid ? (uint16_t)lround(atof(fields[7].c_str()) * 1852 / 36) : 0;
+                course = valid ? (uint16_t)lround(atof(fields[8].c_str()) * 100) : 0;
+            }
+            else if(sentence == "GGA" && atoi(fields[6].c_str()) != 0){
+                GpsFix fix = {};
+                double t = atof(fields[1].c_str());
+                fix.utcTime = (uint32_t)llround(((int)(t / 10000) * 3600 + ((int)(t / 100) % 100) * 60 + fmod(t, 100)) * 1000);
+                fix.latitude = parseMinutes(fields[2], fields[3][0]);
+                fix.longitude = parseMinutes(fields[4], fields[5][0]);
+                fix.fixType = GPS_FIX_3D;
+                fix.satellites = atoi(fields[7].c_str());
+                fix.altitude = (int32_t)lround(atof(fields[9].c_str()) * 100);
+                fix.speed = speed;
+                fix.course = course;
+                fixes.push_back(fix);
+            }
+        }
+        return rejected;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       sentFixes                                                               |
+    |   Purpose:    Returns the fix records the UART carried.                               |
+    |   Arguments:  void                                                                    |
+    |   Returns:    std::vector<GpsFix>                                                     |
+    \*-------------------------------------------------------------------------------------*/
+    std::vector<GpsFix> sentFixes(void){
+        std::vector<GpsFix> fixes;
+        const std::vector<std::vector<uint8_t> >& writes = hostSerialWrites();
+        for(size_t i = 0; i < writes.size(); i++){
+            const std::vector<uint8_t>& packet = writes[i];
+            if(packet.size() < PKT_HEADER_LEN + BENCH_FIX_LEN + PKT_TRAILER_LEN) continue;
+            const uint8_t* record = packet.data() + packet.size() - PKT_TRAILER_LEN - BENCH_FIX_LEN;
+            if(record[0] != TELEMETRY_GPS_FIX) continue;
+
+            GpsFix fix;
+            decodeGpsFix(record + TELEMETRY_RECORD_HEADER_LEN, &fix);
+            fixes.push_back(fix);
+        }
+        return fixes;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       gpsByteDue                                                              |
+    |   Purpose:    Returns when the receiver's next byte arrives (us). It sends each       |
+    |               second's sentences back to back from the top of the second.             |
+    |   Arguments:  void                                                                    |
+    |   Returns:    double                                                                  |
+    \*-------------------------------------------------------------------------------------*/
+    double gpsByteDue(void){
+        if(feedIndex >= nmeaLog.size()) return INFINITY;
+        if(nextEpoch < epochs.size() && feedIndex == epochs[nextEpoch]) return std::max(nextByte, liveStart + nextEpoch * 1e6);
+        return nextByte;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       queueHostPacket                                                         |
+    |   Purpose:    Puts the host's next packet on the line, a command of random length.    |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void queueHostPacket(void){
+        uint16_t len = PKT_HEADER_TRAILER_LEN + 1 + rng() % BENCH_HOST_PAYLOAD;
+        uint8_t header[PKT_HEADER_LEN] = { START_FLAG, COMMAND_PACKET, (uint8_t)(len >> 8), (uint8_t)len, 0, 0, 0, 0 };
+        hostPacket.assign(header, header + PKT_HEADER_LEN);
+        hostPacket.resize(len - PKT_TRAILER_LEN, 'c');
+        hostPacket.push_back(END_FLAG);
+        hostIndex = 0;
+        hostNextByte = hostMicros();
+        hostAnswered = false;
+        hostPackets++;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       serviceHost                                                             |
+    |   Purpose:    The host's side of an exchange: the next packet once one is answered,   |
+    |               the same again once it's given up waiting, and a new exchange when one  |
+    |               is due while the log is still playing.                                  |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void serviceHost(void){
+        uint32_t now = hostMicros() / 1000;
+        if(!hostSending){
+            if(feedIndex >= nmeaLog.size() || (int32_t)(now - hostNextExchange) < 0) return;
+            hostSending = true;
+            hostFirstPacket = true;
+            hostPacketsLeft = rng() % BENCH_EXCHANGE_PACKETS;
+            exchanges++;
+            queueHostPacket();
+            return;
+        }
+        if(hostIndex != hostPacket.size()) return;
+
+        double sent = hostNextByte / 1000;
+        if(hostAnswered){
+            if(now < sent + BENCH_HOST_TURNAROUND) return;
+            hostFirstPacket = false;
+            if(hostPacketsLeft-- != 0) queueHostPacket();
+            else{
+                hostSending = false;
+                hostNextExchange = now + 1 + (uint32_t)std::exponential_distribution<double>(1.0 / BENCH_EXCHANGE_GAP)(rng);
+            }
+        }
+        else if(now >= sent + BENCH_HOST_RETRY){
+            if(hostFirstPacket) firstsLost++;
+            else othersLost++;
+            hostPackets--;
+            queueHostPacket();
+        }
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       benchInterrupts                                                         |
+    |   Purpose:    Every byte due by now from the receiver and the host. The software      |
+    |               serial interrupt takes a receiver byte into the buffer, or drops it if  |
+    |               it's full, and keeps interrupts off while it runs. The UART holds the   |
+    |               first host bytes to arrive meanwhile and loses the rest.                |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void benchInterrupts(void){
+        while(true){
+            double gpsDue = gpsByteDue();
+            double hostDue = (hostSending && hostIndex != hostPacket.size()) ? hostNextByte : INFINITY;
+            if(std::min(gpsDue, hostDue) > hostMicros()) break;
+
+            if(gpsDue <= hostDue){
+                if(nextEpoch < epochs.size() && feedIndex == epochs[nextEpoch]) nextEpoch++;
+                if(!hostSoftwareSerialListening()) quietDropped++;
+                else{
+                    if(hostSoftwareSerialFeed(&nmeaLog[feedIndex], 1) == 0) overflowed++;
+                    interruptEnd = gpsDue + BENCH_GPS_INTERRUPT_MICROS;
+                    uartHeld = 0;
+                }
+                feedIndex++;
+                nextByte = gpsDue + BENCH_BYTE_MICROS;
+            }
+            else{
+                if(hostDue >= interruptEnd || ++uartHeld <= BENCH_UART_HELD) hostSerialFeed(&hostPacket[hostIndex], 1);
+                else hostBytesLost++;
+                hostIndex++;
+                hostNextByte += BENCH_HOST_BYTE_MICROS;
+            }
+        }
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       benchReadSerial                                                         |
+    |   Purpose:    As LCOM.ino's readSerial, answering every packet taken.                 |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void benchReadSerial(void){
+        int16_t res;
+        do{
+            res = readSerialData();
+        } while(res == NEW_PARTIAL_SERIAL_DATA);
+
+        SerialFrame frame;
+        while(takeSerialFrame(&frame)){
+            releaseBlock(frame.block);
+            hostAnswered = true;
+        }
+        serviceHost();
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       benchBlocker                                                            |
+    |   Purpose:    A transmission in the blocking case, the loop stuck with interrupts on. |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void benchBlocker(void){
+        if(!blocking) return;
+        for(int i = 0; i < BENCH_BLOCK_TIME; i++) delay(1);
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       findEpochs                                                              |
+    |   Purpose:    Finds where each second's output starts in the log.                     |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void findEpochs(void){
+        epochs.clear();
+        for(size_t i = 0; i + 6 < nmeaLog.size(); i++){
+            if(memcmp(&nmeaLog[i], "$GPRMC", 6) == 0) epochs.push_back(i);
+        }
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       onlyFixSentences                                                        |
+    |   Purpose:    Cuts the log down to its RMC and GGA lines, good or not.                |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void onlyFixSentences(void){
+        std::vector<uint8_t> kept;
+        size_t start = 0;
+        while(start < nmeaLog.size()){
+            size_t end = std::find(nmeaLog.begin() + start, nmeaLog.end(), '\n') - nmeaLog.begin();
+            end = std::min(end + 1, nmeaLog.size());
+            if(end - start > 6 && (memcmp(&nmeaLog[start + 3], "RMC", 3) == 0 || memcmp(&nmeaLog[start + 3], "GGA", 3) == 0)){
+                kept.insert(kept.end(), nmeaLog.begin() + start, nmeaLog.begin() + end);
+            }
+            start = end;
+        }
+        nmeaLog = kept;
+        findEpochs();
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       runLive                                                                 |
+    |   Purpose:    Feeds the log at the receiver's baud rate through the scheduler, with   |
+    |               the loop blocked or the host sending as well if asked.                  |
+    |   Arguments:  const char*, bool, bool                                                 |
+    |   Returns:    uint32_t (fixes sent)                                                   |
+    \*-------------------------------------------------------------------------------------*/
+    uint32_t runLive(const char* name, bool block, bool host){
+        blocking = block;
+        feedIndex = 0;
+        nextEpoch = 0;
+        overflowed = 0;
+        quietDropped = 0;
+        liveStart = nextByte = hostMicros();
+        hostNextExchange = hostMicros() / 1000;
+        resetPerfStats();
+        hostSerialClear();
+        hostInterruptSource = benchInterrupts;
+        if(host) CHECK_EQUAL(initializeScheduler(benchHostTable, sizeof(benchHostTable)/sizeof(benchHostTable[0])), SCHEDULER_OK);
+        else CHECK_EQUAL(initializeScheduler(benchTable, sizeof(benchTable)/sizeof(benchTable[0])), SCHEDULER_OK);
+
+        uint64_t start = hostMicros();
+        while(feedIndex < nmeaLog.size() || hostSoftwareSerialPending() != 0 || hostSending){
+            runScheduler();
+            idleScheduler();
+        }
+        hostInterruptSource = NULL;
+
+        uint32_t fixes = sentFixes().size();
+        double seconds = (hostMicros() - start) / 1e6;
+        printf("  %-40s %5.0f B/s   %5lu fixes   %4lu errors   %6lu bytes dropped\n", name, nmeaLog.size() / seconds,
+            (unsigned long)fixes, (unsigned long)perfCounters[PERF_GPS_ERRORS], (unsigned long)overflowed);
+        return fixes;
+    }
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       runShared                                                               |
+    |   Purpose:    Feeds the log with the host sending as well, and checks nothing is lost |
+    |               but the packets that start an exchange, and fixes for the time the      |
+    |               listener is off.                                                        |
+    |   Arguments:  const char*, size_t (fixes in the log), uint32_t (lines rejected)       |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void runShared(const char* name, size_t expected, uint32_t rejected){
+        exchanges = hostPackets = hostBytesLost = firstsLost = othersLost = 0;
+        uint32_t fixes = runLive(name, false, true);
+        printf("    %lu exchanges of %lu packets, %lu host bytes overrun, %lu first packets and %lu others sent again,\n"
+               "    %lu receiver bytes sent with the listener off\n", (unsigned long)exchanges, (unsigned long)hostPackets,
+            (unsigned long)hostBytesLost, (unsigned long)firstsLost, (unsigned long)othersLost, (unsigned long)quietDropped);
+        CHECK(exchanges > 0 && hostPackets > exchanges);
+        CHECK_EQUAL(othersLost, 0);
+        CHECK(firstsLost < exchanges);
+        CHECK(quietDropped > 0);
+        CHECK(perfCounters[PERF_GPS_ERRORS] <= rejected);
+        CHECK(fixes + 3 * exchanges >= expected);
+    }
+
+
+/*-------------------------------------------------------------------------*\
+|								     Main					   			    |
+\*-------------------------------------------------------------------------*/
+
+
+    int main(void){
+        std::ifstream file(BENCH_LOG, std::ios::binary);
+        nmeaLog.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        CHECK(!nmeaLog.empty());
+        if(nmeaLog.empty()) return hostTestResult();
+
+        findEpochs();
+
+        std::vector<GpsFix> expected;
+        uint32_t rejected = referenceParse(expected);
+        CHECK_EQUAL(initializeGps(), GPS_OK);
+        CHECK_EQUAL(setTelemetryDestination(TELEMETRY_UART), TELEMETRY_OK);
+
+        /* Straight through, every fix field for field */
+        resetPerfStats();
+        for(size_t i = 0; i < nmeaLog.size(); i++) parseGpsByte(nmeaLog[i]);
+        std::vector<GpsFix> fixes = sentFixes();
+        CHECK_EQUAL(fixes.size(), expected.size());
+        CHECK_EQUAL(perfCounters[PERF_GPS_FIXES], expected.size());
+        CHECK_EQUAL(perfCounters[PERF_GPS_ERRORS], rejected);
+        for(size_t i = 0; i < fixes.size() && i < expected.size(); i++){
+            CHECK_EQUAL(fixes[i].utcTime, expected[i].utcTime);
+            CHECK(abs(fixes[i].latitude - expected[i].latitude) <= 1);
+            CHECK(abs(fixes[i].longitude - expected[i].longitude) <= 1);
+            CHECK_EQUAL(fixes[i].altitude, expected[i].altitude);
+            CHECK(abs(fixes[i].speed - expected[i].speed) <= 1);
+            CHECK_EQUAL(fixes[i].course, expected[i].course);
+            CHECK_EQUAL(fixes[i].satellites, expected[i].satellites);
+            CHECK_EQUAL(fixes[i].fixType, expected[i].fixType);
+        }
+        printf("%zu bytes, %zu fixes matching the reference parse, %lu lines rejected\n\n", nmeaLog.size(), fixes.size(), (unsigned long)rejected);
+
+        /* At the receiver's pace, nothing lost steady, and a blocked loop only loses what overflows the buffer */
+        printf("Each second's output at %u baud into a %u byte buffer, serviceGps every %u ms\n", GPS_BAUD, HOST_SOFTWARE_SERIAL_BUFFER_LEN, BENCH_SERVICE_PERIOD);
+        CHECK_EQUAL(runLive("Steady", false, false), expected.size());
+        CHECK_EQUAL(overflowed, 0);
+        CHECK_EQUAL(perfCounters[PERF_GPS_ERRORS], rejected);
+        uint32_t blocks = epochs.size() * 1000 / BENCH_BLOCK_PERIOD + 1;
+        CHECK(runLive("A 370 ms transmission about every 10 s", true, false) + blocks >= expected.size());
+
+        runShared("The host sending as well", expected.size(), rejected);
+
+        /* Fewer bytes a second, a shorter burst for a transmission to land on */
+        std::vector<uint8_t> fullLog = nmeaLog;
+        onlyFixSentences();
+        CHECK_EQUAL(runLive("RMC and GGA only, steady", false, false), expected.size());
+        CHECK(runLive("RMC and GGA only, blocked", true, false) + blocks >= expected.size());
+        runShared("RMC and GGA only, the host sending", expected.size(), rejected);
+        nmeaLog = fullLog;
+
+        /* The parser's cost on this machine, with nothing sent */
+        setTelemetryDestination(TELEMETRY_OFF);
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        for(int pass = 0; pass < BENCH_TIMING_PASSES; pass++){
+            for(size_t i = 0; i < nmeaLog.size(); i++) parseGpsByte(nmeaLog[i]);
+        }
+        std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+        double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / ((double)nmeaLog.size() * BENCH_TIMING_PASSES);
+        printf("\nHost time per parseGpsByte: %.1f ns, %.0f MB/s\n", ns, 1e3 / ns);
+
+        return hostTestResult();
+    }
@@ -0,0 +1,187 @@
+/*
+*   Purpose :   Frequency hopping loopback. The firmware sends frames through transmitRadio and
+*               hears its own copies through readRadioData, but only the ones sent on the channel
+*               it was listening on. Frames are dropped on purpose under steady traffic, and the
+*               link is left idle for pauses either side of the resync timeout, and each frame
+*               must be passed up once, or within HOP_SYNC_INTERVAL frames of the one dropped.
+*/
+
+
+#include "HostTest.h"
+#include "HostArduino.h"
+#include "RadioController.h"
+#include <vector>
+
+
+/*-------------------------------------------------------------------------*\
+|								  Definitions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    #define TEST_PAYLOAD_LEN                16
+    #define TEST_FRAME_GAP                  200000                  // us between frames under steady traffic
+    #define TEST_STEADY_FRAMES              400
+    #define TEST_DROP_EVERY                 97                      // Under steady traffic, frames this far apart are lost
+    #define TEST_SETTLE_FRAMES              20                      // Steady frames before each pause
+    #define TEST_PAUSE_STEP                 50                      // ms between the pauses tried
+    #define TEST_PAUSE_MAX                  (3 * HOP_RESYNC_TIMEOUT)
+
+
+/*-------------------------------------------------------------------------*\
+|								     Types					   			    |
+\*-------------------------------------------------------------------------*/
+
+
+    struct AirCopy{
+        float frequency;
+        std::vector<uint8_t> data;
+    };
+
+
+/*-------------------------------------------------------------------------*\
+|								   Variables					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    std::vector<AirCopy> air;                                       // Copies sent by the last transmitRadio
+    std::vector<uint8_t> delivered;                                 // Times each frame was passed up
+    uint32_t copiesSent = 0;
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       captureTransmit                                                         |
+    |   Purpose:    The radio's transmit hook, keeps the frame and the channel it went on.  |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void captureTransmit(void){
+        AirCopy copy;
+        copy.frequency = hostRadio.frequency;
+        copy.data.assign(hostRadio.txData, hostRadio.txData + hostRadio.txLen);
+        air.push_back(copy);
+        copiesSent++;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       sendFrame                                                               |
+    |   Purpose:    Sends frame id, then plays each copy back to the radio if it was sent   |
+    |               on the channel the radio is listening on, counting what is passed up.   |
+    |   Arguments:  uint16_t, bool (lose every copy)                                        |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void sendFrame(uint16_t id, bool lost){
+        uint8_t frame[RADIO_TX_HEADROOM + TEST_PAYLOAD_LEN] = {};
+        uint8_t* data = frame + RADIO_TX_HEADROOM;
+        data[0] = id >> 8;
+        data[1] = id;
+
+        air.clear();
+        CHECK_EQUAL(transmitRadio(data, TEST_PAYLOAD_LEN), ERR_NONE);
+        if(id >= delivered.size()) delivered.resize(id + 1, 0);
+        if(lost) return;
+
+        for(size_t i = 0; i < air.size(); i++){
+            if(air[i].frequency != hostRadio.frequency) continue;
+            hostRadioReceive(air[i].data.data(), air[i].data.size());
+            if(readRadioData() != ERR_NONE) continue;
+            CHECK_EQUAL(getRadioDataLength(), TEST_PAYLOAD_LEN);
+            uint16_t heard = ((uint16_t)getRadioData()[0] << 8) | getRadioData()[1];
+            CHECK_EQUAL(heard, id);
+            delivered[id]++;
+        }
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       checkSteadyLoss                                                         |
+    |   Purpose:    Sends frames at a steady rate, losing one every TEST_DROP_EVERY, and    |
+    |               checks the link comes back on the next home channel frame at the latest.|
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void checkSteadyLoss(void){
+        uint16_t first = delivered.size();
+        uint32_t copiesBefore = copiesSent;
+        uint16_t worst = 0;
+        uint16_t missed = 0;
+        for(uint16_t n = 0; n != TEST_STEADY_FRAMES; n++){
+            uint16_t id = first + n;
+            sendFrame(id, n % TEST_DROP_EVERY == TEST_DROP_EVERY / 2);
+            hostAdvanceMicros(TEST_FRAME_GAP);
+
+            /* Count the run of frames lost, starting at the one dropped */
+            if(delivered[id] == 0) missed++;
+            else missed = 0;
+            if(missed > worst) worst = missed;
+            CHECK(delivered[id] <= 1);
+        }
+        printf("Steady traffic: worst run of lost frames %u, %lu copies for %u frames\n",
+            worst, (unsigned long)(copiesSent - copiesBefore), TEST_STEADY_FRAMES);
+        CHECK(worst >= 1);
+        CHECK(worst <= HOP_SYNC_INTERVAL);
+        CHECK_EQUAL(copiesSent - copiesBefore, TEST_STEADY_FRAMES);
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       checkPauses                                                             |
+    |   Purpose:    Leaves the link idle for pauses from none to TEST_PAUSE_MAX between     |
+    |               bursts of steady traffic, and checks every frame is passed up once.     |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void checkPauses(void){
+        uint32_t lost = 0;
+        uint32_t duplicated = 0;
+        uint32_t repeats = 0;
+        for(uint32_t pause = 0; pause <= TEST_PAUSE_MAX; pause += TEST_PAUSE_STEP){
+            for(uint16_t n = 0; n != TEST_SETTLE_FRAMES; n++){
+                uint16_t id = delivered.size();
+                sendFrame(id, false);
+                hostAdvanceMicros(TEST_FRAME_GAP);
+                if(delivered[id] == 0) lost++;
+                if(delivered[id] > 1) duplicated++;
+            }
+            hostAdvanceMicros((uint64_t)pause * 1000);
+
+            uint32_t copiesBefore = copiesSent;
+            uint16_t id = delivered.size();
+            sendFrame(id, false);
+            hostAdvanceMicros(TEST_FRAME_GAP);
+            if(delivered[id] != 1) printf("Frame after a %lu ms pause passed up %u times\n", (unsigned long)pause, delivered[id]);
+            if(delivered[id] == 0) lost++;
+            if(delivered[id] > 1) duplicated++;
+            repeats += copiesSent - copiesBefore - 1;
+        }
+        printf("Pauses up to %u ms: %lu frames lost, %lu duplicated, %lu repeated on the home channel\n",
+            TEST_PAUSE_MAX, (unsigned long)lost, (unsigned long)duplicated, (unsigned long)repeats);
+        CHECK_EQUAL(lost, 0);
+        CHECK_EQUAL(duplicated, 0);
+    }
+
+
+/*-------------------------------------------------------------------------*\
+|								     Main					   			    |
+\*-------------------------------------------------------------------------*/
+
+
+    int main(void){
+        hostEepromErase();
+        CHECK_EQUAL(initializeRadio(), ERR_NONE);
+        CHECK_EQUAL(configureHopping(true, HOP_DEFAULT_SEED, NULL, 0), ERR_NONE);
+        hostRadio.transmitted = captureTransmit;
+        hostRadio.transmitMicros = getTimeOnAir(TEST_PAYLOAD_LEN + HOP_HEADER_LEN + AIR_HEADER_LEN);
+
+        /* The first frame goes on the home channel, where the radio waits for sync */
+        sendFrame(0, false);
+        CHECK_EQUAL(delivered[0], 1);
+        hostAdvanceMicros(TEST_FRAME_GAP);
+
+        checkSteadyLoss();
+        checkPauses();
+
+        return hostTestResult();
+    }
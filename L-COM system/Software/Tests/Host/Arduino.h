@@ -0,0 +1,125 @@
+/*
+*   Purpose :   The parts of the Arduino core the L-COM firmware uses, for building it on the host.
+*               The behaviour behind them is in HostArduino.cpp and the tests drive it through
+*               HostArduino.h.
+*/
+
+#ifndef INC_HOST_ARDUINO_H_
+#define INC_HOST_ARDUINO_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include <stdlib.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+
+
+/*-------------------------------------------------------------------------*\
+|								  Definitions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    class __FlashStringHelper;
+    #define F(x)                            (reinterpret_cast<const __FlashStringHelper*>(x))
+
+    typedef bool boolean;
+    typedef uint8_t byte;
+
+    #define INPUT                           0x0
+    #define OUTPUT                          0x1
+    #define INPUT_PULLUP                    0x2
+    #define LOW                             0x0
+    #define HIGH                            0x1
+    #define CHANGE                          1
+    #define FALLING                         2
+    #define RISING                          3
+    #define DEC                             10
+    #define HEX                             16
+
+    /* ATmega328P pins */
+    #define A0                              14
+    #define A1                              15
+    #define A2                              16
+    #define A3                              17
+    #define SDA                             18
+    #define SCL                             19
+    #define HOST_PIN_COUNT                  20
+    #define digitalPinToInterrupt(p)        ((p) == 2 ? 0 : ((p) == 3 ? 1 : -1))
+
+
+/*-------------------------------------------------------------------------*\
+|								     Types					   			    |
+\*-------------------------------------------------------------------------*/
+
+
+    /* Text is dropped, bytes written are kept for the tests, see HostArduino.h */
+    class Stream{
+        public:
+            virtual ~Stream(){}
+            virtual int available(void);
+            virtual int read(void);
+            virtual int peek(void);
+            virtual size_t write(uint8_t b);
+            virtual size_t write(const uint8_t* buf, size_t len);
+            size_t write(const char* buf, size_t len){ return write((const uint8_t*)buf, len); }
+            template<typename T> size_t print(T){ return 0; }
+            template<typename T> size_t print(T, int){ return 0; }
+            template<typename T> size_t println(T){ return 0; }
+            template<typename T> size_t println(T, int){ return 0; }
+            size_t println(void){ return 0; }
+            int printf(const char*, ...){ return 0; }
+            int printf(const __FlashStringHelper*, ...){ return 0; }
+            void flush(void){}
+            void begin(unsigned long){}
+            operator bool(void){ return true; }
+            int availableForWrite(void){ return 64; }
+    };
+
+    class HardwareSerial : public Stream{
+        public:
+            int available(void);
+            int read(void);
+            int peek(void);
+            size_t write(uint8_t b);
+            size_t write(const uint8_t* buf, size_t len);
+            using Stream::write;
+    };
+
+
+/*-------------------------------------------------------------------------*\
+|								   Variables					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    extern HardwareSerial Serial;
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    uint32_t millis(void);
+    uint32_t micros(void);
+    void delay(uint32_t ms);
+    void delayMicroseconds(uint16_t us);
+
+    void pinMode(uint8_t pin, uint8_t mode);
+    void digitalWrite(uint8_t pin, uint8_t level);
+    int digitalRead(uint8_t pin);
+    int analogRead(uint8_t pin);
+    void attachInterrupt(uint8_t interrupt, void (*isr)(void), int mode);
+    void detachInterrupt(uint8_t interrupt);
+
+    void noInterrupts(void);
+    void interrupts(void);
+
+    long random(long howBig);
+    long random(long howSmall, long howBig);
+    void randomSeed(unsigned long seed);
+
+    char* dtostrf(double val, signed char width, unsigned char prec, char* s);
+
+#endif /* INC_HOST_ARDUINO_H_ */
@@ -0,0 +1,35 @@
+/*
+*   Purpose :   The 1 KB EEPROM as an array. As on the module a write returns at once and the cell
+*               takes 3.3 ms of host clock, and a read or write waits out the one before. Writes are
+*               counted per cell and waits in all, so the tests can see both the blocking and the wear.
+*/
+
+#ifndef INC_HOST_EEPROM_H_
+#define INC_HOST_EEPROM_H_
+
+#include <stdint.h>
+#include <avr/eeprom.h>
+
+
+    class EEPROMClass{
+        public:
+            uint8_t read(int address);
+            void write(int address, uint8_t value);
+            void update(int address, uint8_t value);
+            uint16_t length(void);
+
+            template<typename T> T& get(int address, T& t){
+                uint8_t* p = (uint8_t*)&t;
+                for(unsigned i = 0; i < sizeof(T); i++) p[i] = read(address + i);
+                return t;
+            }
+            template<typename T> const T& put(int address, const T& t){
+                const uint8_t* p = (const uint8_t*)&t;
+                for(unsigned i = 0; i < sizeof(T); i++) update(address + i, p[i]);
+                return t;
+            }
+    };
+
+    extern EEPROMClass EEPROM;
+
+#endif /* INC_HOST_EEPROM_H_ */
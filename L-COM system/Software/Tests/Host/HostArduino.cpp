@@ -0,0 +1,484 @@
+/*
+*   Purpose :   The simulated board behind the host Arduino, AVR, and library headers.
+*/
+
+
+#include "HostArduino.h"
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <avr/wdt.h>
+#include <util/atomic.h>
+#include <util/crc16.h>
+#include <EEPROM.h>
+#include <RadioLib.h>
+#include <SoftwareSerial.h>
+#include <SPI.h>
+#include <Wire.h>
+#include <algorithm>
+#include <deque>
+#include <random>
+#include <stdio.h>
+
+
+/*-------------------------------------------------------------------------*\
+|								   Variables					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /* Registers */
+    volatile uint8_t MCUSR, SREG, SMCR, PRR;
+    volatile uint8_t ADMUX, ADCSRA, ADCSRB, DIDR0, ADCL, ADCH;
+    volatile uint16_t ADC;
+    volatile uint8_t TWSR, TWBR, TWDR, TWAR;
+    HostTwiControlRegister TWCR;
+    volatile uint8_t EIMSK, EICRA, SPCR, SPSR, SPDR, PORTB, DDRB;
+    volatile uint16_t SP = RAMEND;
+
+    /* The libraries' instances */
+    HardwareSerial Serial;
+    EEPROMClass EEPROM;
+    SPIClass SPI;
+    TwoWire Wire;
+
+    /* Clock and interrupts */
+    uint64_t hostClock = 0;
+    uint32_t hostClockStepMicros = 1;
+    bool hostMillisTicks = false;
+    bool hostInterruptFlag = true;
+    bool hostInInterrupt = false;
+    void (*hostInterruptSource)(void) = NULL;
+    uint64_t (*hostNextInterrupt)(void) = NULL;
+    void (*hostExternalHandlers[HOST_EXTERNAL_INTERRUPTS])(void);
+
+    /* Pins */
+    uint8_t hostPinModes[HOST_PIN_COUNT];
+    uint8_t hostPinLevels[HOST_PIN_COUNT];
+    void (*hostPinChanged)(uint8_t pin) = NULL;
+    int (*hostPinInput)(uint8_t pin) = NULL;
+    uint16_t hostAnalogValue = 512;
+
+    void (*hostTwiControlWritten)(uint8_t value) = NULL;
+
+    /* EEPROM, erased */
+    uint8_t hostEeprom[HOST_EEPROM_SIZE];
+    uint32_t hostEepromWriteCounts[HOST_EEPROM_SIZE];
+    bool hostEepromErased = false;
+    uint64_t hostEepromReadyAt = 0;                                 // us, when the last write is in
+    uint32_t hostEepromWaitCount = 0;
+
+    /* Serial ports */
+    std::deque<uint8_t> hostSerialInput;
+    std::vector<std::vector<uint8_t> > hostSerialOutput;
+    std::deque<uint8_t> hostSoftwareSerialInput;
+    bool hostSoftwareSerialOverflow = false;
+    bool hostSoftwareSerialListens = true;
+    uint32_t hostSerialBaud = 0;
+    double hostSerialIdleAt = 0;                                    // us, when the last byte written will have left
+
+    /* Wire slave */
+    uint8_t hostWireSlaveAddress = 0;
+    void (*hostWireReceiveHandler)(int) = NULL;
+    void (*hostWireRequestHandler)(void) = NULL;
+    uint8_t hostWireRxBuffer[HOST_WIRE_BUFFER_LEN];
+    size_t hostWireRxLen = 0;
+    size_t hostWireRxIndex = 0;
+    uint8_t hostWireTxBuffer[HOST_WIRE_BUFFER_LEN];
+    size_t hostWireTxLen = 0;
+
+    HostRadio hostRadio;
+    HostSleep hostSleep;
+    std::mt19937 hostRandom(1);
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /* ---------------------------- Clock ---------------------------- */
+    void hostTakeInterrupts(void){
+        if(!hostInterruptFlag || hostInInterrupt || hostInterruptSource == NULL) return;
+        hostInInterrupt = true;
+        hostInterruptFlag = false;
+        hostInterruptSource();
+        hostInterruptFlag = true;
+        hostInInterrupt = false;
+    }
+
+    void hostSetMicros(uint64_t us){ hostClock = us; }
+    void hostAdvanceMicros(uint64_t us){ hostClock += us; }
+    uint64_t hostMicros(void){ return hostClock; }
+
+    uint32_t micros(void){
+        hostClock += hostClockStepMicros;
+        hostTakeInterrupts();
+        return (uint32_t)hostClock;
+    }
+
+    uint32_t millis(void){
+        hostClock += hostClockStepMicros;
+        hostTakeInterrupts();
+        if(hostMillisTicks) return (uint32_t)(hostClock / HOST_TIMER0_OVERFLOW_MICROS * HOST_TIMER0_OVERFLOW_MICROS / 1000);
+        return (uint32_t)(hostClock / 1000);
+    }
+
+    void delay(uint32_t ms){
+        hostClock += (uint64_t)ms * 1000;
+        hostTakeInterrupts();
+    }
+
+    void delayMicroseconds(uint16_t us){
+        hostClock += us;
+        hostTakeInterrupts();
+    }
+
+    /* -------------------------- Interrupts -------------------------- */
+    bool hostInterruptsEnabled(void){ return hostInterruptFlag; }
+    void noInterrupts(void){ hostInterruptFlag = false; }
+    void cli(void){ hostInterruptFlag = false; }
+    void interrupts(void){
+        hostInterruptFlag = true;
+        hostTakeInterrupts();
+    }
+    void sei(void){ interrupts(); }
+
+    HostTwiControlRegister& HostTwiControlRegister::operator=(uint8_t v){
+        value = v;
+        if(hostTwiControlWritten != NULL) hostTwiControlWritten(v);
+        return *this;
+    }
+
+    /* Every pin interrupt is taken as the mode it was attached with, the caller decides when */
+    void attachInterrupt(uint8_t interrupt, void (*isr)(void), int mode){
+        (void)mode;
+        if(interrupt < HOST_EXTERNAL_INTERRUPTS) hostExternalHandlers[interrupt] = isr;
+    }
+
+    void detachInterrupt(uint8_t interrupt){
+        if(interrupt < HOST_EXTERNAL_INTERRUPTS) hostExternalHandlers[interrupt] = NULL;
+    }
+
+    void hostExternalInterrupt(uint8_t interrupt){
+        if(interrupt < HOST_EXTERNAL_INTERRUPTS && hostExternalHandlers[interrupt] != NULL) hostExternalHandlers[interrupt]();
+    }
+
+    /* ----------------------------- Sleep ----------------------------- */
+    void set_sleep_mode(int mode){ hostSleep.mode = mode; }
+    void sleep_enable(void){ hostSleep.enabled = true; }
+    void sleep_disable(void){ hostSleep.enabled = false; }
+    void sleep_bod_disable(void){}
+
+    /* Sleeps until the next millis() tick, the one wake the firmware can count on, or the source's next interrupt */
+    void sleep_cpu(void){
+        if(!hostSleep.enabled) return;
+        hostSleep.sleeps++;
+        if(!hostInterruptFlag) hostSleep.sleepsWithInterruptsOff++;
+        uint64_t wake = hostClock + HOST_TIMER0_OVERFLOW_MICROS - hostClock % HOST_TIMER0_OVERFLOW_MICROS;
+        if(hostNextInterrupt != NULL && hostInterruptFlag){
+            uint64_t next = hostNextInterrupt();
+            if(next < wake) wake = (next > hostClock) ? next : hostClock;
+        }
+        hostClock = wake;
+        hostTakeInterrupts();
+    }
+
+    void wdt_enable(int timeout){ (void)timeout; }
+    void wdt_reset(void){}
+    void wdt_disable(void){}
+
+    /* ----------------------------- Pins ----------------------------- */
+    void pinMode(uint8_t pin, uint8_t mode){
+        if(pin >= HOST_PIN_COUNT) return;
+        hostPinModes[pin] = mode;
+        if(hostPinChanged != NULL) hostPinChanged(pin);
+    }
+
+    void digitalWrite(uint8_t pin, uint8_t level){
+        if(pin >= HOST_PIN_COUNT) return;
+        hostPinLevels[pin] = level;
+        if(hostPinChanged != NULL) hostPinChanged(pin);
+    }
+
+    uint8_t hostGetPinMode(uint8_t pin){ return pin < HOST_PIN_COUNT ? hostPinModes[pin] : INPUT; }
+
+    int hostGetPinLevel(uint8_t pin){
+        if(pin >= HOST_PIN_COUNT) return LOW;
+        if(hostPinModes[pin] == OUTPUT) return hostPinLevels[pin];
+        return HIGH;
+    }
+
+    int digitalRead(uint8_t pin){
+        if(pin < HOST_PIN_COUNT && hostPinModes[pin] != OUTPUT && hostPinInput != NULL) return hostPinInput(pin);
+        return hostGetPinLevel(pin);
+    }
+
+    int analogRead(uint8_t pin){ (void)pin; return hostAnalogValue; }
+
+    /* ------------------------------ Misc ------------------------------ */
+    long random(long howBig){
+        if(howBig <= 0) return 0;
+        return (long)(hostRandom() % (unsigned long)howBig);
+    }
+
+    long random(long howSmall, long howBig){
+        if(howSmall >= howBig) return howSmall;
+        return howSmall + random(howBig - howSmall);
+    }
+
+    void randomSeed(unsigned long seed){ if(seed != 0) hostRandom.seed(seed); }
+
+    char* dtostrf(double val, signed char width, unsigned char prec, char* s){
+        sprintf(s, "%*.*f", width, prec, val);
+        return s;
+    }
+
+    uint16_t _crc16_update(uint16_t crc, uint8_t a){
+        crc ^= a;
+        for(uint8_t i = 0; i < 8; i++) crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : (crc >> 1);
+        return crc;
+    }
+
+    /* ----------------------------- EEPROM ----------------------------- */
+    void hostEepromErase(void){
+        memset(hostEeprom, 0xFF, sizeof(hostEeprom));
+        memset(hostEepromWriteCounts, 0, sizeof(hostEepromWriteCounts));
+        hostEepromErased = true;
+        hostEepromReadyAt = 0;
+        hostEepromWaitCount = 0;
+    }
+
+    void hostEepromWait(void){
+        if(hostClock >= hostEepromReadyAt) return;
+        hostClock = hostEepromReadyAt;
+        hostEepromWaitCount++;
+    }
+
+    uint8_t* hostEepromData(void){
+        if(!hostEepromErased) hostEepromErase();
+        return hostEeprom;
+    }
+
+    uint32_t hostEepromWrites(int address){ return hostEepromWriteCounts[address]; }
+
+    uint32_t hostEepromTotalWrites(void){
+        uint32_t total = 0;
+        for(int i = 0; i < HOST_EEPROM_SIZE; i++) total += hostEepromWriteCounts[i];
+        return total;
+    }
+
+    uint32_t hostEepromWaits(void){ return hostEepromWaitCount; }
+    bool eeprom_is_ready(void){ return hostClock >= hostEepromReadyAt; }
+
+    uint8_t EEPROMClass::read(int address){
+        hostEepromWait();
+        return hostEepromData()[address % HOST_EEPROM_SIZE];
+    }
+
+    void EEPROMClass::write(int address, uint8_t value){
+        hostEepromWait();
+        address %= HOST_EEPROM_SIZE;
+        hostEepromData()[address] = value;
+        hostEepromWriteCounts[address]++;
+        hostEepromReadyAt = hostClock + HOST_EEPROM_WRITE_MICROS;
+    }
+
+    void EEPROMClass::update(int address, uint8_t value){
+        if(read(address) != value) write(address, value);
+    }
+
+    uint16_t EEPROMClass::length(void){ return HOST_EEPROM_SIZE; }
+
+    /* ------------------------- Serial ports ------------------------- */
+    int Stream::available(void){ return 0; }
+    int Stream::read(void){ return -1; }
+    int Stream::peek(void){ return -1; }
+    size_t Stream::write(uint8_t b){ (void)b; return 1; }
+    size_t Stream::write(const uint8_t* buf, size_t len){ (void)buf; return len; }
+
+    int HardwareSerial::available(void){ return hostSerialInput.size(); }
+    int HardwareSerial::peek(void){ return hostSerialInput.empty() ? -1 : hostSerialInput.front(); }
+
+    int HardwareSerial::read(void){
+        if(hostSerialInput.empty()) return -1;
+        uint8_t b = hostSerialInput.front();
+        hostSerialInput.pop_front();
+        return b;
+    }
+
+    size_t HardwareSerial::write(uint8_t b){ return write(&b, 1); }
+
+    /* With a baud rate set, the core's write: into the TX buffer, waiting with interrupts on while it's full */
+    size_t HardwareSerial::write(const uint8_t* buf, size_t len){
+        hostSerialOutput.push_back(std::vector<uint8_t>(buf, buf + len));
+        if(hostSerialBaud == 0) return len;
+
+        double byteMicros = 10e6 / hostSerialBaud;
+        for(size_t i = 0; i != len; i++){
+            hostSerialIdleAt = std::max(hostSerialIdleAt, (double)hostClock) + byteMicros;
+            double roomAt = hostSerialIdleAt - (HOST_SERIAL_TX_BUFFER_LEN + 1) * byteMicros;
+            if(roomAt > hostClock){
+                hostClock = (uint64_t)ceil(roomAt);
+                hostTakeInterrupts();
+            }
+        }
+        return len;
+    }
+
+    void hostSerialFeed(const uint8_t* buf, size_t len){ hostSerialInput.insert(hostSerialInput.end(), buf, buf + len); }
+    const std::vector<std::vector<uint8_t> >& hostSerialWrites(void){ return hostSerialOutput; }
+    void hostSerialClear(void){ hostSerialOutput.clear(); }
+
+    int SoftwareSerial::available(void){ return hostSoftwareSerialListens ? hostSoftwareSerialInput.size() : 0; }
+    int SoftwareSerial::peek(void){ return (!hostSoftwareSerialListens || hostSoftwareSerialInput.empty()) ? -1 : hostSoftwareSerialInput.front(); }
+    bool SoftwareSerial::isListening(void){ return hostSoftwareSerialListens; }
+
+    int SoftwareSerial::read(void){
+        if(!hostSoftwareSerialListens || hostSoftwareSerialInput.empty()) return -1;
+        uint8_t b = hostSoftwareSerialInput.front();
+        hostSoftwareSerialInput.pop_front();
+        return b;
+    }
+
+    bool SoftwareSerial::overflow(void){
+        bool overflowed = hostSoftwareSerialOverflow;
+        hostSoftwareSerialOverflow = false;
+        return overflowed;
+    }
+
+    bool SoftwareSerial::listen(void){
+        if(hostSoftwareSerialListens) return false;
+        hostSoftwareSerialInput.clear();
+        hostSoftwareSerialOverflow = false;
+        hostSoftwareSerialListens = true;
+        return true;
+    }
+
+    bool SoftwareSerial::stopListening(void){
+        bool was = hostSoftwareSerialListens;
+        hostSoftwareSerialListens = false;
+        return was;
+    }
+
+    size_t hostSoftwareSerialFeed(const uint8_t* buf, size_t len){
+        if(!hostSoftwareSerialListens) return 0;
+        size_t room = HOST_SOFTWARE_SERIAL_BUFFER_LEN - hostSoftwareSerialInput.size();
+        if(len > room) hostSoftwareSerialOverflow = true;
+        len = std::min(len, room);
+        hostSoftwareSerialInput.insert(hostSoftwareSerialInput.end(), buf, buf + len);
+        return len;
+    }
+    size_t hostSoftwareSerialPending(void){ return hostSoftwareSerialInput.size(); }
+    bool hostSoftwareSerialListening(void){ return hostSoftwareSerialListens; }
+
+    /* ----------------------------- Wire ----------------------------- */
+    void TwoWire::begin(uint8_t address){ hostWireSlaveAddress = address; }
+    void TwoWire::onReceive(void (*handler)(int)){ hostWireReceiveHandler = handler; }
+    void TwoWire::onRequest(void (*handler)(void)){ hostWireRequestHandler = handler; }
+    int TwoWire::available(void){ return hostWireRxLen - hostWireRxIndex; }
+    int TwoWire::read(void){ return hostWireRxIndex < hostWireRxLen ? hostWireRxBuffer[hostWireRxIndex++] : -1; }
+
+    size_t TwoWire::write(uint8_t b){
+        if(hostWireTxLen >= HOST_WIRE_BUFFER_LEN) return 0;
+        hostWireTxBuffer[hostWireTxLen++] = b;
+        return 1;
+    }
+
+    size_t TwoWire::write(const uint8_t* buf, size_t len){
+        size_t n = 0;
+        while(n < len && write(buf[n])) n++;
+        return n;
+    }
+
+    uint8_t hostWireAddress(void){ return hostWireSlaveAddress; }
+
+    void hostWireReceive(const uint8_t* buf, size_t len){
+        if(len > HOST_WIRE_BUFFER_LEN) len = HOST_WIRE_BUFFER_LEN;
+        memcpy(hostWireRxBuffer, buf, len);
+        hostWireRxLen = len;
+        hostWireRxIndex = 0;
+        if(hostWireReceiveHandler != NULL) hostWireReceiveHandler(len);
+    }
+
+    size_t hostWireRequest(uint8_t* buf, size_t maxLen){
+        hostWireTxLen = 0;
+        if(hostWireRequestHandler != NULL) hostWireRequestHandler();
+        size_t len = hostWireTxLen < maxLen ? hostWireTxLen : maxLen;
+        memcpy(buf, hostWireTxBuffer, len);
+        return len;
+    }
+
+    /* ----------------------------- Radio ----------------------------- */
+    void hostRadioReset(void){
+        memset(&hostRadio, 0, sizeof(hostRadio));
+    }
+
+    void hostRadioReceive(const uint8_t* buf, size_t len){
+        if(len > HOST_RADIO_BUFFER_LEN) len = HOST_RADIO_BUFFER_LEN;
+        memcpy(hostRadio.rxData, buf, len);
+        hostRadio.rxLen = len;
+        if(hostRadio.dio1 != NULL) hostRadio.dio1();
+    }
+
+    int16_t SX1262::begin(float freq, float bw, uint8_t sf, uint8_t cr, uint8_t syncWord, int8_t power, uint16_t preambleLength, float tcxoVoltage, bool useRegulatorLDO){
+        (void)syncWord; (void)tcxoVoltage; (void)useRegulatorLDO;
+        hostRadio.frequency = freq;
+        hostRadio.bandwidth = bw;
+        hostRadio.spreadingFactor = sf;
+        hostRadio.codingRate = cr;
+        hostRadio.power = power;
+        hostRadio.preambleLength = preambleLength;
+        return ERR_NONE;
+    }
+
+    int16_t SX1262::setFrequency(float freq, bool calibrate){
+        (void)calibrate;
+        if(hostRadio.setFrequencyResult != ERR_NONE) return hostRadio.setFrequencyResult;
+        hostRadio.frequency = freq;
+        return ERR_NONE;
+    }
+
+    int16_t SX1262::setBandwidth(float bw){ hostRadio.bandwidth = bw; return ERR_NONE; }
+    int16_t SX1262::setSpreadingFactor(uint8_t sf){ hostRadio.spreadingFactor = sf; return ERR_NONE; }
+    int16_t SX1262::setCodingRate(uint8_t cr){ hostRadio.codingRate = cr; return ERR_NONE; }
+    int16_t SX1262::setSyncWord(uint8_t syncWord, uint8_t controlBits){ (void)syncWord; (void)controlBits; return ERR_NONE; }
+    int16_t SX1262::setOutputPower(int8_t power){ hostRadio.power = power; return ERR_NONE; }
+    int16_t SX1262::setPreambleLength(uint16_t preambleLength){ hostRadio.preambleLength = preambleLength; return ERR_NONE; }
+    int16_t SX1262::setCurrentLimit(float currentLimit){ hostRadio.currentLimit = currentLimit; return ERR_NONE; }
+    void SX1262::setRfSwitchPins(int rxEn, int txEn){ (void)rxEn; (void)txEn; }
+    void SX1262::setDio1Action(void (*func)(void)){ hostRadio.dio1 = func; }
+    void SX1262::clearDio1Action(void){ hostRadio.dio1 = NULL; }
+
+    int16_t SX1262::startReceive(uint32_t timeout, uint16_t irqFlags, uint16_t irqMask){
+        (void)timeout; (void)irqFlags; (void)irqMask;
+        hostRadio.receiving = true;
+        return ERR_NONE;
+    }
+
+    int16_t SX1262::readData(uint8_t* data, size_t len){
+        memcpy(data, hostRadio.rxData, hostRadio.rxLen < len ? hostRadio.rxLen : len);
+        return ERR_NONE;
+    }
+
+    int16_t SX1262::transmit(uint8_t* data, size_t len, uint8_t addr){
+        (void)addr;
+        hostRadio.receiving = false;
+        if(len > HOST_RADIO_BUFFER_LEN) return ERR_PACKET_TOO_LONG;
+        memcpy(hostRadio.txData, data, len);
+        hostRadio.txLen = len;
+        hostRadio.txCount++;
+        hostClock += hostRadio.transmitMicros;
+        if(hostRadio.transmitted != NULL) hostRadio.transmitted();
+        return ERR_NONE;
+    }
+
+    int16_t SX1262::scanChannel(void){
+        hostRadio.receiving = false;
+        return hostRadio.scanChannel != NULL ? hostRadio.scanChannel() : CHANNEL_FREE;
+    }
+
+    int16_t SX1262::standby(void){ hostRadio.receiving = false; return ERR_NONE; }
+    int16_t SX1262::sleep(bool retainConfig){ (void)retainConfig; hostRadio.receiving = false; return ERR_NONE; }
+    size_t SX1262::getPacketLength(bool update){ (void)update; return hostRadio.rxLen; }
+    float SX1262::getRSSI(void){ return hostRadio.rssi; }
+    float SX1262::getSNR(void){ return hostRadio.snr; }
+    uint32_t SX1262::getPacketStatus(void){ return 0; }
@@ -0,0 +1,141 @@
+/*
+*   Purpose :   What the tests see of the simulated board: its clock, interrupts, pins, EEPROM,
+*               serial ports, radio, and the TWI and Wire hooks the bus simulation attaches to.
+*/
+
+#ifndef INC_HOST_HOSTARDUINO_H_
+#define INC_HOST_HOSTARDUINO_H_
+
+#include <Arduino.h>
+#include <vector>
+
+
+/*-------------------------------------------------------------------------*\
+|								  Definitions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    #define HOST_EEPROM_SIZE                (E2END + 1)
+    #define HOST_EEPROM_WRITE_MICROS        3300                    // Erase and write of one cell
+    #define HOST_TIMER0_OVERFLOW_MICROS     2048                    // The millis() tick at 8 MHz, what wakes an idle sleep
+    #define HOST_RADIO_BUFFER_LEN           256
+    #define HOST_EXTERNAL_INTERRUPTS        2                       // INT0 and INT1
+    #define HOST_SERIAL_TX_BUFFER_LEN       64                      // The core's, a write waits once it's full
+    #define HOST_SOFTWARE_SERIAL_BUFFER_LEN 64                      // The library's, bytes past it are dropped
+
+
+/*-------------------------------------------------------------------------*\
+|								     Types					   			    |
+\*-------------------------------------------------------------------------*/
+
+
+    /* The SX1262's configuration as last set, and what it will do next */
+    struct HostRadio{
+        float frequency;
+        float bandwidth;
+        uint8_t spreadingFactor;
+        uint8_t codingRate;
+        uint16_t preambleLength;
+        int8_t power;
+        float currentLimit;                                         // mA
+        bool receiving;
+
+        int16_t (*scanChannel)(void);                               // CHANNEL_FREE when NULL
+        int16_t setFrequencyResult;
+        uint32_t transmitMicros;                                    // How long transmit() blocks
+
+        uint8_t txData[HOST_RADIO_BUFFER_LEN];
+        size_t txLen;
+        uint32_t txCount;
+        void (*transmitted)(void);                                  // Called after each transmit(), the frame is in txData
+
+        uint8_t rxData[HOST_RADIO_BUFFER_LEN];
+        size_t rxLen;
+        float rssi;
+        float snr;
+
+        void (*dio1)(void);
+    };
+
+    /* How sleep_cpu has been called */
+    struct HostSleep{
+        int mode;
+        bool enabled;
+        uint32_t sleeps;
+        uint32_t sleepsWithInterruptsOff;                           // Would never have woken
+    };
+
+
+/*-------------------------------------------------------------------------*\
+|								   Variables					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /* Runs wherever the firmware could take an interrupt: the clock, interrupts(), and sleep */
+    extern void (*hostInterruptSource)(void);
+
+    /* When the source's next interrupt arrives (us), so sleep_cpu wakes for it before the next tick */
+    extern uint64_t (*hostNextInterrupt)(void);
+
+    /* Called with every value written to TWCR */
+    extern void (*hostTwiControlWritten)(uint8_t value);
+
+    /* Called after pinMode or digitalWrite, and asked for the level of pins that aren't driven */
+    extern void (*hostPinChanged)(uint8_t pin);
+    extern int (*hostPinInput)(uint8_t pin);
+
+    extern uint32_t hostClockStepMicros;                            // Added on every millis() and micros(), so spinning on the clock ends
+    extern bool hostMillisTicks;                                    // millis() moves only on timer 0 overflows, as on the board
+    extern uint16_t hostAnalogValue;
+    extern uint32_t hostSerialBaud;                                 // 0 sends instantly, otherwise writes take the line's time
+    extern HostRadio hostRadio;
+    extern HostSleep hostSleep;
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /* Clock */
+    void hostSetMicros(uint64_t us);
+    void hostAdvanceMicros(uint64_t us);
+    uint64_t hostMicros(void);
+
+    /* Interrupts */
+    bool hostInterruptsEnabled(void);
+
+    /* Runs the handler attached to INT0 or INT1, from a hostInterruptSource */
+    void hostExternalInterrupt(uint8_t interrupt);
+
+    /* Pins, the level a driven pin is driven to, or HIGH from the pull-up otherwise */
+    uint8_t hostGetPinMode(uint8_t pin);
+    int hostGetPinLevel(uint8_t pin);
+
+    /* EEPROM */
+    uint8_t* hostEepromData(void);
+    uint32_t hostEepromWrites(int address);
+    uint32_t hostEepromTotalWrites(void);
+    uint32_t hostEepromWaits(void);
+    void hostEepromErase(void);
+
+    /* Hardware serial, every write() call is kept as one chunk */
+    void hostSerialFeed(const uint8_t* buf, size_t len);
+    const std::vector<std::vector<uint8_t> >& hostSerialWrites(void);
+    void hostSerialClear(void);
+
+    /* Software serial, returns how many fit in the buffer, none while it isn't listening */
+    size_t hostSoftwareSerialFeed(const uint8_t* buf, size_t len);
+    size_t hostSoftwareSerialPending(void);
+    bool hostSoftwareSerialListening(void);
+
+    /* Radio, a received frame is loaded and DIO1 raised */
+    void hostRadioReset(void);
+    void hostRadioReceive(const uint8_t* buf, size_t len);
+
+    /* Wire slave, as the bus master sees it */
+    uint8_t hostWireAddress(void);
+    void hostWireReceive(const uint8_t* buf, size_t len);
+    size_t hostWireRequest(uint8_t* buf, size_t maxLen);
+
+#endif /* INC_HOST_HOSTARDUINO_H_ */
@@ -0,0 +1,248 @@
+/*
+*   Purpose :   The simulated TWI bus behind HostTwiBus.h.
+*/
+
+
+#include "HostTwiBus.h"
+#include "HostArduino.h"
+#include <Wire.h>
+#include <util/twi.h>
+
+
+/*-------------------------------------------------------------------------*\
+|								  Definitions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    #define HOST_TWI_START_BITS             1
+    #define HOST_TWI_BYTE_BITS              9                       // Eight and the acknowledge
+
+    /* Where the master is in a transfer */
+    enum HostTwiPhase{ HOST_TWI_IDLE, HOST_TWI_ADDRESS, HOST_TWI_WRITING, HOST_TWI_READING, HOST_TWI_UNANSWERED };
+
+    /* The firmware's TWI interrupt */
+    extern "C" void TWI_vect(void);
+
+
+/*-------------------------------------------------------------------------*\
+|								   Variables					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    HostTwiStats hostTwiStats;
+
+    const HostTwiSlave* hostTwiSlaves[HOST_TWI_MAX_SLAVES];
+    const HostTwiSlave* hostTwiAddressed = NULL;
+    HostTwiPhase hostTwiPhase = HOST_TWI_IDLE;
+    bool hostTwiOwned = false;                                      // Between the master's START and STOP
+
+    /* TWINT, raised when the step in progress finishes */
+    bool hostTwiPending = false;
+    uint64_t hostTwiReadyAt = 0;
+
+    /* The lines while the pins are driven by hand */
+    uint8_t hostTwiSdaHeldClocks = 0;
+    int hostTwiLastScl = HIGH;
+    int hostTwiLastSda = HIGH;
+
+    /* The Wire slave's side of a transfer */
+    HostTwiSlave hostTwiWire;
+    uint8_t hostTwiWireRx[HOST_WIRE_BUFFER_LEN];
+    size_t hostTwiWireRxLen = 0;
+    uint8_t hostTwiWireTx[HOST_WIRE_BUFFER_LEN];
+    size_t hostTwiWireTxLen = 0;
+    size_t hostTwiWireTxIndex = 0;
+    bool hostTwiWireReading = false;
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /* ----------------------------- Master ----------------------------- */
+    void hostTwiSchedule(uint8_t status, uint8_t bits){
+        uint32_t sclPeriod = 16 + 2 * TWBR;                         // CPU cycles per SCL period, prescaler 1
+        uint64_t us = ((uint64_t)bits * sclPeriod * 1000000 + F_CPU - 1) / F_CPU;
+        TWSR = status | (TWSR & ~TW_STATUS_MASK);
+        hostTwiReadyAt = hostMicros() + us;
+        hostTwiStats.busyMicros += us;
+        hostTwiPending = true;
+    }
+
+    void hostTwiRelease(void){
+        if(hostTwiAddressed != NULL && hostTwiAddressed->stop != NULL) hostTwiAddressed->stop();
+        hostTwiAddressed = NULL;
+    }
+
+    const HostTwiSlave* hostTwiFind(uint8_t address){
+        for(int i = 0; i < HOST_TWI_MAX_SLAVES; i++){
+            if(hostTwiSlaves[i] != NULL && hostTwiSlaves[i]->address == address) return hostTwiSlaves[i];
+        }
+        return NULL;
+    }
+
+    void hostTwiControl(uint8_t value){
+        /* Off, the TWI lets go of the pins and forgets the transfer, the slaves don't */
+        if(!(value & _BV(TWEN))){
+            hostTwiPending = false;
+            hostTwiOwned = false;
+            hostTwiPhase = HOST_TWI_IDLE;
+            return;
+        }
+
+        /* Writing TWINT clears it and starts the next step, without it nothing moves */
+        if(!(value & _BV(TWINT))) return;
+        TWCR.value &= ~_BV(TWINT);
+
+        if(value & _BV(TWSTO)){
+            TWCR.value &= ~_BV(TWSTO);
+            hostTwiRelease();
+            hostTwiOwned = false;
+            hostTwiPhase = HOST_TWI_IDLE;
+            hostTwiStats.stops++;
+            return;
+        }
+
+        /* A START waits for the bus to be free, which it never is while SDA is held */
+        if(value & _BV(TWSTA)){
+            if(hostTwiSdaHeldClocks != 0) return;
+            hostTwiRelease();
+            hostTwiStats.starts++;
+            hostTwiSchedule(hostTwiOwned ? TW_REP_START : TW_START, HOST_TWI_START_BITS);
+            hostTwiOwned = true;
+            hostTwiPhase = HOST_TWI_ADDRESS;
+            return;
+        }
+
+        switch(hostTwiPhase){
+            case HOST_TWI_ADDRESS: {
+                bool reading = TWDR & TW_READ;
+                hostTwiStats.bytes++;
+                hostTwiAddressed = hostTwiFind(TWDR >> 1);
+                if(hostTwiAddressed == NULL){
+                    hostTwiPhase = HOST_TWI_UNANSWERED;
+                    hostTwiSchedule(reading ? TW_MR_SLA_NACK : TW_MT_SLA_NACK, HOST_TWI_BYTE_BITS);
+                    break;
+                }
+                hostTwiAddressed->start(reading);
+                hostTwiPhase = reading ? HOST_TWI_READING : HOST_TWI_WRITING;
+                hostTwiSchedule(reading ? TW_MR_SLA_ACK : TW_MT_SLA_ACK, HOST_TWI_BYTE_BITS);
+                break;
+            }
+            case HOST_TWI_WRITING:
+                hostTwiStats.bytes++;
+                hostTwiSchedule(hostTwiAddressed->write(TWDR) ? TW_MT_DATA_ACK : TW_MT_DATA_NACK, HOST_TWI_BYTE_BITS);
+                break;
+            case HOST_TWI_READING:
+                hostTwiStats.bytes++;
+                TWDR = hostTwiAddressed->read();
+                hostTwiSchedule((value & _BV(TWEA)) ? TW_MR_DATA_ACK : TW_MR_DATA_NACK, HOST_TWI_BYTE_BITS);
+                break;
+            default:
+                break;
+        }
+    }
+
+    void hostTwiInterrupt(void){
+        if(!hostTwiPending || hostMicros() < hostTwiReadyAt || !(TWCR.value & _BV(TWEN))) return;
+        hostTwiPending = false;
+        TWCR.value |= _BV(TWINT);
+        if(TWCR.value & _BV(TWIE)) TWI_vect();
+    }
+
+    /* ------------------------------ Pins ------------------------------ */
+    int hostTwiSda(void){ return hostTwiSdaHeldClocks != 0 ? LOW : hostGetPinLevel(SDA); }
+
+    int hostTwiPinInput(uint8_t pin){
+        if(pin == SDA) return hostTwiSda();
+        return hostGetPinLevel(pin);
+    }
+
+    /* With the TWI off, counts SCL pulses, which free a held SDA, and sees a STOP by hand */
+    void hostTwiPinChanged(uint8_t pin){
+        if(TWCR.value & _BV(TWEN)) return;
+        int scl = hostGetPinLevel(SCL);
+        if(pin == SCL && scl == HIGH && hostTwiLastScl == LOW){
+            hostTwiStats.manualClocks++;
+            if(hostTwiSdaHeldClocks != 0) hostTwiSdaHeldClocks--;
+        }
+        int sda = hostTwiSda();
+        if(pin == SDA && scl == HIGH && sda == HIGH && hostTwiLastSda == LOW){
+            hostTwiRelease();
+            hostTwiStats.stops++;
+        }
+        hostTwiLastScl = scl;
+        hostTwiLastSda = sda;
+    }
+
+    /* ------------------------------ Setup ------------------------------ */
+    void hostTwiBegin(void){
+        memset(hostTwiSlaves, 0, sizeof(hostTwiSlaves));
+        memset(&hostTwiStats, 0, sizeof(hostTwiStats));
+        hostTwiAddressed = NULL;
+        hostTwiPhase = HOST_TWI_IDLE;
+        hostTwiOwned = false;
+        hostTwiPending = false;
+        hostTwiSdaHeldClocks = 0;
+        hostTwiLastScl = HIGH;
+        hostTwiLastSda = HIGH;
+
+        hostTwiControlWritten = hostTwiControl;
+        hostPinInput = hostTwiPinInput;
+        hostPinChanged = hostTwiPinChanged;
+        hostInterruptSource = hostTwiInterrupt;
+    }
+
+    void hostTwiAttach(const HostTwiSlave* slave){
+        for(int i = 0; i < HOST_TWI_MAX_SLAVES; i++){
+            if(hostTwiSlaves[i] == NULL){
+                hostTwiSlaves[i] = slave;
+                return;
+            }
+        }
+    }
+
+    void hostTwiDetach(const HostTwiSlave* slave){
+        for(int i = 0; i < HOST_TWI_MAX_SLAVES; i++){
+            if(hostTwiSlaves[i] == slave) hostTwiSlaves[i] = NULL;
+        }
+    }
+
+    void hostTwiHoldSda(uint8_t clocks){ hostTwiSdaHeldClocks = clocks; }
+    bool hostTwiSdaHeld(void){ return hostTwiSdaHeldClocks != 0; }
+
+    /* --------------------------- Wire slave --------------------------- */
+    /* As the AVR Wire library: onRequest when addressed to read, onReceive when the write ends */
+    void hostTwiWireStart(bool reading){
+        hostTwiWireReading = reading;
+        hostTwiWireRxLen = 0;
+        if(reading){
+            hostTwiWireTxLen = hostWireRequest(hostTwiWireTx, sizeof(hostTwiWireTx));
+            hostTwiWireTxIndex = 0;
+        }
+    }
+
+    bool hostTwiWireWrite(uint8_t value){
+        if(hostTwiWireRxLen >= sizeof(hostTwiWireRx)) return false;
+        hostTwiWireRx[hostTwiWireRxLen++] = value;
+        return true;
+    }
+
+    /* Past what onRequest wrote the slave lets SDA float, the master reads 0xFF */
+    uint8_t hostTwiWireRead(void){
+        return hostTwiWireTxIndex < hostTwiWireTxLen ? hostTwiWireTx[hostTwiWireTxIndex++] : 0xFF;
+    }
+
+    void hostTwiWireStop(void){
+        if(!hostTwiWireReading) hostWireReceive(hostTwiWireRx, hostTwiWireRxLen);
+    }
+
+    const HostTwiSlave* hostTwiWireSlave(void){
+        hostTwiWire.address = hostWireAddress();
+        hostTwiWire.start = hostTwiWireStart;
+        hostTwiWire.write = hostTwiWireWrite;
+        hostTwiWire.read = hostTwiWireRead;
+        hostTwiWire.stop = hostTwiWireStop;
+        return &hostTwiWire;
+    }
@@ -0,0 +1,75 @@
+/*
+*   Purpose :   The ATmega328P's TWI as a bus master, and the slaves on its bus. Writes to TWCR step
+*               the bus, each step raises TWINT a bit or byte time later at the TWBR clock, and
+*               TWI_vect is taken from hostInterruptSource like any interrupt. A slave can be made
+*               to hold SDA low, as one left mid-byte does, until SCL has been pulsed by hand.
+*/
+
+#ifndef INC_HOST_HOSTTWIBUS_H_
+#define INC_HOST_HOSTTWIBUS_H_
+
+#include <Arduino.h>
+
+
+/*-------------------------------------------------------------------------*\
+|								  Definitions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    #define HOST_TWI_MAX_SLAVES             4
+
+
+/*-------------------------------------------------------------------------*\
+|								     Types					   			    |
+\*-------------------------------------------------------------------------*/
+
+
+    /* A slave, called as the master moves the bus along */
+    struct HostTwiSlave{
+        uint8_t address;                                            // 7-bit
+        void (*start)(bool reading);                                // Addressed for a write or a read
+        bool (*write)(uint8_t value);                               // A byte from the master, false to NACK it
+        uint8_t (*read)(void);                                      // A byte for the master
+        void (*stop)(void);                                         // A STOP or repeated start ended its part
+    };
+
+    /* What the bus has seen */
+    struct HostTwiStats{
+        uint32_t starts;                                            // Including repeated starts
+        uint32_t stops;                                             // By the TWI or by hand
+        uint32_t bytes;                                             // Address and data, either way
+        uint32_t manualClocks;                                      // SCL pulses with the TWI off
+        uint64_t busyMicros;                                        // Time the TWI spent moving bits
+    };
+
+
+/*-------------------------------------------------------------------------*\
+|								   Variables					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    extern HostTwiStats hostTwiStats;
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /* Attaches the bus to TWCR, the SDA and SCL pins, and hostInterruptSource, with no slaves */
+    void hostTwiBegin(void);
+
+    /* Takes TWI_vect if it's due, for tests that install their own hostInterruptSource */
+    void hostTwiInterrupt(void);
+
+    void hostTwiAttach(const HostTwiSlave* slave);
+    void hostTwiDetach(const HostTwiSlave* slave);
+
+    /* The power board's Wire slave (Wire.h) as a bus slave at the address it began with */
+    const HostTwiSlave* hostTwiWireSlave(void);
+
+    /* A slave holds SDA low from now until SCL has been pulsed the given number of times */
+    void hostTwiHoldSda(uint8_t clocks);
+    bool hostTwiSdaHeld(void);
+
+#endif /* INC_HOST_HOSTTWIBUS_H_ */
@@ -0,0 +1,56 @@
+/*
+*   Purpose :   The SX1262 as RadioLib presents it, backed by hostRadio (HostArduino.h) so the tests
+*               can set what the radio hears and see what it sent.
+*/
+
+#ifndef INC_HOST_RADIOLIB_H_
+#define INC_HOST_RADIOLIB_H_
+
+#include <Arduino.h>
+
+
+    #define ERR_NONE                        0
+    #define ERR_UNKNOWN                     -1
+    #define ERR_PACKET_TOO_LONG             -4
+    #define ERR_TX_TIMEOUT                  -5
+    #define ERR_RX_TIMEOUT                  -6
+    #define ERR_CRC_MISMATCH                -7
+    #define ERR_INVALID_BANDWIDTH           -8
+    #define PREAMBLE_DETECTED               -14
+    #define CHANNEL_FREE                    -15
+
+    class Module{
+        public:
+            Module(int cs, int irq, int rst, int gpio){ (void)cs; (void)irq; (void)rst; (void)gpio; }
+    };
+
+    class SX1262{
+        public:
+            SX1262(Module* mod){ (void)mod; }
+            int16_t begin(float freq, float bw, uint8_t sf, uint8_t cr, uint8_t syncWord, int8_t power, uint16_t preambleLength, float tcxoVoltage = 1.6, bool useRegulatorLDO = false);
+            int16_t setFrequency(float freq, bool calibrate = true);
+            int16_t setBandwidth(float bw);
+            int16_t setSpreadingFactor(uint8_t sf);
+            int16_t setCodingRate(uint8_t cr);
+            int16_t setSyncWord(uint8_t syncWord, uint8_t controlBits = 0x44);
+            int16_t setOutputPower(int8_t power);
+            int16_t setPreambleLength(uint16_t preambleLength);
+            int16_t setCurrentLimit(float currentLimit);
+            void setRfSwitchPins(int rxEn, int txEn);
+            void setDio1Action(void (*func)(void));
+            void clearDio1Action(void);
+            int16_t startReceive(uint32_t timeout = 0xFFFFFF, uint16_t irqFlags = 0, uint16_t irqMask = 0);
+            int16_t readData(uint8_t* data, size_t len);
+            int16_t transmit(uint8_t* data, size_t len, uint8_t addr = 0);
+            int16_t scanChannel(void);
+            int16_t standby(void);
+            int16_t sleep(bool retainConfig = true);
+            size_t getPacketLength(bool update = true);
+            float getRSSI(void);
+            float getSNR(void);
+
+        protected:
+            uint32_t getPacketStatus(void);
+    };
+
+#endif /* INC_HOST_RADIOLIB_H_ */
@@ -0,0 +1,24 @@
+#ifndef INC_HOST_SPI_H_
+#define INC_HOST_SPI_H_
+
+#include <stdint.h>
+
+
+    #define MSBFIRST                        1
+    #define SPI_MODE0                       0
+
+    struct SPISettings{
+        SPISettings(uint32_t clock, uint8_t order, uint8_t mode){ (void)clock; (void)order; (void)mode; }
+    };
+
+    class SPIClass{
+        public:
+            void begin(void){}
+            void beginTransaction(SPISettings){}
+            void endTransaction(void){}
+            uint8_t transfer(uint8_t b){ return b; }
+    };
+
+    extern SPIClass SPI;
+
+#endif /* INC_HOST_SPI_H_ */
@@ -0,0 +1,27 @@
+/*
+*   Purpose :   Reads whatever the test fed with hostSoftwareSerialFeed, writes are dropped. As on the
+*               module, nothing is taken in while the port isn't listening, and listen() empties it.
+*/
+
+#ifndef INC_HOST_SOFTWARESERIAL_H_
+#define INC_HOST_SOFTWARESERIAL_H_
+
+#include <Arduino.h>
+
+
+    class SoftwareSerial : public Stream{
+        public:
+            SoftwareSerial(uint8_t rx, uint8_t tx){ (void)rx; (void)tx; }
+            bool listen(void);
+            bool stopListening(void);
+            bool isListening(void);
+            bool overflow(void);
+            int available(void);
+            int read(void);
+            int peek(void);
+            size_t write(uint8_t b){ (void)b; return 1; }
+            size_t write(const uint8_t* buf, size_t len){ (void)buf; return len; }
+            using Stream::write;
+    };
+
+#endif /* INC_HOST_SOFTWARESERIAL_H_ */
@@ -0,0 +1,28 @@
+/*
+*   Purpose :   Wire as a slave only, for the power board firmware. The simulated bus master
+*               (hostWireReceive, hostWireRequest) calls the handlers the sketch registered.
+*/
+
+#ifndef INC_HOST_WIRE_H_
+#define INC_HOST_WIRE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+    #define HOST_WIRE_BUFFER_LEN            32                      // As the AVR Wire library
+
+    class TwoWire{
+        public:
+            void begin(uint8_t address);
+            size_t write(uint8_t b);
+            size_t write(const uint8_t* buf, size_t len);
+            int available(void);
+            int read(void);
+            void onReceive(void (*handler)(int));
+            void onRequest(void (*handler)(void));
+    };
+
+    extern TwoWire Wire;
+
+#endif /* INC_HOST_WIRE_H_ */
@@ -0,0 +1,8 @@
+#ifndef INC_HOST_AVR_EEPROM_H_
+#define INC_HOST_AVR_EEPROM_H_
+
+
+    /* False until the last write's HOST_EEPROM_WRITE_MICROS are up, as EECR's EEPE */
+    bool eeprom_is_ready(void);
+
+#endif /* INC_HOST_AVR_EEPROM_H_ */
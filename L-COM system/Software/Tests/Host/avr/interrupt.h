@@ -0,0 +1,10 @@
+#ifndef INC_HOST_AVR_INTERRUPT_H_
+#define INC_HOST_AVR_INTERRUPT_H_
+
+#include <avr/io.h>
+
+
+    void sei(void);
+    void cli(void);
+
+#endif /* INC_HOST_AVR_INTERRUPT_H_ */
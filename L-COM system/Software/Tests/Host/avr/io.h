@@ -0,0 +1,88 @@
+/*
+*   Purpose :   The ATmega328P registers the L-COM firmware touches, as plain variables. TWCR is
+*               the exception, writing it hands the value to the simulated TWI (HostArduino.h).
+*/
+
+#ifndef INC_HOST_AVR_IO_H_
+#define INC_HOST_AVR_IO_H_
+
+#include <stdint.h>
+
+
+/*-------------------------------------------------------------------------*\
+|								  Definitions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    #define F_CPU                           8000000UL
+    #define RAMSTART                        0x100
+    #define RAMEND                          0x8FF
+    #define E2END                           0x3FF
+
+    #define _BV(b)                          (1 << (b))
+    #define ISR(vector)                     extern "C" void vector(void)
+
+    /* MCUSR */
+    #define PORF                            0
+    #define EXTRF                           1
+    #define BORF                            2
+    #define WDRF                            3
+
+    /* ADMUX, ADCSRA */
+    #define MUX0                            0
+    #define MUX1                            1
+    #define MUX2                            2
+    #define MUX3                            3
+    #define REFS0                           6
+    #define REFS1                           7
+    #define ADPS0                           0
+    #define ADPS1                           1
+    #define ADPS2                           2
+    #define ADIE                            3
+    #define ADIF                            4
+    #define ADATE                           5
+    #define ADSC                            6
+    #define ADEN                            7
+    #define ADTS0                           0
+    #define ADTS1                           1
+    #define ADTS2                           2
+
+    /* TWCR, TWSR */
+    #define TWIE                            0
+    #define TWEN                            2
+    #define TWWC                            3
+    #define TWSTO                           4
+    #define TWSTA                           5
+    #define TWEA                            6
+    #define TWINT                           7
+    #define TWPS0                           0
+    #define TWPS1                           1
+
+
+/*-------------------------------------------------------------------------*\
+|								     Types					   			    |
+\*-------------------------------------------------------------------------*/
+
+
+    /* Every write is passed to hostTwiControlWritten */
+    struct HostTwiControlRegister{
+        volatile uint8_t value;
+        HostTwiControlRegister& operator=(uint8_t v);
+        operator uint8_t(void) const { return value; }
+    };
+
+
+/*-------------------------------------------------------------------------*\
+|								   Variables					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    extern volatile uint8_t MCUSR, SREG, SMCR, PRR;
+    extern volatile uint8_t ADMUX, ADCSRA, ADCSRB, DIDR0, ADCL, ADCH;
+    extern volatile uint16_t ADC;
+    extern volatile uint8_t TWSR, TWBR, TWDR, TWAR;
+    extern HostTwiControlRegister TWCR;
+    extern volatile uint8_t EIMSK, EICRA, SPCR, SPSR, SPDR, PORTB, DDRB;
+    extern volatile uint16_t SP;
+
+#endif /* INC_HOST_AVR_IO_H_ */
@@ -0,0 +1,22 @@
+/*
+*   Purpose :   The host has one address space, so flash reads are plain reads.
+*/
+
+#ifndef INC_HOST_AVR_PGMSPACE_H_
+#define INC_HOST_AVR_PGMSPACE_H_
+
+#include <stdint.h>
+#include <string.h>
+
+
+    #define PROGMEM
+    #define PSTR(s)                         (s)
+    #define pgm_read_byte(p)                (*(const uint8_t*)(p))
+    #define pgm_read_word(p)                (*(const uint16_t*)(p))
+    #define pgm_read_dword(p)               (*(const uint32_t*)(p))
+    #define pgm_read_ptr(p)                 (*(void* const*)(p))
+    #define memcpy_P                        memcpy
+    #define memcmp_P                        memcmp
+    #define strncpy_P                       strncpy
+
+#endif /* INC_HOST_AVR_PGMSPACE_H_ */
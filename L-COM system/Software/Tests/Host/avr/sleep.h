@@ -0,0 +1,20 @@
+/*
+*   Purpose :   sleep_cpu records the call and moves the clock to the next wake, see HostArduino.h.
+*/
+
+#ifndef INC_HOST_AVR_SLEEP_H_
+#define INC_HOST_AVR_SLEEP_H_
+
+
+    #define SLEEP_MODE_IDLE                 0
+    #define SLEEP_MODE_ADC                  1
+    #define SLEEP_MODE_PWR_DOWN             2
+    #define SLEEP_MODE_PWR_SAVE             3
+
+    void set_sleep_mode(int mode);
+    void sleep_enable(void);
+    void sleep_disable(void);
+    void sleep_cpu(void);
+    void sleep_bod_disable(void);
+
+#endif /* INC_HOST_AVR_SLEEP_H_ */
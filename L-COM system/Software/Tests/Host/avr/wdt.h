@@ -0,0 +1,12 @@
+#ifndef INC_HOST_AVR_WDT_H_
+#define INC_HOST_AVR_WDT_H_
+
+
+    #define WDTO_15MS                       0
+    #define WDTO_4S                         8
+
+    void wdt_enable(int timeout);
+    void wdt_reset(void);
+    void wdt_disable(void);
+
+#endif /* INC_HOST_AVR_WDT_H_ */
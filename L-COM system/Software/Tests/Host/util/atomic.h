@@ -0,0 +1,24 @@
+/*
+*   Purpose :   ATOMIC_BLOCK over the simulated interrupt flag, restoring it on the way out.
+*/
+
+#ifndef INC_HOST_UTIL_ATOMIC_H_
+#define INC_HOST_UTIL_ATOMIC_H_
+
+
+    void noInterrupts(void);
+    void interrupts(void);
+    bool hostInterruptsEnabled(void);
+
+    struct HostAtomicBlock{
+        bool restore;
+        bool once;
+        HostAtomicBlock(bool enableAfter) : restore(enableAfter), once(true){ noInterrupts(); }
+        ~HostAtomicBlock(){ if(restore) interrupts(); }
+    };
+
+    #define ATOMIC_RESTORESTATE             hostInterruptsEnabled()
+    #define ATOMIC_FORCEON                  true
+    #define ATOMIC_BLOCK(type)              for(HostAtomicBlock hostAtomic(type); hostAtomic.once; hostAtomic.once = false)
+
+#endif /* INC_HOST_UTIL_ATOMIC_H_ */
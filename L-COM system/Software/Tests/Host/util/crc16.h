@@ -0,0 +1,10 @@
+#ifndef INC_HOST_UTIL_CRC16_H_
+#define INC_HOST_UTIL_CRC16_H_
+
+#include <stdint.h>
+
+
+    /* The same polynomial (0xA001) as avr-libc */
+    uint16_t _crc16_update(uint16_t crc, uint8_t a);
+
+#endif /* INC_HOST_UTIL_CRC16_H_ */
@@ -0,0 +1,23 @@
+/*
+*   Purpose :   Checks for the host tests. A failed check is reported and the test carries on, main
+*               returns hostTestResult() so ctest sees the failure.
+*/
+
+#ifndef INC_HOSTTEST_H_
+#define INC_HOSTTEST_H_
+
+#include <stdio.h>
+
+
+    static int hostTestFailures = 0;
+
+    #define CHECK(cond)                     do{ if(!(cond)){ printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); hostTestFailures++; } } while(0)
+    #define CHECK_EQUAL(a, b)               do{ long long _a = (long long)(a), _b = (long long)(b); if(_a != _b){ printf("%s:%d: check failed: %s == %s (%lld != %lld)\n", __FILE__, __LINE__, #a, #b, _a, _b); hostTestFailures++; } } while(0)
+
+    static inline int hostTestResult(void){
+        if(hostTestFailures) printf("%d check(s) failed\n", hostTestFailures);
+        else printf("All checks passed\n");
+        return hostTestFailures ? 1 : 0;
+    }
+
+#endif /* INC_HOSTTEST_H_ */
@@ -0,0 +1,336 @@
+/*
+*   Purpose :   IMU batching model. The firmware's Imu.cpp runs from the scheduler as LCOM.ino does,
+*               against an MPU9250 on the simulated I2C bus: a register file, a 512 byte FIFO kept
+*               oldest-first, and the INT pin pulsing once per sample. Each sample carries its
+*               number, so the batches sent to the UART show any gap or misnumbering.
+*
+*               Every rate SET_IMU accepts from 100 Hz up runs for a minute steady, and again with
+*               a 370 ms transmission blocking the loop every 10 s. Reported are the samples lost,
+*               the share of time on the I2C bus and in drainImuFifo, and the UART's load, which
+*               blocks the writer at 115200 baud as the core's Serial.write does. The firmware's
+*               own CPU time outside the bus and the UART is not modeled.
+*/
+
+
+#include "HostTest.h"
+#include "HostArduino.h"
+#include "HostTwiBus.h"
+#include "Imu.h"
+#include "Perf.h"
+#include "Scheduler.h"
+#include "SerialInterface.h"
+#include <deque>
+#include <vector>
+
+
+/*-------------------------------------------------------------------------*\
+|								  Definitions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    #define MODEL_DURATION                  (60ULL * 1000000)       // us per case
+    #define MODEL_BLOCK_PERIOD              10000                   // ms between transmissions in the blocking case
+    #define MODEL_BLOCK_TIME                370                     // ms, a 40 byte frame at SF9
+    #define MODEL_FIFO_LEN                  512                     // MPU9250 FIFO, bytes
+    #define MODEL_MAX_RATE                  500                     // Hz, above it batches of 8 fill the UART
+    #define MODEL_UNCOUNTED                 0xFFFF                  // Number of a sample taken with the INT pin off
+    #define MODEL_RECORD_LEN                (TELEMETRY_RECORD_HEADER_LEN + IMU_BATCH_LEN + IMU_DEFAULT_BATCH*IMU_SAMPLE_LEN)
+
+
+/*-------------------------------------------------------------------------*\
+|								     Types					   			    |
+\*-------------------------------------------------------------------------*/
+
+
+    /* The MPU9250 as the firmware drives it */
+    struct ModelImu{
+        uint8_t registers[128];
+        uint8_t pointer;
+        bool pointerWritten;                                        // The first byte of a write is the register
+        uint8_t intStatus;
+        uint16_t countLatch;                                        // FIFO_COUNTH latches the count FIFO_COUNTL reads
+        std::deque<uint8_t> fifo;
+        uint64_t nextSample;                                        // us
+        uint16_t pulses;                                            // INT pulses since the interrupt was enabled, the firmware's count
+        uint32_t taken;
+    };
+
+    /* What the UART carried */
+    struct ModelResult{
+        uint32_t batches;
+        uint32_t sent;                                              // Samples
+        uint32_t gaps;                                              // Samples skipped between batches
+        uint32_t misnumbered;                                       // Not the sample the batch header says
+        uint32_t worstTimeError;                                    // ms, header time against when the first sample was taken
+        uint64_t uartBytes;
+    };
+
+
+/*-------------------------------------------------------------------------*\
+|								   Variables					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    ModelImu imu;
+    uint32_t takenMillis[65536];                                    // When each numbered sample was taken
+
+    void modelBlocker(void);
+    bool blocking = false;
+
+    /* serviceImu as in LCOM.ino's task table, and the transmission standing in for readRadio */
+    const SchedulerTask modelTable[] PROGMEM = {
+        {serviceImu,           5,                      10,     2},
+        {modelBlocker,         MODEL_BLOCK_PERIOD,     1000,   1}
+    };
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       imuSamplePeriod                                                         |
+    |   Purpose:    Returns the time between samples at the SMPLRT_DIV written.             |
+    |   Arguments:  void                                                                    |
+    |   Returns:    uint64_t (us)                                                           |
+    \*-------------------------------------------------------------------------------------*/
+    uint64_t imuSamplePeriod(void){
+        return 1000000ULL * (imu.registers[IMU_REG_SMPLRT_DIV] + 1) / IMU_INTERNAL_RATE;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       imuWriteRegister                                                        |
+    |   Purpose:    A register write, with the side effects the firmware relies on.         |
+    |   Arguments:  uint8_t, uint8_t                                                        |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void imuWriteRegister(uint8_t reg, uint8_t value){
+        bool wasSleeping = imu.registers[IMU_REG_PWR_MGMT_1] & IMU_SLEEP;
+        bool wasPulsing = imu.registers[IMU_REG_INT_ENABLE] & IMU_RAW_READY_ENABLE;
+        imu.registers[reg] = value;
+
+        if(reg == IMU_REG_PWR_MGMT_1 && (value & IMU_RESET)){
+            memset(imu.registers, 0, sizeof(imu.registers));
+            imu.registers[IMU_REG_PWR_MGMT_1] = IMU_SLEEP;
+            imu.fifo.clear();
+            imu.intStatus = 0;
+        }
+        if(reg == IMU_REG_USER_CTRL && (value & IMU_FIFO_RESET)){
+            imu.fifo.clear();
+            imu.registers[IMU_REG_USER_CTRL] &= ~IMU_FIFO_RESET;
+        }
+        if(wasSleeping && !(imu.registers[IMU_REG_PWR_MGMT_1] & IMU_SLEEP)) imu.nextSample = hostMicros() + imuSamplePeriod();
+        if(!wasPulsing && (imu.registers[IMU_REG_INT_ENABLE] & IMU_RAW_READY_ENABLE)) imu.pulses = 0;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       imuTakeSample                                                           |
+    |   Purpose:    One sample into the FIFO if it has room for all of it, numbered in      |
+    |               accelX and checked in accelY, then the INT pulse.                       |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void imuTakeSample(void){
+        bool pulsing = imu.registers[IMU_REG_INT_ENABLE] & IMU_RAW_READY_ENABLE;
+        uint16_t number = pulsing ? imu.pulses : MODEL_UNCOUNTED;
+        imu.taken++;
+        if(pulsing) takenMillis[number] = hostMicros() / 1000;
+
+        bool fifoOn = (imu.registers[IMU_REG_USER_CTRL] & IMU_FIFO_ENABLE) && imu.registers[IMU_REG_FIFO_EN] == IMU_FIFO_ACCEL_GYRO;
+        if(fifoOn && imu.fifo.size() + IMU_SAMPLE_LEN <= MODEL_FIFO_LEN){
+            ImuSample sample = { (int16_t)number, (int16_t)(number ^ 0x5555), 8192, 0, 0, 0 };
+            uint8_t buf[IMU_SAMPLE_LEN];
+            encodeImuSample(buf, sample);
+            imu.fifo.insert(imu.fifo.end(), buf, buf + IMU_SAMPLE_LEN);
+        }
+        else if(fifoOn) imu.intStatus |= IMU_FIFO_OVERFLOW;
+
+        if(pulsing){
+            imu.intStatus |= IMU_RAW_READY_ENABLE;
+            imu.pulses++;
+            hostExternalInterrupt(digitalPinToInterrupt(IMU_INT_PIN));
+        }
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       modelInterrupts                                                         |
+    |   Purpose:    The model's interrupt source: TWI_vect, then every sample due by now.   |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void modelInterrupts(void){
+        hostTwiInterrupt();
+        if(imu.registers[IMU_REG_PWR_MGMT_1] & IMU_SLEEP) return;
+        while(hostMicros() >= imu.nextSample){
+            imuTakeSample();
+            imu.nextSample += imuSamplePeriod();
+        }
+    }
+
+    /* The bus side of the MPU9250 */
+    void imuStart(bool reading){
+        if(!reading) imu.pointerWritten = false;
+    }
+
+    bool imuWrite(uint8_t value){
+        if(!imu.pointerWritten){
+            imu.pointer = value & 0x7F;
+            imu.pointerWritten = true;
+        }
+        else imuWriteRegister(imu.pointer++ & 0x7F, value);
+        return true;
+    }
+
+    uint8_t imuRead(void){
+        uint8_t reg = imu.pointer & 0x7F;
+        if(reg == IMU_REG_FIFO_R_W){
+            if(imu.fifo.empty()) return 0xFF;
+            uint8_t value = imu.fifo.front();
+            imu.fifo.pop_front();
+            return value;
+        }
+
+        imu.pointer++;
+        if(reg == IMU_REG_WHO_AM_I) return IMU_WHO_AM_I_MPU9250;
+        if(reg == IMU_REG_INT_STATUS){
+            uint8_t value = imu.intStatus;
+            imu.intStatus = 0;
+            return value;
+        }
+        if(reg == IMU_REG_FIFO_COUNTH){
+            imu.countLatch = imu.fifo.size();
+            return imu.countLatch >> 8;
+        }
+        if(reg == IMU_REG_FIFO_COUNTH + 1) return imu.countLatch & 0xFF;
+        return imu.registers[reg];
+    }
+
+    void imuStop(void){}
+
+    const HostTwiSlave imuSlave = { IMU_ADDRESS, imuStart, imuWrite, imuRead, imuStop };
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       modelBlocker                                                            |
+    |   Purpose:    A transmission in the blocking case, the loop stuck with interrupts on. |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void modelBlocker(void){
+        if(!blocking) return;
+        for(int i = 0; i < MODEL_BLOCK_TIME; i++) delay(1);
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       checkBatches                                                            |
+    |   Purpose:    Walks the batch records the UART carried, in order.                     |
+    |   Arguments:  void                                                                    |
+    |   Returns:    ModelResult                                                             |
+    \*-------------------------------------------------------------------------------------*/
+    ModelResult checkBatches(void){
+        ModelResult result = {};
+        bool first = true;
+        uint16_t expected = 0;
+
+        const std::vector<std::vector<uint8_t> >& writes = hostSerialWrites();
+        for(size_t i = 0; i < writes.size(); i++){
+            const std::vector<uint8_t>& packet = writes[i];
+            result.uartBytes += packet.size();
+            if(packet.size() < PKT_HEADER_LEN + MODEL_RECORD_LEN + PKT_TRAILER_LEN) continue;
+
+            const uint8_t* record = packet.data() + packet.size() - PKT_TRAILER_LEN - MODEL_RECORD_LEN;
+            if(record[0] != TELEMETRY_IMU_BATCH) continue;
+            ImuBatch header;
+            const uint8_t* p = decodeImuBatch(record + TELEMETRY_RECORD_HEADER_LEN, &header);
+
+            if(!first) result.gaps += (uint16_t)(header.sequence - expected);
+            first = false;
+            expected = header.sequence + header.count;
+
+            uint32_t error = (uint32_t)abs((int32_t)(header.time - takenMillis[header.sequence]));
+            if(error > result.worstTimeError) result.worstTimeError = error;
+
+            for(uint8_t j = 0; j < header.count; j++){
+                ImuSample sample;
+                p = decodeImuSample(p, &sample);
+                uint16_t number = header.sequence + j;
+                if((uint16_t)sample.accelX != number || (uint16_t)sample.accelY != (number ^ 0x5555)) result.misnumbered++;
+            }
+            result.batches++;
+            result.sent += header.count;
+        }
+        return result;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       runCase                                                                 |
+    |   Purpose:    Starts the IMU at the rate and runs the loop for MODEL_DURATION,        |
+    |               printing one line of results.                                           |
+    |   Arguments:  uint16_t (Hz), bool                                                     |
+    |   Returns:    ModelResult                                                             |
+    \*-------------------------------------------------------------------------------------*/
+    ModelResult runCase(uint16_t rate, bool block){
+        blocking = block;
+        CHECK_EQUAL(configureImu(rate, IMU_DEFAULT_BATCH), IMU_OK);
+        CHECK_EQUAL(initializeScheduler(modelTable, sizeof(modelTable)/sizeof(modelTable[0])), SCHEDULER_OK);
+        resetPerfStats();
+        hostSerialClear();
+        hostTwiStats = HostTwiStats();
+        imu.taken = 0;
+
+        uint64_t start = hostMicros();
+        while(hostMicros() - start < MODEL_DURATION){
+            runScheduler();
+            idleScheduler();
+        }
+        configureImu(0, IMU_DEFAULT_BATCH);
+
+        ModelResult result = checkBatches();
+        uint8_t stats[PERF_STATS_LEN];
+        getPerfStats(stats);
+        const uint8_t* drain = stats + 2 + PERF_COUNTER_COUNT*4 + PERF_IMU_DRAIN*PERF_TIMER_RECORD_LEN;
+        double drainMicros = (double)extract_uint32_t(drain, 8) * extract_uint32_t(drain, 12);
+        double seconds = MODEL_DURATION / 1e6;
+
+        printf("  %4u Hz  %-8s  %7lu  %7lu  %6lu  %5lu  %5lu  %6.2f %%  %6.2f %%  %6.0f B/s  %5.1f %%  %4lu ms\n", rate, block ? "blocked" : "steady",
+            (unsigned long)imu.taken, (unsigned long)result.sent, (unsigned long)perfCounters[PERF_IMU_SAMPLES_LOST], (unsigned long)result.gaps,
+            (unsigned long)result.misnumbered, 100.0 * hostTwiStats.busyMicros / MODEL_DURATION, 100.0 * drainMicros / MODEL_DURATION,
+            result.uartBytes / seconds, 100.0 * result.uartBytes / seconds / (SERIAL_BAUD / 10), (unsigned long)result.worstTimeError);
+        return result;
+    }
+
+
+/*-------------------------------------------------------------------------*\
+|								     Main					   			    |
+\*-------------------------------------------------------------------------*/
+
+
+    int main(void){
+        hostTwiBegin();
+        hostInterruptSource = modelInterrupts;
+        hostSerialBaud = SERIAL_BAUD;
+        imu.registers[IMU_REG_PWR_MGMT_1] = IMU_SLEEP;
+        hostTwiAttach(&imuSlave);
+
+        initializeTwi();
+        CHECK_EQUAL(initializeImu(), IMU_OK);
+        CHECK_EQUAL(setTelemetryDestination(TELEMETRY_UART), TELEMETRY_OK);
+
+        printf("  rate     case        taken     sent    lost   gaps  wrong      I2C     drain        UART   of link  time err\n");
+        const uint16_t rates[] = { 100, 125, 200, 250, 500, 1000 };
+        for(size_t i = 0; i < sizeof(rates)/sizeof(rates[0]); i++){
+            for(int block = 0; block < 2; block++){
+                ModelResult result = runCase(rates[i], block);
+                CHECK_EQUAL(result.misnumbered, 0);
+                CHECK(result.worstTimeError <= 1000U / rates[i] + 2);
+                if(rates[i] > MODEL_MAX_RATE) continue;
+
+                /* Up to the UART's limit nothing goes steady, and blocked only what the FIFO can't hold over a block */
+                uint32_t blocks = block ? MODEL_DURATION / 1000 / MODEL_BLOCK_PERIOD : 0;
+                CHECK(perfCounters[PERF_IMU_SAMPLES_LOST] <= blocks * (rates[i] * MODEL_BLOCK_TIME / 1000 + IMU_QUEUE_LEN));
+                CHECK(result.gaps <= perfCounters[PERF_IMU_SAMPLES_LOST]);
+            }
+        }
+
+        return hostTestResult();
+    }
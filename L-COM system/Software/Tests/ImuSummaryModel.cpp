@@ -0,0 +1,231 @@
+/*
+*   Purpose :   IMU summary model. A minute of synthetic flight at 200 Hz (gravity, a slow pendulum
+*               swing, spin, noise, and a shock at burst) goes through ImuSummary.cpp, and every
+*               window it sends to the UART is checked against the same statistics worked out in
+*               doubles.
+*
+*               The records it sent are then priced in airtime with the firmware's getTimeOnAir at
+*               SF7 to SF12, against raw batches of 8 at every rate from 100 Hz, each frame with
+*               its air header and the record type, along with the shortest window that keeps
+*               summaries to a tenth of the airtime.
+*/
+
+
+#include "HostTest.h"
+#include "HostArduino.h"
+#include "Imu.h"
+#include "ImuSummary.h"
+#include "RadioController.h"
+#include "SerialInterface.h"
+#include <math.h>
+#include <random>
+#include <vector>
+
+
+/*-------------------------------------------------------------------------*\
+|								  Definitions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    #define MODEL_RATE                      200                     // Hz
+    #define MODEL_SECONDS                   60
+    #define MODEL_WINDOW                    1000                    // ms
+    #define MODEL_SHOCK_SAMPLE              (MODEL_RATE * 42 + 17)  // Burst, 42 s in
+    #define MODEL_SEED                      2021
+    #define MODEL_BUDGET                    0.1                     // Share of airtime telemetry may take, the rest is the link's
+
+
+/*-------------------------------------------------------------------------*\
+|								     Types					   			    |
+\*-------------------------------------------------------------------------*/
+
+
+    /* One window's statistics worked out in doubles */
+    struct ModelWindow{
+        double sum[6];
+        double sumSquares[6];
+        int16_t min[6];
+        int16_t max[6];
+        double accelPeak;
+        double gyroPeak;
+        uint16_t first;
+        uint16_t count;
+    };
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       flightSample                                                            |
+    |   Purpose:    The n'th sample of the synthetic flight, raw counts at 4 g and 500 dps. |
+    |   Arguments:  uint32_t, std::mt19937&                                                 |
+    |   Returns:    ImuSample                                                               |
+    \*-------------------------------------------------------------------------------------*/
+    ImuSample flightSample(uint32_t n, std::mt19937& random){
+        std::normal_distribution<double> noise(0, 40);
+        double t = (double)n / MODEL_RATE;
+        double swing = 0.3 * sin(2 * M_PI * t / 4.5);                          // rad, a 5 m line
+        double g = IMU_ACCEL_LSB_PER_G;
+        double shock = (n >= MODEL_SHOCK_SAMPLE && n < MODEL_SHOCK_SAMPLE + 3) ? 3.5 * g : 0;
+
+        ImuSample sample;
+        sample.accelX = (int16_t)lround(g * sin(swing) + noise(random) + shock);
+        sample.accelY = (int16_t)lround(noise(random));
+        sample.accelZ = (int16_t)lround(g * cos(swing) + noise(random) - shock / 2);
+        sample.gyroX = (int16_t)lround(IMU_GYRO_LSB_PER_DPS * 0.3 * 2 * M_PI / 4.5 * cos(2 * M_PI * t / 4.5) * 180 / M_PI + noise(random) / 4);
+        sample.gyroY = (int16_t)lround(noise(random) / 4);
+        sample.gyroZ = (int16_t)lround(IMU_GYRO_LSB_PER_DPS * 12 * sin(2 * M_PI * t / 30) + noise(random) / 4);
+        return sample;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       addToWindow                                                             |
+    |   Purpose:    Folds a sample into the reference window.                               |
+    |   Arguments:  ModelWindow&, const ImuSample&, uint16_t                                |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void addToWindow(ModelWindow& window, const ImuSample& sample, uint16_t sequence){
+        const int16_t axes[6] = { sample.accelX, sample.accelY, sample.accelZ, sample.gyroX, sample.gyroY, sample.gyroZ };
+        if(window.count == 0){
+            window = ModelWindow();
+            for(int i = 0; i < 6; i++){
+                window.min[i] = INT16_MAX;
+                window.max[i] = INT16_MIN;
+            }
+            window.first = sequence;
+        }
+
+        double magnitude[2] = { 0, 0 };
+        for(int i = 0; i < 6; i++){
+            window.sum[i] += axes[i];
+            window.sumSquares[i] += (double)axes[i] * axes[i];
+            window.min[i] = std::min(window.min[i], axes[i]);
+            window.max[i] = std::max(window.max[i], axes[i]);
+            magnitude[i / 3] += (double)axes[i] * axes[i];
+        }
+        window.accelPeak = std::max(window.accelPeak, sqrt(magnitude[0]));
+        window.gyroPeak = std::max(window.gyroPeak, sqrt(magnitude[1]));
+        window.count++;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       checkSummary                                                            |
+    |   Purpose:    Checks a summary record against the reference window. Means and RMS     |
+    |               may be a count out from rounding, the rest must match.                  |
+    |   Arguments:  const uint8_t* (record after its type), const ModelWindow&              |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void checkSummary(const uint8_t* p, const ModelWindow& window){
+        ImuSummary header;
+        p = decodeImuSummary(p, &header);
+        CHECK_EQUAL(header.sequence, window.first);
+        CHECK_EQUAL(header.count, window.count);
+        CHECK_EQUAL(header.included, IMU_SUMMARY_ALL);
+
+        ImuSample mean, min, max, rms;
+        p = decodeImuSample(p, &mean);
+        p = decodeImuSample(p, &min);
+        p = decodeImuSample(p, &max);
+        p = decodeImuSample(p, &rms);
+        const int16_t means[6] = { mean.accelX, mean.accelY, mean.accelZ, mean.gyroX, mean.gyroY, mean.gyroZ };
+        const int16_t mins[6] = { min.accelX, min.accelY, min.accelZ, min.gyroX, min.gyroY, min.gyroZ };
+        const int16_t maxes[6] = { max.accelX, max.accelY, max.accelZ, max.gyroX, max.gyroY, max.gyroZ };
+        const int16_t roots[6] = { rms.accelX, rms.accelY, rms.accelZ, rms.gyroX, rms.gyroY, rms.gyroZ };
+        for(int i = 0; i < 6; i++){
+            CHECK(fabs(means[i] - window.sum[i] / window.count) <= 0.5 + 1e-9);
+            CHECK_EQUAL(mins[i], window.min[i]);
+            CHECK_EQUAL(maxes[i], window.max[i]);
+            CHECK(fabs(roots[i] - sqrt(window.sumSquares[i] / window.count)) < 1);
+        }
+
+        ImuPeaks peaks;
+        decodeImuPeaks(p, &peaks);
+        CHECK(fabs(peaks.accelPeak - window.accelPeak) < 1);
+        CHECK(fabs(peaks.gyroPeak - window.gyroPeak) < 1);
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       airtimeShare                                                            |
+    |   Purpose:    Returns the share of airtime frames of the given record length take at  |
+    |               the given rate, with the radio's current parameters.                    |
+    |   Arguments:  uint16_t (record with its type), double (frames/s)                      |
+    |   Returns:    double                                                                  |
+    \*-------------------------------------------------------------------------------------*/
+    double airtimeShare(uint16_t recordLen, double framesPerSecond){
+        return getTimeOnAir(AIR_HEADER_LEN + recordLen) * framesPerSecond / 1e6;
+    }
+
+
+/*-------------------------------------------------------------------------*\
+|								     Main					   			    |
+\*-------------------------------------------------------------------------*/
+
+
+    int main(void){
+        hostEepromErase();
+        CHECK_EQUAL(initializeRadio(), ERR_NONE);
+        CHECK_EQUAL(setTelemetryDestination(TELEMETRY_UART), TELEMETRY_OK);
+        CHECK_EQUAL(configureImuSummary(MODEL_WINDOW, IMU_SUMMARY_ALL), IMU_SUMMARY_OK);
+        restartImuSummary(MODEL_RATE);
+
+        /* The flight, each window checked as its record comes out */
+        std::mt19937 random(MODEL_SEED);
+        ModelWindow window = ModelWindow();
+        uint32_t records = 0;
+        uint16_t recordLen = 0;
+        hostSerialClear();
+        for(uint32_t n = 0; n < (uint32_t)MODEL_RATE * MODEL_SECONDS; n++){
+            ImuSample sample = flightSample(n, random);
+            addToWindow(window, sample, n);
+            addImuSummarySample(sample, n);
+            if(hostSerialWrites().empty()) continue;
+
+            CHECK_EQUAL(window.count, MODEL_RATE * MODEL_WINDOW / 1000);
+            const std::vector<uint8_t>& packet = hostSerialWrites().back();
+            recordLen = TELEMETRY_RECORD_HEADER_LEN + IMU_SUMMARY_LEN + 4*IMU_SAMPLE_LEN + IMU_PEAKS_LEN;
+            const uint8_t* record = packet.data() + packet.size() - PKT_TRAILER_LEN - recordLen;
+            CHECK_EQUAL(record[0], TELEMETRY_IMU_SUMMARY);
+            checkSummary(record + TELEMETRY_RECORD_HEADER_LEN, window);
+            if(n / MODEL_RATE == MODEL_SHOCK_SAMPLE / MODEL_RATE) CHECK(window.accelPeak > 3 * IMU_ACCEL_LSB_PER_G);
+
+            window.count = 0;
+            records++;
+            hostSerialClear();
+        }
+        CHECK_EQUAL(records, MODEL_SECONDS * 1000 / MODEL_WINDOW);
+        printf("%lu windows of %u samples checked, %u bytes a record with every field\n\n", (unsigned long)records,
+            MODEL_RATE * MODEL_WINDOW / 1000, recordLen);
+
+        /* What each costs on air */
+        const uint16_t rawLen = TELEMETRY_RECORD_HEADER_LEN + IMU_BATCH_LEN + IMU_DEFAULT_BATCH*IMU_SAMPLE_LEN;
+        const uint16_t meanLen = TELEMETRY_RECORD_HEADER_LEN + IMU_SUMMARY_LEN + IMU_SAMPLE_LEN;
+        const uint16_t rates[] = { 100, 125, 200, 250, 500, 1000 };
+        printf("Airtime share at 125 kHz, CR 4/5: raw batches of %u (%u bytes) at each rate, summaries every %u ms\n", IMU_DEFAULT_BATCH, rawLen, MODEL_WINDOW);
+        printf("  SF   raw 100 Hz   125 Hz   200 Hz   250 Hz   500 Hz  1000 Hz   mean only (%u B)   all fields (%u B)   window for %.0f %%\n",
+            meanLen, recordLen, 100 * MODEL_BUDGET);
+        RadioParameters params = getRadioParameters();
+        for(uint8_t sf = 7; sf <= 12; sf++){
+            params.spreadingFactor = sf;
+            params.bandwidth = 125000;
+            params.codingRate = 5;
+            CHECK_EQUAL(setRadioParameters(params), ERR_NONE);
+
+            printf("  %2u", sf);
+            for(size_t i = 0; i < sizeof(rates)/sizeof(rates[0]); i++){
+                printf("  %8.0f %%", 100 * airtimeShare(rawLen, (double)rates[i] / IMU_DEFAULT_BATCH));
+                CHECK(airtimeShare(rawLen, (double)rates[i] / IMU_DEFAULT_BATCH) > 1);
+            }
+            double mean = airtimeShare(meanLen, 1000.0 / MODEL_WINDOW);
+            double all = airtimeShare(recordLen, 1000.0 / MODEL_WINDOW);
+            uint32_t window = (uint32_t)ceil(getTimeOnAir(AIR_HEADER_LEN + recordLen) / 1000.0 / MODEL_BUDGET);
+            printf("   %15.1f %%   %16.1f %%   %10.1f s\n", 100 * mean, 100 * all, window / 1000.0);
+
+            /* Raw batches never fit even at SF7, a summary with every field fits the budget at every SF with a window the command accepts */
+            CHECK(window <= IMU_SUMMARY_MAX_WINDOW);
+        }
+
+        return hostTestResult();
+    }
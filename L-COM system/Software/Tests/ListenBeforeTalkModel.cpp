@@ -0,0 +1,299 @@
+/*
+*   Purpose :   Collision model for listen-before-talk. Several nodes in range of each other send
+*               frames at random, once straight onto the air (pure ALOHA) and once through the
+*               firmware's CAD and backoff, and the frames that reached the receiver unoverlapped
+*               are counted. Frame length and the backoff constants come from the firmware, and
+*               its waitForClearChannel is run against a scripted busy channel first.
+*/
+
+
+#include "HostTest.h"
+#include "HostArduino.h"
+#include "RadioController.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+
+/*-------------------------------------------------------------------------*\
+|								  Definitions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    #define MODEL_PAYLOAD_LEN               40                      // Bytes on air per frame, air header included
+    #define MODEL_CAD_SYMBOLS               3                       // Two CAD symbols and the processing after them
+    #define MODEL_DURATION                  (4UL * 3600 * 1000000)  // us simulated per case
+    #define MODEL_SEED                      12345
+
+
+/*-------------------------------------------------------------------------*\
+|								     Types					   			    |
+\*-------------------------------------------------------------------------*/
+
+
+    struct Transmission{
+        uint64_t start;
+        uint64_t end;
+        int node;
+        bool collided;
+    };
+
+    enum NodeState{ NODE_IDLE, NODE_CAD, NODE_BACKOFF, NODE_TRANSMITTING };
+
+    struct Node{
+        NodeState state;
+        uint64_t stateEnd;                                          // When the CAD, backoff, or transmission ends
+        uint64_t cadStart;
+        uint64_t frameArrival;                                      // When the frame being sent was queued
+        uint32_t deferred;                                          // ms of backoff taken for this frame
+        uint8_t attempt;
+        std::vector<uint64_t> queue;                                // Arrival times of frames waiting to go
+        uint64_t nextArrival;
+    };
+
+    struct ModelResult{
+        uint32_t offered;
+        uint32_t delivered;
+        uint32_t collided;
+        uint32_t abandoned;
+        uint64_t accessDelay;                                       // Sum over sent frames, us
+        uint32_t sent;
+    };
+
+
+/*-------------------------------------------------------------------------*\
+|								   Variables					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    uint8_t scriptedBusyScans = 0;
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       scriptedScan                                                            |
+    |   Purpose:    The radio's CAD, busy for the first scriptedBusyScans scans.            |
+    |   Arguments:  void                                                                    |
+    |   Returns:    int16_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t scriptedScan(void){
+        if(scriptedBusyScans == 0) return CHANNEL_FREE;
+        scriptedBusyScans--;
+        return PREAMBLE_DETECTED;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       checkFirmwareBackoff                                                    |
+    |   Purpose:    Runs transmitRadio against a channel busy for a few scans, then one     |
+    |               that never clears, and checks the counters and deferral limit.          |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void checkFirmwareBackoff(void){
+        uint8_t frame[RADIO_TX_HEADROOM + 8];
+        uint8_t* data = frame + RADIO_TX_HEADROOM;
+        memcpy(data, "LBT test", 8);
+
+        setLBTEnabled(true);
+        hostRadio.scanChannel = scriptedScan;
+
+        /* Busy three times, then sent after waiting at most 2 + 4 + 8 slots */
+        scriptedBusyScans = 3;
+        uint32_t txBefore = hostRadio.txCount;
+        uint64_t start = hostMicros();
+        CHECK_EQUAL(transmitRadio(data, 8), ERR_NONE);
+        uint64_t waited = (hostMicros() - start) / 1000;
+        CHECK_EQUAL(hostRadio.txCount, txBefore + 1);
+        CHECK_EQUAL(getBusyDeferrals(), 3);
+        CHECK_EQUAL(getCollisionsAvoided(), 1);
+        CHECK(waited >= 3 * LBT_SLOT_TIME && waited <= 14 * LBT_SLOT_TIME + 5);
+
+        /* Never clears, abandoned without going past LBT_MAX_DEFERRAL */
+        scriptedBusyScans = 255;
+        start = hostMicros();
+        CHECK_EQUAL(transmitRadio(data, 8), RADIO_CHANNEL_BUSY);
+        waited = (hostMicros() - start) / 1000;
+        CHECK_EQUAL(hostRadio.txCount, txBefore + 1);
+        CHECK_EQUAL(getTransmissionsAbandoned(), 1);
+        CHECK(waited <= LBT_MAX_DEFERRAL + 5);
+        CHECK(hostRadio.receiving);
+
+        hostRadio.scanChannel = NULL;
+        setLBTEnabled(false);
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       channelSeen                                                             |
+    |   Purpose:    Whether a CAD over the window would have seen another node's frame,     |
+    |               which needs at least a symbol of it inside the window.                  |
+    |   Arguments:  const std::vector<Transmission>&, uint64_t, uint64_t, uint32_t          |
+    |   Returns:    bool                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    bool channelSeen(const std::vector<Transmission>& air, uint64_t from, uint64_t to, uint32_t symbolTime){
+        for(size_t i = 0; i < air.size(); i++){
+            uint64_t overlapStart = std::max(air[i].start, from);
+            uint64_t overlapEnd = std::min(air[i].end, to);
+            if(overlapEnd > overlapStart && overlapEnd - overlapStart >= symbolTime) return true;
+        }
+        return false;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       startTransmission                                                       |
+    |   Purpose:    Puts a node's frame on air, marking it and everything it overlaps as    |
+    |               collided.                                                               |
+    |   Arguments:  std::vector<Transmission>&, Node&, int, uint64_t, uint32_t,             |
+    |               ModelResult&                                                            |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void startTransmission(std::vector<Transmission>& air, Node& node, int who, uint64_t now, uint32_t timeOnAir, ModelResult& result){
+        Transmission t = { now, now + timeOnAir, who, false };
+        for(size_t i = 0; i < air.size(); i++){
+            if(air[i].end > now){
+                air[i].collided = true;
+                t.collided = true;
+            }
+        }
+        air.push_back(t);
+
+        node.state = NODE_TRANSMITTING;
+        node.stateEnd = t.end;
+        result.sent++;
+        result.accessDelay += now - node.frameArrival;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       runModel                                                                |
+    |   Purpose:    Simulates the nodes for MODEL_DURATION at the given offered load, with  |
+    |               or without listen-before-talk.                                          |
+    |   Arguments:  int, double (offered load, frames per frame time), bool, uint32_t,      |
+    |               uint32_t (time-on-air and symbol time, us)                              |
+    |   Returns:    ModelResult                                                             |
+    \*-------------------------------------------------------------------------------------*/
+    ModelResult runModel(int nodeCount, double load, bool lbt, uint32_t timeOnAir, uint32_t symbolTime){
+        std::mt19937 rng(MODEL_SEED);
+        std::exponential_distribution<double> interval(load / nodeCount / timeOnAir);
+        ModelResult result = {};
+
+        std::vector<Node> nodes(nodeCount);
+        for(int n = 0; n < nodeCount; n++){
+            nodes[n].state = NODE_IDLE;
+            nodes[n].nextArrival = (uint64_t)interval(rng);
+        }
+
+        std::vector<Transmission> air;                              // On air or recently ended
+        uint64_t now = 0;
+        while(now < MODEL_DURATION){
+            /* The next thing to happen, an arrival or a node's state ending */
+            uint64_t next = UINT64_MAX;
+            int who = 0;
+            bool arrival = false;
+            for(int n = 0; n < nodeCount; n++){
+                if(nodes[n].nextArrival < next){ next = nodes[n].nextArrival; who = n; arrival = true; }
+                if(nodes[n].state != NODE_IDLE && nodes[n].stateEnd < next){ next = nodes[n].stateEnd; who = n; arrival = false; }
+            }
+            now = next;
+            Node& node = nodes[who];
+
+            if(arrival){
+                result.offered++;
+                node.queue.push_back(now);
+                node.nextArrival = now + 1 + (uint64_t)interval(rng);
+            }
+            else if(node.state == NODE_TRANSMITTING){
+                /* Collided if anything else was on air at any point of it */
+                for(size_t i = 0; i < air.size(); i++){
+                    if(air[i].node != who || air[i].end != now) continue;
+                    if(air[i].collided) result.collided++;
+                    else result.delivered++;
+                }
+                node.state = NODE_IDLE;
+            }
+            else if(node.state == NODE_CAD){
+                if(!channelSeen(air, node.cadStart, now, symbolTime)) startTransmission(air, node, who, now, timeOnAir, result);
+                else{
+                    /* As waitForClearChannel */
+                    if(node.attempt < LBT_MAX_BACKOFF_EXPONENT) node.attempt++;
+                    uint32_t backoff = std::uniform_int_distribution<uint32_t>(1, 1 << node.attempt)(rng) * LBT_SLOT_TIME;
+                    if(node.deferred + backoff > LBT_MAX_DEFERRAL){
+                        result.abandoned++;
+                        node.state = NODE_IDLE;
+                    }
+                    else{
+                        node.deferred += backoff;
+                        node.state = NODE_BACKOFF;
+                        node.stateEnd = now + backoff * 1000UL;
+                    }
+                }
+            }
+            else if(node.state == NODE_BACKOFF){
+                node.state = NODE_CAD;
+                node.cadStart = now;
+                node.stateEnd = now + MODEL_CAD_SYMBOLS * symbolTime;
+            }
+
+            /* An idle node takes its next frame, to CAD first or straight on air */
+            if(node.state == NODE_IDLE && !node.queue.empty()){
+                node.frameArrival = node.queue.front();
+                node.queue.erase(node.queue.begin());
+                node.attempt = 0;
+                node.deferred = 0;
+                if(lbt){
+                    node.state = NODE_CAD;
+                    node.cadStart = now;
+                    node.stateEnd = now + MODEL_CAD_SYMBOLS * symbolTime;
+                }
+                else startTransmission(air, node, who, now, timeOnAir, result);
+            }
+
+            /* Forget frames that can't overlap anything any more */
+            while(!air.empty() && air.front().end + timeOnAir < now) air.erase(air.begin());
+        }
+        return result;
+    }
+
+
+/*-------------------------------------------------------------------------*\
+|								     Main					   			    |
+\*-------------------------------------------------------------------------*/
+
+
+    int main(void){
+        hostEepromErase();
+        CHECK_EQUAL(initializeRadio(), ERR_NONE);
+        checkFirmwareBackoff();
+
+        RadioParameters params = getRadioParameters();
+        uint32_t timeOnAir = getTimeOnAir(MODEL_PAYLOAD_LEN);
+        uint32_t symbolTime = (1000000UL << params.spreadingFactor) / params.bandwidth;
+        printf("SF%u, %lu Hz, CR 4/%u: %u byte frame on air %lu us, CAD %lu us\n\n",
+            params.spreadingFactor, (unsigned long)params.bandwidth, params.codingRate, MODEL_PAYLOAD_LEN,
+            (unsigned long)timeOnAir, (unsigned long)(MODEL_CAD_SYMBOLS * symbolTime));
+
+        const int nodeCounts[] = { 3, 8 };
+        const double loads[] = { 0.05, 0.1, 0.2, 0.4 };
+        printf("nodes  load   ALOHA delivered   LBT delivered   LBT abandoned   LBT mean access (ms)\n");
+        for(int nodeCount : nodeCounts){
+            for(double load : loads){
+                ModelResult aloha = runModel(nodeCount, load, false, timeOnAir, symbolTime);
+                ModelResult lbt = runModel(nodeCount, load, true, timeOnAir, symbolTime);
+                double alohaRatio = (double)aloha.delivered / aloha.offered;
+                double lbtRatio = (double)lbt.delivered / lbt.offered;
+                double abandonedRatio = (double)lbt.abandoned / lbt.offered;
+                printf("%5d  %4.2f   %15.3f   %13.3f   %13.3f   %20.1f\n", nodeCount, load, alohaRatio, lbtRatio,
+                    abandonedRatio, lbt.sent ? lbt.accessDelay / 1000.0 / lbt.sent : 0.0);
+
+                /* Listening first must pay for itself at every load, and keep most of the light loads' collisions away */
+                CHECK(lbtRatio > alohaRatio);
+                double alohaLost = 1 - alohaRatio;
+                double lbtCollided = (double)lbt.collided / lbt.offered;
+                if(load <= 0.1) CHECK(lbtCollided < alohaLost / 2);
+            }
+        }
+
+        return hostTestResult();
+    }
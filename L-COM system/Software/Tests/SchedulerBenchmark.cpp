@@ -0,0 +1,225 @@
+/*
+*   Purpose :   Scheduler benchmark. Runs LCOM.ino's loop (runScheduler, then idleScheduler) over a
+*               task table shaped like LCOM.ino's, with each task taking a representative time,
+*               and reports per-task start lateness and deadline misses: steady, with a 370 ms
+*               transmission blocking the loop every 10 s, and across the millis() wrap. The
+*               dispatch cost itself is timed on the host.
+*
+*               At 8 MHz millis() moves 2 ms at a time, on the timer 0 overflow that also ends each
+*               idle sleep, so a task can't run more often than that. readSerial's 1 ms period
+*               means every tick, about 490 runs a second rather than 1000.
+*/
+
+
+#include "HostTest.h"
+#include "HostArduino.h"
+#include "Scheduler.h"
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+
+/*-------------------------------------------------------------------------*\
+|								  Definitions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    #define BENCH_TASKS                     8
+    #define BENCH_DURATION                  (3600ULL * 1000000)     // us simulated per case
+    #define BENCH_BLOCK_PERIOD              10000000                // us between transmissions in the blocking case
+    #define BENCH_BLOCK_TIME                370000                  // us, a 40 byte frame at SF9
+    #define BENCH_DISPATCHES                2000000
+
+
+/*-------------------------------------------------------------------------*\
+|								   Variables					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /* Execution time of each task (us), roughly what each costs at 8 MHz */
+    const char* const taskNames[BENCH_TASKS] = { "readSerial", "readRadio", "serviceImu", "serviceGps", "serviceTimeSync", "servicePowerBoard", "saveWarmState", "serviceStoreForward" };
+    const uint32_t taskCost[BENCH_TASKS] = { 60, 400, 350, 900, 20, 120, 300, 30 };
+
+    /* Per task start lateness (ms) of every run, and when the next run is due (ms) */
+    std::vector<uint32_t> lateness[BENCH_TASKS];
+    uint64_t due[BENCH_TASKS];
+    bool blocking = false;
+    uint64_t nextBlock = 0;
+
+    template<int N> void benchTask(void);
+
+    /* Periods, deadlines, and priorities as LCOM.ino's task table */
+    const SchedulerTask benchTable[] PROGMEM = {
+        {benchTask<0>,         1,          5,      0},
+        {benchTask<1>,         100,        20,     1},
+        {benchTask<2>,         5,          10,     2},
+        {benchTask<3>,         20,         20,     2},
+        {benchTask<4>,         100,        50,     2},
+        {benchTask<5>,         1000,       100,    3},
+        {benchTask<6>,         5000,       250,    3},
+        {benchTask<7>,         10,         250,    3}
+    };
+    static_assert(sizeof(benchTable)/sizeof(benchTable[0]) == BENCH_TASKS, "One cost per task");
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       benchTask                                                               |
+    |   Purpose:    Records how late the run started against its phase, which moves on      |
+    |               when a whole period is missed, then takes its execution time. readSerial|
+    |               blocks for a transmission every BENCH_BLOCK_PERIOD in the blocking case.|
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    template<int N> void benchTask(void){
+        uint64_t now = hostMicros();
+        uint64_t late = now / 1000 - due[N];
+        lateness[N].push_back((uint32_t)late);
+        due[N] = (late >= benchTable[N].period) ? now / 1000 + benchTable[N].period : due[N] + benchTable[N].period;
+
+        hostAdvanceMicros(taskCost[N]);
+        if(N == 0 && blocking && now >= nextBlock){
+            nextBlock += BENCH_BLOCK_PERIOD;
+            hostAdvanceMicros(BENCH_BLOCK_TIME);
+        }
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       expectedRuns                                                            |
+    |   Purpose:    Returns how many times a task can run in the duration, once a period or |
+    |               once a millis() tick, whichever is longer.                              |
+    |   Arguments:  int, uint64_t (us)                                                      |
+    |   Returns:    uint32_t                                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint32_t expectedRuns(int task, uint64_t duration){
+        uint64_t period = benchTable[task].period * 1000ULL;
+        return duration / std::max(period, (uint64_t)HOST_TIMER0_OVERFLOW_MICROS);
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       runCase                                                                 |
+    |   Purpose:    Runs the loop for the duration from the given clock, printing the       |
+    |               scheduler's statistics and the lateness seen by each task.              |
+    |   Arguments:  const char*, uint64_t (us), uint64_t (us), bool                         |
+    |   Returns:    void (the stats are left in getTaskStats)                               |
+    \*-------------------------------------------------------------------------------------*/
+    void runCase(const char* name, uint64_t start, uint64_t duration, bool block){
+        hostSetMicros(start);
+        blocking = block;
+        nextBlock = start;
+        for(int i = 0; i < BENCH_TASKS; i++){
+            lateness[i].clear();
+            due[i] = start / 1000;
+        }
+        CHECK_EQUAL(initializeScheduler(benchTable, BENCH_TASKS), SCHEDULER_OK);
+
+        while(hostMicros() - start < duration){
+            runScheduler();
+            idleScheduler();
+        }
+
+        printf("%s\n", name);
+        printf("  task                  period   runs       expected   mean late   p99 late   worst late   misses   worst exec\n");
+        uint8_t stats[1 + BENCH_TASKS * TASK_STATS_RECORD_LEN];
+        getTaskStats(stats);
+        for(int i = 0; i < BENCH_TASKS; i++){
+            const uint8_t* record = stats + 1 + i * TASK_STATS_RECORD_LEN;
+            std::vector<uint32_t> late = lateness[i];
+            std::sort(late.begin(), late.end());
+            uint64_t sum = 0;
+            for(size_t j = 0; j < late.size(); j++) sum += late[j];
+            printf("  %-20s  %6u   %8lu   %8lu   %6.2f ms   %5u ms   %7u ms   %6u   %7u us\n", taskNames[i], benchTable[i].period,
+                (unsigned long)extract_uint32_t(record, 0), (unsigned long)expectedRuns(i, duration),
+                late.empty() ? 0.0 : (double)sum / late.size(), late.empty() ? 0 : late[late.size() * 99 / 100],
+                extract_uint16_t(record, 6), extract_uint16_t(record, 8), extract_uint16_t(record, 4));
+        }
+        printf("\n");
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       taskRecord                                                              |
+    |   Purpose:    Returns a field of a task's getTaskStats record.                        |
+    |   Arguments:  int, uint8_t (byte offset in the record)                                |
+    |   Returns:    uint32_t                                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint32_t taskRecord(int task, uint8_t offset){
+        uint8_t stats[1 + BENCH_TASKS * TASK_STATS_RECORD_LEN];
+        getTaskStats(stats);
+        const uint8_t* record = stats + 1 + task * TASK_STATS_RECORD_LEN;
+        return (offset == 0) ? extract_uint32_t(record, 0) : extract_uint16_t(record, offset);
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       idleTask                                                                |
+    |   Purpose:    A task that costs nothing, for timing the dispatch alone.               |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void idleTask(void){}
+
+
+/*-------------------------------------------------------------------------*\
+|								     Main					   			    |
+\*-------------------------------------------------------------------------*/
+
+
+    int main(void){
+        hostClockStepMicros = 0;
+
+        /* The limit holds at run time too */
+        SchedulerTask tooMany[SCHEDULER_MAX_TASKS + 1];
+        for(int i = 0; i <= SCHEDULER_MAX_TASKS; i++) tooMany[i] = benchTable[0];
+        CHECK_EQUAL(initializeScheduler(tooMany, SCHEDULER_MAX_TASKS + 1), SCHEDULER_TOO_MANY_TASKS);
+
+        /* Steady, every task on its period and inside its deadline */
+        runCase("Steady, one hour", 0, BENCH_DURATION, false);
+        for(int i = 0; i < BENCH_TASKS; i++){
+            CHECK(taskRecord(i, 0) + 1 >= expectedRuns(i, BENCH_DURATION));
+            CHECK(taskRecord(i, 0) <= BENCH_DURATION / 1000 / benchTable[i].period + 1);
+            CHECK_EQUAL(taskRecord(i, 8), 0);
+        }
+
+        /* Blocked, the misses are counted and the backlog is skipped rather than run in a burst */
+        runCase("A 370 ms transmission every 10 s, one hour", 0, BENCH_DURATION, true);
+        uint32_t blocks = BENCH_DURATION / BENCH_BLOCK_PERIOD;
+        for(int i = 0; i < BENCH_TASKS; i++){
+            CHECK(taskRecord(i, 0) + 1 >= expectedRuns(i, BENCH_DURATION - blocks * (uint64_t)BENCH_BLOCK_TIME));
+            CHECK(taskRecord(i, 0) <= BENCH_DURATION / 1000 / benchTable[i].period + 1);
+            CHECK_EQUAL(taskRecord(i, 8), blocks);
+        }
+
+        /* Across the millis() wrap, 10 s either side of it */
+        uint64_t wrap = 4294967296ULL * 1000;
+        runCase("Across the millis() wrap, 20 s", wrap - 10000000, 20000000, false);
+        for(int i = 0; i < BENCH_TASKS; i++){
+            CHECK(taskRecord(i, 0) + 1 >= expectedRuns(i, 20000000));
+            CHECK(taskRecord(i, 0) <= 20000UL / benchTable[i].period + 1);
+            CHECK_EQUAL(taskRecord(i, 8), 0);
+        }
+
+        /* Dispatch cost on this machine, nothing due (the idle check) and one task due on every call */
+        SchedulerTask dispatchTable[SCHEDULER_MAX_TASKS];
+        for(int i = 0; i < SCHEDULER_MAX_TASKS; i++) dispatchTable[i] = { idleTask, 1000, 10, (uint8_t)i };
+        dispatchTable[SCHEDULER_MAX_TASKS - 1].period = 1;
+        hostSetMicros(0);
+        initializeScheduler(dispatchTable, SCHEDULER_MAX_TASKS);
+        for(int i = 0; i < SCHEDULER_MAX_TASKS; i++) runScheduler();
+
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        for(int i = 0; i < BENCH_DISPATCHES; i++) runScheduler();
+        std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+        for(int i = 0; i < BENCH_DISPATCHES; i++){
+            hostAdvanceMicros(1000);
+            runScheduler();
+        }
+        std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+        double idleNs = std::chrono::duration<double, std::nano>(t1 - t0).count() / BENCH_DISPATCHES;
+        double dispatchNs = std::chrono::duration<double, std::nano>(t2 - t1).count() / BENCH_DISPATCHES;
+        printf("Host time per runScheduler over %d tasks: %.1f ns with nothing due, %.1f ns dispatching one\n", SCHEDULER_MAX_TASKS, idleNs, dispatchNs);
+
+        return hostTestResult();
+    }
@@ -0,0 +1,173 @@
+/*
+*   Purpose :   SpscQueue stress test. A producer thread races a consumer thread through queues the
+*               sizes the firmware uses, each item carrying a sequence number and a check of its
+*               payload, so a lost, repeated, reordered or torn item fails the test. The single
+*               threaded cases check the full and empty edges, count, clear, and index wrap.
+*
+*               On the host the queue's indices are std::atomic with acquire/release, the threads
+*               stand in for the main loop and an ISR. The SpscQueueTsan target builds this file
+*               alone with ThreadSanitizer where the compiler has it.
+*/
+
+
+#include "HostTest.h"
+#include "SpscQueue.h"
+#include <thread>
+
+
+/*-------------------------------------------------------------------------*\
+|								  Definitions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    #ifndef STRESS_ITEMS
+        #define STRESS_ITEMS                1000000                 // Items through each queue
+    #endif
+    #define STRESS_PAYLOAD                  12                      // Bytes, as an IMU sample
+
+
+/*-------------------------------------------------------------------------*\
+|								     Types					   			    |
+\*-------------------------------------------------------------------------*/
+
+
+    /* Wider than the indices, so a torn copy shows as a payload that doesn't match its sequence */
+    struct StressItem{
+        uint32_t sequence;
+        uint8_t payload[STRESS_PAYLOAD];
+    };
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       fillItem                                                                |
+    |   Purpose:    Builds the item for a sequence number.                                  |
+    |   Arguments:  uint32_t                                                                |
+    |   Returns:    StressItem                                                              |
+    \*-------------------------------------------------------------------------------------*/
+    StressItem fillItem(uint32_t sequence){
+        StressItem item;
+        item.sequence = sequence;
+        for(uint8_t i = 0; i < STRESS_PAYLOAD; i++) item.payload[i] = (uint8_t)(sequence * 31 + i);
+        return item;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       itemIntact                                                              |
+    |   Purpose:    Returns whether an item's payload is the one built for its sequence.    |
+    |   Arguments:  const StressItem&                                                       |
+    |   Returns:    bool                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    bool itemIntact(const StressItem& item){
+        for(uint8_t i = 0; i < STRESS_PAYLOAD; i++){
+            if(item.payload[i] != (uint8_t)(item.sequence * 31 + i)) return false;
+        }
+        return true;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       stress                                                                  |
+    |   Purpose:    Pushes STRESS_ITEMS from one thread while another pops them, spinning   |
+    |               on a full or empty queue, and checks every item arrives once, in order, |
+    |               and whole.                                                              |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    template<uint8_t N> void stress(void){
+        static SpscQueue<StressItem, N> queue;
+        uint32_t received = 0;
+        uint32_t disorders = 0;
+        uint32_t torn = 0;
+        uint32_t fullSpins = 0;
+
+        std::thread producer([&fullSpins](){
+            for(uint32_t i = 0; i < STRESS_ITEMS; i++){
+                StressItem item = fillItem(i);
+                while(!queue.push(item)){
+                    fullSpins++;
+                    std::this_thread::yield();
+                }
+            }
+        });
+
+        while(received < STRESS_ITEMS){
+            StressItem item;
+            if(!queue.pop(item)){
+                std::this_thread::yield();
+                continue;
+            }
+            if(item.sequence != received) disorders++;
+            if(!itemIntact(item)) torn++;
+            received++;
+        }
+        producer.join();
+
+        printf("Queue of %3u: %lu items, %lu out of order, %lu torn, producer found it full %lu times\n", N,
+            (unsigned long)received, (unsigned long)disorders, (unsigned long)torn, (unsigned long)fullSpins);
+        CHECK_EQUAL(disorders, 0);
+        CHECK_EQUAL(torn, 0);
+        CHECK(queue.empty());
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       edges                                                                   |
+    |   Purpose:    Checks full, empty, count, and clear on one thread, over enough rounds  |
+    |               that the 8 bit indices wrap several times.                              |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    template<uint8_t N> void edges(void){
+        SpscQueue<StressItem, N> queue;
+        StressItem item;
+        uint32_t sequence = 0;
+        uint32_t expected = 0;
+
+        for(int round = 0; round < 1000; round++){
+            CHECK(queue.empty());
+            CHECK(!queue.pop(item));
+
+            /* A varying fill, up to full, then the push past full is refused */
+            uint8_t fill = (round % 2) ? N : (uint8_t)(round % N + 1);
+            for(uint8_t i = 0; i < fill; i++) CHECK(queue.push(fillItem(sequence++)));
+            CHECK_EQUAL(queue.count(), fill);
+            if(fill == N) CHECK(!queue.push(fillItem(0)));
+
+            /* Every third round is cleared, the rest drained in order */
+            if(round % 3 == 0){
+                queue.clear();
+                expected = sequence;
+                continue;
+            }
+            while(queue.pop(item)){
+                CHECK_EQUAL(item.sequence, expected);
+                CHECK(itemIntact(item));
+                expected++;
+            }
+            CHECK_EQUAL(expected, sequence);
+        }
+    }
+
+
+/*-------------------------------------------------------------------------*\
+|								     Main					   			    |
+\*-------------------------------------------------------------------------*/
+
+
+    int main(void){
+        edges<1>();
+        edges<8>();
+        edges<128>();
+
+        /* Smallest, the firmware's sizes, and the largest the 8 bit indices allow */
+        stress<1>();
+        stress<2>();
+        stress<4>();
+        stress<8>();
+        stress<128>();
+
+        return hostTestResult();
+    }
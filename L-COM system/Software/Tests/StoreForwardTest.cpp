@@ -0,0 +1,220 @@
+/*
+*   Purpose :   Store-and-forward against the simulated EEPROM. Records sent while the link is down
+*               are staged without touching the EEPROM, written a byte each serviceStoreForward run
+*               with each slot's state byte last and once, and forwarded oldest first once the link
+*               is back. No run may wait on the EEPROM. Covers a slot cut off mid-write, a ring that
+*               wraps, and the writes each cell takes a record, for the wear note in StoreForward.h.
+*/
+
+
+#include "HostTest.h"
+#include "HostArduino.h"
+#include "RadioController.h"
+#include "StoreForward.h"
+#include "Telemetry.h"
+#include <util/crc16.h>
+#include <vector>
+
+
+/*-------------------------------------------------------------------------*\
+|								  Definitions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    #define TEST_CELL_ENDURANCE             100000                  // Writes, ATmega328P datasheet
+    #define TEST_RUN_SLACK                  1000                    // us a run may take, less than one EEPROM write
+
+
+/*-------------------------------------------------------------------------*\
+|								   Variables					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    uint8_t testFill = 0;                                           // Each record's bytes count on from the last's
+    uint32_t worstRun = 0;                                          // us, the longest serviceStoreForward run
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       sendRecord                                                              |
+    |   Purpose:    Sends a radio telemetry record of the given type and length.            |
+    |   Arguments:  uint8_t, uint16_t                                                       |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void sendRecord(uint8_t type, uint16_t len){
+        uint8_t* record = beginTelemetryRecord(type);
+        CHECK(record != NULL);
+        if(record == NULL) return;
+        for(uint16_t i = 0; i < len; i++) record[i] = testFill++;
+        CHECK_EQUAL(sendTelemetryRecord(len), TELEMETRY_OK);
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       runService                                                              |
+    |   Purpose:    One serviceStoreForward run a scheduler period on, checking it wrote no |
+    |               more than a byte and never waited on the EEPROM.                        |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void runService(void){
+        hostAdvanceMicros(STORE_SERVICE_PERIOD * 1000UL);
+        uint32_t writes = hostEepromTotalWrites();
+        uint32_t waits = hostEepromWaits();
+        uint64_t start = hostMicros();
+        uint32_t frames = hostRadio.txCount;
+        serviceStoreForward();
+        hostSerialClear();
+
+        /* A forwarded record's transmit isn't the EEPROM's doing */
+        uint32_t took = (uint32_t)(hostMicros() - start);
+        CHECK(hostEepromTotalWrites() - writes <= 1);
+        CHECK_EQUAL(hostEepromWaits(), waits);
+        if(hostRadio.txCount == frames) worstRun = std::max(worstRun, took);
+        CHECK(hostRadio.txCount != frames || took <= TEST_RUN_SLACK);
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       slotIntact                                                              |
+    |   Purpose:    Returns whether a slot reads back as a record after a reset, as         |
+    |               readStoreSlot checks it: a known state, a length, and a matching CRC.   |
+    |   Arguments:  uint8_t                                                                 |
+    |   Returns:    bool                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    bool slotIntact(uint8_t slot){
+        uint16_t address = STORE_RING_ADDRESS + slot*STORE_SLOT_LEN;
+        StoreSlotHeader header;
+        EEPROM.get(address, header);
+        if(header.state != STORE_SLOT_PENDING && header.state != STORE_SLOT_SENT) return false;
+        if(header.len == 0 || header.len > STORE_MAX_RECORD_LEN) return false;
+
+        uint16_t crc = 0xFFFF;
+        crc = _crc16_update(crc, header.sequence >> 8);
+        crc = _crc16_update(crc, header.sequence & 0xFF);
+        crc = _crc16_update(crc, header.len);
+        for(uint8_t i = 0; i != header.len; i++) crc = _crc16_update(crc, EEPROM.read(address + sizeof(StoreSlotHeader) + i));
+        return crc == header.crc;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       stateWrites                                                             |
+    |   Purpose:    Returns the writes every slot's state byte has taken, summed.           |
+    |   Arguments:  void                                                                    |
+    |   Returns:    uint32_t                                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint32_t stateWrites(void){
+        uint32_t writes = 0;
+        for(uint8_t i = 0; i != STORE_SLOT_COUNT; i++) writes += hostEepromWrites(STORE_RING_ADDRESS + i*STORE_SLOT_LEN);
+        return writes;
+    }
+
+
+/*-------------------------------------------------------------------------*\
+|								     Main					   			    |
+\*-------------------------------------------------------------------------*/
+
+
+    int main(void){
+        hostEepromErase();
+        CHECK_EQUAL(initializeRadio(), ERR_NONE);
+        initializeStoreForward();
+        CHECK_EQUAL(setTelemetryDestination(TELEMETRY_RADIO), TELEMETRY_OK);
+        CHECK_EQUAL(configureStoreForward(true, STORE_DEFAULT_LINK_TIMEOUT, STORE_DEFAULT_INTERVAL), STORE_OK);
+        CHECK_EQUAL(STORE_SLOT_COUNT, 22);                          // The wear note in StoreForward.h
+        hostSetMicros(1000000);
+        hostSerialClear();
+        CHECK(!getLinkUp());
+
+        /* The sender never waits on the EEPROM */
+        uint32_t writes = hostEepromTotalWrites();
+        uint64_t start = hostMicros();
+        sendRecord(TELEMETRY_GPS_FIX, GPS_FIX_LEN);
+        uint32_t sendTook = (uint32_t)(hostMicros() - start);
+        CHECK_EQUAL(hostEepromTotalWrites(), writes);
+        CHECK(sendTook < HOST_EEPROM_WRITE_MICROS);
+        CHECK_EQUAL(hostRadio.txCount, 0);
+
+        /* Written over a few runs, the slot reading as empty until its state byte goes in last */
+        const uint16_t slotBytes = sizeof(StoreSlotHeader) + TELEMETRY_RECORD_HEADER_LEN + GPS_FIX_LEN;
+        uint32_t runs = 0;
+        while(getStoreForwardStatus().stored == 0 && runs < 100){
+            CHECK_EQUAL(EEPROM.read(STORE_RING_ADDRESS), STORE_SLOT_EMPTY);
+            CHECK_EQUAL(getStoreForwardStatus().pending, 0);
+            runService();
+            runs++;
+        }
+        uint32_t writesPerRecord = hostEepromTotalWrites() - writes;
+        CHECK_EQUAL(runs, writesPerRecord);
+        CHECK(runs <= slotBytes);
+        CHECK_EQUAL(hostEepromWrites(STORE_RING_ADDRESS), 1);
+        CHECK_EQUAL(EEPROM.read(STORE_RING_ADDRESS), STORE_SLOT_PENDING);
+        CHECK(slotIntact(0));
+        CHECK_EQUAL(getStoreForwardStatus().pending, 1);
+
+        /* An outage long enough to wrap the ring: a GPS fix and a power reading every interval */
+        uint32_t records = 1;
+        while(records < STORE_SLOT_COUNT + 3){
+            start = hostMicros() + STORE_DEFAULT_INTERVAL * 1000000ULL;
+            while(hostMicros() < start) runService();
+            sendRecord(TELEMETRY_GPS_FIX, GPS_FIX_LEN);
+            sendRecord(TELEMETRY_POWER, POWER_STATUS_LEN);
+            records += 2;
+        }
+        for(uint32_t i = 0; i < STORE_STAGED_SLOTS * STORE_SLOT_LEN && getStoreForwardStatus().stored != records; i++) runService();
+        StoreForwardStatus status = getStoreForwardStatus();
+        CHECK_EQUAL(status.dropped, 0);
+        CHECK_EQUAL(status.overwritten, records - STORE_SLOT_COUNT);
+        CHECK_EQUAL(status.pending, STORE_SLOT_COUNT);
+
+        /* A state byte already pending isn't written again over a slot still waiting */
+        CHECK_EQUAL(stateWrites(), records - status.overwritten);
+
+        /* Cut off mid-write over a pending slot: its old state stays, over a record that fails the CRC */
+        uint8_t oldest = status.nextSequence % STORE_SLOT_COUNT;
+        hostAdvanceMicros(STORE_DEFAULT_INTERVAL * 1000000ULL);
+        sendRecord(TELEMETRY_GPS_FIX, GPS_FIX_LEN);
+        runService();
+        CHECK_EQUAL(EEPROM.read(STORE_RING_ADDRESS + oldest*STORE_SLOT_LEN), STORE_SLOT_PENDING);
+        CHECK(!slotIntact(oldest));
+        records++;
+
+        /* The link comes back: the staged record finishes and everything goes out oldest first */
+        noteLinkHeard();
+        std::vector<uint16_t> forwarded;
+        for(uint32_t i = 0; i < 4 * STORE_SLOT_COUNT * STORE_DRAIN_PERIOD / STORE_SERVICE_PERIOD && (getStoreForwardStatus().pending != 0 || getStoreForwardStatus().stored != records); i++){
+            uint32_t frames = hostRadio.txCount;
+            runService();
+            if(hostRadio.txCount == frames) continue;
+            CHECK_EQUAL(hostRadio.txData[AIR_HEADER_LEN], TELEMETRY_STORED);
+            forwarded.push_back((hostRadio.txData[AIR_HEADER_LEN + 1] << 8) | hostRadio.txData[AIR_HEADER_LEN + 2]);
+        }
+        status = getStoreForwardStatus();
+        CHECK_EQUAL(status.pending, 0);
+        CHECK_EQUAL(status.stored, records);
+        CHECK_EQUAL(status.forwarded, STORE_SLOT_COUNT);
+        CHECK_EQUAL(forwarded.size(), STORE_SLOT_COUNT);
+        for(size_t i = 1; i < forwarded.size(); i++) CHECK_EQUAL(forwarded[i], forwarded[i - 1] + 1);
+        CHECK_EQUAL(forwarded.back(), records - 1);
+
+        /* Each state byte took one write a record stored and one a record sent, nothing more */
+        CHECK_EQUAL(stateWrites(), status.stored - status.overwritten + status.forwarded);
+
+        /* A staging slot for each record sent at once, the next is dropped until one is written */
+        hostSetMicros(hostMicros() + (STORE_DEFAULT_LINK_TIMEOUT + 1) * 1000000ULL);
+        CHECK(!getLinkUp());
+        const uint8_t types[STORE_STAGED_SLOTS + 1] = { TELEMETRY_IMU_SUMMARY, TELEMETRY_GPS_FIX, TELEMETRY_POWER };
+        for(uint8_t i = 0; i < STORE_STAGED_SLOTS + 1; i++) sendRecord(types[i], GPS_FIX_LEN);
+        CHECK_EQUAL(getStoreForwardStatus().dropped, 1);
+
+        double passSeconds = (double)STORE_SLOT_COUNT * STORE_DEFAULT_INTERVAL / 2;
+        printf("Sending a record while the link is down: %u us, no EEPROM writes (before: %u writes, %.1f ms)\n", sendTook,
+            slotBytes, slotBytes * HOST_EEPROM_WRITE_MICROS / 1000.0);
+        printf("Written a byte a run over %lu runs, none waiting on the EEPROM, the longest run %.1f ms\n", (unsigned long)runs, worstRun / 1000.0);
+        printf("Wear: %lu writes a GPS fix record, the state byte two (stored, sent); with a GPS fix and a power reading\n"
+            "  every %u s the %u slot ring comes round every %.0f s, the state bytes lasting %.0f days of outage\n",
+            (unsigned long)writesPerRecord, STORE_DEFAULT_INTERVAL, (unsigned)STORE_SLOT_COUNT, passSeconds, TEST_CELL_ENDURANCE / 2 * passSeconds / 86400);
+        return hostTestResult();
+    }
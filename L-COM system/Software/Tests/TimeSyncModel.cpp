@@ -0,0 +1,216 @@
+/*
+*   Purpose :   Over-the-air time sync model. The firmware runs as the balloon's slave on a crystal
+*               that drifts from true time, and beacons stamped by a perfect ground clock reach
+*               it through the radio path (DIO1 capture, readRadioData, handleTimeBeacon). The
+*               slave's UNIX time is compared with the truth every second.
+*
+*               The errors modeled are the master's stamp being cut to the millisecond, the
+*               fixed latency varying around TIME_SYNC_FIXED_LATENCY, readRadio running up to
+*               its period after the frame arrived, lost beacons, and the crystal's drift
+*               changing as the balloon cools.
+*/
+
+
+#include "HostTest.h"
+#include "HostArduino.h"
+#include "RadioController.h"
+#include "TimeSync.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+
+/*-------------------------------------------------------------------------*\
+|								  Definitions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    #define MODEL_EPOCH                     1634000000ULL           // s, the true time the model starts at
+    #define MODEL_DURATION                  (2ULL * 3600 * 1000000) // us of true time per case
+    #define MODEL_SETTLE_BEACONS            8                       // Beacons before the error is measured, the drift estimate needs a few minutes
+    #define MODEL_LATENCY_JITTER            150                     // us either side of TIME_SYNC_FIXED_LATENCY
+    #define MODEL_READ_PERIOD               100000                  // us, readRadio's period in the task table
+    #define MODEL_SEED                      2021
+
+
+/*-------------------------------------------------------------------------*\
+|								     Types					   			    |
+\*-------------------------------------------------------------------------*/
+
+
+    struct SyncCase{
+        const char* name;
+        uint16_t period;                                            // s between beacons
+        double startPpm;                                            // Slave crystal, fast if positive
+        double endPpm;                                              // Drift moves linearly to this by the end
+        double loss;                                                // Fraction of beacons lost
+    };
+
+    struct SyncResult{
+        double meanError;                                           // ms, over measurements after settling
+        uint32_t p95Error;
+        uint32_t maxError;
+        uint16_t beaconsReceived;
+        uint16_t reportedMeanOffset;                                // The slave's own status, ms
+        int16_t reportedDrift;                                      // ppm
+    };
+
+
+/*-------------------------------------------------------------------------*\
+|								   Variables					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /* True time, the slave's clock is the host clock */
+    uint64_t trueMicros = 0;
+    double slaveFraction = 0;                                       // Slave us not yet added to the host clock
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       advanceTrue                                                             |
+    |   Purpose:    Moves true time on, and the slave's clock by the same at its drift.     |
+    |   Arguments:  uint64_t (us), double (ppm)                                             |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void advanceTrue(uint64_t us, double ppm){
+        trueMicros += us;
+        slaveFraction += us * (1 + ppm / 1e6);
+        uint64_t whole = (uint64_t)slaveFraction;
+        slaveFraction -= whole;
+        hostAdvanceMicros(whole);
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       slaveError                                                              |
+    |   Purpose:    Returns the slave's UNIX time less the true time (ms).                  |
+    |   Arguments:  void                                                                    |
+    |   Returns:    int64_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    int64_t slaveError(void){
+        uint32_t timestamp;
+        uint16_t milliseconds;
+        getUnixTimeMs(&timestamp, &milliseconds);
+        int64_t slave = (int64_t)timestamp * 1000 + milliseconds;
+        int64_t truth = (int64_t)(MODEL_EPOCH * 1000 + trueMicros / 1000);
+        return slave - truth;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       runCase                                                                 |
+    |   Purpose:    Runs one case from an unsynchronized slave, beaconing from the start.   |
+    |   Arguments:  const SyncCase&                                                         |
+    |   Returns:    SyncResult                                                              |
+    \*-------------------------------------------------------------------------------------*/
+    SyncResult runCase(const SyncCase& c){
+        std::mt19937 rng(MODEL_SEED);
+        std::uniform_real_distribution<double> unit(0, 1);
+        SyncResult result = {};
+        std::vector<uint32_t> errors;
+
+        /* Long enough since any earlier sync that the drift estimate starts over */
+        trueMicros = 0;
+        hostAdvanceMicros((uint64_t)CLOCK_DRIFT_MAX_INTERVAL * 2000);
+        setClockDrift(0);
+        configureTimeSync(TIME_SYNC_SLAVE, c.period);
+
+        uint64_t nextBeacon = 0;
+        uint64_t nextMeasure = 0;
+        uint32_t beaconsSent = 0;
+        while(trueMicros < MODEL_DURATION){
+            double ppm = c.startPpm + (c.endPpm - c.startPpm) * trueMicros / MODEL_DURATION;
+
+            /* Measure once a second, between beacons */
+            if(trueMicros >= nextMeasure){
+                nextMeasure += 1000000;
+                if(beaconsSent > MODEL_SETTLE_BEACONS){
+                    int64_t error = slaveError();
+                    errors.push_back((uint32_t)(error < 0 ? -error : error));
+                }
+            }
+
+            if(trueMicros < nextBeacon){
+                advanceTrue(std::min(nextBeacon, nextMeasure) - trueMicros, ppm);
+                continue;
+            }
+            nextBeacon += (uint64_t)c.period * 1000000;
+            beaconsSent++;
+
+            /* The master stamps its millisecond, the frame goes out a varying latency later */
+            uint64_t stampMicros = trueMicros;
+            uint64_t stampMs = MODEL_EPOCH * 1000 + stampMicros / 1000;
+            uint8_t frame[AIR_HEADER_LEN + TIME_BEACON_LEN];
+            frame[0] = AIR_FRAME_TIME_BEACON;
+            uint32_t seconds = (uint32_t)(stampMs / 1000);
+            uint16_t milliseconds = (uint16_t)(stampMs % 1000);
+            frame[1] = seconds >> 24;
+            frame[2] = seconds >> 16;
+            frame[3] = seconds >> 8;
+            frame[4] = seconds;
+            frame[5] = milliseconds >> 8;
+            frame[6] = milliseconds;
+            uint32_t latency = TIME_SYNC_FIXED_LATENCY - MODEL_LATENCY_JITTER + (uint32_t)(unit(rng) * 2 * MODEL_LATENCY_JITTER);
+            if(unit(rng) < c.loss) continue;
+
+            /* RxDone at the end of the frame, then readRadio picks it up on its next run */
+            advanceTrue(getTimeOnAir(sizeof(frame)) + latency, ppm);
+            hostRadioReceive(frame, sizeof(frame));
+            advanceTrue((uint64_t)(unit(rng) * MODEL_READ_PERIOD), ppm);
+            readRadioData();
+        }
+
+        /* The slave's view of itself */
+        TimeSyncStatus status = getTimeSyncStatus();
+        result.beaconsReceived = status.beaconsReceived;
+        result.reportedMeanOffset = status.meanOffset;
+        result.reportedDrift = status.drift;
+
+        std::sort(errors.begin(), errors.end());
+        uint64_t sum = 0;
+        for(size_t i = 0; i < errors.size(); i++) sum += errors[i];
+        result.meanError = errors.empty() ? 0 : (double)sum / errors.size();
+        result.p95Error = errors.empty() ? 0 : errors[errors.size() * 95 / 100];
+        result.maxError = errors.empty() ? 0 : errors.back();
+        return result;
+    }
+
+
+/*-------------------------------------------------------------------------*\
+|								     Main					   			    |
+\*-------------------------------------------------------------------------*/
+
+
+    int main(void){
+        hostEepromErase();
+        CHECK_EQUAL(initializeRadio(), ERR_NONE);
+        hostClockStepMicros = 0;
+
+        const SyncCase cases[] = {
+            { "10 s, +40 ppm",                      10,     40,     40,     0   },
+            { "10 s, -40 ppm",                      10,     -40,    -40,    0   },
+            { "10 s, +20 to -40 ppm, 20% lost",     10,     20,     -40,    0.2 },
+            { "60 s, +40 ppm",                      60,     40,     40,     0   },
+            { "60 s, +20 to -40 ppm, 20% lost",     60,     20,     -40,    0.2 }
+        };
+
+        printf("Beacon time on air %lu us, %u us fixed latency\n\n", (unsigned long)getTimeOnAir(AIR_HEADER_LEN + TIME_BEACON_LEN), TIME_SYNC_FIXED_LATENCY);
+        printf("case                              received   mean |err|   p95 |err|   max |err|   reported mean   reported drift\n");
+        for(const SyncCase& c : cases){
+            SyncResult r = runCase(c);
+            printf("%-32s  %8u   %7.2f ms   %6lu ms   %6lu ms   %10u ms   %10d ppm\n", c.name, r.beaconsReceived, r.meanError,
+                (unsigned long)r.p95Error, (unsigned long)r.maxError, r.reportedMeanOffset, r.reportedDrift);
+
+            /* Low single-digit milliseconds at the default period, and the drift found to within a few ppm */
+            if(c.period == TIME_SYNC_DEFAULT_PERIOD){
+                CHECK(r.p95Error <= 2);
+                CHECK(r.maxError <= 3);
+            }
+            if(c.startPpm == c.endPpm) CHECK(abs(r.reportedDrift + (int16_t)c.startPpm) <= 3);
+        }
+
+        return hostTestResult();
+    }
@@ -0,0 +1,216 @@
+/*
+*   Purpose :   L-COM's TWI master against the power board's firmware on a simulated bus. Both ends
+*               are the real code: Twi.cpp and PowerBoard.cpp driving the TWI registers, and the
+*               power board's PowerRegisters.cpp answering through Wire. Covers the background block
+*               read, register pointer reads, an address nobody answers, a busy bus, and a slave
+*               holding SDA low through the timeout and the bus recovery.
+*/
+
+
+#include "HostTest.h"
+#include "HostArduino.h"
+#include "HostTwiBus.h"
+#include "PowerBoard.h"
+#include "Twi.h"
+#include "Battery.h"
+#include "PowerRegisters.h"
+
+
+/*-------------------------------------------------------------------------*\
+|								  Definitions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /* The two ends of the contract */
+    static_assert(PB_I2C_ADDRESS == POWER_BOARD_ADDRESS, "Power board address differs between the boards");
+    static_assert(PB_REG_ID == POWER_REG_ID && PB_ID == POWER_BOARD_ID, "Power board ID differs between the boards");
+    static_assert(PB_REG_FLAGS == POWER_REG_FLAGS && PB_FLAG_HEATER_ON == POWER_HEATER_ON, "Power board flags differ between the boards");
+    static_assert(PB_REG_VOLTAGE == POWER_REG_VOLTAGE, "Power board voltage register differs between the boards");
+    static_assert(PB_REG_CURRENT == POWER_REG_CURRENT, "Power board current register differs between the boards");
+    static_assert(PB_REG_TEMPERATURE == POWER_REG_TEMPERATURE, "Power board temperature register differs between the boards");
+    static_assert(PB_REGISTERS_LEN == POWER_REGISTERS_LEN, "Power board register count differs between the boards");
+
+    #define TEST_SETTLE_STEP                25                      // us, about a byte at 400 kHz
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       settleBus                                                               |
+    |   Purpose:    Lets time pass with interrupts on until the bus has nothing pending,    |
+    |               as the main loop does between servicePowerBoard runs.                   |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void settleBus(void){
+        for(int i = 0; i < 1000; i++){
+            hostAdvanceMicros(TEST_SETTLE_STEP);
+            interrupts();
+        }
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       pollPowerBoard                                                          |
+    |   Purpose:    One background poll: a servicePowerBoard run starts it, the bus runs,   |
+    |               and the next run collects it (and starts another).                      |
+    |   Arguments:  void                                                                    |
+    |   Returns:    PowerStatus                                                             |
+    \*-------------------------------------------------------------------------------------*/
+    PowerStatus pollPowerBoard(void){
+        servicePowerBoard();
+        settleBus();
+        servicePowerBoard();
+        settleBus();
+        return getPowerStatus();
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       readRegisters                                                           |
+    |   Purpose:    Reads from a register on, blocking, as Imu.cpp reads the MPU9250.       |
+    |   Arguments:  uint8_t (address), uint8_t (register), uint8_t*, uint8_t                |
+    |   Returns:    int16_t                                                                 |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t readRegisters(uint8_t address, uint8_t reg, uint8_t* buf, uint8_t len){
+        TwiTransfer transfer = { address, &reg, 1, buf, len, TWI_OK };
+        return runTwiTransfer(&transfer);
+    }
+
+
+/*-------------------------------------------------------------------------*\
+|								     Main					   			    |
+\*-------------------------------------------------------------------------*/
+
+
+    int main(void){
+        hostTwiBegin();
+        initializeTwi();
+
+        /* The power board's setup, then its slave on the bus */
+        initializePowerRegisters();
+        const HostTwiSlave* board = hostTwiWireSlave();
+        hostTwiAttach(board);
+        CHECK_EQUAL(hostWireAddress(), POWER_BOARD_ADDRESS);
+
+        PowerReading reading = { PB_FLAG_HEATER_ON, 11850, -250, 1234 };
+        publishPowerReading(reading);
+
+        /* The background block read: register pointer, repeated start, all eight registers */
+        PowerStatus status = pollPowerBoard();
+        CHECK(status.powerFlags & POWER_READING_VALID);
+        CHECK(status.powerFlags & POWER_HEATER_ON);
+        CHECK_EQUAL(status.batteryVoltage, 11850);
+        CHECK_EQUAL(status.batteryCurrent, -250);
+        CHECK_EQUAL(status.batteryTemperature, 1234);
+        CHECK_EQUAL(hostTwiStats.starts, 4);                        // Two polls, each a start and a repeated start
+        CHECK_EQUAL(hostTwiStats.stops, 2);
+        CHECK_EQUAL(hostTwiStats.bytes, 2 * (3 + POWER_REGISTERS_LEN));
+        settleBus();
+        servicePowerBoard();                                        // Collect the poll the last run started
+        settleBus();
+
+        /* A new reading shows up on the next poll */
+        reading = { 0, 10100, 1500, -520 };
+        publishPowerReading(reading);
+        status = pollPowerBoard();
+        CHECK(!(status.powerFlags & POWER_HEATER_ON));
+        CHECK_EQUAL(status.batteryVoltage, 10100);
+        CHECK_EQUAL(status.batteryCurrent, 1500);
+        CHECK_EQUAL(status.batteryTemperature, -520);
+
+        /* Reads from the register pointer, and past the end of the file */
+        uint8_t buf[4];
+        CHECK_EQUAL(readRegisters(POWER_BOARD_ADDRESS, POWER_REG_VOLTAGE, buf, 2), TWI_OK);
+        CHECK_EQUAL((buf[0] << 8) | buf[1], 10100);
+        CHECK_EQUAL(readRegisters(POWER_BOARD_ADDRESS, POWER_REG_TEMPERATURE, buf, 4), TWI_OK);
+        CHECK_EQUAL((int16_t)((buf[0] << 8) | buf[1]), -520);
+        CHECK_EQUAL(buf[2], 0xFF);
+        CHECK_EQUAL(buf[3], 0xFF);
+
+        /* Nothing at the address */
+        uint32_t stops = hostTwiStats.stops;
+        CHECK_EQUAL(readRegisters(POWER_BOARD_ADDRESS + 1, 0, buf, 1), TWI_ADDRESS_NACK);
+        CHECK_EQUAL(hostTwiStats.stops, stops + 1);
+
+        /* The board drops off the bus, the cache goes stale, and comes back when it does */
+        settleBus();
+        servicePowerBoard();
+        settleBus();
+        hostTwiDetach(board);
+        status = pollPowerBoard();
+        CHECK(!(status.powerFlags & POWER_READING_VALID));
+        CHECK_EQUAL(status.batteryVoltage, 10100);
+        hostTwiAttach(board);
+        status = pollPowerBoard();
+        CHECK(status.powerFlags & POWER_READING_VALID);
+        settleBus();
+        servicePowerBoard();
+        settleBus();
+
+        /* One transfer at a time */
+        uint8_t reg = POWER_REG_ID;
+        uint8_t first, second;
+        TwiTransfer a = { POWER_BOARD_ADDRESS, &reg, 1, &first, 1, TWI_OK };
+        TwiTransfer b = { POWER_BOARD_ADDRESS, &reg, 1, &second, 1, TWI_OK };
+        CHECK_EQUAL(startTwiTransfer(&a), TWI_OK);
+        CHECK_EQUAL(startTwiTransfer(&b), TWI_BUSY);
+        settleBus();
+        CHECK_EQUAL(pollTwiTransfer(&a), TWI_OK);
+        CHECK_EQUAL(first, POWER_BOARD_ID);
+
+        /* A slave left mid-byte holds SDA, the START never happens, and the timeout clocks it free */
+        hostTwiHoldSda(3);
+        uint32_t clocks = hostTwiStats.manualClocks;
+        stops = hostTwiStats.stops;
+        uint64_t start = hostMicros();
+        CHECK_EQUAL(readRegisters(POWER_BOARD_ADDRESS, POWER_REG_VOLTAGE, buf, 2), TWI_TIMEOUT_ERROR);
+        CHECK(hostMicros() - start >= TWI_TIMEOUT * 1000);
+        CHECK(!hostTwiSdaHeld());
+        CHECK_EQUAL(hostTwiStats.manualClocks - clocks, 3 + 1);     // Three to free SDA, one in the STOP
+        CHECK_EQUAL(hostTwiStats.stops, stops + 1);
+        CHECK_EQUAL(TWCR.value, _BV(TWEN));
+        CHECK_EQUAL(hostGetPinMode(SDA), INPUT_PULLUP);
+        CHECK_EQUAL(hostGetPinMode(SCL), INPUT_PULLUP);
+        CHECK_EQUAL(readRegisters(POWER_BOARD_ADDRESS, POWER_REG_VOLTAGE, buf, 2), TWI_OK);
+        CHECK_EQUAL((buf[0] << 8) | buf[1], 10100);
+
+        /* Held past what clocking can free, recovery gives up after TWI_RECOVERY_CLOCKS */
+        hostTwiHoldSda(50);
+        clocks = hostTwiStats.manualClocks;
+        CHECK_EQUAL(readRegisters(POWER_BOARD_ADDRESS, POWER_REG_VOLTAGE, buf, 2), TWI_TIMEOUT_ERROR);
+        CHECK_EQUAL(hostTwiStats.manualClocks - clocks, TWI_RECOVERY_CLOCKS + 1);
+        CHECK(hostTwiSdaHeld());
+        hostTwiHoldSda(0);
+        CHECK_EQUAL(readRegisters(POWER_BOARD_ADDRESS, POWER_REG_VOLTAGE, buf, 2), TWI_OK);
+
+        /* The power board's own measurement and heater, every ADC pin reading the same value */
+        hostAnalogValue = 512;
+        PowerReading measured = {};
+        readBattery(&measured);
+        CHECK_EQUAL(measured.voltage, 2502 * BATTERY_DIVIDER_RATIO);
+        CHECK_EQUAL(measured.current, (2502 - CURRENT_ZERO_MV) * 1000 / CURRENT_MV_PER_A);
+        CHECK(abs(measured.temperature - 2500) < 10);               // Half the supply is the nominal 25 degrees C
+
+        initializeBattery();
+        measured = { 0, 11000, 0, 400 };
+        updateHeater(&measured);
+        CHECK(measured.flags & PB_FLAG_HEATER_ON);
+        CHECK_EQUAL(hostGetPinLevel(HEATER_PIN), HIGH);
+        measured.temperature = 800;                                 // Inside the hysteresis, stays on
+        updateHeater(&measured);
+        CHECK(measured.flags & PB_FLAG_HEATER_ON);
+        measured.temperature = 1100;
+        updateHeater(&measured);
+        CHECK(!(measured.flags & PB_FLAG_HEATER_ON));
+        CHECK_EQUAL(hostGetPinLevel(HEATER_PIN), LOW);
+        measured = { 0, HEATER_MIN_VOLTAGE - 1, 0, 0 };             // Cold, but the pack is flat
+        updateHeater(&measured);
+        CHECK(!(measured.flags & PB_FLAG_HEATER_ON));
+
+        printf("Bus: %lu starts, %lu stops, %lu bytes, %lu us busy, %lu SCL pulses by hand\n", (unsigned long)hostTwiStats.starts,
+            (unsigned long)hostTwiStats.stops, (unsigned long)hostTwiStats.bytes, (unsigned long)hostTwiStats.busyMicros,
+            (unsigned long)hostTwiStats.manualClocks);
+        return hostTestResult();
+    }
@@ -0,0 +1,282 @@
+/*
+*   Purpose :   Wake latency model. LCOM.ino's loop runs over a task table shaped like its own while
+*               host bytes arrive on the UART and frames raise DIO1 at random, once spinning on
+*               runScheduler as it did before idleScheduler and once sleeping between tasks. For
+*               each it reports how long every interrupt waited to be taken, how long readSerial
+*               and readRadio took to get to what it raised, and the MCU's share of time asleep
+*               with the current that works out to by Energy.cpp's figures.
+*
+*               millis() moves on timer 0 overflows here, as on the board, so neither loop can
+*               see a task fall due between ticks. Every idleScheduler call is also checked: it
+*               must not sleep with a task due, and never with interrupts off.
+*/
+
+
+#include "HostTest.h"
+#include "HostArduino.h"
+#include "Energy.h"
+#include "Scheduler.h"
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <vector>
+
+
+/*-------------------------------------------------------------------------*\
+|								  Definitions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    #define MODEL_TASKS                     8
+    #define MODEL_DURATION                  (600ULL * 1000000)      // us simulated per case
+    #define MODEL_LOOP_PASS                 10                      // us, a pass of the loop with nothing due, wdt_reset to idleScheduler's check
+    #define MODEL_UART_MEAN                 50000                   // us between host bytes
+    #define MODEL_RADIO_MEAN                2000000                 // us between received frames
+    #define MODEL_SEED                      48
+
+
+/*-------------------------------------------------------------------------*\
+|								     Types					   			    |
+\*-------------------------------------------------------------------------*/
+
+
+    struct Latencies{
+        std::vector<uint32_t> interrupt;                            // us from the event to its interrupt being taken
+        std::vector<uint32_t> uart;                                 // us from a byte arriving to readSerial reading it
+        std::vector<uint32_t> radio;                                // us from DIO1 to readRadio seeing it
+        uint32_t sleeps;
+        uint32_t sleptWhileDue;
+        uint32_t sleptWithInterruptsOff;
+        double asleep;                                              // Share of the time
+    };
+
+
+/*-------------------------------------------------------------------------*\
+|								   Variables					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /* Execution time of each task (us), as SchedulerBenchmark.cpp */
+    const uint32_t taskCost[MODEL_TASKS] = { 60, 400, 350, 900, 20, 120, 300, 250 };
+
+    /* When each task is next due (ms), kept as the scheduler keeps it */
+    uint32_t nextRun[MODEL_TASKS];
+
+    /* The events, and what is waiting on them */
+    std::mt19937 eventRandom(MODEL_SEED);
+    std::exponential_distribution<double> uartGap(1.0 / MODEL_UART_MEAN);
+    std::exponential_distribution<double> radioGap(1.0 / MODEL_RADIO_MEAN);
+    uint64_t nextUart = 0;
+    uint64_t nextRadio = 0;
+    std::vector<uint64_t> uartArrivals;
+    uint64_t radioArrival = 0;                                      // 0 when DIO1 hasn't been raised
+    Latencies* latencies = NULL;
+
+    template<int N> void modelTask(void);
+    void runFor(uint32_t us);
+
+    /* Periods, deadlines, and priorities as LCOM.ino's task table */
+    const SchedulerTask modelTable[] = {
+        {modelTask<0>,         1,          5,      0},
+        {modelTask<1>,         100,        20,     1},
+        {modelTask<2>,         5,          10,     2},
+        {modelTask<3>,         20,         20,     2},
+        {modelTask<4>,         100,        50,     2},
+        {modelTask<5>,         1000,       100,    3},
+        {modelTask<6>,         5000,       250,    3},
+        {modelTask<7>,         500,        250,    3}
+    };
+    static_assert(sizeof(modelTable)/sizeof(modelTable[0]) == MODEL_TASKS, "One cost per task");
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       modelTask                                                               |
+    |   Purpose:    Moves the task's next run on as runScheduler does, takes its execution  |
+    |               time, and for readSerial and readRadio records how long what they read  |
+    |               had waited.                                                             |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    template<int N> void modelTask(void){
+        uint32_t now = millis();
+        uint32_t late = now - nextRun[N];
+        nextRun[N] = (late >= modelTable[N].period) ? now + modelTable[N].period : nextRun[N] + modelTable[N].period;
+
+        if(N == 0 && Serial.available() > 0){
+            while(Serial.read() >= 0);
+            for(size_t i = 0; i < uartArrivals.size(); i++) latencies->uart.push_back((uint32_t)(hostMicros() - uartArrivals[i]));
+            uartArrivals.clear();
+        }
+        if(N == 1 && radioArrival != 0){
+            latencies->radio.push_back((uint32_t)(hostMicros() - radioArrival));
+            radioArrival = 0;
+        }
+        runFor(taskCost[N]);
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       modelInterrupts                                                         |
+    |   Purpose:    Takes every byte and frame that has arrived, as the UART RX and DIO1    |
+    |               interrupts would, recording how long each waited to be taken.           |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void modelInterrupts(void){
+        uint64_t now = hostMicros();
+        while(nextUart <= now){
+            uint8_t byte = 0x55;
+            hostSerialFeed(&byte, 1);
+            uartArrivals.push_back(nextUart);
+            latencies->interrupt.push_back((uint32_t)(now - nextUart));
+            nextUart += 1 + (uint64_t)uartGap(eventRandom);
+        }
+        while(nextRadio <= now){
+            if(radioArrival == 0) radioArrival = nextRadio;
+            latencies->interrupt.push_back((uint32_t)(now - nextRadio));
+            nextRadio += 1 + (uint64_t)radioGap(eventRandom);
+        }
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       modelNextInterrupt                                                      |
+    |   Purpose:    Returns when the next byte or frame arrives, what ends an idle sleep    |
+    |               before the next tick.                                                   |
+    |   Arguments:  void                                                                    |
+    |   Returns:    uint64_t (us)                                                           |
+    \*-------------------------------------------------------------------------------------*/
+    uint64_t modelNextInterrupt(void){
+        return std::min(nextUart, nextRadio);
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       runFor                                                                  |
+    |   Purpose:    Lets the CPU run for the given time, taking each interrupt as it comes. |
+    |   Arguments:  uint32_t (us)                                                           |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void runFor(uint32_t us){
+        uint64_t end = hostMicros() + us;
+        while(modelNextInterrupt() < end){
+            hostSetMicros(std::max(hostMicros(), modelNextInterrupt()));
+            interrupts();
+        }
+        hostSetMicros(end);
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       anyTaskDue                                                              |
+    |   Purpose:    Returns whether a task is due now.                                      |
+    |   Arguments:  void                                                                    |
+    |   Returns:    bool                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    bool anyTaskDue(void){
+        uint32_t now = millis();
+        for(int i = 0; i < MODEL_TASKS; i++){
+            if((int32_t)(now - nextRun[i]) >= 0) return true;
+        }
+        return false;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       percentile                                                              |
+    |   Purpose:    Returns the given percentile of the samples.                            |
+    |   Arguments:  std::vector<uint32_t> (copied to sort), int                             |
+    |   Returns:    uint32_t                                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint32_t percentile(std::vector<uint32_t> samples, int p){
+        if(samples.empty()) return 0;
+        std::sort(samples.begin(), samples.end());
+        return samples[std::min(samples.size() - 1, samples.size() * p / 100)];
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       runCase                                                                 |
+    |   Purpose:    Runs the loop for MODEL_DURATION from the same events, spinning or      |
+    |               sleeping between tasks, and prints what it measured.                    |
+    |   Arguments:  const char*, bool (sleep), Latencies&                                   |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void runCase(const char* name, bool sleep, Latencies& result){
+        hostSetMicros(0);
+        eventRandom.seed(MODEL_SEED);
+        nextUart = (uint64_t)uartGap(eventRandom);
+        nextRadio = (uint64_t)radioGap(eventRandom);
+        uartArrivals.clear();
+        radioArrival = 0;
+        while(Serial.read() >= 0);
+        latencies = &result;
+        hostSleep.sleeps = 0;
+        hostSleep.sleepsWithInterruptsOff = 0;
+
+        CHECK_EQUAL(initializeScheduler(modelTable, MODEL_TASKS), SCHEDULER_OK);
+        for(int i = 0; i < MODEL_TASKS; i++) nextRun[i] = millis();
+        EnergyStatus before = getEnergyStatus();
+
+        while(hostMicros() < MODEL_DURATION){
+            runFor(MODEL_LOOP_PASS);
+            runScheduler();
+            if(!sleep) continue;
+
+            bool due = anyTaskDue();
+            uint32_t sleeps = hostSleep.sleeps;
+            idleScheduler();
+            if(due && hostSleep.sleeps != sleeps) result.sleptWhileDue++;
+        }
+
+        EnergyStatus after = getEnergyStatus();
+        result.sleeps = hostSleep.sleeps;
+        result.sleptWithInterruptsOff = hostSleep.sleepsWithInterruptsOff;
+        result.asleep = (double)(after.mcuIdleTime - before.mcuIdleTime) / (after.uptime - before.uptime);
+        double current = ENERGY_MCU_ACTIVE_CURRENT * (1 - result.asleep) + ENERGY_MCU_IDLE_CURRENT * result.asleep;
+
+        printf("%s: %lu sleeps, %.1f %% asleep, MCU about %.2f mA\n", name, (unsigned long)result.sleeps, 100 * result.asleep, current / 10);
+        printf("  interrupt taken   mean %7.1f us   p99 %6u us   worst %6u us   (%lu)\n",
+            result.interrupt.empty() ? 0.0 : std::accumulate(result.interrupt.begin(), result.interrupt.end(), 0.0) / result.interrupt.size(),
+            percentile(result.interrupt, 99), percentile(result.interrupt, 100), (unsigned long)result.interrupt.size());
+        printf("  readSerial        mean %7.1f us   p99 %6u us   worst %6u us   (%lu)\n",
+            result.uart.empty() ? 0.0 : std::accumulate(result.uart.begin(), result.uart.end(), 0.0) / result.uart.size(),
+            percentile(result.uart, 99), percentile(result.uart, 100), (unsigned long)result.uart.size());
+        printf("  readRadio         mean %7.1f us   p99 %6u us   worst %6u us   (%lu)\n\n",
+            result.radio.empty() ? 0.0 : std::accumulate(result.radio.begin(), result.radio.end(), 0.0) / result.radio.size(),
+            percentile(result.radio, 99), percentile(result.radio, 100), (unsigned long)result.radio.size());
+    }
+
+
+/*-------------------------------------------------------------------------*\
+|								     Main					   			    |
+\*-------------------------------------------------------------------------*/
+
+
+    int main(void){
+        hostClockStepMicros = 0;
+        hostMillisTicks = true;
+        hostInterruptSource = modelInterrupts;
+        hostNextInterrupt = modelNextInterrupt;
+
+        Latencies spin, idle;
+        runCase("Spinning", false, spin);
+        runCase("Sleeping between tasks", true, idle);
+
+        /* The same events were served either way */
+        CHECK_EQUAL(idle.uart.size(), spin.uart.size());
+        CHECK_EQUAL(idle.radio.size(), spin.radio.size());
+
+        /* Asleep most of the time, never with work due or with no way to wake */
+        CHECK(idle.asleep > 0.5);
+        CHECK_EQUAL(idle.sleptWhileDue, 0);
+        CHECK_EQUAL(idle.sleptWithInterruptsOff, 0);
+        CHECK_EQUAL(spin.sleeps, 0);
+
+        /* No later for it: an interrupt wakes the sleep at once, and the tasks see what it raised no later than spinning */
+        CHECK(percentile(idle.interrupt, 100) <= percentile(spin.interrupt, 100));
+        CHECK(percentile(idle.uart, 99) <= percentile(spin.uart, 99) + MODEL_LOOP_PASS);
+        CHECK(percentile(idle.uart, 100) <= percentile(spin.uart, 100) + MODEL_LOOP_PASS);
+        CHECK(percentile(idle.radio, 100) <= percentile(spin.radio, 100) + MODEL_LOOP_PASS);
+
+        return hostTestResult();
+    }
@@ -0,0 +1,85 @@
+#include "Battery.h"
+
+
+/*-------------------------------------------------------------------------*\
+|								   Variables					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    bool heaterOn = false;
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       readMillivolts                                                          |
+    |   Purpose:    Averages ADC_OVERSAMPLE conversions of a pin.                           |
+    |   Arguments:  uint8_t                                                                 |
+    |   Returns:    uint16_t (mV at the pin)                                                |
+    \*-------------------------------------------------------------------------------------*/
+    uint16_t readMillivolts(uint8_t pin){
+        uint32_t sum = 0;
+        for(uint8_t i = 0; i != ADC_OVERSAMPLE; i++) sum += analogRead(pin);
+        return sum * ADC_REFERENCE_MV / ((uint32_t)ADC_MAX_VALUE * ADC_OVERSAMPLE);
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       thermistorTemperature                                                   |
+    |   Purpose:    Converts the thermistor divider's voltage with the beta equation.       |
+    |   Arguments:  uint16_t (mV)                                                           |
+    |   Returns:    int16_t (0.01 degrees C)                                                |
+    \*-------------------------------------------------------------------------------------*/
+    int16_t thermistorTemperature(uint16_t mv){
+        if(mv == 0 || mv >= ADC_REFERENCE_MV) return INT16_MIN;            // Shorted or open
+        double ohms = (double)THERMISTOR_SERIES_OHM * mv / (ADC_REFERENCE_MV - mv);
+        double kelvin = 1.0 / (1.0 / KELVIN_AT_25C + log(ohms / THERMISTOR_NOMINAL_OHM) / THERMISTOR_BETA);
+        return (int16_t)lround((kelvin - 273.15) * 100);
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       initializeBattery                                                       |
+    |   Purpose:    Sets up the sensor pins, with the heater off.                           |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void initializeBattery(void){
+        pinMode(BATTERY_VOLTAGE_PIN, INPUT);
+        pinMode(BATTERY_CURRENT_PIN, INPUT);
+        pinMode(BATTERY_THERMISTOR_PIN, INPUT);
+        digitalWrite(HEATER_PIN, LOW);
+        pinMode(HEATER_PIN, OUTPUT);
+        heaterOn = false;
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       readBattery                                                             |
+    |   Purpose:    Measures the pack's voltage, current, and temperature into the reading, |
+    |               leaving its flags alone.                                                |
+    |   Arguments:  PowerReading*                                                           |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void readBattery(PowerReading* reading){
+        reading->voltage = readMillivolts(BATTERY_VOLTAGE_PIN) * BATTERY_DIVIDER_RATIO;
+        reading->current = ((int32_t)readMillivolts(BATTERY_CURRENT_PIN) - CURRENT_ZERO_MV) * 1000 / CURRENT_MV_PER_A;
+        reading->temperature = thermistorTemperature(readMillivolts(BATTERY_THERMISTOR_PIN));
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       updateHeater                                                            |
+    |   Purpose:    Switches the heater from a fresh reading, and flags whether it's on.    |
+    |               A failed thermistor leaves it off rather than heating blind.            |
+    |   Arguments:  PowerReading*                                                           |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void updateHeater(PowerReading* reading){
+        if(reading->temperature == INT16_MIN || reading->voltage < HEATER_MIN_VOLTAGE) heaterOn = false;
+        else if(reading->temperature < HEATER_ON_TEMPERATURE) heaterOn = true;
+        else if(reading->temperature > HEATER_OFF_TEMPERATURE) heaterOn = false;
+
+        digitalWrite(HEATER_PIN, heaterOn ? HIGH : LOW);
+        if(heaterOn) reading->flags |= PB_FLAG_HEATER_ON;
+        else reading->flags &= ~PB_FLAG_HEATER_ON;
+    }
@@ -0,0 +1,99 @@
+#ifndef INC_BATTERY_H_
+#define INC_BATTERY_H_
+
+#include <Arduino.h>
+#include "PowerRegisters.h"
+
+
+/*-------------------------------------------------------------------------*\
+|								  Definitions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*
+     * The 3S pack's voltage through a divider, its current through a bidirectional hall sensor centred
+     * on half the supply, and its temperature from an NTC thermistor taped to the cells, which a heater
+     * pad keeps above freezing. The board has no schematic in the repo yet, so the pins and scaling are
+     * build flags, set for a 30k/10k divider, an ACS712-05B, and a 10k NTC.
+     */
+
+    /* Pins */
+    #ifndef BATTERY_VOLTAGE_PIN
+        #define BATTERY_VOLTAGE_PIN         A0
+    #endif
+    #ifndef BATTERY_CURRENT_PIN
+        #define BATTERY_CURRENT_PIN         A1
+    #endif
+    #ifndef BATTERY_THERMISTOR_PIN
+        #define BATTERY_THERMISTOR_PIN      A2
+    #endif
+    #ifndef HEATER_PIN
+        #define HEATER_PIN                  9                       // Gate of the heater pad's MOSFET
+    #endif
+
+    /* Scaling */
+    #define ADC_MAX_VALUE                   1023
+    #define ADC_OVERSAMPLE                  16                      // Conversions averaged per reading
+    #ifndef ADC_REFERENCE_MV
+        #define ADC_REFERENCE_MV            5000                    // AVcc
+    #endif
+    #ifndef BATTERY_DIVIDER_RATIO
+        #define BATTERY_DIVIDER_RATIO       4                       // 30k over 10k, 12.6 V full reads 3.15 V
+    #endif
+    #ifndef CURRENT_ZERO_MV
+        #define CURRENT_ZERO_MV             2500                    // Sensor output at 0 A
+    #endif
+    #ifndef CURRENT_MV_PER_A
+        #define CURRENT_MV_PER_A            185                     // ACS712-05B
+    #endif
+
+    /* Thermistor, NTC to ground under a series resistor to AVcc */
+    #define THERMISTOR_SERIES_OHM           10000
+    #define THERMISTOR_NOMINAL_OHM          10000                   // At 25 degrees C
+    #define THERMISTOR_BETA                 3950
+    #define KELVIN_AT_25C                   298.15
+
+    /* Heater, on below the first temperature, off above the second, and never on a flat pack */
+    #ifndef HEATER_ON_TEMPERATURE
+        #define HEATER_ON_TEMPERATURE       500                     // 0.01 degrees C
+    #endif
+    #ifndef HEATER_OFF_TEMPERATURE
+        #define HEATER_OFF_TEMPERATURE      1000
+    #endif
+    #ifndef HEATER_MIN_VOLTAGE
+        #define HEATER_MIN_VOLTAGE          10200                   // mV, L-COM's critical level
+    #endif
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       initializeBattery                                                       |
+    |   Purpose:    Sets up the sensor pins, with the heater off.                           |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void initializeBattery(void);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       readBattery                                                             |
+    |   Purpose:    Measures the pack's voltage, current, and temperature into the reading, |
+    |               leaving its flags alone.                                                |
+    |   Arguments:  PowerReading*                                                           |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void readBattery(PowerReading* reading);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       updateHeater                                                            |
+    |   Purpose:    Switches the heater from a fresh reading, and flags whether it's on.    |
+    |               A failed thermistor leaves it off rather than heating blind.            |
+    |   Arguments:  PowerReading*                                                           |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void updateHeater(PowerReading* reading);
+
+#endif /* INC_BATTERY_H_ */
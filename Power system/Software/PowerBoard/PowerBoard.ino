@@ -0,0 +1,67 @@
+/*
+*   Purpose :   This software runs the power board, the second ATmega328P on the L-COM stack. It measures the battery, runs its heater, and answers L-COM's register reads over I2C (see PowerRegisters.h).
+*/
+
+/*-------------------------------------------------------------------------*\
+|                                  Includes                                 |
+\*-------------------------------------------------------------------------*/
+
+
+    #include <avr/wdt.h>
+    #include "Battery.h"
+    #include "PowerRegisters.h"
+
+
+/*-------------------------------------------------------------------------*\
+|                                 Definitions                               |
+\*-------------------------------------------------------------------------*/
+
+
+    #define MEASURE_PERIOD          250                     // ms, L-COM polls once a second
+
+
+/*-------------------------------------------------------------------------*\
+|                                  Variables                                |
+\*-------------------------------------------------------------------------*/
+
+
+    PowerReading reading = {};
+    uint32_t lastMeasureMillis = 0;
+
+
+/*-------------------------------------------------------------------------*\
+|                                    Setup                                  |
+\*-------------------------------------------------------------------------*/
+
+
+    void setup(){
+        wdt_enable(WDTO_4S);
+
+        // Heater off before anything else
+        initializeBattery();
+
+        // Take a first reading before answering, so L-COM never sees an empty register file
+        readBattery(&reading);
+        updateHeater(&reading);
+        publishPowerReading(reading);
+
+        initializePowerRegisters();
+        lastMeasureMillis = millis();
+    }
+
+
+/*-------------------------------------------------------------------------*\
+|                                    Main                                   |
+\*-------------------------------------------------------------------------*/
+
+
+    void loop(){
+        wdt_reset();
+
+        if(millis() - lastMeasureMillis >= MEASURE_PERIOD){
+            lastMeasureMillis += MEASURE_PERIOD;
+            readBattery(&reading);
+            updateHeater(&reading);
+            publishPowerReading(reading);
+        }
+    }
@@ -0,0 +1,79 @@
+#include "PowerRegisters.h"
+#include <util/atomic.h>
+#include <Wire.h>
+
+
+/*-------------------------------------------------------------------------*\
+|								   Variables					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /* The register file as L-COM reads it, and where its next read starts */
+    uint8_t powerRegisterFile[PB_REGISTERS_LEN] = { PB_ID };
+    volatile uint8_t powerRegisterPointer = PB_REG_ID;
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       receivePowerRegisters                                                   |
+    |   Purpose:    Wire receive handler. The first byte is the register the next read      |
+    |               starts at, the rest are dropped.                                        |
+    |   Arguments:  int (bytes received)                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void receivePowerRegisters(int count){
+        if(Wire.available()) powerRegisterPointer = Wire.read();
+        while(Wire.available()) Wire.read();
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       requestPowerRegisters                                                   |
+    |   Purpose:    Wire request handler. Queues every register from the pointer on, the    |
+    |               master takes as many as it wants.                                       |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void requestPowerRegisters(void){
+        uint8_t first = powerRegisterPointer;
+        if(first < PB_REGISTERS_LEN) Wire.write(powerRegisterFile + first, PB_REGISTERS_LEN - first);
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       initializePowerRegisters                                                |
+    |   Purpose:    Joins the bus as a slave at PB_I2C_ADDRESS. Until the first reading is  |
+    |               published every register but the ID reads 0.                            |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void initializePowerRegisters(void){
+        Wire.begin(PB_I2C_ADDRESS);
+        Wire.onReceive(receivePowerRegisters);
+        Wire.onRequest(requestPowerRegisters);
+    }
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       publishPowerReading                                                     |
+    |   Purpose:    Replaces the registers with a new reading. The Wire handlers run in     |
+    |               the TWI interrupt, so a read sees all of the old one or all of the new. |
+    |   Arguments:  const PowerReading&                                                     |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void publishPowerReading(const PowerReading& reading){
+        uint8_t file[PB_REGISTERS_LEN];
+        file[PB_REG_ID] = PB_ID;
+        file[PB_REG_FLAGS] = reading.flags;
+        file[PB_REG_VOLTAGE] = reading.voltage >> 8;
+        file[PB_REG_VOLTAGE + 1] = reading.voltage;
+        file[PB_REG_CURRENT] = (uint16_t)reading.current >> 8;
+        file[PB_REG_CURRENT + 1] = reading.current;
+        file[PB_REG_TEMPERATURE] = (uint16_t)reading.temperature >> 8;
+        file[PB_REG_TEMPERATURE + 1] = reading.temperature;
+
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+            memcpy(powerRegisterFile, file, PB_REGISTERS_LEN);
+        }
+    }
@@ -0,0 +1,70 @@
+#ifndef INC_POWERREGISTERS_H_
+#define INC_POWERREGISTERS_H_
+
+#include <Arduino.h>
+
+
+/*-------------------------------------------------------------------------*\
+|								  Definitions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*
+     * The power board is an I2C slave on the L-COM stack's bus. L-COM writes a register number, then
+     * reads from there on in one transfer; the registers are read-only, anything written after the
+     * number is dropped. This map is the contract with L-COM's PowerBoard.h: multi-byte registers are
+     * big-endian, and a read past the last register gets 0xFF.
+     */
+
+    /* Registers */
+    #define PB_I2C_ADDRESS                  0x30
+    #define PB_REG_ID                       0x00                    // Reads PB_ID
+    #define PB_REG_FLAGS                    0x01                    // PB_FLAG_*
+    #define PB_REG_VOLTAGE                  0x02                    // U16, battery mV
+    #define PB_REG_CURRENT                  0x04                    // I16, mA drawn from the battery, negative while charging
+    #define PB_REG_TEMPERATURE              0x06                    // I16, battery pack 0.01 degrees C
+    #define PB_REGISTERS_LEN                8
+    #define PB_ID                           0x50
+
+    /* Flags */
+    #define PB_FLAG_HEATER_ON               0x01
+
+
+/*-------------------------------------------------------------------------*\
+|								     Types					   			    |
+\*-------------------------------------------------------------------------*/
+
+
+    /* One set of readings, published to the registers together */
+    struct PowerReading{
+        uint8_t flags;
+        uint16_t voltage;                                   // mV
+        int16_t current;                                    // mA
+        int16_t temperature;                                // 0.01 degrees C
+    };
+
+
+/*-------------------------------------------------------------------------*\
+|								   Functions					   			|
+\*-------------------------------------------------------------------------*/
+
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       initializePowerRegisters                                                |
+    |   Purpose:    Joins the bus as a slave at PB_I2C_ADDRESS. Until the first reading is  |
+    |               published every register but the ID reads 0.                            |
+    |   Arguments:  void                                                                    |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void initializePowerRegisters(void);
+
+    /*-------------------------------------------------------------------------------------*\
+    |   Name:       publishPowerReading                                                     |
+    |   Purpose:    Replaces the registers with a new reading. The Wire handlers run in     |
+    |               the TWI interrupt, so a read sees all of the old one or all of the new. |
+    |   Arguments:  const PowerReading&                                                     |
+    |   Returns:    void                                                                    |
+    \*-------------------------------------------------------------------------------------*/
+    void publishPowerReading(const PowerReading& reading);
+
+#endif /* INC_POWERREGISTERS_H_ */